@@ -0,0 +1,35 @@
+/**
+ * @file bench_headless.c
+ * @brief renders the demo scene offscreen for a fixed number of frames and
+ * reports frame time statistics. Needs no window system, so it can run in
+ * CI: `sls-bench [frames] [width] [height]`
+ *
+ * With SLS_GL_NULL=1 no GPU is needed either. Combine it with
+ * SLS_GL_CAPTURE=frames.slsgl, and inspect the log with sls-glstat.
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+#include <dangerengine.h>
+#include <renderer/slsglnull.h>
+
+
+int main(int argc, char** argv)
+{
+  long n_frames = argc > 1 ? strtol(argv[1], NULL, 10) : 1000;
+  size_t width = argc > 2 ? strtoul(argv[2], NULL, 10) : 1280;
+  size_t height = argc > 3 ? strtoul(argv[3], NULL, 10) : 720;
+
+  if (!sls_headless_available() && !sls_glnull_requested()) {
+    sls_log_err("this build has no headless support");
+    return EXIT_FAILURE;
+  }
+
+  slsContext* ctx = sls_context_new_headless(width, height, n_frames);
+  if (!ctx) {
+    return EXIT_FAILURE;
+  }
+  sls_context_run(ctx);
+  free(sls_context_dtor(ctx));
+  return 0;
+}
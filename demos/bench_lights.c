@@ -0,0 +1,87 @@
+/**
+ * @file bench_lights.c
+ * @brief bins random point lights into a clustered light grid and reports
+ * the time per frame, on the calling thread and on the job queue. Needs no
+ * GPU: `sls-bench-lights [lights] [frames] [threads]`
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+#include <dangerengine.h>
+#include <renderer/slslightgrid.h>
+#include <slsjobs.h>
+
+static float bench_random(float min, float max)
+{
+  return min + (max - min) * (float)rand() / (float)RAND_MAX;
+}
+
+/**
+ * @return average milliseconds per frame
+ */
+static double bench_bin(slsLightGrid* grid, slsJobQueue* jobs, long n_frames)
+{
+  double tick_ms = 1000.0 / (double)SDL_GetPerformanceFrequency();
+  uint64_t start = SDL_GetPerformanceCounter();
+  for (long frame = 0; frame < n_frames; ++frame) {
+    // pan the camera, so frames bin differently
+    kmMat4 view;
+    kmMat4Identity(&view);
+    view.mat[12] = (float)(frame % 20) - 10.f;
+    if (!sls_lightgrid_bin(grid, &view, jobs)) {
+      return -1.0;
+    }
+  }
+  return (double)(SDL_GetPerformanceCounter() - start) * tick_ms /
+         (double)(n_frames > 0 ? n_frames : 1);
+}
+
+int main(int argc, char** argv)
+{
+  size_t n_lights = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000;
+  long n_frames = argc > 2 ? strtol(argv[2], NULL, 10) : 200;
+  size_t n_threads = argc > 3 ? strtoul(argv[3], NULL, 10) : 0;
+
+  slsLightGrid grid;
+  if (!sls_lightgrid_init(&grid, &SLS_LIGHTGRID_DEFAULT_PARAMS) ||
+      !grid.cells) {
+    return EXIT_FAILURE;
+  }
+  kmMat4 projection;
+  kmMat4PerspectiveProjection(&projection, 60.f, 16.f / 9.f, 0.1f, 1000.f);
+  sls_lightgrid_set_projection(&grid, &projection, 1280, 720);
+
+  srand(1);
+  for (size_t i = 0; i < n_lights; ++i) {
+    kmVec3 position = { bench_random(-60.f, 60.f),
+                        bench_random(-30.f, 30.f),
+                        bench_random(-150.f, -1.f) };
+    kmVec3 color = { bench_random(0.f, 1.f),
+                     bench_random(0.f, 1.f),
+                     bench_random(0.f, 1.f) };
+    sls_lightgrid_add(&grid, position, bench_random(1.f, 8.f), color);
+  }
+
+  slsJobQueue jobs;
+  if (!sls_jobqueue_init(&jobs, n_threads)) {
+    sls_lightgrid_dtor(&grid);
+    return EXIT_FAILURE;
+  }
+
+  double serial_ms = bench_bin(&grid, NULL, n_frames);
+  double parallel_ms = bench_bin(&grid, &jobs, n_frames);
+
+  printf("lights: %zu, visible: %zu, indices: %zu, most per cell: %u\n",
+         grid.stats.n_lights,
+         grid.stats.n_visible,
+         grid.stats.n_indices,
+         grid.stats.max_per_cell);
+  printf("binning: %.3f ms on one thread, %.3f ms with %zu workers\n",
+         serial_ms,
+         parallel_ms,
+         jobs.n_threads);
+
+  sls_jobqueue_dtor(&jobs);
+  sls_lightgrid_dtor(&grid);
+  return 0;
+}
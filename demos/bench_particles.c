@@ -0,0 +1,97 @@
+/**
+ * @file bench_particles.c
+ * @brief simulates a particle system holding a steady population and
+ * reports the time per frame to update it and write its vertices, on the
+ * calling thread and on the job queue. Needs no GPU:
+ * `sls-bench-particles [particles] [frames] [threads]`
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+#include <dangerengine.h>
+#include <renderer/slsparticles.h>
+#include <slsjobs.h>
+
+#define BENCH_DT (1.f / 60.f)
+
+typedef struct benchTimes {
+  double update_ms;
+  double vertices_ms;
+} benchTimes;
+
+/**
+ * @return average milliseconds per frame of each stage
+ */
+static benchTimes bench_frames(slsParticleSystem* particles,
+                               slsParticleVertex* vertices,
+                               slsJobQueue* jobs,
+                               long n_frames)
+{
+  double tick_ms = 1000.0 / (double)SDL_GetPerformanceFrequency();
+  uint64_t update_ticks = 0, vertices_ticks = 0;
+  for (long frame = 0; frame < n_frames; ++frame) {
+    uint64_t start = SDL_GetPerformanceCounter();
+    sls_particles_update(particles, BENCH_DT, jobs);
+    uint64_t updated = SDL_GetPerformanceCounter();
+    sls_particles_write_vertices(particles, vertices, jobs);
+    update_ticks += updated - start;
+    vertices_ticks += SDL_GetPerformanceCounter() - updated;
+  }
+  double frames = (double)(n_frames > 0 ? n_frames : 1);
+  return (benchTimes){ (double)update_ticks * tick_ms / frames,
+                       (double)vertices_ticks * tick_ms / frames };
+}
+
+int main(int argc, char** argv)
+{
+  size_t n_particles = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+  long n_frames = argc > 2 ? strtol(argv[2], NULL, 10) : 200;
+  size_t n_threads = argc > 3 ? strtoul(argv[3], NULL, 10) : 0;
+
+  // spawning the population once per average lifetime keeps it steady
+  slsParticleEmitter emitter = SLS_PARTICLES_DEFAULT_EMITTER;
+  emitter.extent = (kmVec3){ 10.f, 1.f, 10.f };
+  emitter.rate = (float)n_particles /
+                 (0.5f * (emitter.lifetime_min + emitter.lifetime_max));
+
+  slsParticleSystem particles;
+  if (!sls_particles_init(&particles, &emitter, n_particles) ||
+      !particles.px) {
+    return EXIT_FAILURE;
+  }
+  slsParticleVertex* vertices =
+    calloc(particles.capacity, sizeof(slsParticleVertex));
+  slsJobQueue jobs;
+  if (!vertices || !sls_jobqueue_init(&jobs, n_threads)) {
+    free(vertices);
+    sls_particles_dtor(&particles);
+    return EXIT_FAILURE;
+  }
+
+  // run past the longest lifetime, so particles are dying as fast as
+  // they spawn
+  long n_warmup = (long)(emitter.lifetime_max / BENCH_DT) + 1;
+  bench_frames(&particles, vertices, &jobs, n_warmup);
+
+  benchTimes serial = bench_frames(&particles, vertices, NULL, n_frames);
+  benchTimes parallel = bench_frames(&particles, vertices, &jobs, n_frames);
+
+  printf("particles: %zu alive of %zu, %zu spawned and %zu died per frame\n",
+         particles.stats.n_alive,
+         particles.capacity,
+         particles.stats.n_spawned,
+         particles.stats.n_died);
+  printf("update: %.3f ms on one thread, %.3f ms with %zu workers\n",
+         serial.update_ms,
+         parallel.update_ms,
+         jobs.n_threads);
+  printf("vertices: %.3f ms on one thread, %.3f ms with %zu workers\n",
+         serial.vertices_ms,
+         parallel.vertices_ms,
+         jobs.n_threads);
+
+  sls_jobqueue_dtor(&jobs);
+  free(vertices);
+  sls_particles_dtor(&particles);
+  return 0;
+}
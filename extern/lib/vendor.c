@@ -7,4 +7,8 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
-#pragma clang diagnostic pop
\ No newline at end of file
+#define NK_IMPLEMENTATION
+#define NK_SDL_GL3_IMPLEMENTATION
+#include <sls-uilib.h>
+
+#pragma clang diagnostic pop
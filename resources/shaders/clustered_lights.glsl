@@ -0,0 +1,64 @@
+#line 0 0
+/**
+ * @file clustered_lights.glsl
+ * @brief point lights binned by slsLightGrid (src/renderer/slslightgrid.h).
+ * Needs buffer textures, GLSL 1.40 or later.
+ * @license FreeBSD
+ **/
+
+/** (offset, count) in cluster_indices of each cell */
+uniform usamplerBuffer cluster_cells;
+uniform usamplerBuffer cluster_indices;
+/** two texels per light: view space position and radius, then color */
+uniform samplerBuffer cluster_lights;
+
+uniform ivec3 cluster_dims;
+/** tile size in pixels */
+uniform vec2 cluster_tile_size;
+/** near, far, and slices per unit of log depth */
+uniform vec3 cluster_depth;
+
+/**
+ * diffuse and specular light of the cell containing the fragment, in view
+ * space, with a falloff reaching zero at each light's radius
+ */
+vec3 sls_clustered_lighting(vec2 frag_coord,
+                            vec3 view_pos,
+                            vec3 normal,
+                            vec3 diffuse,
+                            vec3 specular,
+                            float shininess)
+{
+  float depth = -view_pos.z;
+  if (depth < cluster_depth.x || depth > cluster_depth.y) {
+    return vec3(0.0);
+  }
+  int slice = int(floor(log(depth / cluster_depth.x) * cluster_depth.z));
+  slice = clamp(slice, 0, cluster_dims.z - 1);
+  ivec2 tile = clamp(ivec2(frag_coord / cluster_tile_size),
+                     ivec2(0),
+                     cluster_dims.xy - 1);
+  int cell = (slice * cluster_dims.y + tile.y) * cluster_dims.x + tile.x;
+  uvec2 range = texelFetch(cluster_cells, cell).xy;
+
+  vec3 eye = normalize(-view_pos);
+  vec3 total = vec3(0.0);
+  for (uint i = 0u; i < range.y; ++i) {
+    int light = int(texelFetch(cluster_indices, int(range.x + i)).x);
+    vec4 position = texelFetch(cluster_lights, 2 * light);
+    vec3 color = texelFetch(cluster_lights, 2 * light + 1).rgb;
+
+    vec3 to_light = position.xyz - view_pos;
+    float dist = length(to_light);
+    float falloff = clamp(1.0 - dist / position.w, 0.0, 1.0);
+    falloff *= falloff;
+
+    vec3 l = to_light / max(dist, 1e-4);
+    float n_dot_l = max(dot(normal, l), 0.0);
+    float spec = n_dot_l > 0.0
+                   ? pow(max(dot(normal, normalize(l + eye)), 0.0), shininess)
+                   : 0.0;
+    total += color * falloff * (diffuse * n_dot_l + specular * spec);
+  }
+  return total;
+}
@@ -5,6 +5,8 @@
  * @license FreeBSD
  **/
 
+// lights every fragment loops over. For more, bin them with slsLightGrid
+// and shade with clustered_lights.glsl
 #define SLS_N_LIGHTS 8
 
 uniform mat4 projection;
@@ -18,7 +20,9 @@ uniform sampler2D diffuse_tex;
 uniform sampler2D specular_tex;
 uniform sampler2D normal_tex;
 
-uniform Material {
+// std140 blocks, mirrored in C by slsMaterialBlock and slsLightsBlock
+// (src/renderer/slsuniformbuffer.h). Keep the two in sync.
+layout(std140) uniform Material {
   vec3 specular_color;
   vec3 diffuse_color;
   vec3 ambient_color;
@@ -26,13 +30,11 @@ uniform Material {
   float shininess;
 } material;
 
-struct Lights {
+layout(std140) uniform Lights {
   int n_lights;
   vec3 ambient_products[SLS_N_LIGHTS];
   vec3 diffuse_products[SLS_N_LIGHTS];
   vec3 specular_products[SLS_N_LIGHTS];
   vec4 light_positions[SLS_N_LIGHTS];
   mat4 light_modelview[SLS_N_LIGHTS];
-};
-
-uniform Lights lights;
+} lights;
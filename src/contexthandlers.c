@@ -51,13 +51,11 @@ sls_init_sdl(uint32_t sdl_flags)
 }
 
 
-bool
-sls_init(void)
+static bool
+sls_init_flags(uint32_t sdl_flags)
 {
   sls_check(!sls_active_flag, "runtime is already active!");
 
-  uint32_t sdl_flags = SDL_INIT_EVERYTHING;
-
   sls_check(sls_init_sdl(sdl_flags), "sdl creation failed %s", SDL_GetError());
 
   sls_active_flag = true;
@@ -72,6 +70,19 @@ error : {
 }
 }
 
+bool
+sls_init(void)
+{
+  return sls_init_flags(SDL_INIT_EVERYTHING);
+}
+
+bool
+sls_init_headless(void)
+{
+  // video would fail without a display server
+  return sls_init_flags(SDL_INIT_TIMER | SDL_INIT_EVENTS);
+}
+
 void
 sls_terminate(void)
 {
@@ -18,6 +18,13 @@
 bool
 sls_init(void);
 
+/**
+ * @brief initializes runtime libraries without video, for headless
+ * contexts
+ */
+bool
+sls_init_headless(void);
+
 /**
  * @brief terminates runtime libraries
  */
@@ -55,6 +55,7 @@
 #include "sls-gl.h"
 #include "sls-imagelib.h"
 #include "slscontext.h"
+#include "slsheadless.h"
 
 
 #endif // DANGERENGINE_DANGERENGINE_H
@@ -15,5 +15,6 @@ SLS_BEGIN_CDECLS
 #include "hashtable.h"
 #include "linkedlist.h"
 #include "ptrarray.h"
+#include "rangeset.h"
 SLS_END_CDECLS
 #endif // DANGERENGINE_DATA_TYPES_H
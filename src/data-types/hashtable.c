@@ -86,7 +86,7 @@ slsHashTable* sls_hashtable_init(slsHashTable* self,
     self->key_callbacks.cmp_fn = sls_cmp_voidptr;
   }
   if (!self->val_callbacks.cmp_fn) {
-    self->key_callbacks.cmp_fn = sls_cmp_voidptr;
+    self->val_callbacks.cmp_fn = sls_cmp_voidptr;
   }
 
   if (!hash_fn) {
@@ -136,12 +136,36 @@ slsHashTable* sls_hashtable_dtor(slsHashTable* self)
   return self;
 }
 
+/**
+ * @brief stores already-owned key and value pointers in the first free
+ * slot of the probe sequence. The slot count must exceed the entry count.
+ */
+static void sls_hashtable_place(slsHashTable* self,
+                                void* key,
+                                void* val,
+                                uint64_t hash)
+{
+  for (size_t i = 0; i < self->array_size; ++i) {
+    size_t idx = (hash + i) % self->array_size;
+    if (!self->keys[idx]) {
+      self->keys[idx] = key;
+      self->vals[idx] = val;
+      self->hashes[idx] = hash;
+      return;
+    }
+  }
+  assert(!"hash table is full");
+}
+
 void sls_hashtable_reserve(slsHashTable* self, size_t n_items)
 {
 
-  if (n_items < self->n_entries) {
+  if (n_items <= self->n_entries) {
     n_items = self->n_entries * 2;
   }
+  if (n_items == 0) {
+    n_items = 1;
+  }
 
   size_t old_size = self->array_size;
 
@@ -159,11 +183,18 @@ void sls_hashtable_reserve(slsHashTable* self, size_t n_items)
   sls_checkmem(self->hashes);
   sls_checkmem(self->keys);
   sls_checkmem(self->vals);
+  self->array_size = n_items;
 
-  for (int i = 0; i < old_size; ++i) {
-    if (keys[i] && vals[i] && !sls_is_hash_sentinel(keys[i]))
-      sls_hashtable_insert_with_hash(self, keys[i], vals[i], hashes[i]);
+  // entries are moved, not copied: the table already owns them
+  for (size_t i = 0; i < old_size; ++i) {
+    if (keys[i] && !sls_is_hash_sentinel(keys[i])) {
+      sls_hashtable_place(self, keys[i], vals[i], hashes[i]);
+    }
   }
+
+  free(hashes);
+  free(keys);
+  free(vals);
   return;
 
 error:
@@ -186,45 +217,45 @@ void const* sls_hashtable_insert_with_hash(slsHashTable* self,
                                            uint64_t hash)
 {
 
-  if (self->n_entries == self->array_size) {
+  // keep the load factor under 3/4 so probe sequences stay short and
+  // always reach a free slot
+  if ((self->n_entries + 1) * 4 > self->array_size * 3) {
     sls_hashtable_reserve(self, self->array_size * 2);
   }
 
-  bool inserted = false;
-
   void* val_res = NULL;
 
-  for (size_t i = 0; !inserted; ++i) {
-    size_t probe = hash + (i * i);
-    size_t idx = probe % self->array_size;
+  for (size_t i = 0; i < self->array_size; ++i) {
+    size_t idx = (hash + i) % self->array_size;
     void** k_itor = self->keys + idx;
     void** v_itor = self->vals + idx;
 
-    if (*k_itor && self->key_callbacks.cmp_fn(*k_itor, key) == 0) {
+    bool replace = *k_itor && self->hashes[idx] == hash &&
+                   self->key_callbacks.cmp_fn(*k_itor, key) == 0;
+
+    if (replace) {
       if (self->key_callbacks.free_fn) {
         self->key_callbacks.free_fn(*k_itor);
       }
       if (self->val_callbacks.free_fn) {
         self->val_callbacks.free_fn(*v_itor);
       }
-      *k_itor = NULL;
+    } else if (*k_itor) {
+      continue;
+    } else {
+      self->n_entries++;
     }
 
-    if (!*k_itor) {
-      *k_itor = self->key_callbacks.copy_fn ? self->key_callbacks.copy_fn(key)
-                                            : sls_copy_assign(key);
-      *v_itor = self->val_callbacks.copy_fn ? self->val_callbacks.copy_fn(val)
-                                            : sls_copy_assign(val);
+    *k_itor = self->key_callbacks.copy_fn ? self->key_callbacks.copy_fn(key)
+                                          : sls_copy_assign(key);
+    *v_itor = self->val_callbacks.copy_fn ? self->val_callbacks.copy_fn(val)
+                                          : sls_copy_assign(val);
+    self->hashes[idx] = hash;
 
-      val_res = *v_itor;
-      inserted = true;
-    } else {
-      val_res = NULL;
-    }
+    val_res = *v_itor;
+    break;
   }
 
-  self->n_entries++;
-
   return val_res;
 }
 
@@ -241,17 +272,17 @@ void* sls_hashtable_find(slsHashTable* self, void const* key, size_t key_size)
 
   uint64_t hash = self->hash(key, key_size);
 
-  bool found = false;
+  // keys are never cleared, so the first empty slot ends the probe
+  for (size_t i = 0; i < array_size; ++i) {
+    size_t idx = (hash + i) % array_size;
+    void* k = self->keys[idx];
 
-  for (size_t i = 0; !found && i < array_size; ++i) {
-    size_t probe = hash + (i * i);
-    size_t idx = probe % array_size;
-    void** k_itor = self->keys + idx;
-    void** v_itor = self->vals + idx;
-
-    if (*k_itor && self->key_callbacks.cmp_fn(*k_itor, key) == 0) {
-      ptr = *v_itor;
-      found = true;
+    if (!k) {
+      break;
+    }
+    if (self->hashes[idx] == hash && self->key_callbacks.cmp_fn(k, key) == 0) {
+      ptr = self->vals[idx];
+      break;
     }
   }
 
@@ -0,0 +1,92 @@
+/**
+ * @file rangeset.c
+ * @brief
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#include "rangeset.h"
+#include <string.h>
+
+void sls_rangeset_clear(slsRangeSet* self)
+{
+  self->n_ranges = 0;
+}
+
+static void sls_rangeset_erase(slsRangeSet* self, size_t i)
+{
+  memmove(self->ranges + i,
+          self->ranges + i + 1,
+          (self->n_ranges - i - 1) * sizeof(slsRange));
+  self->n_ranges--;
+}
+
+/**
+ * @brief merges the neighbouring pair with the smallest gap between them
+ */
+static void sls_rangeset_merge_closest(slsRangeSet* self)
+{
+  size_t best = 0;
+  size_t best_gap = SIZE_MAX;
+  for (size_t i = 0; i + 1 < self->n_ranges; ++i) {
+    size_t gap = self->ranges[i + 1].begin - self->ranges[i].end;
+    if (gap < best_gap) {
+      best_gap = gap;
+      best = i;
+    }
+  }
+
+  self->ranges[best].end = self->ranges[best + 1].end;
+  sls_rangeset_erase(self, best + 1);
+}
+
+void sls_rangeset_add(slsRangeSet* self, size_t begin, size_t end)
+{
+  if (end <= begin) {
+    return;
+  }
+
+  // find insertion point, keeping ranges sorted by begin
+  size_t i = 0;
+  while (i < self->n_ranges && self->ranges[i].begin < begin) {
+    ++i;
+  }
+
+  // step back if the previous range touches the new one
+  if (i > 0 && self->ranges[i - 1].end >= begin) {
+    --i;
+    if (self->ranges[i].end < end) {
+      self->ranges[i].end = end;
+    }
+  } else {
+    if (self->n_ranges == SLS_RANGESET_MAX) {
+      sls_rangeset_merge_closest(self);
+      sls_rangeset_add(self, begin, end);
+      return;
+    }
+    memmove(self->ranges + i + 1,
+            self->ranges + i,
+            (self->n_ranges - i) * sizeof(slsRange));
+    self->ranges[i] = (slsRange){.begin = begin, .end = end };
+    self->n_ranges++;
+  }
+
+  // absorb following ranges now covered or adjacent
+  while (i + 1 < self->n_ranges &&
+         self->ranges[i + 1].begin <= self->ranges[i].end) {
+    if (self->ranges[i + 1].end > self->ranges[i].end) {
+      self->ranges[i].end = self->ranges[i + 1].end;
+    }
+    sls_rangeset_erase(self, i + 1);
+  }
+}
+
+size_t sls_rangeset_total(slsRangeSet const* self)
+{
+  size_t total = 0;
+  for (size_t i = 0; i < self->n_ranges; ++i) {
+    total += self->ranges[i].end - self->ranges[i].begin;
+  }
+  return total;
+}
@@ -0,0 +1,66 @@
+/**
+ * @file rangeset.h
+ * @brief small fixed-capacity set of coalesced half-open ranges
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#ifndef DANGERENGINE_RANGESET_H
+#define DANGERENGINE_RANGESET_H
+
+#include <slsutils.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+SLS_BEGIN_CDECLS
+
+/**
+ * @brief maximum number of disjoint ranges tracked by a slsRangeSet
+ */
+#define SLS_RANGESET_MAX 16
+
+typedef struct slsRange slsRange;
+typedef struct slsRangeSet slsRangeSet;
+
+/**
+ * @brief half-open interval [begin, end)
+ */
+struct slsRange {
+  size_t begin;
+  size_t end;
+};
+
+/**
+ * @brief Sorted list of disjoint ranges.
+ * @detail Overlapping and adjacent ranges are merged on insertion. Once the
+ * set holds SLS_RANGESET_MAX ranges, the two neighbours separated by the
+ * smallest gap are merged, so the set stays a conservative cover of
+ * everything added.
+ */
+struct slsRangeSet {
+  slsRange ranges[SLS_RANGESET_MAX];
+  size_t n_ranges;
+};
+
+void sls_rangeset_clear(slsRangeSet* self) SLS_NONNULL(1);
+
+/**
+ * @brief adds [begin, end) to the set. Empty ranges are ignored.
+ */
+void sls_rangeset_add(slsRangeSet* self, size_t begin, size_t end)
+  SLS_NONNULL(1);
+
+static inline bool sls_rangeset_empty(slsRangeSet const* self)
+{
+  return self->n_ranges == 0;
+}
+
+/**
+ * @brief sum of the lengths of all ranges in the set
+ */
+size_t sls_rangeset_total(slsRangeSet const* self) SLS_NONNULL(1);
+
+SLS_END_CDECLS
+
+#endif // DANGERENGINE_RANGESET_H
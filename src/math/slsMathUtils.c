@@ -3,6 +3,8 @@
 //
 
 #include "slsMathUtils.h"
+#include <assert.h>
+#include <string.h>
 
 size_t sls_nearest_squarelu(size_t x)
 {
@@ -62,6 +64,75 @@ double sls_to_radians(double degrees)
   return degrees * M_PI / 180.0;
 }
 
+uint16_t sls_float_to_half(float value)
+{
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+
+  const uint32_t sign = (bits >> 16) & 0x8000;
+  const uint32_t float_exponent = (bits >> 23) & 0xff;
+  int32_t exponent = (int32_t)float_exponent - 127 + 15;
+  uint32_t mantissa = bits & 0x7fffff;
+
+  if (float_exponent == 0xff) { // inf or nan
+    return (uint16_t)(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+  }
+  if (exponent >= 31) { // overflow
+    return (uint16_t)(sign | 0x7c00);
+  }
+
+  if (exponent <= 0) { // subnormal half
+    if (exponent < -10) {
+      return (uint16_t)sign;
+    }
+    mantissa |= 0x800000;
+    const uint32_t shift = (uint32_t)(14 - exponent);
+    uint32_t half_mantissa = mantissa >> shift;
+    const uint32_t rem = mantissa & ((1u << shift) - 1);
+    const uint32_t halfway = 1u << (shift - 1);
+    if (rem > halfway || (rem == halfway && (half_mantissa & 1))) {
+      half_mantissa++;
+    }
+    return (uint16_t)(sign | half_mantissa);
+  }
+
+  uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+  const uint32_t rem = mantissa & 0x1fff;
+  // a carry out of the mantissa correctly bumps the exponent
+  if (rem > 0x1000 || (rem == 0x1000 && (half & 1))) {
+    half++;
+  }
+  return (uint16_t)half;
+}
+
+float sls_half_to_float(uint16_t value)
+{
+  const uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+  int32_t exponent = (value >> 10) & 0x1f;
+  uint32_t mantissa = value & 0x3ff;
+  uint32_t bits;
+
+  if (exponent == 0x1f) {
+    bits = sign | 0x7f800000 | (mantissa << 13);
+  } else if (exponent == 0 && mantissa == 0) {
+    bits = sign;
+  } else {
+    if (exponent == 0) { // subnormal: renormalise
+      exponent = 1;
+      while (!(mantissa & 0x400)) {
+        mantissa <<= 1;
+        exponent--;
+      }
+      mantissa &= 0x3ff;
+    }
+    bits = sign | ((uint32_t)(exponent + 127 - 15) << 23) | (mantissa << 13);
+  }
+
+  float result;
+  memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
 bool sls_vec2_near(kmVec2 const* a, kmVec2 const* b, float epsilon)
 {
   assert(a && b);
@@ -12,8 +12,10 @@
 #include <kazmath/kazmath.h>
 #include <kazmath/vec4.h>
 #include <math.h>
+#include <slsmacros.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 size_t sls_nearest_squarelu(size_t x);
 
@@ -45,6 +47,14 @@ double sls_to_degrees(double radians);
 
 bool sls_vec2_near(kmVec2 const* a, kmVec2 const* b, float epsilon);
 
+/**
+ * @brief converts a float to IEEE 754 half precision, rounding to nearest
+ * even. Out of range values become infinity.
+ */
+uint16_t sls_float_to_half(float value) SLS_CONSTFN;
+
+float sls_half_to_float(uint16_t value) SLS_CONSTFN;
+
 /*
  * by-value vector functions
  */
@@ -62,4 +62,187 @@ uniform mat4 modelview_projection;
 uniform sampler2D diffuse_tex;
 
 
-)SHADER";
\ No newline at end of file
+)SHADER";
+/*----------------------------*
+ * post-processing
+ *----------------------------*/
+
+char const *SLS_POSTFX_VS = R"SHADER(
+out vec2 frag_uv;
+
+// one triangle covering the screen, drawn without vertex buffers
+void main(void)
+{
+  vec2 p = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));
+  frag_uv = p;
+  gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);
+}
+)SHADER";
+
+char const *SLS_POSTFX_UNIFORMS = R"SHADER(
+uniform sampler2D postfx_src;
+/** size of a source texel in uv units */
+uniform vec2 postfx_texel;
+uniform vec2 postfx_direction;
+)SHADER";
+
+char const *SLS_POSTFX_DOWNSAMPLE_FS = R"SHADER(
+in vec2 frag_uv;
+out vec4 out_color;
+
+void main(void)
+{
+  // four bilinear taps average the 4x4 source texels around the pixel
+  vec2 d = postfx_texel;
+  vec4 color = 0.25 * (texture(postfx_src, frag_uv + vec2(-d.x, -d.y)) +
+                       texture(postfx_src, frag_uv + vec2(d.x, -d.y)) +
+                       texture(postfx_src, frag_uv + vec2(-d.x, d.y)) +
+                       texture(postfx_src, frag_uv + vec2(d.x, d.y)));
+#ifdef POSTFX_PREFILTER
+  color = POSTFX_PREFILTER(color);
+#endif
+  out_color = color;
+}
+)SHADER";
+
+char const *SLS_POSTFX_BLUR_FS = R"SHADER(
+in vec2 frag_uv;
+out vec4 out_color;
+
+void main(void)
+{
+  // 9-tap gaussian in 5 fetches, using bilinear filtering between taps
+  vec2 step = postfx_direction * postfx_texel;
+  vec4 color = texture(postfx_src, frag_uv) * 0.2270270270;
+  color += (texture(postfx_src, frag_uv + step * 1.3846153846) +
+            texture(postfx_src, frag_uv - step * 1.3846153846)) *
+           0.3162162162;
+  color += (texture(postfx_src, frag_uv + step * 3.2307692308) +
+            texture(postfx_src, frag_uv - step * 3.2307692308)) *
+           0.0702702703;
+  out_color = color;
+}
+)SHADER";
+
+char const *SLS_POSTFX_BLOOM_GLSL = R"SHADER(
+uniform sampler2D bloom_tex;
+uniform float bloom_threshold;
+uniform float bloom_intensity;
+
+vec4 bloom_prefilter(vec4 color)
+{
+  float brightness = max(color.r, max(color.g, color.b));
+  float weight =
+    max(brightness - bloom_threshold, 0.0) / max(brightness, 1e-4);
+  return vec4(color.rgb * weight, 1.0);
+}
+
+vec4 bloom(vec4 color, vec2 uv)
+{
+  vec3 glow = texture(bloom_tex, uv).rgb * bloom_intensity;
+  return vec4(color.rgb + glow, color.a);
+}
+)SHADER";
+
+char const *SLS_POSTFX_TONEMAP_GLSL = R"SHADER(
+uniform float tonemap_exposure;
+
+// Narkowicz's fit of the ACES filmic curve, then gamma encoding
+vec4 tonemap(vec4 color, vec2 uv)
+{
+  vec3 x = color.rgb * tonemap_exposure;
+  vec3 mapped =
+    clamp((x * (2.51 * x + 0.03)) / (x * (2.43 * x + 0.59) + 0.14), 0.0, 1.0);
+  return vec4(pow(mapped, vec3(1.0 / 2.2)), color.a);
+}
+)SHADER";
+
+char const *SLS_POSTFX_GRADE_GLSL = R"SHADER(
+uniform vec3 grade_lift;
+uniform vec3 grade_gain;
+uniform float grade_contrast;
+uniform float grade_saturation;
+
+vec4 grade(vec4 color, vec2 uv)
+{
+  vec3 c = color.rgb * grade_gain + grade_lift * (1.0 - color.rgb);
+  c = (c - 0.5) * grade_contrast + 0.5;
+  float luma = dot(c, vec3(0.2126, 0.7152, 0.0722));
+  c = mix(vec3(luma), c, grade_saturation);
+  return vec4(clamp(c, 0.0, 1.0), color.a);
+}
+)SHADER";
+
+char const *SLS_POSTFX_FXAA_GLSL = R"SHADER(
+#define FXAA_REDUCE_MIN (1.0 / 128.0)
+#define FXAA_REDUCE_MUL (1.0 / 8.0)
+#define FXAA_SPAN_MAX 8.0
+
+// FXAA without edge walking: blends along the local luma gradient
+vec4 fxaa(sampler2D src, vec2 uv, vec2 texel)
+{
+  vec3 weights = vec3(0.299, 0.587, 0.114);
+  float nw = dot(texture(src, uv + vec2(-1.0, -1.0) * texel).rgb, weights);
+  float ne = dot(texture(src, uv + vec2(1.0, -1.0) * texel).rgb, weights);
+  float sw = dot(texture(src, uv + vec2(-1.0, 1.0) * texel).rgb, weights);
+  float se = dot(texture(src, uv + vec2(1.0, 1.0) * texel).rgb, weights);
+  vec4 center = texture(src, uv);
+  float m = dot(center.rgb, weights);
+  float luma_min = min(m, min(min(nw, ne), min(sw, se)));
+  float luma_max = max(m, max(max(nw, ne), max(sw, se)));
+
+  vec2 dir = vec2(-((nw + ne) - (sw + se)), (nw + sw) - (ne + se));
+  float reduce =
+    max((nw + ne + sw + se) * (0.25 * FXAA_REDUCE_MUL), FXAA_REDUCE_MIN);
+  float scale = 1.0 / (min(abs(dir.x), abs(dir.y)) + reduce);
+  dir = clamp(dir * scale, vec2(-FXAA_SPAN_MAX), vec2(FXAA_SPAN_MAX)) * texel;
+
+  vec3 near = 0.5 * (texture(src, uv + dir * (1.0 / 3.0 - 0.5)).rgb +
+                     texture(src, uv + dir * (2.0 / 3.0 - 0.5)).rgb);
+  vec3 far = near * 0.5 + 0.25 * (texture(src, uv - dir * 0.5).rgb +
+                                  texture(src, uv + dir * 0.5).rgb);
+  float luma_far = dot(far, weights);
+  bool outside = luma_far < luma_min || luma_far > luma_max;
+  return vec4(outside ? near : far, center.a);
+}
+)SHADER";
+
+/*----------------------------*
+ * particles
+ *----------------------------*/
+
+char const *SLS_PARTICLE_UNIFORMS = R"SHADER(
+uniform mat4 particle_view_projection;
+/** pixels per world unit at a distance of one */
+uniform float particle_point_scale;
+)SHADER";
+
+char const *SLS_PARTICLE_VS = R"SHADER(
+layout (location=0) in vec4 position;
+layout (location=3) in vec4 color;
+
+out vec4 frag_color;
+
+void main(void)
+{
+  frag_color = color;
+  gl_Position = particle_view_projection * vec4(position.xyz, 1.0);
+  // w is the particle's world space size
+  gl_PointSize =
+    max(particle_point_scale * position.w / gl_Position.w, 1.0);
+}
+)SHADER";
+
+char const *SLS_PARTICLE_FS = R"SHADER(
+in vec4 frag_color;
+
+out vec4 out_color;
+
+// soft round sprite, fading out towards the point's edge
+void main(void)
+{
+  vec2 d = gl_PointCoord * 2.0 - 1.0;
+  float falloff = max(1.0 - dot(d, d), 0.0);
+  out_color = vec4(frag_color.rgb, frag_color.a * falloff);
+}
+)SHADER";
@@ -11,6 +11,7 @@
 #include <stdlib.h>
 
 #include "shaderutils.h"
+#include "slsprogrambuild.h"
 
 int sls_get_glversion();
 
@@ -79,31 +80,30 @@ void _sls_print_log(GLuint object,
   free(log);
 }
 
-/**
- * Compile the shader from file 'filename', with error handling
- */
-GLuint sls_create_shader(const char *source,
-                         char const *uniforms,
-                         GLenum type)
+char const* sls_shader_preamble()
 {
   GLchar const* modern_preamble = "#version 330\n#define SLS_MODERN_OPENGL 1\n";
   GLchar const* legacy_preamble = "#version 130\n";
   GLchar const* gles_preamble = "#version 100\n";
 
-  GLchar const* preamble;
-
 #ifndef SLS_GLES
   int v = sls_get_glversion();
   if (v >= 330) {
-    preamble = modern_preamble;
+    return modern_preamble;
   } else {
-    preamble = legacy_preamble;
+    return legacy_preamble;
   }
 
 #else
-  preamble = gles_preamble;
+  return gles_preamble;
 #endif
+}
 
+GLuint sls_submit_shader(const char *source,
+                         char const *uniforms,
+                         GLenum type)
+{
+  GLchar const* preamble = sls_shader_preamble();
 
   GLuint res = glCreateShader(type);
 
@@ -114,6 +114,18 @@ GLuint sls_create_shader(const char *source,
 
 
   glCompileShader(res);
+
+  return res;
+}
+
+/**
+ * Compile the shader from file 'filename', with error handling
+ */
+GLuint sls_create_shader(const char *source,
+                         char const *uniforms,
+                         GLenum type)
+{
+  GLuint res = sls_submit_shader(source, uniforms, type);
   GLint compile_ok = GL_FALSE;
   glGetShaderiv(res, GL_COMPILE_STATUS, &compile_ok);
 
@@ -131,46 +143,18 @@ GLuint sls_create_program(const char* vertex_source,
                           const char* frag_source,
                           char const* uniform_definitions)
 {
-  GLuint program = glCreateProgram(), vs = 0, fs = 0;
-
-
-  vs = sls_create_shader(vertex_source, uniform_definitions, GL_VERTEX_SHADER);
-  if (vs == 0) {
-    sls_log_err("vertex active_shader at path %s is invalid", vertex_source);
-    sls_checkmem(vs != 0);
-    return 0;
-  }
-  glAttachShader(program, vs);
-
-  fs = sls_create_shader(frag_source, uniform_definitions, GL_FRAGMENT_SHADER);
-  if (fs == 0) {
-    sls_log_err("fragment active_shader at path %s is invalid", frag_source);
-    glDeleteShader(vs);
-    sls_checkmem(fs != 0);
+  // submit both stages before querying anything, so the driver is not
+  // forced to finish each compile in turn
+  slsProgramBuild build;
+  sls_program_build_submit(
+    &build, vertex_source, frag_source, uniform_definitions);
+
+  if (sls_program_build_wait(&build) != SLS_PROGRAM_READY) {
+    sls_log_err("could not build program");
     return 0;
   }
-  glAttachShader(program, fs);
 
-  //
-
-  glLinkProgram(program);
-  GLint link_ok = GL_FALSE;
-  glGetProgramiv(program, GL_LINK_STATUS, &link_ok);
-  if (!link_ok) {
-    fprintf(stderr, "glLinkProgram:");
-    sls_print_log(program, "program");
-    glDeleteProgram(program);
-    return 0;
-  }
-
-  glDeleteShader(vs);
-  glDeleteShader(fs);
-
-  return program;
-
-error:
-  glDeleteProgram(program);
-  return 0;
+  return build.program;
 }
 
 #ifdef GL_GEOMETRY_SHADER
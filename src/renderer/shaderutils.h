@@ -34,6 +34,20 @@ void _sls_print_log(GLuint object,
                    __LINE__);                                                  \
   } while (0)
 
+/**
+ * @brief `#version` line and defines prepended to every shader source by
+ * sls_create_shader, chosen from the context's GL version
+ */
+char const* sls_shader_preamble();
+
+/**
+ * @brief creates a shader and starts compiling it, without checking the
+ * result. Querying GL_COMPILE_STATUS waits for the compile to finish.
+ */
+GLuint sls_submit_shader(const char *source,
+                         char const *uniforms,
+                         GLenum type) SLS_NONNULL(1, 2);
+
 GLuint sls_create_shader(const char *source,
                          char const *uniforms,
                          GLenum type) SLS_NONNULL(1, 2);
@@ -0,0 +1,403 @@
+/**
+ * @file slsatlas.c
+ * @brief
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#include "slsatlas.h"
+#include "../sls-imagelib.h"
+#include <limits.h>
+#include <slsutils.h>
+#include <stdint.h>
+#include <string.h>
+
+/*================================
+ * skyline allocator
+ *================================*/
+
+slsSkyline* sls_skyline_init(slsSkyline* self, int width, int height)
+{
+  *self = (slsSkyline){.width = width, .height = height };
+
+  self->capacity = 16;
+  self->nodes = calloc(self->capacity, sizeof(slsSkylineNode));
+  sls_checkmem(self->nodes);
+
+  self->nodes[0] = (slsSkylineNode){.x = 0, .y = 0, .width = width };
+  self->n_nodes = 1;
+
+  return self;
+error:
+  return sls_skyline_dtor(self);
+}
+
+slsSkyline* sls_skyline_dtor(slsSkyline* self)
+{
+  free(self->nodes);
+  *self = (slsSkyline){};
+  return self;
+}
+
+/**
+ * @brief height a width x height rectangle rests at if its left edge is
+ * placed on node `i`
+ * @return -1 if it does not fit there
+ */
+static int sls_skyline_fit(slsSkyline const* self,
+                           size_t i,
+                           int width,
+                           int height)
+{
+  int x = self->nodes[i].x;
+  if (x + width > self->width) {
+    return -1;
+  }
+
+  int y = 0;
+  int remaining = width;
+  for (size_t j = i; remaining > 0; ++j) {
+    // x + width <= self->width, so the nodes always cover the span
+    y = self->nodes[j].y > y ? self->nodes[j].y : y;
+    if (y + height > self->height) {
+      return -1;
+    }
+    remaining -= self->nodes[j].width;
+  }
+
+  return y;
+}
+
+static bool sls_skyline_insert_node(slsSkyline* self,
+                                    size_t index,
+                                    slsSkylineNode node)
+{
+  if (self->n_nodes == self->capacity) {
+    size_t capacity = self->capacity * 2;
+    slsSkylineNode* nodes =
+      realloc(self->nodes, capacity * sizeof(slsSkylineNode));
+    if (!nodes) {
+      return false;
+    }
+    self->nodes = nodes;
+    self->capacity = capacity;
+  }
+
+  memmove(self->nodes + index + 1,
+          self->nodes + index,
+          (self->n_nodes - index) * sizeof(slsSkylineNode));
+  self->nodes[index] = node;
+  self->n_nodes++;
+  return true;
+}
+
+static void sls_skyline_remove_node(slsSkyline* self, size_t index)
+{
+  memmove(self->nodes + index,
+          self->nodes + index + 1,
+          (self->n_nodes - index - 1) * sizeof(slsSkylineNode));
+  self->n_nodes--;
+}
+
+bool sls_skyline_insert(slsSkyline* self,
+                        int width,
+                        int height,
+                        int* x_out,
+                        int* y_out)
+{
+  if (width <= 0 || height <= 0) {
+    return false;
+  }
+
+  // bottom-left rule: lowest top edge, then the narrowest segment
+  size_t best = SIZE_MAX;
+  int best_top = INT_MAX;
+  int best_width = INT_MAX;
+  int best_y = 0;
+
+  for (size_t i = 0; i < self->n_nodes; ++i) {
+    int y = sls_skyline_fit(self, i, width, height);
+    if (y < 0) {
+      continue;
+    }
+    int top = y + height;
+    if (top < best_top ||
+        (top == best_top && self->nodes[i].width < best_width)) {
+      best = i;
+      best_top = top;
+      best_width = self->nodes[i].width;
+      best_y = y;
+    }
+  }
+
+  if (best == SIZE_MAX) {
+    return false;
+  }
+
+  slsSkylineNode node = {.x = self->nodes[best].x, .y = best_top, .width =
+                                                                    width };
+  if (!sls_skyline_insert_node(self, best, node)) {
+    return false;
+  }
+
+  // trim the segments the new one now covers
+  int right = node.x + node.width;
+  for (size_t i = best + 1; i < self->n_nodes;) {
+    slsSkylineNode* n = self->nodes + i;
+    if (n->x >= right) {
+      break;
+    }
+    int overlap = right - n->x;
+    if (overlap >= n->width) {
+      sls_skyline_remove_node(self, i);
+    } else {
+      n->x += overlap;
+      n->width -= overlap;
+      break;
+    }
+  }
+
+  // merge neighbours at equal height
+  for (size_t i = 0; i + 1 < self->n_nodes;) {
+    if (self->nodes[i].y == self->nodes[i + 1].y) {
+      self->nodes[i].width += self->nodes[i + 1].width;
+      sls_skyline_remove_node(self, i + 1);
+    } else {
+      ++i;
+    }
+  }
+
+  self->used_area += (size_t)width * (size_t)height;
+  *x_out = node.x;
+  *y_out = best_y;
+  return true;
+}
+
+float sls_skyline_occupancy(slsSkyline const* self)
+{
+  size_t area = (size_t)self->width * (size_t)self->height;
+  return area ? (float)self->used_area / (float)area : 0.f;
+}
+
+/*================================
+ * texture atlas
+ *================================*/
+
+slsAtlas* sls_atlas_init(slsAtlas* self,
+                         int page_width,
+                         int page_height,
+                         int padding,
+                         size_t max_pages)
+{
+  *self = (slsAtlas){.page_width = page_width,
+                     .page_height = page_height,
+                     .padding = padding,
+                     .max_pages = max_pages };
+
+  sls_check(page_width > 0 && page_height > 0 && padding >= 0,
+            "invalid atlas dimensions %dx%d, padding %d",
+            page_width,
+            page_height,
+            padding);
+
+  return self;
+error:
+  return sls_atlas_dtor(self);
+}
+
+slsAtlas* sls_atlas_dtor(slsAtlas* self)
+{
+  for (size_t i = 0; i < self->n_pages; ++i) {
+    glDeleteTextures(1, &self->pages[i]->texture.id);
+    sls_skyline_dtor(&self->pages[i]->skyline);
+    free(self->pages[i]);
+  }
+  free(self->pages);
+
+  *self = (slsAtlas){};
+  return self;
+}
+
+static slsAtlasPage* sls_atlas_add_page(slsAtlas* self)
+{
+  if (self->max_pages && self->n_pages >= self->max_pages) {
+    return NULL;
+  }
+
+  slsAtlasPage** pages =
+    realloc(self->pages, (self->n_pages + 1) * sizeof(slsAtlasPage*));
+  if (!pages) {
+    return NULL;
+  }
+  self->pages = pages;
+
+  slsAtlasPage* page = calloc(1, sizeof(slsAtlasPage));
+  if (!page) {
+    return NULL;
+  }
+  if (!sls_skyline_init(&page->skyline, self->page_width, self->page_height)
+         ->nodes) {
+    free(page);
+    return NULL;
+  }
+
+  page->texture = (slsTexture){.width = self->page_width,
+                               .height = self->page_height,
+                               .state = SLS_TEXTURE_READY };
+  glGenTextures(1, &page->texture.id);
+  glBindTexture(GL_TEXTURE_2D, page->texture.id);
+  glTexImage2D(GL_TEXTURE_2D,
+               0,
+               GL_RGBA8,
+               self->page_width,
+               self->page_height,
+               0,
+               GL_RGBA,
+               GL_UNSIGNED_BYTE,
+               NULL);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  self->pages[self->n_pages++] = page;
+  return page;
+}
+
+/**
+ * @brief copies `src` into the centre of a padded buffer, extruding the
+ * edge texels outwards into the padding
+ */
+static void sls_atlas_extrude(unsigned char* dst,
+                              unsigned char const* src,
+                              int width,
+                              int height,
+                              int padding)
+{
+  int padded_width = width + 2 * padding;
+  int padded_height = height + 2 * padding;
+
+  for (int y = 0; y < padded_height; ++y) {
+    int sy = y - padding;
+    sy = sy < 0 ? 0 : (sy >= height ? height - 1 : sy);
+    for (int x = 0; x < padded_width; ++x) {
+      int sx = x - padding;
+      sx = sx < 0 ? 0 : (sx >= width ? width - 1 : sx);
+      memcpy(dst + ((size_t)y * padded_width + x) * 4,
+             src + ((size_t)sy * width + sx) * 4,
+             4);
+    }
+  }
+}
+
+bool sls_atlas_add(slsAtlas* self,
+                   unsigned char const* rgba,
+                   int width,
+                   int height,
+                   slsAtlasRegion* region_out)
+{
+  unsigned char* padded = NULL;
+  int padded_width = width + 2 * self->padding;
+  int padded_height = height + 2 * self->padding;
+
+  sls_check(width > 0 && height > 0 && padded_width <= self->page_width &&
+              padded_height <= self->page_height,
+            "image of %dx%d does not fit a %dx%d atlas page",
+            width,
+            height,
+            self->page_width,
+            self->page_height);
+
+  // the newest page is the emptiest, try it first
+  slsAtlasPage* page = NULL;
+  size_t page_index = self->n_pages;
+  int x = 0, y = 0;
+  for (size_t i = self->n_pages; i > 0 && !page; --i) {
+    if (sls_skyline_insert(
+          &self->pages[i - 1]->skyline, padded_width, padded_height, &x, &y)) {
+      page = self->pages[i - 1];
+      page_index = i - 1;
+    }
+  }
+  if (!page) {
+    page = sls_atlas_add_page(self);
+    sls_check(page, "atlas is full (%lu pages)", self->n_pages);
+    sls_check(sls_skyline_insert(
+                &page->skyline, padded_width, padded_height, &x, &y),
+              "could not place image on an empty page");
+  }
+
+  unsigned char const* upload = rgba;
+  if (self->padding > 0) {
+    padded = malloc((size_t)padded_width * padded_height * 4);
+    sls_checkmem(padded);
+    sls_atlas_extrude(padded, rgba, width, height, self->padding);
+    upload = padded;
+  }
+
+  glBindTexture(GL_TEXTURE_2D, page->texture.id);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glTexSubImage2D(GL_TEXTURE_2D,
+                  0,
+                  x,
+                  y,
+                  padded_width,
+                  padded_height,
+                  GL_RGBA,
+                  GL_UNSIGNED_BYTE,
+                  upload);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  free(padded);
+
+  int inner_x = x + self->padding, inner_y = y + self->padding;
+  *region_out = (slsAtlasRegion){
+    .texture = &page->texture,
+    .page = page_index,
+    .x = inner_x,
+    .y = inner_y,
+    .width = width,
+    .height = height,
+    .uv_min = {.x = inner_x / (float)self->page_width,
+               .y = inner_y / (float)self->page_height },
+    .uv_max = {.x = (inner_x + width) / (float)self->page_width,
+               .y = (inner_y + height) / (float)self->page_height },
+  };
+
+  return true;
+error:
+  free(padded);
+  return false;
+}
+
+bool sls_atlas_add_file(slsAtlas* self,
+                        char const* path,
+                        slsAtlasRegion* region_out)
+{
+  int width = 0, height = 0, channels = 0;
+
+  // match the row order of slsTextureLoader
+  stbi_set_flip_vertically_on_load(true);
+  unsigned char* pixels =
+    stbi_load(path, &width, &height, &channels, STBI_rgb_alpha);
+  if (!pixels) {
+    sls_log_err("could not decode %s: %s", path, stbi_failure_reason());
+    return false;
+  }
+
+  bool res = sls_atlas_add(self, pixels, width, height, region_out);
+  stbi_image_free(pixels);
+  return res;
+}
+
+void sls_atlas_build_mipmaps(slsAtlas* self)
+{
+  for (size_t i = 0; i < self->n_pages; ++i) {
+    glBindTexture(GL_TEXTURE_2D, self->pages[i]->texture.id);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glTexParameteri(
+      GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
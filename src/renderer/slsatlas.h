@@ -0,0 +1,149 @@
+/**
+ * @file slsatlas.h
+ * @brief packs many small images into a few large textures
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#ifndef DANGERENGINE_SLSATLAS_H
+#define DANGERENGINE_SLSATLAS_H
+
+#include "../sls-gl.h"
+#include "slstexture.h"
+#include <kazmath/kazmath.h>
+#include <slsmacros.h>
+#include <stdbool.h>
+
+SLS_BEGIN_CDECLS
+
+/*================================
+ * skyline allocator
+ *================================*/
+
+typedef struct slsSkylineNode {
+  int x;
+  int y;
+  int width;
+} slsSkylineNode;
+
+/**
+ * @brief bottom-left skyline rectangle packer.
+ * @detail The skyline is the upper outline of everything placed so far,
+ * stored as horizontal segments sorted by x. Rectangles sit on it as low
+ * as possible, so space hidden beneath an overhang is lost, but insertion
+ * is cheap and works incrementally.
+ */
+typedef struct slsSkyline {
+  int width;
+  int height;
+
+  slsSkylineNode* nodes;
+  size_t n_nodes;
+  size_t capacity;
+
+  /** @brief total area of placed rectangles */
+  size_t used_area;
+} slsSkyline;
+
+slsSkyline* sls_skyline_init(slsSkyline* self, int width, int height)
+  SLS_NONNULL(1);
+
+slsSkyline* sls_skyline_dtor(slsSkyline* self) SLS_NONNULL(1);
+
+/**
+ * @brief allocates a width x height rectangle
+ * @return false if there is no room
+ */
+bool sls_skyline_insert(slsSkyline* self,
+                        int width,
+                        int height,
+                        int* x_out,
+                        int* y_out) SLS_NONNULL(1, 4, 5);
+
+/**
+ * @return fraction of the area covered by placed rectangles
+ */
+float sls_skyline_occupancy(slsSkyline const* self) SLS_NONNULL(1);
+
+/*================================
+ * texture atlas
+ *================================*/
+
+/**
+ * @brief where an image landed in an atlas
+ */
+typedef struct slsAtlasRegion {
+  /** @brief page texture, owned by the atlas */
+  slsTexture* texture;
+  size_t page;
+
+  /** @brief texel rectangle, excluding padding */
+  int x;
+  int y;
+  int width;
+  int height;
+
+  kmVec2 uv_min;
+  kmVec2 uv_max;
+} slsAtlasRegion;
+
+typedef struct slsAtlasPage {
+  slsTexture texture;
+  slsSkyline skyline;
+} slsAtlasPage;
+
+typedef struct slsAtlas {
+  int page_width;
+  int page_height;
+  /**
+   * @brief border around each image, filled by repeating its edge texels
+   * so filtering and mipmapping do not sample neighbouring images
+   */
+  int padding;
+  size_t max_pages;
+
+  /** @brief pages are boxed so region texture pointers stay valid */
+  slsAtlasPage** pages;
+  size_t n_pages;
+} slsAtlas;
+
+/**
+ * @param max_pages upper bound on textures the atlas may create, 0 for
+ * no limit
+ */
+slsAtlas* sls_atlas_init(slsAtlas* self,
+                         int page_width,
+                         int page_height,
+                         int padding,
+                         size_t max_pages) SLS_NONNULL(1);
+
+slsAtlas* sls_atlas_dtor(slsAtlas* self) SLS_NONNULL(1);
+
+/**
+ * @brief copies an RGBA8 image into the atlas, opening a page if none
+ * has room. Rows are bottom first, as GL expects. Single-channel images
+ * such as rasterised glyphs must be expanded first.
+ * @return false if the image does not fit on a page, or max_pages is hit
+ */
+bool sls_atlas_add(slsAtlas* self,
+                   unsigned char const* rgba,
+                   int width,
+                   int height,
+                   slsAtlasRegion* region_out) SLS_NONNULL(1, 2, 5);
+
+/**
+ * @brief decodes the image at `path` and adds it. Blocks on the decode.
+ */
+bool sls_atlas_add_file(slsAtlas* self,
+                        char const* path,
+                        slsAtlasRegion* region_out) SLS_NONNULL(1, 2, 3);
+
+/**
+ * @brief regenerates mipmaps of every page. Call after a batch of adds.
+ */
+void sls_atlas_build_mipmaps(slsAtlas* self) SLS_NONNULL(1);
+
+SLS_END_CDECLS
+
+#endif // DANGERENGINE_SLSATLAS_H
@@ -0,0 +1,364 @@
+/**
+ * @file slscull.c
+ * @brief
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#include "slscull.h"
+#include <assert.h>
+#include <math.h>
+#include <slsutils.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define SLS_CULL_SSE 1
+#endif
+
+static size_t const sls_cull_n_components[SLS_CULL_SHAPE_COUNT] = {
+  [SLS_CULL_RECT] = 4, [SLS_CULL_SPHERE] = 4, [SLS_CULL_AABB] = 6,
+};
+
+/*----------------------------------------*
+ * camera
+ *----------------------------------------*/
+
+static kmVec4 sls_cull_transform(float const* m, kmVec4 v)
+{
+  return (kmVec4){
+    m[0] * v.x + m[4] * v.y + m[8] * v.z + m[12] * v.w,
+    m[1] * v.x + m[5] * v.y + m[9] * v.z + m[13] * v.w,
+    m[2] * v.x + m[6] * v.y + m[10] * v.z + m[14] * v.w,
+    m[3] * v.x + m[7] * v.y + m[11] * v.z + m[15] * v.w,
+  };
+}
+
+/**
+ * @brief bounds of the points where the frustum's corner edges cross
+ * z = 0
+ * @return false if an edge misses the plane
+ */
+static bool sls_cull_footprint(slsCullCamera* self, kmMat4 const* clip)
+{
+  kmMat4 inverse;
+  if (!kmMat4Inverse(&inverse, clip)) {
+    return false;
+  }
+
+  self->rect_min = (kmVec2){ INFINITY, INFINITY };
+  self->rect_max = (kmVec2){ -INFINITY, -INFINITY };
+  for (int corner = 0; corner < 4; ++corner) {
+    float x = corner & 1 ? 1.f : -1.f;
+    float y = corner & 2 ? 1.f : -1.f;
+    kmVec4 near = sls_cull_transform(inverse.mat, (kmVec4){ x, y, -1.f, 1.f });
+    kmVec4 far = sls_cull_transform(inverse.mat, (kmVec4){ x, y, 1.f, 1.f });
+    if (fabsf(near.w) < 1e-8f || fabsf(far.w) < 1e-8f) {
+      return false;
+    }
+    kmVec3 a = { near.x / near.w, near.y / near.w, near.z / near.w };
+    kmVec3 b = { far.x / far.w, far.y / far.w, far.z / far.w };
+
+    float dz = a.z - b.z;
+    float t = fabsf(dz) > 1e-8f ? a.z / dz : -1.f;
+    if (t < 0.f || t > 1.f) {
+      return false;
+    }
+    float px = a.x + (b.x - a.x) * t;
+    float py = a.y + (b.y - a.y) * t;
+    self->rect_min.x = fminf(self->rect_min.x, px);
+    self->rect_min.y = fminf(self->rect_min.y, py);
+    self->rect_max.x = fmaxf(self->rect_max.x, px);
+    self->rect_max.y = fmaxf(self->rect_max.y, py);
+  }
+  return true;
+}
+
+void sls_cull_camera_init(slsCullCamera* self,
+                          kmMat4 const* modelview,
+                          kmMat4 const* projection)
+{
+  kmMat4 clip;
+  kmMat4Multiply(&clip, projection, modelview);
+  float const* m = clip.mat;
+
+  // Gribb & Hartmann: each plane is the last row of the clip matrix plus
+  // or minus one of the others
+  for (int axis = 0; axis < 3; ++axis) {
+    for (int side = 0; side < 2; ++side) {
+      float sign = side ? -1.f : 1.f;
+      kmVec4 plane = {
+        m[3] + sign * m[axis],
+        m[7] + sign * m[4 + axis],
+        m[11] + sign * m[8 + axis],
+        m[15] + sign * m[12 + axis],
+      };
+      float len = sqrtf(plane.x * plane.x + plane.y * plane.y +
+                        plane.z * plane.z);
+      if (len > 0.f) {
+        plane.x /= len;
+        plane.y /= len;
+        plane.z /= len;
+        plane.w /= len;
+      }
+      self->planes[axis * 2 + side] = plane;
+    }
+  }
+
+  if (!sls_cull_footprint(self, &clip)) {
+    self->rect_min = (kmVec2){ -INFINITY, -INFINITY };
+    self->rect_max = (kmVec2){ INFINITY, INFINITY };
+  }
+}
+
+/*----------------------------------------*
+ * bounds
+ *----------------------------------------*/
+
+slsCullSet* sls_cullset_init(slsCullSet* self,
+                             slsCullShape shape,
+                             size_t capacity)
+{
+  *self = (slsCullSet){.shape = shape };
+  sls_check(shape < SLS_CULL_SHAPE_COUNT, "invalid cull shape %d", shape);
+  self->n_components = sls_cull_n_components[shape];
+
+  // padded to whole groups of four, so batches never read past the end
+  capacity = (capacity + 3) & ~(size_t)3;
+  if (capacity == 0) {
+    capacity = 64;
+  }
+  for (size_t c = 0; c < self->n_components; ++c) {
+    self->components[c] = calloc(capacity, sizeof(float));
+    sls_checkmem(self->components[c]);
+  }
+  self->capacity = capacity;
+  return self;
+error:
+  sls_cullset_dtor(self);
+  return NULL;
+}
+
+slsCullSet* sls_cullset_dtor(slsCullSet* self)
+{
+  for (size_t c = 0; c < SLS_CULL_MAX_COMPONENTS; ++c) {
+    free(self->components[c]);
+  }
+  *self = (slsCullSet){};
+  return self;
+}
+
+size_t sls_cullset_push(slsCullSet* self, float const* bounds)
+{
+  if (self->n == self->capacity) {
+    size_t capacity = self->capacity * 2;
+    for (size_t c = 0; c < self->n_components; ++c) {
+      float* component =
+        realloc(self->components[c], capacity * sizeof(*component));
+      if (!component) {
+        return SIZE_MAX;
+      }
+      memset(component + self->capacity,
+             0,
+             (capacity - self->capacity) * sizeof(*component));
+      self->components[c] = component;
+    }
+    self->capacity = capacity;
+  }
+
+  size_t index = self->n++;
+  sls_cullset_set(self, index, bounds);
+  return index;
+}
+
+void sls_cullset_set(slsCullSet* self, size_t index, float const* bounds)
+{
+  assert(index < self->n);
+  for (size_t c = 0; c < self->n_components; ++c) {
+    self->components[c][index] = bounds[c];
+  }
+}
+
+/*----------------------------------------*
+ * culling
+ *----------------------------------------*/
+
+/**
+ * @brief appends the objects of group [first, first + 4) selected by
+ * `mask`, ignoring lanes at or past `end`
+ */
+static inline size_t sls_cull_emit(unsigned mask,
+                                   size_t first,
+                                   size_t end,
+                                   uint32_t* out,
+                                   size_t n_out)
+{
+  size_t n_lanes = end - first < 4 ? end - first : 4;
+  for (size_t lane = 0; lane < n_lanes; ++lane) {
+    out[n_out] = (uint32_t)(first + lane);
+    n_out += (mask >> lane) & 1u;
+  }
+  return n_out;
+}
+
+static size_t sls_cull_rects(slsCullCamera const* camera,
+                             slsCullSet const* set,
+                             size_t begin,
+                             size_t end,
+                             uint32_t* out)
+{
+  float const* min_x = set->components[0];
+  float const* min_y = set->components[1];
+  float const* max_x = set->components[2];
+  float const* max_y = set->components[3];
+  size_t n_out = 0;
+
+#ifdef SLS_CULL_SSE
+  __m128 cam_min_x = _mm_set1_ps(camera->rect_min.x);
+  __m128 cam_min_y = _mm_set1_ps(camera->rect_min.y);
+  __m128 cam_max_x = _mm_set1_ps(camera->rect_max.x);
+  __m128 cam_max_y = _mm_set1_ps(camera->rect_max.y);
+  for (size_t i = begin; i < end; i += 4) {
+    __m128 visible =
+      _mm_and_ps(_mm_cmpge_ps(_mm_loadu_ps(max_x + i), cam_min_x),
+                 _mm_cmple_ps(_mm_loadu_ps(min_x + i), cam_max_x));
+    visible = _mm_and_ps(visible,
+                         _mm_cmpge_ps(_mm_loadu_ps(max_y + i), cam_min_y));
+    visible = _mm_and_ps(visible,
+                         _mm_cmple_ps(_mm_loadu_ps(min_y + i), cam_max_y));
+    n_out = sls_cull_emit(
+      (unsigned)_mm_movemask_ps(visible), i, end, out, n_out);
+  }
+#else
+  for (size_t i = begin; i < end; ++i) {
+    out[n_out] = (uint32_t)i;
+    n_out += max_x[i] >= camera->rect_min.x &&
+             min_x[i] <= camera->rect_max.x &&
+             max_y[i] >= camera->rect_min.y && min_y[i] <= camera->rect_max.y;
+  }
+#endif
+  return n_out;
+}
+
+/**
+ * @brief spheres or boxes against the frustum planes
+ */
+static size_t sls_cull_volumes(slsCullCamera const* camera,
+                               slsCullSet const* set,
+                               size_t begin,
+                               size_t end,
+                               uint32_t* out)
+{
+  float const* x = set->components[0];
+  float const* y = set->components[1];
+  float const* z = set->components[2];
+  bool boxes = set->shape == SLS_CULL_AABB;
+  size_t n_out = 0;
+
+#ifdef SLS_CULL_SSE
+  __m128 zero = _mm_setzero_ps();
+  for (size_t i = begin; i < end; i += 4) {
+    __m128 cx = _mm_loadu_ps(x + i);
+    __m128 cy = _mm_loadu_ps(y + i);
+    __m128 cz = _mm_loadu_ps(z + i);
+    // radius, or x half extent
+    __m128 r = _mm_loadu_ps(set->components[3] + i);
+    __m128 ey = boxes ? _mm_loadu_ps(set->components[4] + i) : zero;
+    __m128 ez = boxes ? _mm_loadu_ps(set->components[5] + i) : zero;
+
+    __m128 visible = _mm_cmpeq_ps(zero, zero);
+    for (size_t p = 0; p < 6; ++p) {
+      kmVec4 plane = camera->planes[p];
+      __m128 d = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(plane.x)),
+                   _mm_mul_ps(cy, _mm_set1_ps(plane.y))),
+        _mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(plane.z)),
+                   _mm_set1_ps(plane.w)));
+      // projected radius of the box onto the plane normal
+      __m128 radius =
+        boxes ? _mm_add_ps(_mm_mul_ps(r, _mm_set1_ps(fabsf(plane.x))),
+                           _mm_add_ps(_mm_mul_ps(ey, _mm_set1_ps(fabsf(plane.y))),
+                                      _mm_mul_ps(ez, _mm_set1_ps(fabsf(plane.z)))))
+              : r;
+      visible = _mm_and_ps(visible, _mm_cmpge_ps(_mm_add_ps(d, radius), zero));
+    }
+    n_out = sls_cull_emit(
+      (unsigned)_mm_movemask_ps(visible), i, end, out, n_out);
+  }
+#else
+  for (size_t i = begin; i < end; ++i) {
+    bool visible = true;
+    for (size_t p = 0; p < 6 && visible; ++p) {
+      kmVec4 plane = camera->planes[p];
+      float d = x[i] * plane.x + y[i] * plane.y + z[i] * plane.z + plane.w;
+      float radius = boxes ? set->components[3][i] * fabsf(plane.x) +
+                               set->components[4][i] * fabsf(plane.y) +
+                               set->components[5][i] * fabsf(plane.z)
+                           : set->components[3][i];
+      visible = d + radius >= 0.f;
+    }
+    out[n_out] = (uint32_t)i;
+    n_out += visible;
+  }
+#endif
+  return n_out;
+}
+
+static size_t sls_cull_range(slsCullCamera const* camera,
+                             slsCullSet const* set,
+                             size_t begin,
+                             size_t end,
+                             uint32_t* out)
+{
+  return set->shape == SLS_CULL_RECT
+           ? sls_cull_rects(camera, set, begin, end, out)
+           : sls_cull_volumes(camera, set, begin, end, out);
+}
+
+typedef struct slsCullBatch {
+  slsCullCamera const* camera;
+  slsCullSet const* set;
+  uint32_t* visible;
+  /** @brief visible count of each chunk, written at the chunk's start */
+  size_t* counts;
+} slsCullBatch;
+
+static void sls_cull_chunk(void* data, size_t begin, size_t end)
+{
+  slsCullBatch* batch = data;
+  batch->counts[begin / SLS_CULL_GRAIN] = sls_cull_range(
+    batch->camera, batch->set, begin, end, batch->visible + begin);
+}
+
+size_t sls_cull(slsCullCamera const* camera,
+                slsCullSet const* set,
+                uint32_t* visible_out,
+                slsJobQueue* jobs_opt)
+{
+  size_t n_chunks = (set->n + SLS_CULL_GRAIN - 1) / SLS_CULL_GRAIN;
+  size_t* counts = NULL;
+  if (!jobs_opt || n_chunks <= 1 ||
+      !(counts = calloc(n_chunks, sizeof(*counts)))) {
+    return sls_cull_range(camera, set, 0, set->n, visible_out);
+  }
+
+  slsCullBatch batch = {.camera = camera,
+                        .set = set,
+                        .visible = visible_out,
+                        .counts = counts };
+  sls_jobqueue_parallel_for(
+    jobs_opt, set->n, SLS_CULL_GRAIN, sls_cull_chunk, &batch);
+
+  // close the gaps between chunks
+  size_t n_visible = counts[0];
+  for (size_t chunk = 1; chunk < n_chunks; ++chunk) {
+    memmove(visible_out + n_visible,
+            visible_out + chunk * SLS_CULL_GRAIN,
+            counts[chunk] * sizeof(*visible_out));
+    n_visible += counts[chunk];
+  }
+  free(counts);
+  return n_visible;
+}
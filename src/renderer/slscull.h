@@ -0,0 +1,107 @@
+/**
+ * @file slscull.h
+ * @brief batched visibility tests of object bounds against the camera
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#ifndef DANGERENGINE_SLSCULL_H
+#define DANGERENGINE_SLSCULL_H
+
+#include "../slsjobs.h"
+#include <kazmath/kazmath.h>
+#include <slsmacros.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+SLS_BEGIN_CDECLS
+
+/**
+ * @brief objects per job when culling in parallel. Smaller sets are culled
+ * on the calling thread.
+ */
+#define SLS_CULL_GRAIN 4096
+
+typedef enum slsCullShape {
+  /** @brief min_x, min_y, max_x, max_y on the z = 0 plane, for sprites */
+  SLS_CULL_RECT,
+  /** @brief center x, y, z and radius */
+  SLS_CULL_SPHERE,
+  /** @brief center x, y, z and half extents x, y, z */
+  SLS_CULL_AABB,
+  SLS_CULL_SHAPE_COUNT
+} slsCullShape;
+
+#define SLS_CULL_MAX_COMPONENTS 6
+
+/**
+ * @brief Bounds of one shape, stored as one array per component, so four
+ * objects are tested at a time.
+ */
+typedef struct slsCullSet {
+  slsCullShape shape;
+  size_t n_components;
+  float* components[SLS_CULL_MAX_COMPONENTS];
+  size_t n;
+  size_t capacity;
+} slsCullSet;
+
+/**
+ * @brief what the camera sees
+ */
+typedef struct slsCullCamera {
+  /** @brief frustum planes, facing inwards, with unit normals */
+  kmVec4 planes[6];
+  /**
+   * @brief bounds of the frustum's footprint on the z = 0 plane. Infinite
+   * if the camera looks along the plane.
+   */
+  kmVec2 rect_min;
+  kmVec2 rect_max;
+} slsCullCamera;
+
+/**
+ * @brief derives the camera from the renderer's matrices
+ */
+void sls_cull_camera_init(slsCullCamera* self,
+                          kmMat4 const* modelview,
+                          kmMat4 const* projection) SLS_NONNULL(1, 2, 3);
+
+slsCullSet* sls_cullset_init(slsCullSet* self,
+                             slsCullShape shape,
+                             size_t capacity) SLS_NONNULL(1);
+
+slsCullSet* sls_cullset_dtor(slsCullSet* self) SLS_NONNULL(1);
+
+static inline void sls_cullset_clear(slsCullSet* self)
+{
+  self->n = 0;
+}
+
+/**
+ * @param bounds n_components values laid out as in slsCullShape
+ * @return index of the object, or SIZE_MAX when out of memory
+ */
+size_t sls_cullset_push(slsCullSet* self, float const* bounds)
+  SLS_NONNULL(1, 2);
+
+void sls_cullset_set(slsCullSet* self, size_t index, float const* bounds)
+  SLS_NONNULL(1, 3);
+
+/**
+ * @brief writes the indices of visible objects to `visible_out`, in
+ * ascending order
+ * @param visible_out room for set->n indices
+ * @param jobs_opt if given, large sets are split across its workers
+ * @return count of visible objects
+ */
+size_t sls_cull(slsCullCamera const* camera,
+                slsCullSet const* set,
+                uint32_t* visible_out,
+                slsJobQueue* jobs_opt) SLS_NONNULL(1, 2, 3);
+
+SLS_END_CDECLS
+
+#endif // DANGERENGINE_SLSCULL_H
@@ -0,0 +1,498 @@
+/**
+ * @file slsgeompool.c
+ * @brief
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#include "slsgeompool.h"
+#include <slsutils.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*----------------------------------------*
+ * free lists
+ *----------------------------------------*/
+
+slsGeomFreeList* sls_geom_freelist_init(slsGeomFreeList* self,
+                                        uint32_t capacity)
+{
+  *self = (slsGeomFreeList){};
+  if (capacity > 0 && !sls_geom_freelist_free(self, 0, capacity)) {
+    return NULL;
+  }
+  return self;
+}
+
+slsGeomFreeList* sls_geom_freelist_dtor(slsGeomFreeList* self)
+{
+  free(self->ranges);
+  *self = (slsGeomFreeList){};
+  return self;
+}
+
+uint32_t sls_geom_freelist_alloc(slsGeomFreeList* self, uint32_t count)
+{
+  for (size_t i = 0; i < self->n_ranges; ++i) {
+    slsGeomRange* range = self->ranges + i;
+    if (range->count < count) {
+      continue;
+    }
+
+    uint32_t first = range->first;
+    range->first += count;
+    range->count -= count;
+    if (range->count == 0) {
+      memmove(range,
+              range + 1,
+              (self->n_ranges - i - 1) * sizeof(*self->ranges));
+      self->n_ranges--;
+    }
+    return first;
+  }
+  return UINT32_MAX;
+}
+
+bool sls_geom_freelist_free(slsGeomFreeList* self,
+                            uint32_t first,
+                            uint32_t count)
+{
+  if (count == 0) {
+    return true;
+  }
+
+  // first range starting after the freed one
+  size_t lo = 0, hi = self->n_ranges;
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    if (self->ranges[mid].first < first) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  size_t i = lo;
+
+  slsGeomRange* prev = i > 0 ? self->ranges + i - 1 : NULL;
+  slsGeomRange* next = i < self->n_ranges ? self->ranges + i : NULL;
+  assert(!prev || prev->first + prev->count <= first);
+  assert(!next || first + count <= next->first);
+
+  bool joins_prev = prev && prev->first + prev->count == first;
+  bool joins_next = next && first + count == next->first;
+
+  if (joins_prev && joins_next) {
+    prev->count += count + next->count;
+    memmove(next, next + 1, (self->n_ranges - i - 1) * sizeof(*next));
+    self->n_ranges--;
+  } else if (joins_prev) {
+    prev->count += count;
+  } else if (joins_next) {
+    next->first = first;
+    next->count += count;
+  } else {
+    if (self->n_ranges == self->capacity) {
+      size_t capacity = self->capacity ? self->capacity * 2 : 16;
+      slsGeomRange* ranges =
+        realloc(self->ranges, capacity * sizeof(*ranges));
+      if (!ranges) {
+        return false;
+      }
+      self->ranges = ranges;
+      self->capacity = capacity;
+    }
+    memmove(self->ranges + i + 1,
+            self->ranges + i,
+            (self->n_ranges - i) * sizeof(*self->ranges));
+    self->ranges[i] = (slsGeomRange){.first = first, .count = count };
+    self->n_ranges++;
+  }
+  return true;
+}
+
+/*----------------------------------------*
+ * geometry pool
+ *----------------------------------------*/
+
+/**
+ * @brief replaces `*buffer` with one of `new_size` bytes holding the first
+ * `old_size` bytes of the old one
+ */
+static void sls_geompool_regrow_buffer(GLuint* buffer,
+                                       size_t old_size,
+                                       size_t new_size)
+{
+  GLuint grown;
+  glGenBuffers(1, &grown);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+  glBufferData(
+    GL_COPY_WRITE_BUFFER, (GLsizeiptr)new_size, NULL, GL_STATIC_DRAW);
+
+  if (*buffer && old_size > 0) {
+    glBindBuffer(GL_COPY_READ_BUFFER, *buffer);
+    glCopyBufferSubData(
+      GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, (GLsizeiptr)old_size);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+  if (*buffer) {
+    glDeleteBuffers(1, buffer);
+  }
+  *buffer = grown;
+}
+
+/**
+ * @brief points the vao at the current buffers
+ */
+static void sls_geompool_bind_vao(slsGeomPool* self)
+{
+  glBindVertexArray(self->vao);
+  glBindBuffer(GL_ARRAY_BUFFER, self->vbo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, self->ibo);
+  sls_vertex_format_apply(&self->format, 0);
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/**
+ * @brief doubles a capacity, or grows it to fit `needed` more elements,
+ * clamped to what 32 bit indices can address
+ * @return false if `needed` more elements cannot be addressed
+ */
+static bool sls_geompool_grown_capacity(uint32_t old,
+                                        uint32_t needed,
+                                        uint32_t* capacity_out)
+{
+  uint64_t wanted = (uint64_t)old + needed;
+  uint64_t doubled = (uint64_t)old * 2;
+  uint64_t capacity = doubled > wanted ? doubled : wanted;
+  if (wanted > UINT32_MAX || wanted == old) {
+    return false;
+  }
+  *capacity_out = capacity > UINT32_MAX ? UINT32_MAX : (uint32_t)capacity;
+  return true;
+}
+
+static bool sls_geompool_grow_vertices(slsGeomPool* self, uint32_t needed)
+{
+  uint32_t old = self->vertex_capacity;
+  uint32_t capacity;
+  sls_check(sls_geompool_grown_capacity(old, needed, &capacity),
+            "geometry pool vertex count overflows");
+
+  sls_geompool_regrow_buffer(&self->vbo,
+                             old * self->format.stride,
+                             capacity * self->format.stride);
+  sls_check(sls_geom_freelist_free(&self->free_vertices, old, capacity - old),
+            "could not grow the vertex free list");
+  self->vertex_capacity = capacity;
+  sls_geompool_bind_vao(self);
+  return true;
+error:
+  return false;
+}
+
+static bool sls_geompool_grow_indices(slsGeomPool* self, uint32_t needed)
+{
+  uint32_t old = self->index_capacity;
+  uint32_t capacity;
+  sls_check(sls_geompool_grown_capacity(old, needed, &capacity),
+            "geometry pool index count overflows");
+
+  sls_geompool_regrow_buffer(
+    &self->ibo, old * sizeof(uint32_t), capacity * sizeof(uint32_t));
+  sls_check(sls_geom_freelist_free(&self->free_indices, old, capacity - old),
+            "could not grow the index free list");
+  self->index_capacity = capacity;
+  sls_geompool_bind_vao(self);
+  return true;
+error:
+  return false;
+}
+
+slsGeomPool* sls_geompool_init(slsGeomPool* self,
+                               slsVertexLayout layout,
+                               uint32_t vertex_capacity,
+                               uint32_t index_capacity)
+{
+  *self = (slsGeomPool){};
+  sls_check(layout.position != SLS_POSITION_UNORM16_AABB,
+            "pooled meshes cannot share quantisation bounds");
+  sls_vertex_format_init(&self->format, layout);
+
+  sls_checkmem(sls_geom_freelist_init(&self->free_vertices, 0));
+  sls_checkmem(sls_geom_freelist_init(&self->free_indices, 0));
+
+  glGenVertexArrays(1, &self->vao);
+  sls_check(sls_geompool_grow_vertices(self, vertex_capacity ? vertex_capacity
+                                                             : 1024),
+            "could not create the pool's vertex buffer");
+  sls_check(
+    sls_geompool_grow_indices(self, index_capacity ? index_capacity : 4096),
+    "could not create the pool's index buffer");
+
+  self->indirect = GLAD_GL_ARB_multi_draw_indirect;
+  self->base_instance = GLAD_GL_ARB_base_instance;
+  self->base_instance_location = -1;
+  return self;
+error:
+  sls_geompool_dtor(self);
+  return NULL;
+}
+
+slsGeomPool* sls_geompool_dtor(slsGeomPool* self)
+{
+  if (self->vao) {
+    glDeleteVertexArrays(1, &self->vao);
+  }
+  GLuint buffers[] = { self->vbo, self->ibo, self->indirect_buffer };
+  for (size_t i = 0; i < SLS_ARRAY_COUNT(buffers); ++i) {
+    if (buffers[i]) {
+      glDeleteBuffers(1, buffers + i);
+    }
+  }
+
+  sls_geom_freelist_dtor(&self->free_vertices);
+  sls_geom_freelist_dtor(&self->free_indices);
+  free(self->commands);
+  free(self->counts);
+  free(self->offsets);
+  free(self->base_vertices);
+  *self = (slsGeomPool){};
+  return self;
+}
+
+bool sls_geompool_add(slsGeomPool* self,
+                      slsVertex const* vertices,
+                      size_t n_vertices,
+                      uint32_t const* indices,
+                      size_t n_indices,
+                      slsGeomMesh* mesh_out)
+{
+  void* packed = NULL;
+  *mesh_out = (slsGeomMesh){};
+  sls_check(n_vertices > 0 && n_indices > 0 && n_vertices < UINT32_MAX &&
+              n_indices < UINT32_MAX,
+            "bad pooled mesh size");
+
+  uint32_t n_verts = (uint32_t)n_vertices, n_idxs = (uint32_t)n_indices;
+  uint32_t base = sls_geom_freelist_alloc(&self->free_vertices, n_verts);
+  if (base == UINT32_MAX && sls_geompool_grow_vertices(self, n_verts)) {
+    base = sls_geom_freelist_alloc(&self->free_vertices, n_verts);
+  }
+  sls_check(base != UINT32_MAX, "geometry pool is out of vertices");
+
+  uint32_t first = sls_geom_freelist_alloc(&self->free_indices, n_idxs);
+  if (first == UINT32_MAX && sls_geompool_grow_indices(self, n_idxs)) {
+    first = sls_geom_freelist_alloc(&self->free_indices, n_idxs);
+  }
+  if (first == UINT32_MAX) {
+    sls_geom_freelist_free(&self->free_vertices, base, n_verts);
+    sls_log_err("geometry pool is out of indices");
+    return false;
+  }
+  size_t stride = self->format.stride;
+  void const* vertex_data = vertices;
+  if (!sls_vertex_format_is_native(&self->format)) {
+    packed = malloc(n_vertices * stride);
+    sls_checkmem(packed);
+    sls_vertex_format_pack(&self->format, vertices, n_vertices, packed);
+    vertex_data = packed;
+  }
+
+  // copy-write binding leaves the vao's element binding untouched
+  glBindBuffer(GL_COPY_WRITE_BUFFER, self->vbo);
+  glBufferSubData(GL_COPY_WRITE_BUFFER,
+                  (GLintptr)(base * stride),
+                  (GLsizeiptr)(n_vertices * stride),
+                  vertex_data);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, self->ibo);
+  glBufferSubData(GL_COPY_WRITE_BUFFER,
+                  (GLintptr)(first * sizeof(uint32_t)),
+                  (GLsizeiptr)(n_indices * sizeof(uint32_t)),
+                  indices);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  free(packed);
+
+  *mesh_out = (slsGeomMesh){.base_vertex = base,
+                            .n_vertices = n_verts,
+                            .first_index = first,
+                            .n_indices = n_idxs };
+  return true;
+error:
+  free(packed);
+  return false;
+}
+
+bool sls_geompool_add_mesh(slsGeomPool* self,
+                           slsMesh const* mesh,
+                           slsGeomMesh* mesh_out)
+{
+  if (!mesh->has_shadow) {
+    sls_log_err("only meshes with a CPU copy can be pooled");
+    *mesh_out = (slsGeomMesh){};
+    return false;
+  }
+  return sls_geompool_add(self,
+                          mesh->vertices.data,
+                          mesh->vertices.length,
+                          mesh->indices.data,
+                          mesh->indices.length,
+                          mesh_out);
+}
+
+void sls_geompool_remove(slsGeomPool* self, slsGeomMesh const* mesh)
+{
+  sls_geom_freelist_free(
+    &self->free_vertices, mesh->base_vertex, mesh->n_vertices);
+  sls_geom_freelist_free(
+    &self->free_indices, mesh->first_index, mesh->n_indices);
+}
+
+void sls_geompool_push(slsGeomPool* self,
+                       slsGeomMesh const* mesh,
+                       GLuint base_instance)
+{
+  if (mesh->n_indices == 0) {
+    return;
+  }
+
+  if (self->n_commands == self->commands_capacity) {
+    size_t capacity = self->commands_capacity ? self->commands_capacity * 2
+                                              : 64;
+    slsDrawElementsIndirectCommand* commands =
+      realloc(self->commands, capacity * sizeof(*commands));
+    GLsizei* counts = realloc(self->counts, capacity * sizeof(*counts));
+    void const** offsets = realloc(self->offsets, capacity * sizeof(*offsets));
+    GLint* base_vertices =
+      realloc(self->base_vertices, capacity * sizeof(*base_vertices));
+    // keep whichever arrays grew, so a later attempt can retry
+    self->commands = commands ? commands : self->commands;
+    self->counts = counts ? counts : self->counts;
+    self->offsets = offsets ? offsets : self->offsets;
+    self->base_vertices = base_vertices ? base_vertices : self->base_vertices;
+    if (!commands || !counts || !offsets || !base_vertices) {
+      sls_log_err("out of memory queueing pooled draws");
+      return;
+    }
+    self->commands_capacity = capacity;
+  }
+
+  self->commands[self->n_commands++] = (slsDrawElementsIndirectCommand){
+    .count = mesh->n_indices,
+    .instance_count = 1,
+    .first_index = mesh->first_index,
+    .base_vertex = (GLint)mesh->base_vertex,
+    .base_instance = base_instance
+  };
+}
+
+/**
+ * @return offset of the commands within the buffer bound to
+ * GL_DRAW_INDIRECT_BUFFER
+ */
+static GLintptr sls_geompool_upload_commands(slsGeomPool* self,
+                                             slsStreamBuffer* stream_opt)
+{
+  size_t size = self->n_commands * sizeof(*self->commands);
+
+  if (stream_opt) {
+    GLintptr offset = sls_streambuffer_write(
+      stream_opt, self->commands, size, sizeof(GLuint));
+    if (offset >= 0) {
+      glBindBuffer(GL_DRAW_INDIRECT_BUFFER, stream_opt->buffer);
+      return offset;
+    }
+  }
+
+  if (!self->indirect_buffer) {
+    glGenBuffers(1, &self->indirect_buffer);
+  }
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, self->indirect_buffer);
+  if (size > self->indirect_capacity) {
+    self->indirect_capacity = size * 2;
+  }
+  // orphan, so commands still in flight are not overwritten
+  glBufferData(GL_DRAW_INDIRECT_BUFFER,
+               (GLsizeiptr)self->indirect_capacity,
+               NULL,
+               GL_STREAM_DRAW);
+  glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, (GLsizeiptr)size, self->commands);
+  return 0;
+}
+
+/**
+ * @brief draws each queued mesh on its own, for base instances the driver
+ * cannot apply to a multi-draw
+ */
+static size_t sls_geompool_submit_each(slsGeomPool* self)
+{
+  for (size_t i = 0; i < self->n_commands; ++i) {
+    slsDrawElementsIndirectCommand const* cmd = self->commands + i;
+    void const* offset =
+      (void const*)((uintptr_t)cmd->first_index * sizeof(uint32_t));
+    if (self->base_instance) {
+      glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES,
+                                                    (GLsizei)cmd->count,
+                                                    GL_UNSIGNED_INT,
+                                                    offset,
+                                                    1,
+                                                    cmd->base_vertex,
+                                                    cmd->base_instance);
+      continue;
+    }
+    if (self->base_instance_location >= 0) {
+      glUniform1i(self->base_instance_location, (GLint)cmd->base_instance);
+    }
+    glDrawElementsBaseVertex(GL_TRIANGLES,
+                             (GLsizei)cmd->count,
+                             GL_UNSIGNED_INT,
+                             offset,
+                             cmd->base_vertex);
+  }
+  return self->n_commands;
+}
+
+size_t sls_geompool_submit(slsGeomPool* self, slsStreamBuffer* stream_opt)
+{
+  size_t n = self->n_commands;
+  if (n == 0) {
+    return 0;
+  }
+
+  bool instanced = false;
+  for (size_t i = 0; i < n && !instanced; ++i) {
+    instanced = self->commands[i].base_instance != 0;
+  }
+
+  size_t n_submits = 1;
+  glBindVertexArray(self->vao);
+  if (self->indirect && (self->base_instance || !instanced)) {
+    GLintptr offset = sls_geompool_upload_commands(self, stream_opt);
+    glMultiDrawElementsIndirect(
+      GL_TRIANGLES, GL_UNSIGNED_INT, (void const*)offset, (GLsizei)n, 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+  } else if (instanced) {
+    n_submits = sls_geompool_submit_each(self);
+  } else {
+    for (size_t i = 0; i < n; ++i) {
+      slsDrawElementsIndirectCommand const* cmd = self->commands + i;
+      self->counts[i] = (GLsizei)cmd->count;
+      self->offsets[i] =
+        (void const*)((uintptr_t)cmd->first_index * sizeof(uint32_t));
+      self->base_vertices[i] = cmd->base_vertex;
+    }
+    glMultiDrawElementsBaseVertex(GL_TRIANGLES,
+                                  self->counts,
+                                  GL_UNSIGNED_INT,
+                                  self->offsets,
+                                  (GLsizei)n,
+                                  self->base_vertices);
+  }
+  glBindVertexArray(0);
+
+  self->n_commands = 0;
+  return n_submits;
+}
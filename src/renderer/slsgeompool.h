@@ -0,0 +1,184 @@
+/**
+ * @file slsgeompool.h
+ * @brief shared vertex and index buffers for many static meshes, drawn
+ * with multi-draw submissions
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#ifndef DANGERENGINE_SLSGEOMPOOL_H
+#define DANGERENGINE_SLSGEOMPOOL_H
+
+#include "../sls-gl.h"
+#include "slsmesh.h"
+#include "slsstreambuffer.h"
+#include "slsvertexformat.h"
+#include <slsmacros.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+SLS_BEGIN_CDECLS
+
+/**
+ * @brief a mesh's place in a slsGeomPool. Indices are relative to
+ * base_vertex.
+ */
+typedef struct slsGeomMesh {
+  uint32_t base_vertex;
+  uint32_t n_vertices;
+  uint32_t first_index;
+  uint32_t n_indices;
+} slsGeomMesh;
+
+/**
+ * @brief layout read by glMultiDrawElementsIndirect
+ */
+typedef struct slsDrawElementsIndirectCommand {
+  GLuint count;
+  GLuint instance_count;
+  GLuint first_index;
+  GLint base_vertex;
+  GLuint base_instance;
+} slsDrawElementsIndirectCommand;
+
+typedef struct slsGeomRange {
+  uint32_t first;
+  uint32_t count;
+} slsGeomRange;
+
+/**
+ * @brief first-fit allocator of element ranges. Free ranges are kept
+ * sorted and coalesced.
+ */
+typedef struct slsGeomFreeList {
+  slsGeomRange* ranges;
+  size_t n_ranges;
+  size_t capacity;
+} slsGeomFreeList;
+
+/**
+ * @brief Geometry pool.
+ * @detail Vertices share one buffer in one vertex format, and indices
+ * share a 32 bit index buffer, so every mesh in the pool draws from a
+ * single vao. Buffers double when full, copying their contents on the
+ * GPU, up to the 32 bit index limit. Batched draws are submitted with
+ * glMultiDrawElementsIndirect when ARB_multi_draw_indirect is available,
+ * and glMultiDrawElementsBaseVertex otherwise. A nonzero base_instance
+ * needs ARB_base_instance, which GL 4.1 lacks: without it, draws that use
+ * one are submitted one by one, setting base_instance_location instead.
+ */
+typedef struct slsGeomPool {
+  slsVertexFormat format;
+  GLuint vao;
+  GLuint vbo;
+  GLuint ibo;
+  uint32_t vertex_capacity;
+  uint32_t index_capacity;
+  slsGeomFreeList free_vertices;
+  slsGeomFreeList free_indices;
+
+  bool indirect;
+  /** @brief draws honour base_instance, from ARB_base_instance */
+  bool base_instance;
+  /**
+   * @brief int uniform of the bound shader set to each draw's
+   * base_instance when the driver cannot apply it, or -1
+   */
+  GLint base_instance_location;
+  /** @brief used when no stream buffer is passed to submit */
+  GLuint indirect_buffer;
+  size_t indirect_capacity;
+
+  slsDrawElementsIndirectCommand* commands;
+  size_t n_commands;
+  size_t commands_capacity;
+
+  /** @brief fallback path arguments */
+  GLsizei* counts;
+  void const** offsets;
+  GLint* base_vertices;
+} slsGeomPool;
+
+/**
+ * @param layout vertex layout of every mesh. Bounds-quantised positions
+ * are rejected, since meshes cannot share quantisation bounds.
+ * @param vertex_capacity, index_capacity initial sizes, in elements
+ */
+slsGeomPool* sls_geompool_init(slsGeomPool* self,
+                               slsVertexLayout layout,
+                               uint32_t vertex_capacity,
+                               uint32_t index_capacity) SLS_NONNULL(1);
+
+slsGeomPool* sls_geompool_dtor(slsGeomPool* self) SLS_NONNULL(1);
+
+/**
+ * @brief copies a mesh into the pool
+ * @param indices relative to the first vertex
+ */
+bool sls_geompool_add(slsGeomPool* self,
+                      slsVertex const* vertices,
+                      size_t n_vertices,
+                      uint32_t const* indices,
+                      size_t n_indices,
+                      slsGeomMesh* mesh_out) SLS_NONNULL(1, 2, 4, 6);
+
+/**
+ * @brief copies a slsMesh that still has its CPU copy into the pool
+ */
+bool sls_geompool_add_mesh(slsGeomPool* self,
+                           slsMesh const* mesh,
+                           slsGeomMesh* mesh_out) SLS_NONNULL(1, 2, 3);
+
+/**
+ * @brief releases the mesh's ranges for reuse
+ */
+void sls_geompool_remove(slsGeomPool* self, slsGeomMesh const* mesh)
+  SLS_NONNULL(1, 2);
+
+/**
+ * @brief queues a draw of `mesh` for the next submit
+ * @param base_instance available to the shader through instanced
+ * attributes, e.g. to fetch per-draw transforms, or through
+ * base_instance_location without ARB_base_instance
+ */
+void sls_geompool_push(slsGeomPool* self,
+                       slsGeomMesh const* mesh,
+                       GLuint base_instance) SLS_NONNULL(1, 2);
+
+/**
+ * @brief draws every queued mesh as triangles with the bound shader, and
+ * clears the queue
+ * @param stream_opt if given, indirect commands are streamed through it
+ * @return GL draw submissions made
+ */
+size_t sls_geompool_submit(slsGeomPool* self, slsStreamBuffer* stream_opt)
+  SLS_NONNULL(1);
+
+/*----------------------------------------*
+ * free lists
+ *----------------------------------------*/
+
+slsGeomFreeList* sls_geom_freelist_init(slsGeomFreeList* self,
+                                        uint32_t capacity) SLS_NONNULL(1);
+
+slsGeomFreeList* sls_geom_freelist_dtor(slsGeomFreeList* self)
+  SLS_NONNULL(1);
+
+/**
+ * @return first element of the allocation, or UINT32_MAX if no free range
+ * is large enough
+ */
+uint32_t sls_geom_freelist_alloc(slsGeomFreeList* self, uint32_t count)
+  SLS_NONNULL(1);
+
+/**
+ * @brief returns a range, merging it with adjacent free ranges
+ */
+bool sls_geom_freelist_free(slsGeomFreeList* self,
+                            uint32_t first,
+                            uint32_t count) SLS_NONNULL(1);
+
+SLS_END_CDECLS
+
+#endif // DANGERENGINE_SLSGEOMPOOL_H
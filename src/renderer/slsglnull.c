@@ -0,0 +1,499 @@
+/**
+ * @file slsglnull.c
+ * @brief
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#include "slsglnull.h"
+#include <slsutils.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** @brief the only extension advertised, so glad's extension scan succeeds */
+#define SLS_GLNULL_EXTENSION "GL_ARB_timer_query"
+
+/**
+ * @brief the single program binary format, and the binary every program
+ * links to. glProgramBinary rejects anything else, like a driver would after
+ * an update.
+ */
+#define SLS_GLNULL_BINARY_FORMAT 0x4e554c4cu // "NULL"
+#define SLS_GLNULL_BINARY "dangerengine null program"
+
+/** @brief buffer targets whose bindings are tracked */
+#define SLS_GLNULL_MAX_TARGETS 16
+
+/**
+ * @brief storage of a buffer object. Each buffer has its own, replaced
+ * only by glBufferData or glBufferStorage, so live mappings of different
+ * buffers never alias and are never moved.
+ */
+typedef struct slsGLNullBuffer {
+  GLuint name;
+  void* data;
+  size_t size;
+} slsGLNullBuffer;
+
+typedef struct slsGLNullBinding {
+  GLenum target;
+  GLuint name;
+} slsGLNullBinding;
+
+static GLuint sls_glnull_next_name = 1;
+
+static slsGLNullBuffer* sls_glnull_buffers = NULL;
+static size_t sls_glnull_n_buffers = 0;
+static size_t sls_glnull_buffers_capacity = 0;
+
+static slsGLNullBinding sls_glnull_bindings[SLS_GLNULL_MAX_TARGETS];
+static size_t sls_glnull_n_bindings = 0;
+
+/** @brief last program given a binary it could not load */
+static GLuint sls_glnull_rejected_program = 0;
+
+static uintptr_t APIENTRY sls_glnull_noop(void)
+{
+  return 0;
+}
+
+static GLenum APIENTRY sls_glnull_get_error(void)
+{
+  return GL_NO_ERROR;
+}
+
+static GLubyte const* APIENTRY sls_glnull_get_string(GLenum name)
+{
+  switch (name) {
+    case GL_VENDOR:
+      return (GLubyte const*)"dangerengine";
+    case GL_RENDERER:
+      return (GLubyte const*)"null";
+    case GL_VERSION:
+      return (GLubyte const*)SLS_GLNULL_VERSION;
+    case GL_SHADING_LANGUAGE_VERSION:
+      return (GLubyte const*)"4.10";
+    default:
+      return (GLubyte const*)"";
+  }
+}
+
+static GLubyte const* APIENTRY sls_glnull_get_stringi(GLenum name,
+                                                      GLuint index)
+{
+  return (GLubyte const*)(name == GL_EXTENSIONS && index == 0
+                            ? SLS_GLNULL_EXTENSION
+                            : "");
+}
+
+static void APIENTRY sls_glnull_get_integerv(GLenum pname, GLint* data)
+{
+  switch (pname) {
+    case GL_NUM_EXTENSIONS:
+    case GL_NUM_PROGRAM_BINARY_FORMATS:
+      *data = 1;
+      break;
+    case GL_MAJOR_VERSION:
+      *data = 4;
+      break;
+    case GL_MINOR_VERSION:
+      *data = 1;
+      break;
+    case GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT:
+      *data = 256;
+      break;
+    case GL_MAX_TEXTURE_SIZE:
+    case GL_MAX_RENDERBUFFER_SIZE:
+      *data = 16384;
+      break;
+    case GL_MAX_UNIFORM_BLOCK_SIZE:
+      *data = 65536;
+      break;
+    case GL_VIEWPORT:
+    case GL_SCISSOR_BOX:
+      memset(data, 0, 4 * sizeof(*data));
+      break;
+    default:
+      *data = 0;
+      break;
+  }
+}
+
+static void APIENTRY sls_glnull_gen(GLsizei n, GLuint* names)
+{
+  for (GLsizei i = 0; i < n; ++i) {
+    names[i] = sls_glnull_next_name++;
+  }
+}
+
+static GLuint APIENTRY sls_glnull_create_program(void)
+{
+  return sls_glnull_next_name++;
+}
+
+static GLuint APIENTRY sls_glnull_create_shader(GLenum type)
+{
+  return sls_glnull_next_name++;
+}
+
+static GLboolean APIENTRY sls_glnull_is(GLuint name)
+{
+  return name != 0 ? GL_TRUE : GL_FALSE;
+}
+
+static void APIENTRY sls_glnull_get_objectiv(GLuint object,
+                                             GLenum pname,
+                                             GLint* params)
+{
+  switch (pname) {
+    case GL_LINK_STATUS:
+      *params = object != sls_glnull_rejected_program ? GL_TRUE : GL_FALSE;
+      break;
+    case GL_PROGRAM_BINARY_LENGTH:
+      *params = (GLint)sizeof(SLS_GLNULL_BINARY);
+      break;
+    case GL_COMPILE_STATUS:
+    case GL_VALIDATE_STATUS:
+    case GL_COMPLETION_STATUS_KHR:
+      *params = GL_TRUE;
+      break;
+    default:
+      *params = 0;
+      break;
+  }
+}
+
+static void APIENTRY sls_glnull_get_info_log(GLuint object,
+                                             GLsizei size,
+                                             GLsizei* length,
+                                             GLchar* log)
+{
+  if (length) {
+    *length = 0;
+  }
+  if (size > 0) {
+    log[0] = '\0';
+  }
+}
+
+static void APIENTRY sls_glnull_get_program_binary(GLuint program,
+                                                   GLsizei size,
+                                                   GLsizei* length,
+                                                   GLenum* format,
+                                                   void* binary)
+{
+  GLsizei n = size < (GLsizei)sizeof(SLS_GLNULL_BINARY)
+                ? 0
+                : (GLsizei)sizeof(SLS_GLNULL_BINARY);
+  memcpy(binary, SLS_GLNULL_BINARY, (size_t)n);
+  *format = SLS_GLNULL_BINARY_FORMAT;
+  if (length) {
+    *length = n;
+  }
+}
+
+static void APIENTRY sls_glnull_program_binary(GLuint program,
+                                               GLenum format,
+                                               void const* binary,
+                                               GLsizei length)
+{
+  bool valid = format == SLS_GLNULL_BINARY_FORMAT &&
+               length == (GLsizei)sizeof(SLS_GLNULL_BINARY) &&
+               memcmp(binary, SLS_GLNULL_BINARY, (size_t)length) == 0;
+  if (!valid) {
+    sls_glnull_rejected_program = program;
+  } else if (sls_glnull_rejected_program == program) {
+    sls_glnull_rejected_program = 0;
+  }
+}
+
+static GLint APIENTRY sls_glnull_get_location(GLuint program,
+                                              GLchar const* name)
+{
+  return 0;
+}
+
+static slsGLNullBuffer* sls_glnull_find_buffer(GLuint name)
+{
+  for (size_t i = 0; name != 0 && i < sls_glnull_n_buffers; ++i) {
+    if (sls_glnull_buffers[i].name == name) {
+      return sls_glnull_buffers + i;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @return the buffer bound to `target`, or NULL if there is none
+ */
+static slsGLNullBuffer* sls_glnull_bound_buffer(GLenum target)
+{
+  for (size_t i = 0; i < sls_glnull_n_bindings; ++i) {
+    if (sls_glnull_bindings[i].target == target) {
+      return sls_glnull_find_buffer(sls_glnull_bindings[i].name);
+    }
+  }
+  return NULL;
+}
+
+static void APIENTRY sls_glnull_gen_buffers(GLsizei n, GLuint* names)
+{
+  sls_glnull_gen(n, names);
+  size_t needed = sls_glnull_n_buffers + (size_t)n;
+  if (needed > sls_glnull_buffers_capacity) {
+    size_t capacity = sls_glnull_buffers_capacity * 2;
+    capacity = capacity > needed ? capacity : needed;
+    slsGLNullBuffer* buffers =
+      realloc(sls_glnull_buffers, capacity * sizeof(slsGLNullBuffer));
+    if (!buffers) {
+      return;
+    }
+    sls_glnull_buffers = buffers;
+    sls_glnull_buffers_capacity = capacity;
+  }
+  for (GLsizei i = 0; i < n; ++i) {
+    sls_glnull_buffers[sls_glnull_n_buffers++] =
+      (slsGLNullBuffer){.name = names[i] };
+  }
+}
+
+static void APIENTRY sls_glnull_delete_buffers(GLsizei n, GLuint const* names)
+{
+  for (GLsizei i = 0; i < n; ++i) {
+    slsGLNullBuffer* buffer = sls_glnull_find_buffer(names[i]);
+    if (!buffer) {
+      continue;
+    }
+    free(buffer->data);
+    *buffer = sls_glnull_buffers[--sls_glnull_n_buffers];
+    for (size_t k = 0; k < sls_glnull_n_bindings; ++k) {
+      if (sls_glnull_bindings[k].name == names[i]) {
+        sls_glnull_bindings[k].name = 0;
+      }
+    }
+  }
+}
+
+static void APIENTRY sls_glnull_bind_buffer(GLenum target, GLuint name)
+{
+  size_t i = 0;
+  while (i < sls_glnull_n_bindings && sls_glnull_bindings[i].target != target) {
+    ++i;
+  }
+  if (i == sls_glnull_n_bindings) {
+    if (i == SLS_GLNULL_MAX_TARGETS) {
+      return;
+    }
+    sls_glnull_n_bindings++;
+  }
+  sls_glnull_bindings[i] = (slsGLNullBinding){ target, name };
+}
+
+static void APIENTRY sls_glnull_bind_buffer_range(GLenum target,
+                                                  GLuint index,
+                                                  GLuint name,
+                                                  GLintptr offset,
+                                                  GLsizeiptr size)
+{
+  sls_glnull_bind_buffer(target, name);
+}
+
+static void APIENTRY sls_glnull_bind_buffer_base(GLenum target,
+                                                 GLuint index,
+                                                 GLuint name)
+{
+  sls_glnull_bind_buffer(target, name);
+}
+
+/**
+ * @brief replaces the bound buffer's storage. As in GL, this invalidates a
+ * mapping of the old storage.
+ */
+static void APIENTRY sls_glnull_buffer_data(GLenum target,
+                                            GLsizeiptr size,
+                                            void const* data,
+                                            GLenum usage)
+{
+  slsGLNullBuffer* buffer = sls_glnull_bound_buffer(target);
+  if (!buffer || size < 0) {
+    return;
+  }
+  free(buffer->data);
+  buffer->data = calloc((size_t)size + 1, 1);
+  buffer->size = buffer->data ? (size_t)size : 0;
+  if (buffer->data && data) {
+    memcpy(buffer->data, data, (size_t)size);
+  }
+}
+
+static void APIENTRY sls_glnull_buffer_storage(GLenum target,
+                                               GLsizeiptr size,
+                                               void const* data,
+                                               GLbitfield flags)
+{
+  sls_glnull_buffer_data(target, size, data, GL_STATIC_DRAW);
+}
+
+static void APIENTRY sls_glnull_buffer_sub_data(GLenum target,
+                                                GLintptr offset,
+                                                GLsizeiptr size,
+                                                void const* data)
+{
+  slsGLNullBuffer* buffer = sls_glnull_bound_buffer(target);
+  if (buffer && data && offset >= 0 && size >= 0 &&
+      (size_t)offset + (size_t)size <= buffer->size) {
+    memcpy((char*)buffer->data + offset, data, (size_t)size);
+  }
+}
+
+/**
+ * @return the range inside the bound buffer's own storage, or NULL as GL
+ * would for a range outside it
+ */
+static void* APIENTRY sls_glnull_map_buffer_range(GLenum target,
+                                                  GLintptr offset,
+                                                  GLsizeiptr length,
+                                                  GLbitfield access)
+{
+  slsGLNullBuffer* buffer = sls_glnull_bound_buffer(target);
+  if (!buffer || !buffer->data || offset < 0 || length < 0 ||
+      (size_t)offset + (size_t)length > buffer->size) {
+    return NULL;
+  }
+  return (char*)buffer->data + offset;
+}
+
+static GLboolean APIENTRY sls_glnull_unmap_buffer(GLenum target)
+{
+  return GL_TRUE;
+}
+
+static GLsync APIENTRY sls_glnull_fence_sync(GLenum condition,
+                                             GLbitfield flags)
+{
+  return (GLsync)(uintptr_t)sls_glnull_next_name++;
+}
+
+static GLenum APIENTRY sls_glnull_client_wait_sync(GLsync sync,
+                                                   GLbitfield flags,
+                                                   GLuint64 timeout)
+{
+  return GL_ALREADY_SIGNALED;
+}
+
+static GLenum APIENTRY sls_glnull_check_framebuffer_status(GLenum target)
+{
+  return GL_FRAMEBUFFER_COMPLETE;
+}
+
+/**
+ * @brief query results are immediately available, and always zero
+ */
+static void APIENTRY sls_glnull_get_query_objectiv(GLuint id,
+                                                   GLenum pname,
+                                                   GLint* params)
+{
+  *params = pname == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0;
+}
+
+static void APIENTRY sls_glnull_get_query_objectuiv(GLuint id,
+                                                    GLenum pname,
+                                                    GLuint* params)
+{
+  *params = pname == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0;
+}
+
+static void APIENTRY sls_glnull_get_query_object64v(GLuint id,
+                                                    GLenum pname,
+                                                    GLuint64* params)
+{
+  *params = pname == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0;
+}
+
+typedef struct slsGLNullProc {
+  char const* name;
+  void* proc;
+} slsGLNullProc;
+
+static slsGLNullProc const sls_glnull_procs[] = {
+  { "glGetError", (void*)sls_glnull_get_error },
+  { "glGetString", (void*)sls_glnull_get_string },
+  { "glGetStringi", (void*)sls_glnull_get_stringi },
+  { "glGetIntegerv", (void*)sls_glnull_get_integerv },
+
+  { "glGenBuffers", (void*)sls_glnull_gen_buffers },
+  { "glGenFramebuffers", (void*)sls_glnull_gen },
+  { "glGenProgramPipelines", (void*)sls_glnull_gen },
+  { "glGenQueries", (void*)sls_glnull_gen },
+  { "glGenRenderbuffers", (void*)sls_glnull_gen },
+  { "glGenSamplers", (void*)sls_glnull_gen },
+  { "glGenTextures", (void*)sls_glnull_gen },
+  { "glGenTransformFeedbacks", (void*)sls_glnull_gen },
+  { "glGenVertexArrays", (void*)sls_glnull_gen },
+  { "glCreateProgram", (void*)sls_glnull_create_program },
+  { "glCreateShader", (void*)sls_glnull_create_shader },
+
+  { "glIsBuffer", (void*)sls_glnull_is },
+  { "glIsFramebuffer", (void*)sls_glnull_is },
+  { "glIsProgram", (void*)sls_glnull_is },
+  { "glIsRenderbuffer", (void*)sls_glnull_is },
+  { "glIsShader", (void*)sls_glnull_is },
+  { "glIsTexture", (void*)sls_glnull_is },
+  { "glIsVertexArray", (void*)sls_glnull_is },
+
+  { "glGetProgramiv", (void*)sls_glnull_get_objectiv },
+  { "glGetShaderiv", (void*)sls_glnull_get_objectiv },
+  { "glGetProgramInfoLog", (void*)sls_glnull_get_info_log },
+  { "glGetShaderInfoLog", (void*)sls_glnull_get_info_log },
+  { "glGetProgramBinary", (void*)sls_glnull_get_program_binary },
+  { "glProgramBinary", (void*)sls_glnull_program_binary },
+  { "glGetAttribLocation", (void*)sls_glnull_get_location },
+  { "glGetUniformLocation", (void*)sls_glnull_get_location },
+  { "glGetUniformBlockIndex", (void*)sls_glnull_get_location },
+
+  { "glDeleteBuffers", (void*)sls_glnull_delete_buffers },
+  { "glBindBuffer", (void*)sls_glnull_bind_buffer },
+  { "glBindBufferBase", (void*)sls_glnull_bind_buffer_base },
+  { "glBindBufferRange", (void*)sls_glnull_bind_buffer_range },
+  { "glBufferData", (void*)sls_glnull_buffer_data },
+  { "glBufferStorage", (void*)sls_glnull_buffer_storage },
+  { "glBufferSubData", (void*)sls_glnull_buffer_sub_data },
+  { "glMapBufferRange", (void*)sls_glnull_map_buffer_range },
+  { "glUnmapBuffer", (void*)sls_glnull_unmap_buffer },
+  { "glFenceSync", (void*)sls_glnull_fence_sync },
+  { "glClientWaitSync", (void*)sls_glnull_client_wait_sync },
+  { "glCheckFramebufferStatus", (void*)sls_glnull_check_framebuffer_status },
+
+  { "glGetQueryObjectiv", (void*)sls_glnull_get_query_objectiv },
+  { "glGetQueryObjectuiv", (void*)sls_glnull_get_query_objectuiv },
+  { "glGetQueryObjecti64v", (void*)sls_glnull_get_query_object64v },
+  { "glGetQueryObjectui64v", (void*)sls_glnull_get_query_object64v },
+};
+
+static void* sls_glnull_get_proc(char const* name)
+{
+  for (size_t i = 0; i < SLS_ARRAY_COUNT(sls_glnull_procs); ++i) {
+    if (strcmp(sls_glnull_procs[i].name, name) == 0) {
+      return sls_glnull_procs[i].proc;
+    }
+  }
+  return (void*)sls_glnull_noop;
+}
+
+bool sls_glnull_load(void)
+{
+  if (!gladLoadGLLoader(sls_glnull_get_proc)) {
+    sls_log_err("could not load the null GL backend");
+    return false;
+  }
+  sls_log_info("using the null GL backend: no rendering will happen");
+  return true;
+}
+
+bool sls_glnull_requested(void)
+{
+  char const* value = getenv("SLS_GL_NULL");
+  return value && *value && strcmp(value, "0") != 0;
+}
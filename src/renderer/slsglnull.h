@@ -0,0 +1,42 @@
+/**
+ * @file slsglnull.h
+ * @brief GL backend that accepts every call and draws nothing
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#ifndef DANGERENGINE_SLSGLNULL_H
+#define DANGERENGINE_SLSGLNULL_H
+
+#include "../sls-gl.h"
+#include <slsmacros.h>
+#include <stdbool.h>
+
+SLS_BEGIN_CDECLS
+
+/** @brief version string reported by the null backend */
+#define SLS_GLNULL_VERSION "4.1 dangerengine null"
+
+/**
+ * @brief points glad at stub functions in place of a driver, so the
+ * engine's GL usage can be recorded (see slsglrecord.h) on machines
+ * without a GPU. Calls succeed: names are generated, shaders compile,
+ * framebuffers are complete and each buffer object has its own storage, so
+ * mappings stay valid until the buffer is respecified or deleted.
+ * Programs share one fixed binary, and glProgramBinary fails the link of
+ * any other. Queries return zero. Functions without a dedicated stub share
+ * a no-op, which relies on the caller cleaning up arguments, so the backend
+ * is unavailable where GL uses stdcall (32-bit Windows).
+ */
+bool sls_glnull_load(void);
+
+/**
+ * @return true if the SLS_GL_NULL environment variable asks for the null
+ * backend
+ */
+bool sls_glnull_requested(void);
+
+SLS_END_CDECLS
+
+#endif // DANGERENGINE_SLSGLNULL_H
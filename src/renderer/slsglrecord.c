@@ -0,0 +1,755 @@
+/**
+ * @file slsglrecord.c
+ * @brief
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#include "slsglrecord.h"
+#include <slsutils.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*----------------------------------------*
+ * call table
+ *----------------------------------------*/
+
+#define SLS_NO_UPLOAD                                                          \
+  .size = -1, .data = -1, .width = -1, .height = -1, .format = -1, .type = -1
+
+#define SLS_GLCALL(fn, sig, call_kind)                                         \
+  {                                                                            \
+    .name = fn, .signature = sig, .kind = call_kind, .set_value = -1,          \
+    SLS_NO_UPLOAD                                                              \
+  }
+
+#define SLS_GLSTATE(fn, sig, key_args)                                         \
+  {                                                                            \
+    .name = fn, .signature = sig, .kind = SLS_GLCALL_STATE,                    \
+    .n_key = key_args, .set_value = -1, SLS_NO_UPLOAD                          \
+  }
+
+#define SLS_GLUPLOAD(fn, sig, call_kind, size_arg, data_arg)                   \
+  {                                                                            \
+    .name = fn, .signature = sig, .kind = call_kind, .set_value = -1,          \
+    .size = size_arg, .data = data_arg, .width = -1, .height = -1,             \
+    .format = -1, .type = -1                                                   \
+  }
+
+#define SLS_GLTEXUPLOAD(fn, sig, w, h, fmt, ty, data_arg)                      \
+  {                                                                            \
+    .name = fn, .signature = sig, .kind = SLS_GLCALL_TEXTURE_UPLOAD,           \
+    .set_value = -1, .size = -1, .data = data_arg, .width = w, .height = h,    \
+    .format = fmt, .type = ty                                                  \
+  }
+
+static slsGLCallDesc const sls_glcall_table[] = {
+  SLS_GLSTATE("glActiveTexture", "u", 0),
+  SLS_GLSTATE("glBindBuffer", "uu", 1),
+  SLS_GLSTATE("glBindBufferBase", "uuu", 2),
+  SLS_GLSTATE("glBindBufferRange", "uuuzz", 2),
+  {.name = "glBindTexture",
+   .signature = "uu",
+   .kind = SLS_GLCALL_STATE,
+   .n_key = 1,
+   .set_value = -1,
+   .per_unit = true,
+   SLS_NO_UPLOAD },
+  SLS_GLSTATE("glBindSampler", "uu", 1),
+  SLS_GLSTATE("glBindVertexArray", "u", 0),
+  SLS_GLSTATE("glBindFramebuffer", "uu", 1),
+  SLS_GLSTATE("glBindRenderbuffer", "uu", 1),
+  SLS_GLSTATE("glUseProgram", "u", 0),
+  {.name = "glEnable",
+   .signature = "u",
+   .kind = SLS_GLCALL_STATE,
+   .n_key = 1,
+   .group = "capability",
+   .set_value = 1,
+   SLS_NO_UPLOAD },
+  {.name = "glDisable",
+   .signature = "u",
+   .kind = SLS_GLCALL_STATE,
+   .n_key = 1,
+   .group = "capability",
+   .set_value = 0,
+   SLS_NO_UPLOAD },
+  SLS_GLSTATE("glBlendFunc", "uu", 0),
+  SLS_GLSTATE("glBlendFuncSeparate", "uuuu", 0),
+  SLS_GLSTATE("glBlendEquation", "u", 0),
+  SLS_GLSTATE("glDepthFunc", "u", 0),
+  SLS_GLSTATE("glDepthMask", "u", 0),
+  SLS_GLSTATE("glCullFace", "u", 0),
+  SLS_GLSTATE("glFrontFace", "u", 0),
+  SLS_GLSTATE("glColorMask", "uuuu", 0),
+  SLS_GLSTATE("glViewport", "iiii", 0),
+  SLS_GLSTATE("glScissor", "iiii", 0),
+  SLS_GLSTATE("glClearColor", "ffff", 0),
+  SLS_GLSTATE("glPixelStorei", "ui", 1),
+
+  SLS_GLCALL("glDrawArrays", "uii", SLS_GLCALL_DRAW),
+  SLS_GLCALL("glDrawArraysInstanced", "uiii", SLS_GLCALL_DRAW),
+  SLS_GLCALL("glDrawArraysIndirect", "up", SLS_GLCALL_DRAW),
+  SLS_GLCALL("glDrawElements", "uiup", SLS_GLCALL_DRAW),
+  SLS_GLCALL("glDrawElementsBaseVertex", "uiupi", SLS_GLCALL_DRAW),
+  SLS_GLCALL("glDrawElementsInstanced", "uiupi", SLS_GLCALL_DRAW),
+  SLS_GLCALL(
+    "glDrawElementsInstancedBaseVertex", "uiupii", SLS_GLCALL_DRAW),
+  SLS_GLCALL("glDrawElementsIndirect", "uup", SLS_GLCALL_DRAW),
+  SLS_GLCALL("glDrawRangeElements", "uuuiup", SLS_GLCALL_DRAW),
+  SLS_GLCALL("glMultiDrawArrays", "uppi", SLS_GLCALL_DRAW),
+  SLS_GLCALL("glMultiDrawArraysIndirect", "upii", SLS_GLCALL_DRAW),
+  SLS_GLCALL("glMultiDrawElements", "upupi", SLS_GLCALL_DRAW),
+  SLS_GLCALL("glMultiDrawElementsBaseVertex", "upupip", SLS_GLCALL_DRAW),
+  SLS_GLCALL("glMultiDrawElementsIndirect", "uupii", SLS_GLCALL_DRAW),
+
+  SLS_GLUPLOAD("glBufferData", "uzpu", SLS_GLCALL_BUFFER_UPLOAD, 1, 2),
+  SLS_GLUPLOAD("glBufferSubData", "uzzp", SLS_GLCALL_BUFFER_UPLOAD, 2, 3),
+  SLS_GLUPLOAD("glBufferStorage", "uzpu", SLS_GLCALL_BUFFER_UPLOAD, 1, 2),
+  // mapped ranges count in full, as whatever is written gets uploaded
+  SLS_GLUPLOAD("glMapBufferRange", "uzzu", SLS_GLCALL_BUFFER_UPLOAD, 2, -1),
+  SLS_GLTEXUPLOAD("glTexImage2D", "uiuiiiuup", 3, 4, 6, 7, 8),
+  SLS_GLTEXUPLOAD("glTexSubImage2D", "uiiiiiuup", 4, 5, 6, 7, 8),
+  SLS_GLUPLOAD(
+    "glCompressedTexImage2D", "uiuiiiip", SLS_GLCALL_COMPRESSED_UPLOAD, 6, 7),
+  SLS_GLUPLOAD("glCompressedTexSubImage2D",
+               "uiiiiiuip",
+               SLS_GLCALL_COMPRESSED_UPLOAD,
+               7,
+               8),
+
+  SLS_GLCALL("glDeleteBuffers", "ip", SLS_GLCALL_DELETE),
+  SLS_GLCALL("glDeleteFramebuffers", "ip", SLS_GLCALL_DELETE),
+  SLS_GLCALL("glDeleteProgram", "u", SLS_GLCALL_DELETE),
+  SLS_GLCALL("glDeleteRenderbuffers", "ip", SLS_GLCALL_DELETE),
+  SLS_GLCALL("glDeleteSamplers", "ip", SLS_GLCALL_DELETE),
+  SLS_GLCALL("glDeleteTextures", "ip", SLS_GLCALL_DELETE),
+  SLS_GLCALL("glDeleteVertexArrays", "ip", SLS_GLCALL_DELETE),
+};
+
+slsGLCallDesc const* sls_glcall_desc(char const* name)
+{
+  for (size_t i = 0; i < SLS_ARRAY_COUNT(sls_glcall_table); ++i) {
+    if (strcmp(sls_glcall_table[i].name, name) == 0) {
+      return sls_glcall_table + i;
+    }
+  }
+  return NULL;
+}
+
+/*----------------------------------------*
+ * capture
+ *----------------------------------------*/
+
+#define SLS_GLRECORD_SLOTS (SLS_GLLOG_MAX_FUNCS * 2)
+#define SLS_GLRECORD_BUFFER (64 * 1024)
+/** @brief largest record: opcode, count and maximal varints */
+#define SLS_GLRECORD_MAX_RECORD (3 + SLS_GLLOG_MAX_ARGS * 10)
+
+/**
+ * @brief function ids, keyed by the address of the name glad passes,
+ * which is a string literal unique to each function
+ */
+typedef struct slsGLRecordSlot {
+  char const* name;
+  slsGLCallDesc const* desc;
+  uint16_t id;
+} slsGLRecordSlot;
+
+typedef struct slsGLRecorder {
+  FILE* fp;
+  slsGLRecordSlot* slots;
+  char const** names;
+  size_t n_funcs;
+
+  uint8_t* buffer;
+  size_t length;
+} slsGLRecorder;
+
+static slsGLRecorder sls_glrecorder;
+
+static void sls_glrecord_flush(slsGLRecorder* self)
+{
+  if (self->length > 0) {
+    fwrite(self->buffer, 1, self->length, self->fp);
+    self->length = 0;
+  }
+}
+
+static inline void sls_glrecord_reserve(slsGLRecorder* self, size_t n)
+{
+  if (self->length + n > SLS_GLRECORD_BUFFER) {
+    sls_glrecord_flush(self);
+  }
+}
+
+static inline void sls_glrecord_put_u16(slsGLRecorder* self, uint16_t value)
+{
+  memcpy(self->buffer + self->length, &value, sizeof(value));
+  self->length += sizeof(value);
+}
+
+static inline void sls_glrecord_put_varint(slsGLRecorder* self,
+                                           uint64_t value)
+{
+  do {
+    uint8_t byte = value & 0x7f;
+    value >>= 7;
+    self->buffer[self->length++] = byte | (value ? 0x80 : 0);
+  } while (value);
+}
+
+bool sls_glrecord_start(char const* path)
+{
+  slsGLRecorder* self = &sls_glrecorder;
+  if (self->fp) {
+    sls_glrecord_stop();
+  }
+
+  *self = (slsGLRecorder){};
+  self->slots = calloc(SLS_GLRECORD_SLOTS, sizeof(*self->slots));
+  self->names = calloc(SLS_GLLOG_MAX_FUNCS, sizeof(*self->names));
+  self->buffer = malloc(SLS_GLRECORD_BUFFER);
+  sls_checkmem(self->slots && self->names && self->buffer);
+
+  self->fp = fopen(path, "wb");
+  sls_check(self->fp, "could not open %s for writing", path);
+
+  uint32_t header[] = { SLS_GLLOG_MAGIC, SLS_GLLOG_VERSION };
+  sls_check(fwrite(header, sizeof(header), 1, self->fp) == 1,
+            "could not write %s",
+            path);
+
+  sls_log_info("recording GL calls to %s", path);
+  return true;
+error:
+  sls_glrecord_stop();
+  return false;
+}
+
+void sls_glrecord_stop(void)
+{
+  slsGLRecorder* self = &sls_glrecorder;
+  if (self->fp) {
+    sls_glrecord_flush(self);
+    fclose(self->fp);
+  }
+  free(self->slots);
+  free(self->names);
+  free(self->buffer);
+  *self = (slsGLRecorder){};
+}
+
+bool sls_glrecord_active(void)
+{
+  return sls_glrecorder.fp != NULL;
+}
+
+void sls_glrecord_frame(void)
+{
+  slsGLRecorder* self = &sls_glrecorder;
+  if (!self->fp) {
+    return;
+  }
+  sls_glrecord_reserve(self, sizeof(uint16_t));
+  sls_glrecord_put_u16(self, SLS_GLLOG_OP_FRAME);
+}
+
+/**
+ * @return the slot for `name`, assigning an id and logging the name the
+ * first time it is seen. NULL once the id space is exhausted.
+ */
+static slsGLRecordSlot* sls_glrecord_intern(slsGLRecorder* self,
+                                            char const* name)
+{
+  uintptr_t hash = ((uintptr_t)name >> 3) * (uintptr_t)0x9e3779b97f4a7c15ull;
+  size_t mask = SLS_GLRECORD_SLOTS - 1;
+
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    slsGLRecordSlot* slot = self->slots + i;
+    if (slot->name == name) {
+      return slot;
+    }
+    if (slot->name) {
+      continue;
+    }
+
+    // new address, though possibly a duplicate literal of a known name
+    size_t id = 0;
+    while (id < self->n_funcs && strcmp(self->names[id], name) != 0) {
+      id++;
+    }
+    if (id == self->n_funcs) {
+      if (self->n_funcs == SLS_GLLOG_MAX_FUNCS) {
+        return NULL;
+      }
+      self->names[self->n_funcs++] = name;
+
+      size_t len = strlen(name);
+      len = len < 0xff ? len : 0xff;
+      sls_glrecord_reserve(self, 3 * sizeof(uint16_t) + len);
+      sls_glrecord_put_u16(self, SLS_GLLOG_OP_NAME);
+      sls_glrecord_put_u16(self, (uint16_t)id);
+      sls_glrecord_put_u16(self, (uint16_t)len);
+      memcpy(self->buffer + self->length, name, len);
+      self->length += len;
+    }
+
+    *slot = (slsGLRecordSlot){
+      .name = name, .desc = sls_glcall_desc(name), .id = (uint16_t)id
+    };
+    return slot;
+  }
+}
+
+void sls_glrecord_call(char const* name, int len_args, va_list args)
+{
+  slsGLRecorder* self = &sls_glrecorder;
+  if (!self->fp) {
+    return;
+  }
+
+  slsGLRecordSlot* slot = sls_glrecord_intern(self, name);
+  if (!slot) {
+    return;
+  }
+
+  char const* signature = slot->desc ? slot->desc->signature : "";
+  size_t n_args = strlen(signature);
+  if (n_args != (size_t)len_args || n_args > SLS_GLLOG_MAX_ARGS) {
+    n_args = 0;
+  }
+
+  sls_glrecord_reserve(self, SLS_GLRECORD_MAX_RECORD);
+  sls_glrecord_put_u16(self, slot->id);
+  self->buffer[self->length++] = (uint8_t)n_args;
+
+  for (size_t i = 0; i < n_args; ++i) {
+    uint64_t value = 0;
+    switch (signature[i]) {
+      case 'u':
+        value = va_arg(args, unsigned int);
+        break;
+      case 'i':
+        value = (uint32_t)va_arg(args, int);
+        break;
+      case 'z':
+        value = (uint64_t)va_arg(args, ptrdiff_t);
+        break;
+      case 'f': {
+        float f = (float)va_arg(args, double);
+        uint32_t bits;
+        memcpy(&bits, &f, sizeof(bits));
+        value = bits;
+      } break;
+      case 'p':
+      default:
+        value = (uintptr_t)va_arg(args, void const*);
+        break;
+    }
+    sls_glrecord_put_varint(self, value);
+  }
+}
+
+/*----------------------------------------*
+ * analysis
+ *----------------------------------------*/
+
+typedef struct slsGLStateSlot {
+  uint64_t key;
+  uint64_t value;
+  bool used;
+} slsGLStateSlot;
+
+/**
+ * @brief open-addressed map from state slots to their last value
+ */
+typedef struct slsGLStateMap {
+  slsGLStateSlot* slots;
+  size_t capacity;
+  size_t n_used;
+} slsGLStateMap;
+
+static inline uint64_t sls_gllog_mix(uint64_t hash, uint64_t value)
+{
+  hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+  return hash;
+}
+
+static uint64_t sls_gllog_hash_string(char const* str)
+{
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (; *str; ++str) {
+    hash = (hash ^ (uint8_t)*str) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+/**
+ * @brief stores `value` under `key`
+ * @return true if `key` already held `value`
+ */
+static bool sls_gllog_state_set(slsGLStateMap* self,
+                                uint64_t key,
+                                uint64_t value)
+{
+  if ((self->n_used + 1) * 2 > self->capacity) {
+    slsGLStateMap grown = { .capacity = self->capacity ? self->capacity * 2
+                                                       : 256 };
+    grown.slots = calloc(grown.capacity, sizeof(*grown.slots));
+    if (!grown.slots) {
+      return false;
+    }
+    for (size_t i = 0; i < self->capacity; ++i) {
+      if (self->slots[i].used) {
+        sls_gllog_state_set(&grown, self->slots[i].key, self->slots[i].value);
+      }
+    }
+    free(self->slots);
+    *self = grown;
+  }
+
+  size_t mask = self->capacity - 1;
+  for (size_t i = (key * 0x9e3779b97f4a7c15ull) >> 32 & mask;;
+       i = (i + 1) & mask) {
+    slsGLStateSlot* slot = self->slots + i;
+    if (!slot->used) {
+      *slot = (slsGLStateSlot){.key = key, .value = value, .used = true };
+      self->n_used++;
+      return false;
+    }
+    if (slot->key == key) {
+      bool same = slot->value == value;
+      slot->value = value;
+      return same;
+    }
+  }
+}
+
+static void sls_gllog_state_clear(slsGLStateMap* self)
+{
+  if (self->slots) {
+    memset(self->slots, 0, self->capacity * sizeof(*self->slots));
+  }
+  self->n_used = 0;
+}
+
+static uint64_t sls_gllog_pixel_size(uint64_t format, uint64_t type)
+{
+  switch (type) {
+    case GL_UNSIGNED_SHORT_5_6_5:
+    case GL_UNSIGNED_SHORT_4_4_4_4:
+    case GL_UNSIGNED_SHORT_5_5_5_1:
+      return 2;
+    case GL_UNSIGNED_INT_8_8_8_8:
+    case GL_UNSIGNED_INT_8_8_8_8_REV:
+    case GL_UNSIGNED_INT_2_10_10_10_REV:
+    case GL_UNSIGNED_INT_24_8:
+      return 4;
+    default:
+      break;
+  }
+
+  uint64_t components = 4;
+  switch (format) {
+    case GL_RED:
+    case GL_RED_INTEGER:
+    case GL_DEPTH_COMPONENT:
+    case GL_STENCIL_INDEX:
+      components = 1;
+      break;
+    case GL_RG:
+    case GL_RG_INTEGER:
+    case GL_DEPTH_STENCIL:
+      components = 2;
+      break;
+    case GL_RGB:
+    case GL_BGR:
+    case GL_RGB_INTEGER:
+      components = 3;
+      break;
+    default:
+      break;
+  }
+
+  switch (type) {
+    case GL_UNSIGNED_SHORT:
+    case GL_SHORT:
+    case GL_HALF_FLOAT:
+      return components * 2;
+    case GL_UNSIGNED_INT:
+    case GL_INT:
+    case GL_FLOAT:
+      return components * 4;
+    default:
+      return components;
+  }
+}
+
+typedef struct slsGLLogReader {
+  uint8_t const* cursor;
+  uint8_t const* end;
+} slsGLLogReader;
+
+static bool sls_gllog_read_u16(slsGLLogReader* self, uint16_t* value)
+{
+  if (self->end - self->cursor < (ptrdiff_t)sizeof(*value)) {
+    return false;
+  }
+  memcpy(value, self->cursor, sizeof(*value));
+  self->cursor += sizeof(*value);
+  return true;
+}
+
+static bool sls_gllog_read_varint(slsGLLogReader* self, uint64_t* value)
+{
+  *value = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7) {
+    if (self->cursor == self->end) {
+      return false;
+    }
+    uint8_t byte = *self->cursor++;
+    *value |= (uint64_t)(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool sls_gllog_push_frame(slsGLLogStats* self,
+                                 slsGLFrameStats const* frame,
+                                 size_t* capacity)
+{
+  if (self->n_frames == *capacity) {
+    size_t new_capacity = *capacity ? *capacity * 2 : 64;
+    slsGLFrameStats* frames =
+      realloc(self->frames, new_capacity * sizeof(*frames));
+    if (!frames) {
+      return false;
+    }
+    self->frames = frames;
+    *capacity = new_capacity;
+  }
+  self->frames[self->n_frames++] = *frame;
+  return true;
+}
+
+slsGLLogStats* sls_gllog_analyze(slsGLLogStats* self,
+                                 void const* data,
+                                 size_t size)
+{
+  *self = (slsGLLogStats){};
+  slsGLStateMap state = {};
+  slsGLCallDesc const** descs = NULL;
+  size_t frames_capacity = 0;
+
+  slsGLLogReader reader = { data, (uint8_t const*)data + size };
+  uint32_t header[2];
+  sls_check(size >= sizeof(header), "GL log too short");
+  memcpy(header, data, sizeof(header));
+  reader.cursor += sizeof(header);
+  sls_check(header[0] == SLS_GLLOG_MAGIC, "not a GL command log");
+  sls_check(header[1] == SLS_GLLOG_VERSION,
+            "unsupported GL log version %u",
+            header[1]);
+
+  descs = calloc(SLS_GLLOG_MAX_FUNCS, sizeof(*descs));
+  self->funcs = calloc(SLS_GLLOG_MAX_FUNCS, sizeof(*self->funcs));
+  sls_checkmem(descs && self->funcs);
+
+  slsGLCallDesc const* active_texture = sls_glcall_desc("glActiveTexture");
+  slsGLCallDesc const* bind_buffer = sls_glcall_desc("glBindBuffer");
+  slsGLCallDesc const* bind_vao = sls_glcall_desc("glBindVertexArray");
+  uint64_t unit = 0, vao = 0;
+  bool unpack_bound = false;
+
+  slsGLFrameStats frame = {};
+  bool frame_open = false;
+  uint16_t op;
+  while (sls_gllog_read_u16(&reader, &op)) {
+    if (op == SLS_GLLOG_OP_FRAME) {
+      sls_checkmem(sls_gllog_push_frame(self, &frame, &frames_capacity));
+      frame = (slsGLFrameStats){};
+      frame_open = false;
+      continue;
+    }
+
+    if (op == SLS_GLLOG_OP_NAME) {
+      uint16_t id, len;
+      sls_check(sls_gllog_read_u16(&reader, &id) &&
+                  sls_gllog_read_u16(&reader, &len) &&
+                  reader.end - reader.cursor >= len,
+                "truncated GL log");
+      sls_check(id < SLS_GLLOG_MAX_FUNCS, "bad function id %u", id);
+
+      slsGLFuncStats* func = self->funcs + id;
+      size_t n = len < sizeof(func->name) ? len : sizeof(func->name) - 1;
+      memcpy(func->name, reader.cursor, n);
+      func->name[n] = '\0';
+      reader.cursor += len;
+
+      descs[id] = sls_glcall_desc(func->name);
+      if (id >= self->n_funcs) {
+        self->n_funcs = id + 1u;
+      }
+      continue;
+    }
+
+    sls_check(op < self->n_funcs && self->funcs[op].name[0],
+              "call to unnamed function %u",
+              op);
+    sls_check(reader.cursor < reader.end, "truncated GL log");
+    size_t n_args = *reader.cursor++;
+    sls_check(n_args <= SLS_GLLOG_MAX_ARGS, "too many arguments");
+
+    uint64_t args[SLS_GLLOG_MAX_ARGS];
+    for (size_t i = 0; i < n_args; ++i) {
+      sls_check(sls_gllog_read_varint(&reader, args + i), "truncated GL log");
+    }
+
+    frame_open = true;
+    frame.calls++;
+    self->funcs[op].calls++;
+
+    slsGLCallDesc const* desc = descs[op];
+    if (!desc || n_args != strlen(desc->signature)) {
+      continue;
+    }
+
+    switch (desc->kind) {
+      case SLS_GLCALL_STATE: {
+        uint64_t key =
+          sls_gllog_hash_string(desc->group ? desc->group : desc->name);
+        for (int i = 0; i < desc->n_key; ++i) {
+          key = sls_gllog_mix(key, args[i]);
+        }
+        if (desc->per_unit) {
+          key = sls_gllog_mix(key, unit);
+        }
+        // the element array binding belongs to the vertex array object
+        if (desc == bind_buffer && args[0] == GL_ELEMENT_ARRAY_BUFFER) {
+          key = sls_gllog_mix(key, vao);
+        }
+
+        uint64_t value = (uint64_t)desc->set_value;
+        if (desc->set_value < 0) {
+          value = 0;
+          for (size_t i = (size_t)desc->n_key; i < n_args; ++i) {
+            value = sls_gllog_mix(value, args[i]);
+          }
+        }
+
+        if (sls_gllog_state_set(&state, key, value)) {
+          frame.redundant++;
+          self->funcs[op].redundant++;
+        } else {
+          frame.state_changes++;
+        }
+
+        if (desc == active_texture) {
+          unit = args[0] - GL_TEXTURE0;
+        } else if (desc == bind_vao) {
+          vao = args[0];
+        } else if (desc == bind_buffer &&
+                   args[0] == GL_PIXEL_UNPACK_BUFFER) {
+          unpack_bound = args[1] != 0;
+        }
+      } break;
+      case SLS_GLCALL_DRAW:
+        frame.draws++;
+        break;
+      case SLS_GLCALL_BUFFER_UPLOAD:
+        if (desc->data < 0 || args[desc->data]) {
+          frame.buffer_bytes += args[desc->size];
+        }
+        break;
+      case SLS_GLCALL_TEXTURE_UPLOAD:
+        // with an unpack buffer bound, the pointer is an offset into it
+        if (unpack_bound || args[desc->data]) {
+          frame.texture_bytes +=
+            (uint64_t)(uint32_t)args[desc->width] *
+            (uint32_t)args[desc->height] *
+            sls_gllog_pixel_size(args[desc->format], args[desc->type]);
+        }
+        break;
+      case SLS_GLCALL_COMPRESSED_UPLOAD:
+        if (unpack_bound || args[desc->data]) {
+          frame.texture_bytes += (uint32_t)args[desc->size];
+        }
+        break;
+      case SLS_GLCALL_DELETE:
+        sls_gllog_state_clear(&state);
+        vao = 0;
+        break;
+      case SLS_GLCALL_OTHER:
+      default:
+        break;
+    }
+  }
+  sls_check(reader.cursor == reader.end, "trailing bytes in GL log");
+
+  if (frame_open) {
+    sls_checkmem(sls_gllog_push_frame(self, &frame, &frames_capacity));
+  }
+
+  for (size_t i = 0; i < self->n_frames; ++i) {
+    slsGLFrameStats const* f = self->frames + i;
+    self->total.calls += f->calls;
+    self->total.draws += f->draws;
+    self->total.state_changes += f->state_changes;
+    self->total.redundant += f->redundant;
+    self->total.buffer_bytes += f->buffer_bytes;
+    self->total.texture_bytes += f->texture_bytes;
+  }
+
+  free(state.slots);
+  free(descs);
+  return self;
+error:
+  free(state.slots);
+  free(descs);
+  sls_gllog_stats_dtor(self);
+  return NULL;
+}
+
+slsGLLogStats* sls_gllog_analyze_file(slsGLLogStats* self, char const* path)
+{
+  void* data = NULL;
+  FILE* fp = fopen(path, "rb");
+  sls_check(fp, "could not open %s", path);
+
+  sls_check(fseek(fp, 0, SEEK_END) == 0, "could not seek %s", path);
+  long size = ftell(fp);
+  sls_check(size >= 0, "could not size %s", path);
+  rewind(fp);
+
+  data = malloc(size > 0 ? (size_t)size : 1);
+  sls_checkmem(data);
+  sls_check(fread(data, 1, (size_t)size, fp) == (size_t)size,
+            "could not read %s",
+            path);
+  fclose(fp);
+  fp = NULL;
+
+  slsGLLogStats* res = sls_gllog_analyze(self, data, (size_t)size);
+  free(data);
+  return res;
+error:
+  if (fp) {
+    fclose(fp);
+  }
+  free(data);
+  *self = (slsGLLogStats){};
+  return NULL;
+}
+
+slsGLLogStats* sls_gllog_stats_dtor(slsGLLogStats* self)
+{
+  free(self->frames);
+  free(self->funcs);
+  *self = (slsGLLogStats){};
+  return self;
+}
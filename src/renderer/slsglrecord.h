@@ -0,0 +1,172 @@
+/**
+ * @file slsglrecord.h
+ * @brief GL call capture through glad's debug callbacks, and offline
+ * analysis of the captured command log
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#ifndef DANGERENGINE_SLSGLRECORD_H
+#define DANGERENGINE_SLSGLRECORD_H
+
+#include "../sls-gl.h"
+#include <slsmacros.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+SLS_BEGIN_CDECLS
+
+/** @brief "SLSG", little-endian */
+#define SLS_GLLOG_MAGIC 0x47534c53u
+#define SLS_GLLOG_VERSION 1
+#define SLS_GLLOG_EXTENSION ".slsgl"
+/** @brief distinct GL functions a single log can name */
+#define SLS_GLLOG_MAX_FUNCS 4096
+#define SLS_GLLOG_MAX_ARGS 16
+
+/**
+ * @brief Log layout: a u32 magic and u32 version, then records that each
+ * start with a u16 opcode. SLS_GLLOG_OP_NAME is followed by a u16 function
+ * id, a u16 length and the function's name, and appears before the
+ * function's first call. SLS_GLLOG_OP_FRAME ends a frame. Any other opcode
+ * is a function id, followed by a u8 argument count and that many LEB128
+ * varints. Only functions listed in the call table have their arguments
+ * recorded; integers are stored zero-extended, floats as their bit
+ * pattern, and pointers as addresses. Values are in host byte order.
+ */
+typedef enum slsGLLogOp {
+  SLS_GLLOG_OP_FRAME = 0xfffe,
+  SLS_GLLOG_OP_NAME = 0xffff,
+} slsGLLogOp;
+
+typedef enum slsGLCallKind {
+  SLS_GLCALL_OTHER,
+  /** @brief sets a piece of context state, so repeats can be redundant */
+  SLS_GLCALL_STATE,
+  SLS_GLCALL_DRAW,
+  SLS_GLCALL_BUFFER_UPLOAD,
+  SLS_GLCALL_TEXTURE_UPLOAD,
+  SLS_GLCALL_COMPRESSED_UPLOAD,
+  /** @brief deletes objects, which may unbind them */
+  SLS_GLCALL_DELETE,
+} slsGLCallKind;
+
+/**
+ * @brief how to decode and interpret one GL function's arguments
+ */
+typedef struct slsGLCallDesc {
+  char const* name;
+  /**
+   * @brief one character per argument: 'u' GLenum, GLuint, GLboolean or
+   * GLbitfield, 'i' GLint or GLsizei, 'z' GLintptr or GLsizeiptr, 'f'
+   * GLfloat, 'p' pointer
+   */
+  char const* signature;
+  slsGLCallKind kind;
+
+  /** @brief state calls: leading arguments that select the state slot */
+  int8_t n_key;
+  /** @brief state calls: slot shared with other functions, or NULL */
+  char const* group;
+  /** @brief state calls: stored value, or -1 to use the arguments */
+  int8_t set_value;
+  /** @brief state calls: the slot is per active texture unit */
+  bool per_unit;
+
+  /** @brief upload calls: argument indices, or -1 */
+  int8_t size;
+  int8_t data;
+  int8_t width;
+  int8_t height;
+  int8_t format;
+  int8_t type;
+} slsGLCallDesc;
+
+/**
+ * @return the table entry for `name`, or NULL
+ */
+slsGLCallDesc const* sls_glcall_desc(char const* name) SLS_NONNULL(1);
+
+/*----------------------------------------*
+ * capture
+ *----------------------------------------*/
+
+/**
+ * @brief starts writing every GL call made through glad to `path`.
+ * Capture is global, since glad's callbacks carry no user data, and GL
+ * calls must come from a single thread while it runs.
+ */
+bool sls_glrecord_start(char const* path) SLS_NONNULL(1);
+
+/**
+ * @brief flushes and closes the log
+ */
+void sls_glrecord_stop(void);
+
+bool sls_glrecord_active(void);
+
+/**
+ * @brief appends a frame marker
+ */
+void sls_glrecord_frame(void);
+
+/**
+ * @brief records one call. Meant for glad's pre-call callback, which
+ * receives the same arguments.
+ */
+void sls_glrecord_call(char const* name, int len_args, va_list args)
+  SLS_NONNULL(1);
+
+/*----------------------------------------*
+ * analysis
+ *----------------------------------------*/
+
+typedef struct slsGLFrameStats {
+  uint64_t calls;
+  uint64_t draws;
+  uint64_t state_changes;
+  /** @brief state calls that set the value the slot already held */
+  uint64_t redundant;
+  uint64_t buffer_bytes;
+  uint64_t texture_bytes;
+} slsGLFrameStats;
+
+typedef struct slsGLFuncStats {
+  char name[64];
+  uint64_t calls;
+  uint64_t redundant;
+} slsGLFuncStats;
+
+/**
+ * @brief totals per frame and per function. Calls after the last frame
+ * marker form a final partial frame.
+ */
+typedef struct slsGLLogStats {
+  slsGLFrameStats* frames;
+  size_t n_frames;
+  slsGLFrameStats total;
+
+  slsGLFuncStats* funcs;
+  size_t n_funcs;
+} slsGLLogStats;
+
+/**
+ * @brief replays a command log, tracking bound state to find redundant
+ * changes. Deleting objects forgets all tracked state, since the deleted
+ * names may have been bound.
+ * @return NULL if the log is malformed
+ */
+slsGLLogStats* sls_gllog_analyze(slsGLLogStats* self,
+                                 void const* data,
+                                 size_t size) SLS_NONNULL(1, 2);
+
+slsGLLogStats* sls_gllog_analyze_file(slsGLLogStats* self, char const* path)
+  SLS_NONNULL(1, 2);
+
+slsGLLogStats* sls_gllog_stats_dtor(slsGLLogStats* self) SLS_NONNULL(1);
+
+SLS_END_CDECLS
+
+#endif // DANGERENGINE_SLSGLRECORD_H
@@ -0,0 +1,901 @@
+/**
+ * @file slsgpuheap.c
+ * @brief
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#include "slsgpuheap.h"
+#include <assert.h>
+#include <slsutils.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*----------------------------------------*
+ * TLSF allocator
+ *----------------------------------------*/
+
+/**
+ * @brief index of the highest set bit of a nonzero value
+ */
+static unsigned sls_tlsf_fls(size_t x)
+{
+#if defined(__GNUC__)
+  return (unsigned)(sizeof(unsigned long long) * 8 - 1 -
+                    __builtin_clzll((unsigned long long)x));
+#else
+  unsigned n = 0;
+  while (x >>= 1) {
+    n++;
+  }
+  return n;
+#endif
+}
+
+/**
+ * @brief index of the lowest set bit of a nonzero value
+ */
+static unsigned sls_tlsf_ffs(uint32_t x)
+{
+#if defined(__GNUC__)
+  return (unsigned)__builtin_ctz(x);
+#else
+  unsigned n = 0;
+  while (!(x & 1u)) {
+    x >>= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+
+static size_t sls_tlsf_align_up(size_t x, size_t align)
+{
+  return (x + align - 1) & ~(align - 1);
+}
+
+static size_t sls_tlsf_pow2(size_t x)
+{
+  size_t p = 1;
+  while (p < x) {
+    p <<= 1;
+  }
+  return p;
+}
+
+/**
+ * @brief size class of a block of `units` granules
+ */
+static void sls_tlsf_mapping(size_t units, unsigned* fl, unsigned* sl)
+{
+  if (units < SLS_TLSF_SL_COUNT) {
+    *fl = 0;
+    *sl = (unsigned)units;
+    return;
+  }
+  unsigned msb = sls_tlsf_fls(units);
+  *fl = msb - SLS_TLSF_SL_LOG2 + 1;
+  *sl = (unsigned)(units >> (msb - SLS_TLSF_SL_LOG2)) - SLS_TLSF_SL_COUNT;
+}
+
+static void sls_tlsf_insert_free(slsTlsf* self, uint32_t b)
+{
+  slsTlsfBlock* block = self->blocks + b;
+  unsigned fl, sl;
+  sls_tlsf_mapping(block->size >> self->granularity_log2, &fl, &sl);
+
+  block->state = SLS_TLSF_BLOCK_FREE;
+  block->handle = SLS_TLSF_NONE;
+  block->prev_free = SLS_TLSF_NONE;
+  block->next_free = self->heads[fl][sl];
+  if (block->next_free != SLS_TLSF_NONE) {
+    self->blocks[block->next_free].prev_free = b;
+  }
+  self->heads[fl][sl] = b;
+  self->fl_bitmap |= 1u << fl;
+  self->sl_bitmap[fl] |= 1u << sl;
+}
+
+static void sls_tlsf_remove_free(slsTlsf* self, uint32_t b)
+{
+  slsTlsfBlock* block = self->blocks + b;
+  assert(block->state == SLS_TLSF_BLOCK_FREE);
+  unsigned fl, sl;
+  sls_tlsf_mapping(block->size >> self->granularity_log2, &fl, &sl);
+
+  if (block->prev_free != SLS_TLSF_NONE) {
+    self->blocks[block->prev_free].next_free = block->next_free;
+  } else {
+    self->heads[fl][sl] = block->next_free;
+  }
+  if (block->next_free != SLS_TLSF_NONE) {
+    self->blocks[block->next_free].prev_free = block->prev_free;
+  }
+  if (self->heads[fl][sl] == SLS_TLSF_NONE) {
+    self->sl_bitmap[fl] &= ~(1u << sl);
+    if (!self->sl_bitmap[fl]) {
+      self->fl_bitmap &= ~(1u << fl);
+    }
+  }
+  block->prev_free = SLS_TLSF_NONE;
+  block->next_free = SLS_TLSF_NONE;
+}
+
+/**
+ * @brief smallest size class whose blocks all hold `size` bytes
+ * @return false if no class is large enough
+ */
+static bool sls_tlsf_search_class(slsTlsf const* self,
+                                  size_t size,
+                                  unsigned* fl,
+                                  unsigned* sl)
+{
+  size_t units = size >> self->granularity_log2;
+  if (units >= SLS_TLSF_SL_COUNT) {
+    // round up to the next class boundary, so any block found fits
+    units += ((size_t)1 << (sls_tlsf_fls(units) - SLS_TLSF_SL_LOG2)) - 1;
+  }
+  sls_tlsf_mapping(units, fl, sl);
+  return *fl < SLS_TLSF_FL_COUNT;
+}
+
+/**
+ * @brief first free block of a size class guaranteed to hold `size` bytes
+ */
+static uint32_t sls_tlsf_find(slsTlsf const* self, size_t size)
+{
+  unsigned fl, sl;
+  if (!sls_tlsf_search_class(self, size, &fl, &sl)) {
+    return SLS_TLSF_NONE;
+  }
+
+  uint32_t sl_map = self->sl_bitmap[fl] & (UINT32_MAX << sl);
+  if (!sl_map) {
+    uint32_t fl_map =
+      fl + 1 < SLS_TLSF_FL_COUNT ? self->fl_bitmap & (UINT32_MAX << (fl + 1))
+                                 : 0;
+    if (!fl_map) {
+      return SLS_TLSF_NONE;
+    }
+    fl = sls_tlsf_ffs(fl_map);
+    sl_map = self->sl_bitmap[fl];
+  }
+  return self->heads[fl][sls_tlsf_ffs(sl_map)];
+}
+
+/**
+ * @brief like sls_tlsf_find, restricted to pools before `pool_limit`. Walks
+ * the free lists, so it is only used by defragmentation.
+ */
+static uint32_t sls_tlsf_find_before(slsTlsf const* self,
+                                     size_t size,
+                                     uint32_t pool_limit)
+{
+  unsigned fl, sl;
+  if (!sls_tlsf_search_class(self, size, &fl, &sl)) {
+    return SLS_TLSF_NONE;
+  }
+  for (; fl < SLS_TLSF_FL_COUNT; ++fl, sl = 0) {
+    uint32_t sl_map = self->sl_bitmap[fl] & (UINT32_MAX << sl);
+    while (sl_map) {
+      unsigned i = sls_tlsf_ffs(sl_map);
+      sl_map &= sl_map - 1;
+      for (uint32_t b = self->heads[fl][i]; b != SLS_TLSF_NONE;
+           b = self->blocks[b].next_free) {
+        if (self->blocks[b].pool < pool_limit) {
+          return b;
+        }
+      }
+    }
+  }
+  return SLS_TLSF_NONE;
+}
+
+/**
+ * @brief makes sure the next two block nodes and the next handle can be
+ * taken without allocating
+ */
+static bool sls_tlsf_reserve(slsTlsf* self)
+{
+  if (self->blocks_capacity - self->n_blocks < 2) {
+    uint32_t capacity = self->blocks_capacity ? self->blocks_capacity * 2 : 64;
+    slsTlsfBlock* blocks = realloc(self->blocks, capacity * sizeof(*blocks));
+    if (!blocks) {
+      return false;
+    }
+    self->blocks = blocks;
+    self->blocks_capacity = capacity;
+  }
+
+  if (self->n_free_handles == 0 && self->n_handles == self->handles_capacity) {
+    uint32_t capacity =
+      self->handles_capacity ? self->handles_capacity * 2 : 64;
+    uint32_t* handles = realloc(self->handles, capacity * sizeof(*handles));
+    if (!handles) {
+      return false;
+    }
+    self->handles = handles;
+    uint32_t* free_handles =
+      realloc(self->free_handles, capacity * sizeof(*free_handles));
+    if (!free_handles) {
+      return false;
+    }
+    self->free_handles = free_handles;
+    self->handles_capacity = capacity;
+  }
+  return true;
+}
+
+static uint32_t sls_tlsf_new_block(slsTlsf* self)
+{
+  uint32_t b = self->unused_head;
+  if (b != SLS_TLSF_NONE) {
+    self->unused_head = self->blocks[b].next_free;
+    return b;
+  }
+  assert(self->n_blocks < self->blocks_capacity);
+  return self->n_blocks++;
+}
+
+static void sls_tlsf_release_block(slsTlsf* self, uint32_t b)
+{
+  self->blocks[b] = (slsTlsfBlock){.state = SLS_TLSF_BLOCK_UNUSED,
+                                   .prev_phys = SLS_TLSF_NONE,
+                                   .next_phys = SLS_TLSF_NONE,
+                                   .prev_free = SLS_TLSF_NONE,
+                                   .next_free = self->unused_head,
+                                   .handle = SLS_TLSF_NONE };
+  self->unused_head = b;
+}
+
+/**
+ * @brief cuts block `b` after `size` bytes
+ * @return the new block holding the rest, not yet in a free list
+ */
+static uint32_t sls_tlsf_split(slsTlsf* self, uint32_t b, size_t size)
+{
+  uint32_t t = sls_tlsf_new_block(self);
+  slsTlsfBlock* block = self->blocks + b;
+  assert(size < block->size);
+
+  self->blocks[t] = (slsTlsfBlock){.offset = block->offset + size,
+                                   .size = block->size - size,
+                                   .pool = block->pool,
+                                   .prev_phys = b,
+                                   .next_phys = block->next_phys,
+                                   .prev_free = SLS_TLSF_NONE,
+                                   .next_free = SLS_TLSF_NONE,
+                                   .handle = SLS_TLSF_NONE,
+                                   .state = SLS_TLSF_BLOCK_FREE };
+  if (block->next_phys != SLS_TLSF_NONE) {
+    self->blocks[block->next_phys].prev_phys = t;
+  }
+  block->next_phys = t;
+  block->size = size;
+  return t;
+}
+
+/**
+ * @brief absorbs `b`'s physical successor into it
+ */
+static void sls_tlsf_merge_next(slsTlsf* self, uint32_t b)
+{
+  slsTlsfBlock* block = self->blocks + b;
+  uint32_t n = block->next_phys;
+  slsTlsfBlock* next = self->blocks + n;
+
+  block->size += next->size;
+  block->next_phys = next->next_phys;
+  if (next->next_phys != SLS_TLSF_NONE) {
+    self->blocks[next->next_phys].prev_phys = b;
+  }
+  sls_tlsf_release_block(self, n);
+}
+
+/**
+ * @brief marks a block free, coalescing it with free neighbours
+ */
+static void sls_tlsf_release_range(slsTlsf* self, uint32_t b)
+{
+  uint32_t prev = self->blocks[b].prev_phys;
+  if (prev != SLS_TLSF_NONE &&
+      self->blocks[prev].state == SLS_TLSF_BLOCK_FREE) {
+    sls_tlsf_remove_free(self, prev);
+    sls_tlsf_merge_next(self, prev);
+    b = prev;
+  }
+  uint32_t next = self->blocks[b].next_phys;
+  if (next != SLS_TLSF_NONE &&
+      self->blocks[next].state == SLS_TLSF_BLOCK_FREE) {
+    sls_tlsf_remove_free(self, next);
+    sls_tlsf_merge_next(self, b);
+  }
+  sls_tlsf_insert_free(self, b);
+}
+
+/**
+ * @brief carves an aligned allocation out of free block `b`, returning
+ * the padding and the tail to the free lists
+ * @return the allocated block
+ */
+static uint32_t sls_tlsf_take(slsTlsf* self,
+                              uint32_t b,
+                              size_t size,
+                              size_t align)
+{
+  sls_tlsf_remove_free(self, b);
+
+  slsTlsfBlock* block = self->blocks + b;
+  size_t pad = sls_tlsf_align_up(block->offset, align) - block->offset;
+  if (pad > 0) {
+    uint32_t t = sls_tlsf_split(self, b, pad);
+    sls_tlsf_insert_free(self, b);
+    b = t;
+  }
+
+  block = self->blocks + b;
+  assert(block->size >= size);
+  if (block->size > size) {
+    uint32_t t = sls_tlsf_split(self, b, size);
+    sls_tlsf_insert_free(self, t);
+  }
+
+  block = self->blocks + b;
+  block->state = SLS_TLSF_BLOCK_USED;
+  block->align = (uint32_t)align;
+
+  slsTlsfPool* pool = self->pools + block->pool;
+  pool->used += size;
+  pool->n_allocs++;
+  return b;
+}
+
+slsTlsf* sls_tlsf_init(slsTlsf* self, size_t granularity)
+{
+  *self = (slsTlsf){.granularity = granularity,
+                    .unused_head = SLS_TLSF_NONE };
+  sls_check(granularity > 0 && (granularity & (granularity - 1)) == 0,
+            "TLSF granularity %zu is not a power of two",
+            granularity);
+  self->granularity_log2 = sls_tlsf_fls(granularity);
+  for (size_t fl = 0; fl < SLS_TLSF_FL_COUNT; ++fl) {
+    for (size_t sl = 0; sl < SLS_TLSF_SL_COUNT; ++sl) {
+      self->heads[fl][sl] = SLS_TLSF_NONE;
+    }
+  }
+  return self;
+error:
+  return NULL;
+}
+
+slsTlsf* sls_tlsf_dtor(slsTlsf* self)
+{
+  free(self->blocks);
+  free(self->pools);
+  free(self->handles);
+  free(self->free_handles);
+  *self = (slsTlsf){};
+  return self;
+}
+
+uint32_t sls_tlsf_add_pool(slsTlsf* self, size_t size)
+{
+  size &= ~(self->granularity - 1);
+  size_t units = size >> self->granularity_log2;
+  if (units == 0 ||
+      units >> (SLS_TLSF_FL_COUNT + SLS_TLSF_SL_LOG2 - 1) != 0 ||
+      !sls_tlsf_reserve(self)) {
+    return SLS_TLSF_NONE;
+  }
+
+  uint32_t pool = 0;
+  while (pool < self->n_pools && self->pools[pool].live) {
+    pool++;
+  }
+  if (pool == self->n_pools) {
+    slsTlsfPool* pools =
+      realloc(self->pools, (self->n_pools + 1) * sizeof(*pools));
+    if (!pools) {
+      return SLS_TLSF_NONE;
+    }
+    self->pools = pools;
+    self->n_pools++;
+  }
+
+  uint32_t b = sls_tlsf_new_block(self);
+  self->blocks[b] = (slsTlsfBlock){.offset = 0,
+                                   .size = size,
+                                   .pool = pool,
+                                   .prev_phys = SLS_TLSF_NONE,
+                                   .next_phys = SLS_TLSF_NONE };
+  self->pools[pool] =
+    (slsTlsfPool){.size = size, .first_block = b, .live = true };
+  sls_tlsf_insert_free(self, b);
+  return pool;
+}
+
+bool sls_tlsf_remove_pool(slsTlsf* self, uint32_t pool)
+{
+  if (pool >= self->n_pools || !self->pools[pool].live ||
+      self->pools[pool].n_allocs > 0) {
+    return false;
+  }
+  // without allocations, the pool has coalesced into a single free block
+  uint32_t b = self->pools[pool].first_block;
+  assert(self->blocks[b].next_phys == SLS_TLSF_NONE);
+  sls_tlsf_remove_free(self, b);
+  sls_tlsf_release_block(self, b);
+  self->pools[pool] = (slsTlsfPool){.first_block = SLS_TLSF_NONE };
+  return true;
+}
+
+uint32_t sls_tlsf_alloc(slsTlsf* self, size_t size, size_t alignment)
+{
+  size_t gran = self->granularity;
+  size = sls_tlsf_align_up(size ? size : 1, gran);
+  size_t align = sls_tlsf_pow2(alignment > gran ? alignment : gran);
+
+  // worst case padding to reach an aligned offset
+  size_t search = size + align - gran;
+  uint32_t b = sls_tlsf_find(self, search);
+  if (b == SLS_TLSF_NONE || !sls_tlsf_reserve(self)) {
+    return SLS_TLSF_NULL;
+  }
+  b = sls_tlsf_take(self, b, size, align);
+
+  uint32_t handle = self->n_free_handles > 0
+                      ? self->free_handles[--self->n_free_handles]
+                      : ++self->n_handles;
+  self->handles[handle - 1] = b;
+  self->blocks[b].handle = handle;
+  self->used += size;
+  self->n_allocs++;
+  return handle;
+}
+
+void sls_tlsf_free(slsTlsf* self, uint32_t handle)
+{
+  if (handle == SLS_TLSF_NULL || handle > self->n_handles ||
+      self->handles[handle - 1] == SLS_TLSF_NONE) {
+    return;
+  }
+  uint32_t b = self->handles[handle - 1];
+  self->handles[handle - 1] = SLS_TLSF_NONE;
+  self->free_handles[self->n_free_handles++] = handle;
+
+  slsTlsfBlock* block = self->blocks + b;
+  slsTlsfPool* pool = self->pools + block->pool;
+  pool->used -= block->size;
+  pool->n_allocs--;
+  self->used -= block->size;
+  self->n_allocs--;
+
+  sls_tlsf_release_range(self, b);
+}
+
+slsTlsfBlock const* sls_tlsf_block(slsTlsf const* self, uint32_t handle)
+{
+  if (handle == SLS_TLSF_NULL || handle > self->n_handles ||
+      self->handles[handle - 1] == SLS_TLSF_NONE) {
+    return NULL;
+  }
+  return self->blocks + self->handles[handle - 1];
+}
+
+/**
+ * @brief moves allocation `b` into a free block of an earlier pool than
+ * `pool_limit`, if one fits
+ */
+static bool sls_tlsf_evacuate(slsTlsf* self,
+                              uint32_t b,
+                              uint32_t pool_limit,
+                              slsTlsfMove* out)
+{
+  slsTlsfBlock const* block = self->blocks + b;
+  size_t size = block->size;
+  size_t align = block->align;
+
+  uint32_t dst =
+    sls_tlsf_find_before(self, size + align - self->granularity, pool_limit);
+  if (dst == SLS_TLSF_NONE) {
+    return false;
+  }
+
+  uint32_t handle = block->handle;
+  *out = (slsTlsfMove){.handle = handle,
+                       .size = size,
+                       .src_pool = block->pool,
+                       .src_offset = block->offset };
+
+  dst = sls_tlsf_take(self, dst, size, align);
+  self->blocks[dst].handle = handle;
+  self->handles[handle - 1] = dst;
+  out->dst_pool = self->blocks[dst].pool;
+  out->dst_offset = self->blocks[dst].offset;
+
+  slsTlsfPool* src_pool = self->pools + out->src_pool;
+  src_pool->used -= size;
+  src_pool->n_allocs--;
+  sls_tlsf_release_range(self, b);
+  return true;
+}
+
+/**
+ * @brief slides allocation `b` down into the free block before it
+ */
+static bool sls_tlsf_slide(slsTlsf* self, uint32_t b, slsTlsfMove* out)
+{
+  slsTlsfBlock* block = self->blocks + b;
+  uint32_t f = block->prev_phys;
+  if (f == SLS_TLSF_NONE || self->blocks[f].state != SLS_TLSF_BLOCK_FREE) {
+    return false;
+  }
+  size_t src = block->offset;
+  size_t dst = sls_tlsf_align_up(self->blocks[f].offset, block->align);
+  if (dst >= src) {
+    return false;
+  }
+  size_t shift = src - dst;
+
+  *out = (slsTlsfMove){.handle = block->handle,
+                       .size = block->size,
+                       .src_pool = block->pool,
+                       .src_offset = src,
+                       .dst_pool = block->pool,
+                       .dst_offset = dst };
+
+  // the vacated tail joins the next free block, or becomes one
+  uint32_t n = block->next_phys;
+  if (n != SLS_TLSF_NONE && self->blocks[n].state == SLS_TLSF_BLOCK_FREE) {
+    sls_tlsf_remove_free(self, n);
+    self->blocks[n].offset -= shift;
+    self->blocks[n].size += shift;
+    sls_tlsf_insert_free(self, n);
+  } else {
+    uint32_t g = sls_tlsf_new_block(self);
+    block = self->blocks + b;
+    self->blocks[g] = (slsTlsfBlock){.offset = dst + block->size,
+                                     .size = shift,
+                                     .pool = block->pool,
+                                     .prev_phys = b,
+                                     .next_phys = n };
+    if (n != SLS_TLSF_NONE) {
+      self->blocks[n].prev_phys = g;
+    }
+    block->next_phys = g;
+    sls_tlsf_insert_free(self, g);
+  }
+  self->blocks[b].offset = dst;
+
+  // whatever alignment padding is left of the preceding free block stays
+  sls_tlsf_remove_free(self, f);
+  slsTlsfBlock* prev = self->blocks + f;
+  prev->size -= shift;
+  if (prev->size > 0) {
+    sls_tlsf_insert_free(self, f);
+  } else {
+    uint32_t before = prev->prev_phys;
+    self->blocks[b].prev_phys = before;
+    if (before == SLS_TLSF_NONE) {
+      self->pools[self->blocks[b].pool].first_block = b;
+    } else {
+      self->blocks[before].next_phys = b;
+    }
+    sls_tlsf_release_block(self, f);
+  }
+  return true;
+}
+
+bool sls_tlsf_next_move(slsTlsf* self, size_t max_size, slsTlsfMove* out)
+{
+  if (!sls_tlsf_reserve(self)) {
+    return false;
+  }
+
+  uint32_t n_live = 0, last = SLS_TLSF_NONE;
+  for (uint32_t p = 0; p < self->n_pools; ++p) {
+    if (self->pools[p].live) {
+      n_live++;
+      last = p;
+    }
+  }
+
+  // empty the last pool into holes in the others
+  if (n_live > 1 && self->pools[last].n_allocs > 0) {
+    for (uint32_t b = self->pools[last].first_block; b != SLS_TLSF_NONE;
+         b = self->blocks[b].next_phys) {
+      if (self->blocks[b].state == SLS_TLSF_BLOCK_USED &&
+          self->blocks[b].size <= max_size &&
+          sls_tlsf_evacuate(self, b, last, out)) {
+        return true;
+      }
+    }
+  }
+
+  for (uint32_t p = 0; p < self->n_pools; ++p) {
+    if (!self->pools[p].live) {
+      continue;
+    }
+    for (uint32_t b = self->pools[p].first_block; b != SLS_TLSF_NONE;
+         b = self->blocks[b].next_phys) {
+      if (self->blocks[b].state == SLS_TLSF_BLOCK_USED &&
+          self->blocks[b].size <= max_size && sls_tlsf_slide(self, b, out)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+size_t sls_tlsf_largest_free(slsTlsf const* self)
+{
+  if (!self->fl_bitmap) {
+    return 0;
+  }
+  unsigned fl = sls_tlsf_fls(self->fl_bitmap);
+  unsigned sl = sls_tlsf_fls(self->sl_bitmap[fl]);
+  size_t largest = 0;
+  for (uint32_t b = self->heads[fl][sl]; b != SLS_TLSF_NONE;
+       b = self->blocks[b].next_free) {
+    if (self->blocks[b].size > largest) {
+      largest = self->blocks[b].size;
+    }
+  }
+  return largest;
+}
+
+/*----------------------------------------*
+ * GPU heap
+ *----------------------------------------*/
+
+static uint32_t sls_gpuheap_n_pages(slsGpuHeap const* self)
+{
+  uint32_t n = 0;
+  for (uint32_t p = 0; p < self->tlsf.n_pools; ++p) {
+    n += self->tlsf.pools[p].live;
+  }
+  return n;
+}
+
+static bool sls_gpuheap_add_page(slsGpuHeap* self, size_t size)
+{
+  if (self->max_pages > 0 && sls_gpuheap_n_pages(self) >= self->max_pages) {
+    return false;
+  }
+  uint32_t pool = sls_tlsf_add_pool(&self->tlsf, size);
+  if (pool == SLS_TLSF_NONE) {
+    return false;
+  }
+
+  if (pool >= self->buffers_capacity) {
+    uint32_t capacity = pool + 1 > self->buffers_capacity * 2
+                          ? pool + 1
+                          : self->buffers_capacity * 2;
+    GLuint* buffers = realloc(self->buffers, capacity * sizeof(*buffers));
+    if (!buffers) {
+      sls_tlsf_remove_pool(&self->tlsf, pool);
+      return false;
+    }
+    memset(buffers + self->buffers_capacity,
+           0,
+           (capacity - self->buffers_capacity) * sizeof(*buffers));
+    self->buffers = buffers;
+    self->buffers_capacity = capacity;
+  }
+
+  glGenBuffers(1, self->buffers + pool);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, self->buffers[pool]);
+  glBufferData(GL_COPY_WRITE_BUFFER,
+               (GLsizeiptr)self->tlsf.pools[pool].size,
+               NULL,
+               self->usage);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  return true;
+}
+
+static void sls_gpuheap_release_page(slsGpuHeap* self, uint32_t pool)
+{
+  if (sls_tlsf_remove_pool(&self->tlsf, pool)) {
+    glDeleteBuffers(1, self->buffers + pool);
+    self->buffers[pool] = 0;
+  }
+}
+
+slsGpuHeap* sls_gpuheap_init(slsGpuHeap* self,
+                             size_t page_size,
+                             uint32_t max_pages,
+                             GLenum usage)
+{
+  *self = (slsGpuHeap){.usage = usage,
+                       .page_size = sls_tlsf_align_up(page_size,
+                                                      SLS_GPUHEAP_GRANULARITY),
+                       .max_pages = max_pages,
+                       .uniform_alignment = SLS_GPUHEAP_GRANULARITY };
+  sls_check(page_size > 0, "GPU heap pages must not be empty");
+  sls_checkmem(sls_tlsf_init(&self->tlsf, SLS_GPUHEAP_GRANULARITY));
+
+  GLint uniform_alignment = 0;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniform_alignment);
+  if ((size_t)uniform_alignment > self->uniform_alignment) {
+    self->uniform_alignment = (size_t)uniform_alignment;
+  }
+  return self;
+error:
+  sls_gpuheap_dtor(self);
+  return NULL;
+}
+
+slsGpuHeap* sls_gpuheap_dtor(slsGpuHeap* self)
+{
+  for (uint32_t p = 0; p < self->buffers_capacity; ++p) {
+    if (self->buffers[p]) {
+      glDeleteBuffers(1, self->buffers + p);
+    }
+  }
+  if (self->scratch) {
+    glDeleteBuffers(1, &self->scratch);
+  }
+  sls_tlsf_dtor(&self->tlsf);
+  free(self->buffers);
+  *self = (slsGpuHeap){};
+  return self;
+}
+
+slsGpuHandle sls_gpuheap_alloc(slsGpuHeap* self,
+                               size_t size,
+                               size_t alignment)
+{
+  slsGpuHandle handle = sls_tlsf_alloc(&self->tlsf, size, alignment);
+  if (handle != SLS_TLSF_NULL) {
+    return handle;
+  }
+
+  // oversized allocations get a page of their own
+  size_t align = alignment > SLS_GPUHEAP_GRANULARITY ? sls_tlsf_pow2(alignment)
+                                                     : SLS_GPUHEAP_GRANULARITY;
+  size_t needed = sls_tlsf_align_up(size, SLS_GPUHEAP_GRANULARITY) + align;
+  if (!sls_gpuheap_add_page(
+        self, needed > self->page_size ? needed : self->page_size)) {
+    sls_log_warn("GPU heap could not fit an allocation of %zu bytes", size);
+    return SLS_TLSF_NULL;
+  }
+  return sls_tlsf_alloc(&self->tlsf, size, alignment);
+}
+
+void sls_gpuheap_free(slsGpuHeap* self, slsGpuHandle handle)
+{
+  sls_tlsf_free(&self->tlsf, handle);
+}
+
+slsGpuRegion sls_gpuheap_region(slsGpuHeap const* self, slsGpuHandle handle)
+{
+  slsTlsfBlock const* block = sls_tlsf_block(&self->tlsf, handle);
+  if (!block) {
+    return (slsGpuRegion){};
+  }
+  return (slsGpuRegion){.buffer = self->buffers[block->pool],
+                        .offset = (GLintptr)block->offset,
+                        .size = (GLsizeiptr)block->size };
+}
+
+bool sls_gpuheap_upload(slsGpuHeap* self,
+                        slsGpuHandle handle,
+                        size_t offset,
+                        void const* data,
+                        size_t size)
+{
+  slsGpuRegion region = sls_gpuheap_region(self, handle);
+  sls_check(region.buffer, "upload to a released GPU heap allocation");
+  sls_check(offset + size <= (size_t)region.size,
+            "upload of %zu bytes at %zu overruns a %zu byte allocation",
+            size,
+            offset,
+            (size_t)region.size);
+
+  glBindBuffer(GL_COPY_WRITE_BUFFER, region.buffer);
+  glBufferSubData(GL_COPY_WRITE_BUFFER,
+                  region.offset + (GLintptr)offset,
+                  (GLsizeiptr)size,
+                  data);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  return true;
+error:
+  return false;
+}
+
+/**
+ * @brief copies a moved allocation's bytes. Overlapping moves within a page
+ * go through the scratch buffer, since glCopyBufferSubData forbids
+ * overlapping ranges.
+ */
+static void sls_gpuheap_copy(slsGpuHeap* self, slsTlsfMove const* move)
+{
+  GLuint src = self->buffers[move->src_pool];
+  GLuint dst = self->buffers[move->dst_pool];
+  GLsizeiptr size = (GLsizeiptr)move->size;
+  bool overlaps = src == dst &&
+                  move->src_offset < move->dst_offset + move->size &&
+                  move->dst_offset < move->src_offset + move->size;
+
+  if (overlaps) {
+    if (self->scratch_size < move->size) {
+      if (!self->scratch) {
+        glGenBuffers(1, &self->scratch);
+      }
+      glBindBuffer(GL_COPY_WRITE_BUFFER, self->scratch);
+      glBufferData(GL_COPY_WRITE_BUFFER, size, NULL, GL_STREAM_COPY);
+      self->scratch_size = move->size;
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, src);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, self->scratch);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER,
+                        GL_COPY_WRITE_BUFFER,
+                        (GLintptr)move->src_offset,
+                        0,
+                        size);
+    glBindBuffer(GL_COPY_READ_BUFFER, self->scratch);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, dst);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER,
+                        GL_COPY_WRITE_BUFFER,
+                        0,
+                        (GLintptr)move->dst_offset,
+                        size);
+  } else {
+    glBindBuffer(GL_COPY_READ_BUFFER, src);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, dst);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER,
+                        GL_COPY_WRITE_BUFFER,
+                        (GLintptr)move->src_offset,
+                        (GLintptr)move->dst_offset,
+                        size);
+  }
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+size_t sls_gpuheap_defrag(slsGpuHeap* self, size_t max_bytes)
+{
+  size_t moved = 0;
+  slsTlsfMove move;
+  while (moved < max_bytes &&
+         sls_tlsf_next_move(&self->tlsf, max_bytes - moved, &move)) {
+    sls_gpuheap_copy(self, &move);
+    moved += move.size;
+  }
+
+  // keep one page around, so the next allocation doesn't recreate it
+  uint32_t n_pages = sls_gpuheap_n_pages(self);
+  for (uint32_t p = self->tlsf.n_pools; p-- > 0 && n_pages > 1;) {
+    slsTlsfPool const* pool = self->tlsf.pools + p;
+    if (pool->live && pool->n_allocs == 0) {
+      sls_gpuheap_release_page(self, p);
+      n_pages--;
+    }
+  }
+
+  if (moved > 0) {
+    self->epoch++;
+    self->bytes_moved += moved;
+  }
+  return moved;
+}
+
+slsGpuHeapStats sls_gpuheap_stats(slsGpuHeap const* self)
+{
+  slsGpuHeapStats stats = {.used = self->tlsf.used,
+                           .n_allocs = self->tlsf.n_allocs,
+                           .largest_free = sls_tlsf_largest_free(&self->tlsf),
+                           .bytes_moved = self->bytes_moved };
+  for (uint32_t p = 0; p < self->tlsf.n_pools; ++p) {
+    if (self->tlsf.pools[p].live) {
+      stats.capacity += self->tlsf.pools[p].size;
+      stats.n_pages++;
+    }
+  }
+  size_t free_bytes = stats.capacity - stats.used;
+  stats.fragmentation =
+    free_bytes > 0 ? 1.0f - (float)stats.largest_free / (float)free_bytes
+                   : 0.0f;
+  return stats;
+}
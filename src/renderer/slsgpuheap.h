@@ -0,0 +1,275 @@
+/**
+ * @file slsgpuheap.h
+ * @brief TLSF suballocator over large GL buffers, with incremental
+ * defragmentation
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#ifndef DANGERENGINE_SLSGPUHEAP_H
+#define DANGERENGINE_SLSGPUHEAP_H
+
+#include "../sls-gl.h"
+#include <slsmacros.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+SLS_BEGIN_CDECLS
+
+/*----------------------------------------*
+ * TLSF allocator
+ *----------------------------------------*/
+
+/** @brief each first level is split into 2^SLS_TLSF_SL_LOG2 size classes */
+#define SLS_TLSF_SL_LOG2 4
+#define SLS_TLSF_SL_COUNT (1 << SLS_TLSF_SL_LOG2)
+#define SLS_TLSF_FL_COUNT 28
+#define SLS_TLSF_NONE UINT32_MAX
+
+/** @brief handle value never returned by an allocation */
+#define SLS_TLSF_NULL 0
+
+typedef enum slsTlsfBlockState {
+  SLS_TLSF_BLOCK_UNUSED,
+  SLS_TLSF_BLOCK_FREE,
+  SLS_TLSF_BLOCK_USED,
+} slsTlsfBlockState;
+
+/**
+ * @brief a range of a pool, linked to its physical neighbours and, while
+ * free, to the other blocks of its size class
+ */
+typedef struct slsTlsfBlock {
+  size_t offset;
+  size_t size;
+  uint32_t pool;
+  uint32_t prev_phys;
+  uint32_t next_phys;
+  uint32_t prev_free;
+  /** @brief also links unused nodes */
+  uint32_t next_free;
+  uint32_t handle;
+  uint32_t align;
+  slsTlsfBlockState state;
+} slsTlsfBlock;
+
+typedef struct slsTlsfPool {
+  size_t size;
+  size_t used;
+  uint32_t n_allocs;
+  uint32_t first_block;
+  bool live;
+} slsTlsfPool;
+
+/**
+ * @brief a relocation decided by sls_tlsf_next_move. The allocator's
+ * bookkeeping already reflects it; the caller copies the bytes.
+ */
+typedef struct slsTlsfMove {
+  uint32_t handle;
+  size_t size;
+  uint32_t src_pool;
+  size_t src_offset;
+  uint32_t dst_pool;
+  size_t dst_offset;
+} slsTlsfMove;
+
+/**
+ * @brief Two-level segregated fit allocator.
+ * @detail Manages offsets only, so it can back any kind of storage. Free
+ * blocks are binned by size into first levels (powers of two) and second
+ * levels (linear subdivisions), with a bitmap per level, so allocation and
+ * release are O(1). Free neighbours are always coalesced. Allocations are
+ * named by handles, which stay valid when the allocation is moved.
+ */
+typedef struct slsTlsf {
+  size_t granularity;
+  unsigned granularity_log2;
+
+  uint32_t fl_bitmap;
+  uint32_t sl_bitmap[SLS_TLSF_FL_COUNT];
+  uint32_t heads[SLS_TLSF_FL_COUNT][SLS_TLSF_SL_COUNT];
+
+  slsTlsfBlock* blocks;
+  uint32_t n_blocks;
+  uint32_t blocks_capacity;
+  uint32_t unused_head;
+
+  slsTlsfPool* pools;
+  uint32_t n_pools;
+
+  /** @brief block of each handle, SLS_TLSF_NONE when released */
+  uint32_t* handles;
+  uint32_t n_handles;
+  uint32_t handles_capacity;
+  uint32_t* free_handles;
+  uint32_t n_free_handles;
+
+  size_t used;
+  uint32_t n_allocs;
+} slsTlsf;
+
+/**
+ * @param granularity power of two. Sizes, offsets and alignments are
+ * multiples of it.
+ */
+slsTlsf* sls_tlsf_init(slsTlsf* self, size_t granularity) SLS_NONNULL(1);
+
+slsTlsf* sls_tlsf_dtor(slsTlsf* self) SLS_NONNULL(1);
+
+/**
+ * @brief adds `size` bytes of storage, reusing a removed pool's index
+ * @return the pool index, or SLS_TLSF_NONE
+ */
+uint32_t sls_tlsf_add_pool(slsTlsf* self, size_t size) SLS_NONNULL(1);
+
+/**
+ * @brief removes a pool without allocations
+ */
+bool sls_tlsf_remove_pool(slsTlsf* self, uint32_t pool) SLS_NONNULL(1);
+
+/**
+ * @param alignment rounded up to a power of two no smaller than the
+ * granularity
+ * @return a handle, or SLS_TLSF_NULL if no pool has room
+ */
+uint32_t sls_tlsf_alloc(slsTlsf* self, size_t size, size_t alignment)
+  SLS_NONNULL(1);
+
+void sls_tlsf_free(slsTlsf* self, uint32_t handle) SLS_NONNULL(1);
+
+/**
+ * @return the allocation's block, or NULL for a released handle
+ */
+slsTlsfBlock const* sls_tlsf_block(slsTlsf const* self, uint32_t handle)
+  SLS_NONNULL(1);
+
+/**
+ * @brief picks one allocation of at most `max_size` bytes to relocate
+ * towards the start of the heap, and updates the bookkeeping. Allocations
+ * in the last live pool are first moved into earlier pools, so it can be
+ * released. Then allocations slide down into the free block preceding
+ * them, which gathers free space at the end of each pool.
+ * @return false if nothing can move
+ */
+bool sls_tlsf_next_move(slsTlsf* self, size_t max_size, slsTlsfMove* out)
+  SLS_NONNULL(1, 3);
+
+/**
+ * @return size of the largest free block
+ */
+size_t sls_tlsf_largest_free(slsTlsf const* self) SLS_NONNULL(1);
+
+/*----------------------------------------*
+ * GPU heap
+ *----------------------------------------*/
+
+/** @brief granularity of GPU heap allocations */
+#define SLS_GPUHEAP_GRANULARITY 16
+
+typedef uint32_t slsGpuHandle;
+
+typedef struct slsGpuRegion {
+  GLuint buffer;
+  GLintptr offset;
+  GLsizeiptr size;
+} slsGpuRegion;
+
+typedef struct slsGpuHeapStats {
+  size_t capacity;
+  size_t used;
+  uint32_t n_allocs;
+  uint32_t n_pages;
+  size_t largest_free;
+  /** @brief 1 - largest free block / free bytes */
+  float fragmentation;
+  /** @brief bytes relocated by defragmentation so far */
+  size_t bytes_moved;
+} slsGpuHeapStats;
+
+/**
+ * @brief Suballocator of GL buffer storage.
+ * @detail Pages are buffer objects of page_size bytes, or larger for
+ * oversized allocations, created on demand. Allocations are named by
+ * handles: call sls_gpuheap_region for the buffer and offset to bind, and
+ * again whenever `epoch` has changed, since defragmentation relocates
+ * allocations. Moves are ordered in the GL command stream, so draws
+ * issued before a defragmentation step still read the old location.
+ *
+ * Nothing in the engine allocates from it yet: slsMesh owns one buffer
+ * pair per mesh, and slsGeomPool keeps its own element free list.
+ */
+typedef struct slsGpuHeap {
+  slsTlsf tlsf;
+  GLenum usage;
+  size_t page_size;
+  uint32_t max_pages;
+
+  /** @brief buffer of each pool index, 0 for released pages */
+  GLuint* buffers;
+  uint32_t buffers_capacity;
+
+  /** @brief staging for moves whose source and destination overlap */
+  GLuint scratch;
+  size_t scratch_size;
+
+  /** @brief GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, for uniform blocks */
+  size_t uniform_alignment;
+
+  /** @brief incremented by each defragmentation step that moves data */
+  uint64_t epoch;
+  size_t bytes_moved;
+} slsGpuHeap;
+
+/**
+ * @param max_pages 0 for no limit
+ */
+slsGpuHeap* sls_gpuheap_init(slsGpuHeap* self,
+                             size_t page_size,
+                             uint32_t max_pages,
+                             GLenum usage) SLS_NONNULL(1);
+
+slsGpuHeap* sls_gpuheap_dtor(slsGpuHeap* self) SLS_NONNULL(1);
+
+/**
+ * @param alignment byte alignment, rounded up to a power of two class of
+ * at least SLS_GPUHEAP_GRANULARITY
+ * @return a handle, or SLS_TLSF_NULL when out of pages
+ */
+slsGpuHandle sls_gpuheap_alloc(slsGpuHeap* self,
+                               size_t size,
+                               size_t alignment) SLS_NONNULL(1);
+
+void sls_gpuheap_free(slsGpuHeap* self, slsGpuHandle handle) SLS_NONNULL(1);
+
+/**
+ * @return where the allocation currently lives, all zero if released
+ */
+slsGpuRegion sls_gpuheap_region(slsGpuHeap const* self, slsGpuHandle handle)
+  SLS_NONNULL(1);
+
+/**
+ * @brief writes `size` bytes at `offset` within the allocation
+ */
+bool sls_gpuheap_upload(slsGpuHeap* self,
+                        slsGpuHandle handle,
+                        size_t offset,
+                        void const* data,
+                        size_t size) SLS_NONNULL(1, 4);
+
+/**
+ * @brief one incremental defragmentation step: relocates allocations
+ * totalling at most `max_bytes` with glCopyBufferSubData, then releases
+ * pages left empty. Call once per frame with a small budget. Allocations
+ * larger than the budget stay put.
+ * @return bytes moved
+ */
+size_t sls_gpuheap_defrag(slsGpuHeap* self, size_t max_bytes) SLS_NONNULL(1);
+
+slsGpuHeapStats sls_gpuheap_stats(slsGpuHeap const* self) SLS_NONNULL(1);
+
+SLS_END_CDECLS
+
+#endif // DANGERENGINE_SLSGPUHEAP_H
@@ -0,0 +1,570 @@
+/**
+ * @file slslightgrid.c
+ * @brief
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#include "slslightgrid.h"
+#include <math.h>
+#include <slsutils.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define SLS_LIGHTGRID_SSE 1
+#endif
+
+static int sls_lightgrid_clamp_cells(int n)
+{
+  return n < 1 ? 1 : n > SLS_LIGHTGRID_MAX_CELLS ? SLS_LIGHTGRID_MAX_CELLS : n;
+}
+
+static size_t sls_lightgrid_n_cells(slsLightGrid const* self)
+{
+  return (size_t)self->params.tiles_x * (size_t)self->params.tiles_y *
+         (size_t)self->params.slices;
+}
+
+slsLightGrid* sls_lightgrid_init(slsLightGrid* self,
+                                 slsLightGridParams const* params)
+{
+  *self = (slsLightGrid){.params = *params };
+  slsLightGridParams* p = &self->params;
+  p->tiles_x = sls_lightgrid_clamp_cells(p->tiles_x);
+  p->tiles_y = sls_lightgrid_clamp_cells(p->tiles_y);
+  p->slices = sls_lightgrid_clamp_cells(p->slices);
+  sls_check(p->near > 0.f && p->far > p->near,
+            "invalid light grid depth range [%f, %f]",
+            p->near,
+            p->far);
+  self->z_scale = (float)p->slices / logf(p->far / p->near);
+
+  self->cells = calloc(2 * sls_lightgrid_n_cells(self), sizeof(uint32_t));
+  sls_checkmem(self->cells);
+
+  kmMat4 identity;
+  kmMat4Identity(&identity);
+  sls_lightgrid_set_projection(self, &identity, 1, 1);
+  return self;
+error:
+  return sls_lightgrid_dtor(self);
+}
+
+slsLightGrid* sls_lightgrid_dtor(slsLightGrid* self)
+{
+  free(self->x);
+  free(self->y);
+  free(self->z);
+  free(self->radius);
+  free(self->color);
+  free(self->view_x);
+  free(self->view_y);
+  free(self->view_z);
+  free(self->ranges);
+  free(self->cells);
+  free(self->indices);
+  if (self->buffers[0]) {
+    glDeleteBuffers(3, self->buffers);
+    glDeleteTextures(3, self->textures);
+  }
+  *self = (slsLightGrid){};
+  return self;
+}
+
+/**
+ * @brief the plane where the clip space coordinate of `row` equals `ndc`
+ * times w, facing increasing coordinates
+ */
+static kmVec4 sls_lightgrid_plane(float const* m, int row, float ndc)
+{
+  kmVec4 plane = {
+    m[row] - ndc * m[3],
+    m[4 + row] - ndc * m[7],
+    m[8 + row] - ndc * m[11],
+    m[12 + row] - ndc * m[15],
+  };
+  float len =
+    sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+  if (len > 0.f) {
+    plane.x /= len;
+    plane.y /= len;
+    plane.z /= len;
+    plane.w /= len;
+  }
+  return plane;
+}
+
+void sls_lightgrid_set_projection(slsLightGrid* self,
+                                  kmMat4 const* projection,
+                                  int width,
+                                  int height)
+{
+  self->viewport_width = width > 0 ? width : 1;
+  self->viewport_height = height > 0 ? height : 1;
+  for (int b = 0; b <= self->params.tiles_x; ++b) {
+    float ndc = -1.f + 2.f * (float)b / (float)self->params.tiles_x;
+    self->planes_x[b] = sls_lightgrid_plane(projection->mat, 0, ndc);
+  }
+  for (int b = 0; b <= self->params.tiles_y; ++b) {
+    float ndc = -1.f + 2.f * (float)b / (float)self->params.tiles_y;
+    self->planes_y[b] = sls_lightgrid_plane(projection->mat, 1, ndc);
+  }
+}
+
+/*----------------------------------------*
+ * lights
+ *----------------------------------------*/
+
+static bool sls_lightgrid_reserve(slsLightGrid* self, size_t capacity)
+{
+  // sls_lightgrid_bound loads four lights from each i, the last past the
+  // count unless the arrays round up to four
+  capacity = (capacity + 3) & ~(size_t)3;
+  if (capacity <= self->capacity) {
+    return true;
+  }
+
+  float** components[] = { &self->x,      &self->y,      &self->z,
+                           &self->radius, &self->view_x, &self->view_y,
+                           &self->view_z };
+  for (size_t c = 0; c < SLS_ARRAY_COUNT(components); ++c) {
+    float* component = realloc(*components[c], capacity * sizeof(float));
+    if (!component) {
+      return false;
+    }
+    memset(component + self->capacity,
+           0,
+           (capacity - self->capacity) * sizeof(float));
+    *components[c] = component;
+  }
+  float* color = realloc(self->color, 4 * capacity * sizeof(float));
+  if (!color) {
+    return false;
+  }
+  self->color = color;
+  slsLightRange* ranges = realloc(self->ranges, capacity * sizeof(*ranges));
+  if (!ranges) {
+    return false;
+  }
+  self->ranges = ranges;
+
+  self->capacity = capacity;
+  return true;
+}
+
+size_t sls_lightgrid_add(slsLightGrid* self,
+                         kmVec3 position,
+                         float radius,
+                         kmVec3 color)
+{
+  if (self->n_lights == self->capacity &&
+      !sls_lightgrid_reserve(self, self->capacity ? 2 * self->capacity : 64)) {
+    return SIZE_MAX;
+  }
+  size_t i = self->n_lights++;
+  self->x[i] = position.x;
+  self->y[i] = position.y;
+  self->z[i] = position.z;
+  self->radius[i] = radius;
+  self->color[4 * i] = color.x;
+  self->color[4 * i + 1] = color.y;
+  self->color[4 * i + 2] = color.z;
+  self->color[4 * i + 3] = 0.f;
+  return i;
+}
+
+/*----------------------------------------*
+ * binning
+ *----------------------------------------*/
+
+static int sls_lightgrid_slice(slsLightGrid const* self, float depth)
+{
+  int slice = (int)floorf(logf(depth / self->params.near) * self->z_scale);
+  return slice < 0 ? 0
+                   : slice >= self->params.slices ? self->params.slices - 1
+                                                  : slice;
+}
+
+/**
+ * @brief fills a light's range from its tile plane counts and depth
+ */
+static void sls_lightgrid_range(slsLightGrid const* self,
+                                size_t i,
+                                bool inside,
+                                int right_of_x,
+                                int left_of_x,
+                                int right_of_y,
+                                int left_of_y)
+{
+  slsLightGridParams const* p = &self->params;
+  slsLightRange* range = self->ranges + i;
+  float depth = -self->view_z[i];
+  float r = self->radius[i];
+  inside = inside && depth + r >= p->near && depth - r <= p->far;
+
+  int x0 = right_of_x, x1 = p->tiles_x - 1 - left_of_x;
+  int y0 = right_of_y, y1 = p->tiles_y - 1 - left_of_y;
+  if (!inside || x0 > x1 || y0 > y1) {
+    *range = (slsLightRange){.x0 = 1, .x1 = 0 };
+    return;
+  }
+  float near = depth - r > p->near ? depth - r : p->near;
+  float far = depth + r < p->far ? depth + r : p->far;
+  *range = (slsLightRange){ (uint8_t)x0,
+                            (uint8_t)x1,
+                            (uint8_t)y0,
+                            (uint8_t)y1,
+                            (uint8_t)sls_lightgrid_slice(self, near),
+                            (uint8_t)sls_lightgrid_slice(self, far) };
+}
+
+typedef struct slsLightGridBatch {
+  slsLightGrid* grid;
+  float const* view;
+} slsLightGridBatch;
+
+/**
+ * @brief transforms lights [begin, end) to view space and finds the cells
+ * each overlaps
+ */
+static void sls_lightgrid_bound(void* data, size_t begin, size_t end)
+{
+  slsLightGridBatch const* batch = data;
+  slsLightGrid* self = batch->grid;
+  float const* m = batch->view;
+  int tiles_x = self->params.tiles_x;
+  int tiles_y = self->params.tiles_y;
+
+#ifdef SLS_LIGHTGRID_SSE
+  __m128 zero = _mm_setzero_ps();
+  __m128 one = _mm_set1_ps(1.f);
+  for (size_t i = begin; i < end; i += 4) {
+    __m128 wx = _mm_loadu_ps(self->x + i);
+    __m128 wy = _mm_loadu_ps(self->y + i);
+    __m128 wz = _mm_loadu_ps(self->z + i);
+    __m128 r = _mm_loadu_ps(self->radius + i);
+    __m128 neg_r = _mm_sub_ps(zero, r);
+
+    __m128 v[3];
+    for (int row = 0; row < 3; ++row) {
+      v[row] = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(wx, _mm_set1_ps(m[row])),
+                   _mm_mul_ps(wy, _mm_set1_ps(m[4 + row]))),
+        _mm_add_ps(_mm_mul_ps(wz, _mm_set1_ps(m[8 + row])),
+                   _mm_set1_ps(m[12 + row])));
+    }
+    _mm_storeu_ps(self->view_x + i, v[0]);
+    _mm_storeu_ps(self->view_y + i, v[1]);
+    _mm_storeu_ps(self->view_z + i, v[2]);
+
+    // count the tile boundaries each sphere lies wholly on either side of
+    __m128 inside = _mm_cmpeq_ps(zero, zero);
+    __m128 counts[4] = { zero, zero, zero, zero };
+    for (int axis = 0; axis < 2; ++axis) {
+      kmVec4 const* planes = axis ? self->planes_y : self->planes_x;
+      int n_tiles = axis ? tiles_y : tiles_x;
+      for (int b = 0; b <= n_tiles; ++b) {
+        __m128 d = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(v[0], _mm_set1_ps(planes[b].x)),
+                     _mm_mul_ps(v[1], _mm_set1_ps(planes[b].y))),
+          _mm_add_ps(_mm_mul_ps(v[2], _mm_set1_ps(planes[b].z)),
+                     _mm_set1_ps(planes[b].w)));
+        if (b == 0) {
+          inside = _mm_and_ps(inside, _mm_cmpge_ps(d, neg_r));
+        } else if (b == n_tiles) {
+          inside = _mm_and_ps(inside, _mm_cmple_ps(d, r));
+        } else {
+          counts[2 * axis] = _mm_add_ps(
+            counts[2 * axis], _mm_and_ps(_mm_cmpge_ps(d, r), one));
+          counts[2 * axis + 1] = _mm_add_ps(
+            counts[2 * axis + 1], _mm_and_ps(_mm_cmple_ps(d, neg_r), one));
+        }
+      }
+    }
+
+    float lanes[4][4];
+    for (int k = 0; k < 4; ++k) {
+      _mm_storeu_ps(lanes[k], counts[k]);
+    }
+    int inside_mask = _mm_movemask_ps(inside);
+    size_t n_lanes = end - i < 4 ? end - i : 4;
+    for (size_t lane = 0; lane < n_lanes; ++lane) {
+      sls_lightgrid_range(self,
+                          i + lane,
+                          (inside_mask >> lane) & 1,
+                          (int)lanes[0][lane],
+                          (int)lanes[1][lane],
+                          (int)lanes[2][lane],
+                          (int)lanes[3][lane]);
+    }
+  }
+#else
+  for (size_t i = begin; i < end; ++i) {
+    float v[3];
+    for (int row = 0; row < 3; ++row) {
+      v[row] = m[row] * self->x[i] + m[4 + row] * self->y[i] +
+               m[8 + row] * self->z[i] + m[12 + row];
+    }
+    self->view_x[i] = v[0];
+    self->view_y[i] = v[1];
+    self->view_z[i] = v[2];
+
+    float r = self->radius[i];
+    bool inside = true;
+    int counts[4] = { 0, 0, 0, 0 };
+    for (int axis = 0; axis < 2; ++axis) {
+      kmVec4 const* planes = axis ? self->planes_y : self->planes_x;
+      int n_tiles = axis ? tiles_y : tiles_x;
+      for (int b = 0; b <= n_tiles; ++b) {
+        float d = v[0] * planes[b].x + v[1] * planes[b].y +
+                  v[2] * planes[b].z + planes[b].w;
+        if (b == 0) {
+          inside = inside && d >= -r;
+        } else if (b == n_tiles) {
+          inside = inside && d <= r;
+        } else {
+          counts[2 * axis] += d >= r;
+          counts[2 * axis + 1] += d <= -r;
+        }
+      }
+    }
+    sls_lightgrid_range(
+      self, i, inside, counts[0], counts[1], counts[2], counts[3]);
+  }
+#endif
+}
+
+static inline bool sls_lightgrid_in_slice(slsLightRange const* range,
+                                          size_t slice)
+{
+  return range->x0 <= range->x1 && range->z0 <= slice && slice <= range->z1;
+}
+
+/**
+ * @brief counts the lights of each cell in slices [begin, end)
+ */
+static void sls_lightgrid_count(void* data, size_t begin, size_t end)
+{
+  slsLightGrid* self = data;
+  size_t tiles_x = (size_t)self->params.tiles_x;
+  size_t slice_cells = tiles_x * (size_t)self->params.tiles_y;
+  for (size_t slice = begin; slice < end; ++slice) {
+    uint32_t* cells = self->cells + 2 * slice * slice_cells;
+    for (size_t c = 0; c < slice_cells; ++c) {
+      cells[2 * c + 1] = 0;
+    }
+    for (size_t i = 0; i < self->n_lights; ++i) {
+      slsLightRange const* range = self->ranges + i;
+      if (!sls_lightgrid_in_slice(range, slice)) {
+        continue;
+      }
+      for (size_t y = range->y0; y <= range->y1; ++y) {
+        for (size_t x = range->x0; x <= range->x1; ++x) {
+          cells[2 * (y * tiles_x + x) + 1]++;
+        }
+      }
+    }
+  }
+}
+
+/**
+ * @brief writes the index lists of slices [begin, end), using the counts
+ * as cursors
+ */
+static void sls_lightgrid_fill(void* data, size_t begin, size_t end)
+{
+  slsLightGrid* self = data;
+  size_t tiles_x = (size_t)self->params.tiles_x;
+  size_t slice_cells = tiles_x * (size_t)self->params.tiles_y;
+  for (size_t slice = begin; slice < end; ++slice) {
+    uint32_t* cells = self->cells + 2 * slice * slice_cells;
+    for (size_t c = 0; c < slice_cells; ++c) {
+      cells[2 * c + 1] = 0;
+    }
+    for (size_t i = 0; i < self->n_lights; ++i) {
+      slsLightRange const* range = self->ranges + i;
+      if (!sls_lightgrid_in_slice(range, slice)) {
+        continue;
+      }
+      for (size_t y = range->y0; y <= range->y1; ++y) {
+        for (size_t x = range->x0; x <= range->x1; ++x) {
+          uint32_t* cell = cells + 2 * (y * tiles_x + x);
+          self->indices[cell[0] + cell[1]++] = (uint32_t)i;
+        }
+      }
+    }
+  }
+}
+
+bool sls_lightgrid_bin(slsLightGrid* self,
+                       kmMat4 const* view,
+                       slsJobQueue* jobs_opt)
+{
+  size_t n_slices = (size_t)self->params.slices;
+  slsLightGridBatch batch = {.grid = self, .view = view->mat };
+  if (jobs_opt && self->n_lights > SLS_LIGHTGRID_GRAIN) {
+    sls_jobqueue_parallel_for(jobs_opt,
+                              self->n_lights,
+                              SLS_LIGHTGRID_GRAIN,
+                              sls_lightgrid_bound,
+                              &batch);
+  } else {
+    sls_lightgrid_bound(&batch, 0, self->n_lights);
+  }
+
+  if (jobs_opt && n_slices > 1) {
+    sls_jobqueue_parallel_for(
+      jobs_opt, n_slices, 1, sls_lightgrid_count, self);
+  } else {
+    sls_lightgrid_count(self, 0, n_slices);
+  }
+
+  size_t n_cells = sls_lightgrid_n_cells(self);
+  size_t n_indices = 0;
+  uint32_t max_per_cell = 0;
+  for (size_t c = 0; c < n_cells; ++c) {
+    uint32_t count = self->cells[2 * c + 1];
+    self->cells[2 * c] = (uint32_t)n_indices;
+    n_indices += count;
+    max_per_cell = count > max_per_cell ? count : max_per_cell;
+  }
+
+  if (n_indices > self->indices_capacity) {
+    size_t capacity = self->indices_capacity ? self->indices_capacity : 256;
+    while (capacity < n_indices) {
+      capacity *= 2;
+    }
+    uint32_t* indices = realloc(self->indices, capacity * sizeof(*indices));
+    if (!indices) {
+      sls_log_err("out of memory binning %lu lights",
+                  (unsigned long)self->n_lights);
+      return false;
+    }
+    self->indices = indices;
+    self->indices_capacity = capacity;
+  }
+
+  if (jobs_opt && n_slices > 1) {
+    sls_jobqueue_parallel_for(jobs_opt, n_slices, 1, sls_lightgrid_fill, self);
+  } else {
+    sls_lightgrid_fill(self, 0, n_slices);
+  }
+
+  self->stats = (slsLightGridStats){.n_lights = self->n_lights,
+                                    .n_indices = n_indices,
+                                    .max_per_cell = max_per_cell };
+  for (size_t i = 0; i < self->n_lights; ++i) {
+    self->stats.n_visible += self->ranges[i].x0 <= self->ranges[i].x1;
+  }
+  return true;
+}
+
+/*----------------------------------------*
+ * GPU
+ *----------------------------------------*/
+
+#ifdef GL_TEXTURE_BUFFER
+
+/**
+ * @brief reallocates a texture buffer and maps it for writing
+ */
+static void* sls_lightgrid_map(slsLightGrid* self,
+                               int k,
+                               GLenum format,
+                               size_t size)
+{
+  // never empty, so the texture stays valid
+  size = size > 16 ? size : 16;
+  glBindBuffer(GL_TEXTURE_BUFFER, self->buffers[k]);
+  glBufferData(GL_TEXTURE_BUFFER, (GLsizeiptr)size, NULL, GL_STREAM_DRAW);
+  glBindTexture(GL_TEXTURE_BUFFER, self->textures[k]);
+  glTexBuffer(GL_TEXTURE_BUFFER, format, self->buffers[k]);
+  return glMapBufferRange(GL_TEXTURE_BUFFER,
+                          0,
+                          (GLsizeiptr)size,
+                          GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+}
+
+void sls_lightgrid_upload(slsLightGrid* self)
+{
+  if (!self->buffers[0]) {
+    glGenBuffers(3, self->buffers);
+    glGenTextures(3, self->textures);
+  }
+
+  size_t cells_size = 2 * sls_lightgrid_n_cells(self) * sizeof(uint32_t);
+  void* cells = sls_lightgrid_map(self, 0, GL_RG32UI, cells_size);
+  if (cells) {
+    memcpy(cells, self->cells, cells_size);
+  }
+  glUnmapBuffer(GL_TEXTURE_BUFFER);
+
+  size_t indices_size = self->stats.n_indices * sizeof(uint32_t);
+  void* indices = sls_lightgrid_map(self, 1, GL_R32UI, indices_size);
+  if (indices && indices_size > 0) {
+    memcpy(indices, self->indices, indices_size);
+  }
+  glUnmapBuffer(GL_TEXTURE_BUFFER);
+
+  // view space position and radius, then color
+  float* lights =
+    sls_lightgrid_map(self, 2, GL_RGBA32F, 8 * self->n_lights * sizeof(float));
+  for (size_t i = 0; lights && i < self->n_lights; ++i) {
+    float* texels = lights + 8 * i;
+    texels[0] = self->view_x[i];
+    texels[1] = self->view_y[i];
+    texels[2] = self->view_z[i];
+    texels[3] = self->radius[i];
+    memcpy(texels + 4, self->color + 4 * i, 4 * sizeof(float));
+  }
+  glUnmapBuffer(GL_TEXTURE_BUFFER);
+
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+void sls_lightgrid_bind(slsLightGrid const* self,
+                        GLuint program,
+                        GLint first_unit)
+{
+  static char const* const samplers[] = { "cluster_cells",
+                                          "cluster_indices",
+                                          "cluster_lights" };
+  for (int k = 0; k < 3; ++k) {
+    glActiveTexture(GL_TEXTURE0 + (GLenum)(first_unit + k));
+    glBindTexture(GL_TEXTURE_BUFFER, self->textures[k]);
+    glUniform1i(glGetUniformLocation(program, samplers[k]), first_unit + k);
+  }
+  glActiveTexture(GL_TEXTURE0);
+
+  slsLightGridParams const* p = &self->params;
+  glUniform3i(glGetUniformLocation(program, "cluster_dims"),
+              p->tiles_x,
+              p->tiles_y,
+              p->slices);
+  glUniform2f(glGetUniformLocation(program, "cluster_tile_size"),
+              (float)self->viewport_width / (float)p->tiles_x,
+              (float)self->viewport_height / (float)p->tiles_y);
+  glUniform3f(glGetUniformLocation(program, "cluster_depth"),
+              p->near,
+              p->far,
+              self->z_scale);
+}
+
+#else
+
+void sls_lightgrid_upload(slsLightGrid* self)
+{
+  sls_log_warn("clustered lighting needs buffer textures");
+}
+
+void sls_lightgrid_bind(slsLightGrid const* self,
+                        GLuint program,
+                        GLint first_unit)
+{
+}
+
+#endif // GL_TEXTURE_BUFFER
@@ -0,0 +1,184 @@
+/**
+ * @file slslightgrid.h
+ * @brief clustered forward lighting: point lights binned into a grid of
+ * view frustum cells on the CPU
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#ifndef DANGERENGINE_SLSLIGHTGRID_H
+#define DANGERENGINE_SLSLIGHTGRID_H
+
+#include "../sls-gl.h"
+#include "../slsjobs.h"
+#include <kazmath/kazmath.h>
+#include <slsmacros.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+SLS_BEGIN_CDECLS
+
+/**
+ * @brief lights per job when computing light bounds in parallel
+ */
+#define SLS_LIGHTGRID_GRAIN 1024
+
+/** @brief cells along each axis, so cell coordinates fit a byte */
+#define SLS_LIGHTGRID_MAX_CELLS 64
+
+typedef struct slsLightGridParams {
+  /** @brief screen tiles across and down */
+  int tiles_x;
+  int tiles_y;
+  /** @brief depth slices, spaced exponentially from near to far */
+  int slices;
+  /** @brief depth range binned, in view units. Lights past far are dropped */
+  float near;
+  float far;
+} slsLightGridParams;
+
+static const slsLightGridParams SLS_LIGHTGRID_DEFAULT_PARAMS = {
+  .tiles_x = 16,
+  .tiles_y = 9,
+  .slices = 24,
+  .near = 0.1f,
+  .far = 1000.f,
+};
+
+/**
+ * @brief cells a light overlaps, inclusive, or x0 > x1 when it is culled
+ */
+typedef struct slsLightRange {
+  uint8_t x0, x1, y0, y1, z0, z1;
+} slsLightRange;
+
+typedef struct slsLightGridStats {
+  size_t n_lights;
+  /** @brief lights inside the binned frustum */
+  size_t n_visible;
+  /** @brief entries of the index list */
+  size_t n_indices;
+  /** @brief lights of the most crowded cell */
+  uint32_t max_per_cell;
+} slsLightGridStats;
+
+/**
+ * @brief Clustered light grid.
+ * @detail The view frustum is split into tiles_x * tiles_y * slices cells.
+ * Each frame, lights are transformed to view space and their bounding
+ * spheres tested against the planes between tiles and the depths between
+ * slices, four lights at a time, giving each light a box of cells. Cells
+ * are then filled one slice per job: a count pass, a prefix sum, and a
+ * fill pass writing each cell's lights contiguously in ascending order.
+ *
+ * Shaders read three buffer textures, see
+ * resources/shaders/clustered_lights.glsl: the (offset, count) of each
+ * cell, the light index list, and two texels per light, view space
+ * position and radius, then color.
+ */
+typedef struct slsLightGrid {
+  slsLightGridParams params;
+  int viewport_width;
+  int viewport_height;
+  /**
+   * @brief view space planes through the tile boundaries, x then y,
+   * facing towards increasing tile coordinates
+   */
+  kmVec4 planes_x[SLS_LIGHTGRID_MAX_CELLS + 1];
+  kmVec4 planes_y[SLS_LIGHTGRID_MAX_CELLS + 1];
+  /** @brief slices per unit of log depth */
+  float z_scale;
+
+  /** @brief world space lights, one array per component */
+  float* x;
+  float* y;
+  float* z;
+  float* radius;
+  /** @brief rgb and padding per light */
+  float* color;
+  size_t n_lights;
+  size_t capacity;
+
+  /** @brief view space positions, written by binning */
+  float* view_x;
+  float* view_y;
+  float* view_z;
+  slsLightRange* ranges;
+
+  /** @brief (offset, count) into the index list per cell */
+  uint32_t* cells;
+  uint32_t* indices;
+  size_t indices_capacity;
+  slsLightGridStats stats;
+
+  GLuint buffers[3];
+  GLuint textures[3];
+} slsLightGrid;
+
+slsLightGrid* sls_lightgrid_init(slsLightGrid* self,
+                                 slsLightGridParams const* params)
+  SLS_NONNULL(1, 2);
+
+slsLightGrid* sls_lightgrid_dtor(slsLightGrid* self) SLS_NONNULL(1);
+
+/**
+ * @brief derives the tile planes from the projection
+ * @param width, height viewport size in pixels, which tiles divide
+ */
+void sls_lightgrid_set_projection(slsLightGrid* self,
+                                  kmMat4 const* projection,
+                                  int width,
+                                  int height) SLS_NONNULL(1, 2);
+
+static inline void sls_lightgrid_clear(slsLightGrid* self)
+{
+  self->n_lights = 0;
+}
+
+/**
+ * @brief adds a point light, in world space
+ * @return the light's index, or SIZE_MAX when out of memory
+ */
+size_t sls_lightgrid_add(slsLightGrid* self,
+                         kmVec3 position,
+                         float radius,
+                         kmVec3 color) SLS_NONNULL(1);
+
+static inline size_t sls_lightgrid_cell(slsLightGrid const* self,
+                                        int x,
+                                        int y,
+                                        int z)
+{
+  return ((size_t)z * (size_t)self->params.tiles_y + (size_t)y) *
+           (size_t)self->params.tiles_x +
+         (size_t)x;
+}
+
+/**
+ * @brief bins the lights into cells. Makes no GL calls.
+ * @param view world to view space transform
+ * @param jobs_opt if given, the work is split across its workers
+ * @return false when out of memory
+ */
+bool sls_lightgrid_bin(slsLightGrid* self,
+                       kmMat4 const* view,
+                       slsJobQueue* jobs_opt) SLS_NONNULL(1, 2);
+
+/**
+ * @brief uploads the binned grid to its buffer textures
+ */
+void sls_lightgrid_upload(slsLightGrid* self) SLS_NONNULL(1);
+
+/**
+ * @brief binds the buffer textures to units first_unit to first_unit + 2,
+ * and sets the uniforms of clustered_lights.glsl in the bound `program`
+ */
+void sls_lightgrid_bind(slsLightGrid const* self,
+                        GLuint program,
+                        GLint first_unit) SLS_NONNULL(1);
+
+SLS_END_CDECLS
+
+#endif // DANGERENGINE_SLSLIGHTGRID_H
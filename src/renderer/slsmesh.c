@@ -7,11 +7,15 @@
 #include "slsmesh.h"
 #include "slsutils.h"
 #include "shaderutils.h"
+#include <string.h>
 
 static const slsMesh sls_mesh_proto = {.vbo = 0,
                                        .ibo = 0,
                                        .vao = 0,
-                                       .gl_draw_mode = GL_TRIANGLES };
+                                       .gl_draw_mode = GL_TRIANGLES,
+                                       .index_type = GL_UNSIGNED_INT,
+                                       .has_shadow = true,
+                                       .uploaded = false };
 
 /*================================
  * IMPLEMENTATIONS
@@ -58,6 +62,7 @@ slsMesh* sls_mesh_init(slsMesh* self,
     return NULL;
   }
   *self = sls_mesh_proto;
+  sls_vertex_format_init(&self->format, SLS_VERTEX_LAYOUT_FLOAT);
 
   self->vertices.data = calloc((vert_count + 1), sizeof(slsVertex));
   self->indices.data = calloc((idx_count + 1), sizeof(uint32_t));
@@ -66,6 +71,8 @@ slsMesh* sls_mesh_init(slsMesh* self,
   memcpy(self->indices.data, indices, idx_count * sizeof(uint32_t));
   self->vertices.length = vert_count;
   self->indices.length = idx_count;
+  self->index_type =
+    vert_count <= UINT16_MAX ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
 
   glGenBuffers(1, &self->vbo);
   glGenBuffers(1, &self->ibo);
@@ -109,16 +116,41 @@ slsMesh* sls_mesh_dtor(slsMesh* self)
 
 void sls_mesh_bindbuffers(slsMesh* self)
 {
+  // the element buffer binding is vao state: bind the vao first
+  glBindVertexArray(self->vao);
   glBindBuffer(GL_ARRAY_BUFFER, self->vbo);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, self->ibo);
-  glBindVertexArray(self->vao);
 }
 
 void sls_mesh_unbind()
 {
+  glBindVertexArray(0);
   glBindBuffer(GL_ARRAY_BUFFER, 0);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-  glBindVertexArray(0);
+}
+
+static void sls_mesh_narrow_indices(uint16_t* dst,
+                                    uint32_t const* src,
+                                    size_t count)
+{
+  for (size_t i = 0; i < count; ++i) {
+    assert(src[i] <= UINT16_MAX);
+    dst[i] = (uint16_t)src[i];
+  }
+}
+
+void sls_mesh_set_layout(slsMesh* self, slsVertexLayout layout)
+{
+  sls_check(!self->uploaded, "vertex layout must be set before upload");
+
+  sls_vertex_format_init(&self->format, layout);
+  if (self->vertices.data) {
+    sls_vertex_format_fit_bounds(
+      &self->format, self->vertices.data, self->vertices.length);
+  }
+
+error:
+  return;
 }
 
 void sls_mesh_setup_buffers(slsMesh* self, slsShader* shader)
@@ -132,51 +164,267 @@ void sls_mesh_setup_buffers(slsMesh* self, slsShader* shader)
 
   sls_mesh_bindbuffers(self);
 
-  const size_t vbo_size = sizeof(slsVertex) * self->vertices.length;
-  const size_t ibo_size = sizeof(uint32_t) * self->indices.length;
+  const size_t vbo_size = self->format.stride * self->vertices.length;
+  const size_t ibo_size = sls_mesh_index_size(self) * self->indices.length;
 
   slsVertex const* verts = self->vertices.data;
   unsigned int const* idxs = self->indices.data;
 
-  // create index buffer data
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, ibo_size, idxs, GL_STATIC_DRAW);
-
-  // create vertex buffer data
-  glBufferData(GL_ARRAY_BUFFER, vbo_size, verts, GL_DYNAMIC_DRAW);
-
-  glVertexAttribPointer(SLS_ATTRIB_POSITION,
-                        3,
-                        GL_FLOAT,
-                        GL_FALSE,
-                        sizeof(slsVertex),
-                        (GLvoid*)offsetof(slsVertex, position));
-  glEnableVertexAttribArray(SLS_ATTRIB_POSITION);
-
-  glVertexAttribPointer(SLS_ATTRIB_NORMAL,
-                        3,
-                        GL_FLOAT,
-                        GL_FALSE,
-                        sizeof(slsVertex),
-                        (GLvoid*)offsetof(slsVertex, normal));
-  glEnableVertexAttribArray(SLS_ATTRIB_NORMAL);
-
-  glVertexAttribPointer(SLS_ATTRIB_UV,
-                        2,
-                        GL_FLOAT,
-                        GL_FALSE,
-                        sizeof(slsVertex),
-                        (GLvoid*)offsetof(slsVertex, uv));
-  glEnableVertexAttribArray(SLS_ATTRIB_UV);
-
-  glVertexAttribPointer(SLS_ATTRIB_COLOR,
-                        4,
-                        GL_FLOAT,
-                        GL_FALSE,
-                        sizeof(slsVertex),
-                        (GLvoid*)offsetof(slsVertex, color));
-  glEnableVertexAttribArray(SLS_ATTRIB_COLOR);
+  // without a CPU copy the buffers already hold the only copy of the data
+  if (self->has_shadow) {
+    // create index buffer data
+    if (self->index_type == GL_UNSIGNED_INT) {
+      glBufferData(GL_ELEMENT_ARRAY_BUFFER, ibo_size, idxs, GL_STATIC_DRAW);
+    } else {
+      uint16_t* narrow = malloc(ibo_size + 1);
+      sls_checkmem(narrow);
+      sls_mesh_narrow_indices(narrow, idxs, self->indices.length);
+      glBufferData(GL_ELEMENT_ARRAY_BUFFER, ibo_size, narrow, GL_STATIC_DRAW);
+      free(narrow);
+    }
+
+    // create vertex buffer data. Geometry that changes every frame belongs
+    // in the renderer's slsStreamBuffer rather than being re-specified here
+    if (sls_vertex_format_is_native(&self->format)) {
+      glBufferData(GL_ARRAY_BUFFER, vbo_size, verts, GL_STATIC_DRAW);
+    } else {
+      void* packed = malloc(vbo_size + 1);
+      sls_checkmem(packed);
+      sls_vertex_format_pack(
+        &self->format, verts, self->vertices.length, packed);
+      glBufferData(GL_ARRAY_BUFFER, vbo_size, packed, GL_STATIC_DRAW);
+      free(packed);
+    }
+
+    sls_rangeset_clear(&self->dirty_vertices);
+    sls_rangeset_clear(&self->dirty_indices);
+  }
+
+  sls_vertex_format_apply(&self->format, 0);
 
   sls_mesh_unbind();
+  self->uploaded = true;
+  return;
+
+error:
+  sls_mesh_unbind();
+}
+
+//---------------------------------partial
+// updates---------------------------------------
+
+/**
+ * @brief uploads bytes directly with glBufferSubData
+ */
+static void sls_mesh_buffer_subdata(GLuint buffer,
+                                    GLintptr offset,
+                                    GLsizeiptr size,
+                                    void const* data)
+{
+  // copy-write binding leaves vao element bindings untouched
+  glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+  glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+/**
+ * @brief uploads bytes, staging them through the stream buffer when one is
+ * given and has room
+ */
+static void sls_mesh_upload(GLuint buffer,
+                            GLintptr offset,
+                            GLsizeiptr size,
+                            void const* data,
+                            slsStreamBuffer* stream_opt)
+{
+  GLintptr staged = -1;
+  if (stream_opt) {
+    staged = sls_streambuffer_write(stream_opt, data, (size_t)size, 4);
+  }
+
+  if (staged >= 0) {
+    glBindBuffer(GL_COPY_READ_BUFFER, stream_opt->buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glCopyBufferSubData(
+      GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, staged, offset, size);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  } else {
+    sls_mesh_buffer_subdata(buffer, offset, size, data);
+  }
+}
+
+/**
+ * @brief converts `count` vertices to the mesh's vertex format and uploads
+ * them at vertex `first`
+ */
+static void sls_mesh_upload_vertices(slsMesh* self,
+                                     size_t first,
+                                     slsVertex const* vertices,
+                                     size_t count,
+                                     slsStreamBuffer* stream_opt)
+{
+  const size_t stride = self->format.stride;
+  const GLintptr offset = (GLintptr)(first * stride);
+  const GLsizeiptr size = (GLsizeiptr)(count * stride);
+
+  if (sls_vertex_format_is_native(&self->format)) {
+    sls_mesh_upload(self->vbo, offset, size, vertices, stream_opt);
+    return;
+  }
+
+  void* packed = malloc((size_t)size + 1);
+  sls_checkmem(packed);
+  sls_vertex_format_pack(&self->format, vertices, count, packed);
+  sls_mesh_upload(self->vbo, offset, size, packed, stream_opt);
+  free(packed);
+
+error:
+  return;
+}
+
+/**
+ * @brief uploads `count` indices at index `first`, narrowing them to the
+ * mesh's index type
+ */
+static void sls_mesh_upload_indices(slsMesh* self,
+                                    size_t first,
+                                    uint32_t const* indices,
+                                    size_t count,
+                                    slsStreamBuffer* stream_opt)
+{
+  const size_t index_size = sls_mesh_index_size(self);
+  const GLintptr offset = (GLintptr)(first * index_size);
+  const GLsizeiptr size = (GLsizeiptr)(count * index_size);
+
+  if (self->index_type == GL_UNSIGNED_INT) {
+    sls_mesh_upload(self->ibo, offset, size, indices, stream_opt);
+    return;
+  }
+
+  uint16_t* narrow = malloc((size_t)size + 1);
+  sls_checkmem(narrow);
+  sls_mesh_narrow_indices(narrow, indices, count);
+  sls_mesh_upload(self->ibo, offset, size, narrow, stream_opt);
+  free(narrow);
+
+error:
+  return;
+}
+
+void sls_mesh_flush_updates(slsMesh* self, slsStreamBuffer* stream_opt)
+{
+  if (!self->uploaded || !self->has_shadow) {
+    return;
+  }
+
+  for (size_t i = 0; i < self->dirty_vertices.n_ranges; ++i) {
+    slsRange r = self->dirty_vertices.ranges[i];
+    sls_mesh_upload_vertices(
+      self, r.begin, self->vertices.data + r.begin, r.end - r.begin, stream_opt);
+  }
+  sls_rangeset_clear(&self->dirty_vertices);
+
+  for (size_t i = 0; i < self->dirty_indices.n_ranges; ++i) {
+    slsRange r = self->dirty_indices.ranges[i];
+    sls_mesh_upload_indices(
+      self, r.begin, self->indices.data + r.begin, r.end - r.begin, stream_opt);
+  }
+  sls_rangeset_clear(&self->dirty_indices);
+}
+
+void sls_mesh_mark_vertices_dirty(slsMesh* self, size_t first, size_t count)
+{
+  if (first + count > self->vertices.length) {
+    sls_log_err("vertex range [%lu, %lu) out of bounds for mesh of %lu",
+                first,
+                first + count,
+                self->vertices.length);
+    return;
+  }
+  sls_rangeset_add(&self->dirty_vertices, first, first + count);
+}
+
+void sls_mesh_mark_indices_dirty(slsMesh* self, size_t first, size_t count)
+{
+  if (first + count > self->indices.length) {
+    sls_log_err("index range [%lu, %lu) out of bounds for mesh of %lu",
+                first,
+                first + count,
+                self->indices.length);
+    return;
+  }
+  sls_rangeset_add(&self->dirty_indices, first, first + count);
+}
+
+void sls_mesh_update_vertices(slsMesh* self,
+                              size_t first,
+                              slsVertex const* vertices,
+                              size_t count)
+{
+  sls_check(first + count <= self->vertices.length,
+            "vertex range [%lu, %lu) out of bounds",
+            first,
+            first + count);
+
+  if (self->has_shadow) {
+    memcpy(self->vertices.data + first, vertices, count * sizeof(slsVertex));
+    sls_mesh_mark_vertices_dirty(self, first, count);
+  } else {
+    sls_mesh_upload_vertices(self, first, vertices, count, NULL);
+  }
+
+error:
+  return;
+}
+
+void sls_mesh_update_indices(slsMesh* self,
+                             size_t first,
+                             uint32_t const* indices,
+                             size_t count)
+{
+  sls_check(first + count <= self->indices.length,
+            "index range [%lu, %lu) out of bounds",
+            first,
+            first + count);
+
+  if (self->has_shadow) {
+    memcpy(self->indices.data + first, indices, count * sizeof(uint32_t));
+    sls_mesh_mark_indices_dirty(self, first, count);
+  } else {
+    sls_mesh_upload_indices(self, first, indices, count, NULL);
+  }
+
+error:
+  return;
+}
+
+bool sls_mesh_drop_shadow(slsMesh* self)
+{
+  if (!self->uploaded) {
+    sls_log_warn("mesh buffers must be set up before dropping the CPU copy");
+    return false;
+  }
+
+  sls_mesh_flush_updates(self, NULL);
+
+  free(self->vertices.data);
+  free(self->indices.data);
+  self->vertices.data = NULL;
+  self->indices.data = NULL;
+  self->has_shadow = false;
+
+  return true;
+}
+
+void sls_mesh_draw(slsMesh* self, slsStreamBuffer* stream_opt)
+{
+  sls_mesh_flush_updates(self, stream_opt);
+
+  glBindVertexArray(self->vao);
+  glDrawElements(
+    self->gl_draw_mode, (GLsizei)self->indices.length, self->index_type, NULL);
+  glBindVertexArray(0);
 }
 
 //---------------------------------plane_mesh
@@ -194,12 +442,13 @@ slsVertex* sls_sphere_vertices(size_t n_vertices, kmVec4 const* color)
 
     float pos[3] = { (float)cos(theta), (float)sin(theta), 1.0f };
 
-    slsVertex v = {.normal = { 0.0, 0.0, 1.0 }, .uv = { 0.0, 0.0 } };
-    memcpy(v.position, pos, sizeof(float[3]));
-    v.color[0] = color->x;
-    v.color[1] = color->y;
-    v.color[2] = color->z;
-    v.color[3] = color->w;
+    slsVertex* v = sphere + i;
+    *v = (slsVertex){.normal = { 0.0, 0.0, 1.0 }, .uv = { 0.0, 0.0 } };
+    memcpy(v->position, pos, sizeof(float[3]));
+    v->color[0] = color->x;
+    v->color[1] = color->y;
+    v->color[2] = color->z;
+    v->color[3] = color->w;
   }
 
   return sphere;
@@ -208,20 +457,22 @@ slsVertex* sls_sphere_vertices(size_t n_vertices, kmVec4 const* color)
 slsMesh* sls_sphere_mesh(size_t n_vertices, kmVec4 const* color)
 {
   slsMesh* m = NULL;
+  if (n_vertices < 3) {
+    return NULL;
+  }
 
   size_t n_triangles = n_vertices - 2;
   size_t n_elements = n_triangles * 3;
   uint32_t* elements = calloc(n_elements + 1, sizeof(uint32_t));
   slsVertex* verts = sls_sphere_vertices(n_vertices, color);
 
-  // naive fan sphere triangulation
-  int starting_pos = 1;
-  for (int i = starting_pos; i < n_triangles; ++i) {
+  // naive fan triangulation around the first vertex
+  for (size_t i = 0; i < n_triangles; ++i) {
 
     assert(i + 2 < n_vertices);
-    uint32_t triangle[3] = { 0, (uint32_t)i, (uint32_t)i + 1 };
+    uint32_t triangle[3] = { 0, (uint32_t)i + 1, (uint32_t)i + 2 };
 
-    memcpy(elements + i, triangle, sizeof(uint32_t[3]));
+    memcpy(elements + 3 * i, triangle, sizeof(uint32_t[3]));
   }
 
   m = sls_mesh_new(verts, n_vertices, elements, n_elements);
@@ -232,6 +483,45 @@ slsMesh* sls_sphere_mesh(size_t n_vertices, kmVec4 const* color)
   return m;
 }
 
+slsMesh* sls_tile_mesh(size_t width, size_t height)
+{
+  // four vertices per tile, so each tile spans the full texture
+  size_t n_tiles = width * height;
+  slsVertex* verts = calloc(n_tiles * 4 + 1, sizeof(slsVertex));
+  uint32_t* elements = calloc(n_tiles * 6 + 1, sizeof(uint32_t));
+  slsMesh* m = NULL;
+  sls_checkmem(verts && elements);
+
+  for (size_t y = 0; y < height; ++y) {
+    for (size_t x = 0; x < width; ++x) {
+      size_t tile = y * width + x;
+      float corners[4][2] = { { 0.f, 0.f }, { 1.f, 0.f }, { 1.f, 1.f },
+                              { 0.f, 1.f } };
+      for (size_t i = 0; i < 4; ++i) {
+        slsVertex* v = verts + tile * 4 + i;
+        *v = (slsVertex){.position = { (float)x + corners[i][0],
+                                       (float)y + corners[i][1],
+                                       0.f },
+                         .normal = { 0.f, 0.f, 1.f },
+                         .uv = { corners[i][0], corners[i][1] },
+                         .color = { 1.f, 1.f, 1.f, 1.f } };
+      }
+
+      uint32_t base = (uint32_t)(tile * 4);
+      uint32_t quad[6] = { base,     base + 1, base + 2,
+                           base + 2, base + 3, base };
+      memcpy(elements + tile * 6, quad, sizeof(quad));
+    }
+  }
+
+  m = sls_mesh_new(verts, n_tiles * 4, elements, n_tiles * 6);
+
+error:
+  free(elements);
+  free(verts);
+  return m;
+}
+
 slsMesh* sls_mesh_square(slsMesh* self_uninit)
 {
   slsVertex verts[] = { {.position = { -1.f, -1.f, 0.f },
@@ -10,9 +10,12 @@
 #define DANGERENGINE_SLS_MESH_H
 
 #include "../data-types/array.h"
+#include "../data-types/rangeset.h"
 #include "../sls-gl.h"
 #include "slsutils.h"
 #include "slsshader.h"
+#include "slsstreambuffer.h"
+#include "slsvertexformat.h"
 #include <kazmath/kazmath.h>
 #include <kazmath/vec4.h>
 
@@ -55,16 +58,55 @@ struct slsMesh {
   GLuint vao;
 
   GLenum gl_draw_mode;
+
+  /**
+   * @brief layout of vertices in the vbo. vertices.data always holds plain
+   * slsVertex values, which are converted when uploaded.
+   */
+  slsVertexFormat format;
+
+  /**
+   * @brief GL_UNSIGNED_SHORT when every vertex is addressable with 16 bits,
+   * otherwise GL_UNSIGNED_INT. indices.data always holds 32 bit indices.
+   */
+  GLenum index_type;
+
+  /**
+   * @brief element ranges of vertices/indices modified since the last
+   * upload
+   */
+  slsRangeSet dirty_vertices;
+  slsRangeSet dirty_indices;
+
+  /**
+   * @brief false once the CPU copy has been released with
+   * sls_mesh_drop_shadow. vertices.data and indices.data are then NULL, but
+   * their lengths remain valid.
+   */
+  bool has_shadow;
+  bool uploaded;
 };
 
 slsMesh const* sls_mesh_class();
 
 slsMesh* sls_mesh_square(slsMesh* self_uninit);
 
+/**
+ * @brief n_vertices around the unit circle at z = 1
+ * @return a heap array of n_vertices
+ */
 slsVertex* sls_sphere_vertices(size_t n_vertices, kmVec4 const* color);
 
+/**
+ * @brief disc of n_vertices, triangulated as a fan. Solid spheres and other
+ * primitives are generated by slsprimitives.h.
+ */
 slsMesh* sls_sphere_mesh(size_t n_vertices, kmVec4 const* color);
 
+/**
+ * @brief grid of width x height unit quads, each textured with the whole
+ * texture. Large maps are better served by slsTileMap (slstilemap.h).
+ */
 slsMesh* sls_tile_mesh(size_t width, size_t height);
 
 slsMesh* sls_mesh_init(slsMesh* self,
@@ -77,6 +119,24 @@ slsMesh* sls_mesh_dtor(slsMesh* self);
 
 void sls_mesh_setup_buffers(slsMesh* self, slsShader* shader);
 
+/**
+ * @brief size in bytes of one index in the ibo
+ */
+static inline size_t sls_mesh_index_size(slsMesh const* self)
+{
+  return self->index_type == GL_UNSIGNED_SHORT ? sizeof(uint16_t)
+                                               : sizeof(uint32_t);
+}
+
+/**
+ * @brief selects the vertex layout used on the GPU. Must be called before
+ * sls_mesh_setup_buffers. Quantisation bounds are fitted to the current
+ * vertices; later updates outside those bounds are clamped. Quantised
+ * positions need the dequantisation matrix, see sls_mesh_draw.
+ */
+void sls_mesh_set_layout(slsMesh* self, slsVertexLayout layout)
+  SLS_NONNULL(1);
+
 static inline slsMesh* sls_mesh_new(slsVertex const* vertices,
                                     size_t vert_count,
                                     unsigned const* indices,
@@ -109,4 +169,53 @@ void sls_mesh_bindbuffers(slsMesh* self) SLS_NONNULL(1);
  */
 void sls_mesh_unbind();
 
+/**
+ * @brief copies `count` vertices into the mesh starting at `first`
+ * @detail With a CPU copy the change is recorded as a dirty range and
+ * uploaded at the next draw. Without one it is uploaded immediately.
+ */
+void sls_mesh_update_vertices(slsMesh* self,
+                              size_t first,
+                              slsVertex const* vertices,
+                              size_t count) SLS_NONNULL(1, 3);
+
+void sls_mesh_update_indices(slsMesh* self,
+                             size_t first,
+                             uint32_t const* indices,
+                             size_t count) SLS_NONNULL(1, 3);
+
+/**
+ * @brief flags vertices modified in-place through vertices.data
+ */
+void sls_mesh_mark_vertices_dirty(slsMesh* self, size_t first, size_t count)
+  SLS_NONNULL(1);
+
+void sls_mesh_mark_indices_dirty(slsMesh* self, size_t first, size_t count)
+  SLS_NONNULL(1);
+
+/**
+ * @brief uploads all dirty ranges.
+ * @param stream_opt if given, ranges are staged through the stream buffer
+ * and copied on the GPU with glCopyBufferSubData, which avoids stalling on
+ * a buffer still in use. Otherwise glBufferSubData is used.
+ */
+void sls_mesh_flush_updates(slsMesh* self, slsStreamBuffer* stream_opt)
+  SLS_NONNULL(1);
+
+/**
+ * @brief releases the CPU copy of a mesh whose buffers have been set up.
+ * Intended for static meshes, whose data then only lives on the GPU.
+ * @return false if the mesh has not been uploaded yet
+ */
+bool sls_mesh_drop_shadow(slsMesh* self) SLS_NONNULL(1);
+
+/**
+ * @brief flushes pending updates and draws the whole mesh
+ * @detail Sets no uniforms. Meshes laid out with SLS_POSITION_UNORM16_AABB
+ * hold positions in [0, 1] relative to their bounds, so the caller must
+ * fold sls_vertex_format_dequant_matrix(&self->format) into the model
+ * matrix it draws them with.
+ */
+void sls_mesh_draw(slsMesh* self, slsStreamBuffer* stream_opt) SLS_NONNULL(1);
+
 #endif // DANGERENGINE_SLS_MESH_H
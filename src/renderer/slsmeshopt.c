@@ -0,0 +1,305 @@
+/**
+ * @file slsmeshopt.c
+ * @brief
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#include "slsmeshopt.h"
+#include <slsutils.h>
+#include <string.h>
+
+static const uint32_t sls_meshopt_unset = UINT32_MAX;
+
+slsVertexCacheStats sls_analyze_vertex_cache(uint32_t const* indices,
+                                             size_t n_indices,
+                                             size_t n_vertices,
+                                             size_t cache_size)
+{
+  slsVertexCacheStats stats = { 0 };
+  const size_t k = cache_size > 0 ? cache_size : SLS_VERTEX_CACHE_SIZE;
+
+  // the time (in misses) each vertex last entered the cache. A vertex is
+  // still cached while fewer than k misses have happened since then
+  size_t* stamps = malloc((n_vertices + 1) * sizeof(size_t));
+  sls_checkmem(stamps);
+  for (size_t i = 0; i < n_vertices; ++i) {
+    stamps[i] = SIZE_MAX;
+  }
+
+  size_t unique = 0;
+  for (size_t i = 0; i < n_indices; ++i) {
+    uint32_t v = indices[i];
+    if (v >= n_vertices) {
+      continue;
+    }
+    if (stamps[v] == SIZE_MAX) {
+      ++unique;
+    } else if (stats.transforms - stamps[v] < k) {
+      continue;
+    }
+    stamps[v] = stats.transforms++;
+  }
+
+  const size_t n_triangles = n_indices / 3;
+  stats.acmr = n_triangles ? (float)stats.transforms / n_triangles : 0.f;
+  stats.atvr = unique ? (float)stats.transforms / unique : 0.f;
+
+error:
+  free(stamps);
+  return stats;
+}
+
+/*================================
+ * Tipsify
+ *================================*/
+
+typedef struct slsTipsify {
+  size_t n_vertices;
+  size_t k;
+
+  /** @brief vertex -> triangle adjacency, in CSR form */
+  uint32_t* adj_offsets;
+  uint32_t* adj;
+
+  /** @brief unemitted triangles referencing each vertex */
+  uint32_t* live;
+  /** @brief time each vertex entered the cache */
+  size_t* stamps;
+  bool* emitted;
+
+  uint32_t* dead_end;
+  size_t n_dead_end;
+
+  uint32_t* candidates;
+  size_t n_candidates;
+
+  size_t time;
+  size_t cursor;
+} slsTipsify;
+
+static uint32_t sls_tipsify_skip_dead_end(slsTipsify* t)
+{
+  while (t->n_dead_end > 0) {
+    uint32_t d = t->dead_end[--t->n_dead_end];
+    if (t->live[d] > 0) {
+      return d;
+    }
+  }
+
+  while (t->cursor < t->n_vertices) {
+    uint32_t v = (uint32_t)t->cursor++;
+    if (t->live[v] > 0) {
+      return v;
+    }
+  }
+
+  return sls_meshopt_unset;
+}
+
+static uint32_t sls_tipsify_next_vertex(slsTipsify* t)
+{
+  uint32_t best = sls_meshopt_unset;
+  long best_priority = -1;
+
+  for (size_t i = 0; i < t->n_candidates; ++i) {
+    uint32_t v = t->candidates[i];
+    if (t->live[v] == 0) {
+      continue;
+    }
+
+    // prefer the oldest candidate that will still be cached after its
+    // remaining triangles are emitted
+    long priority = 0;
+    size_t age = t->time - t->stamps[v];
+    if (age + 2 * t->live[v] <= t->k) {
+      priority = (long)age;
+    }
+    if (priority > best_priority) {
+      best_priority = priority;
+      best = v;
+    }
+  }
+
+  if (best == sls_meshopt_unset) {
+    best = sls_tipsify_skip_dead_end(t);
+  }
+
+  return best;
+}
+
+bool sls_optimize_vertex_cache(uint32_t* indices,
+                               size_t n_indices,
+                               size_t n_vertices,
+                               size_t cache_size)
+{
+  bool res = false;
+  const size_t n_triangles = n_indices / 3;
+  uint32_t* out = NULL;
+  slsTipsify t = {.n_vertices = n_vertices,
+                  .k = cache_size > 0 ? cache_size : SLS_VERTEX_CACHE_SIZE };
+
+  if (n_triangles == 0 || n_vertices == 0) {
+    return true;
+  }
+
+  for (size_t i = 0; i < n_triangles * 3; ++i) {
+    sls_check(indices[i] < n_vertices, "index %u out of range", indices[i]);
+  }
+
+  t.adj_offsets = calloc(n_vertices + 1, sizeof(uint32_t));
+  t.adj = malloc(n_triangles * 3 * sizeof(uint32_t));
+  t.live = calloc(n_vertices, sizeof(uint32_t));
+  t.stamps = calloc(n_vertices, sizeof(size_t));
+  t.emitted = calloc(n_triangles, sizeof(bool));
+  t.dead_end = malloc(n_triangles * 3 * sizeof(uint32_t));
+  t.candidates = malloc(n_triangles * 3 * sizeof(uint32_t));
+  out = malloc(n_triangles * 3 * sizeof(uint32_t));
+  sls_checkmem(t.adj_offsets && t.adj && t.live && t.stamps && t.emitted &&
+               t.dead_end && t.candidates && out);
+
+  // build adjacency
+  for (size_t i = 0; i < n_triangles * 3; ++i) {
+    t.live[indices[i]]++;
+  }
+  for (size_t v = 0; v < n_vertices; ++v) {
+    t.adj_offsets[v + 1] = t.adj_offsets[v] + t.live[v];
+  }
+  {
+    uint32_t* fill = calloc(n_vertices, sizeof(uint32_t));
+    sls_checkmem(fill);
+    for (size_t i = 0; i < n_triangles * 3; ++i) {
+      uint32_t v = indices[i];
+      t.adj[t.adj_offsets[v] + fill[v]++] = (uint32_t)(i / 3);
+    }
+    free(fill);
+  }
+
+  // stamps start k + 1 in the past so no vertex begins cached
+  t.time = t.k + 1;
+  size_t n_out = 0;
+  uint32_t fan = 0;
+
+  while (fan != sls_meshopt_unset) {
+    t.n_candidates = 0;
+
+    for (uint32_t a = t.adj_offsets[fan]; a < t.adj_offsets[fan + 1]; ++a) {
+      uint32_t tri = t.adj[a];
+      if (t.emitted[tri]) {
+        continue;
+      }
+
+      for (size_t c = 0; c < 3; ++c) {
+        uint32_t v = indices[tri * 3 + c];
+        out[n_out++] = v;
+        t.dead_end[t.n_dead_end++] = v;
+        t.candidates[t.n_candidates++] = v;
+        t.live[v]--;
+        if (t.time - t.stamps[v] > t.k) {
+          t.stamps[v] = t.time++;
+        }
+      }
+      t.emitted[tri] = true;
+    }
+
+    fan = sls_tipsify_next_vertex(&t);
+  }
+
+  assert(n_out == n_triangles * 3);
+  memcpy(indices, out, n_out * sizeof(uint32_t));
+  res = true;
+
+error:
+  free(t.adj_offsets);
+  free(t.adj);
+  free(t.live);
+  free(t.stamps);
+  free(t.emitted);
+  free(t.dead_end);
+  free(t.candidates);
+  free(out);
+  return res;
+}
+
+bool sls_optimize_vertex_fetch(slsVertex* vertices,
+                               size_t n_vertices,
+                               uint32_t* indices,
+                               size_t n_indices)
+{
+  bool res = false;
+  uint32_t* remap = malloc((n_vertices + 1) * sizeof(uint32_t));
+  slsVertex* reordered = malloc((n_vertices + 1) * sizeof(slsVertex));
+  sls_checkmem(remap && reordered);
+
+  for (size_t i = 0; i < n_vertices; ++i) {
+    remap[i] = sls_meshopt_unset;
+  }
+
+  uint32_t next = 0;
+  for (size_t i = 0; i < n_indices; ++i) {
+    uint32_t v = indices[i];
+    sls_check(v < n_vertices, "index %u out of range", v);
+    if (remap[v] == sls_meshopt_unset) {
+      remap[v] = next++;
+    }
+  }
+  for (size_t v = 0; v < n_vertices; ++v) {
+    if (remap[v] == sls_meshopt_unset) {
+      remap[v] = next++;
+    }
+  }
+
+  for (size_t v = 0; v < n_vertices; ++v) {
+    reordered[remap[v]] = vertices[v];
+  }
+  memcpy(vertices, reordered, n_vertices * sizeof(slsVertex));
+
+  for (size_t i = 0; i < n_indices; ++i) {
+    indices[i] = remap[indices[i]];
+  }
+  res = true;
+
+error:
+  free(remap);
+  free(reordered);
+  return res;
+}
+
+bool sls_mesh_optimize(slsMesh* self, size_t cache_size)
+{
+  sls_check(self->has_shadow, "mesh has no CPU copy to optimize");
+  sls_check(self->gl_draw_mode == GL_TRIANGLES,
+            "only triangle lists can be optimized");
+
+  uint32_t* indices = self->indices.data;
+  const size_t n_indices = self->indices.length;
+  const size_t n_vertices = self->vertices.length;
+
+  slsVertexCacheStats before =
+    sls_analyze_vertex_cache(indices, n_indices, n_vertices, cache_size);
+
+  sls_check(
+    sls_optimize_vertex_cache(indices, n_indices, n_vertices, cache_size),
+    "vertex cache optimization failed");
+  sls_check(sls_optimize_vertex_fetch(
+              self->vertices.data, n_vertices, indices, n_indices),
+            "vertex fetch optimization failed");
+
+  slsVertexCacheStats after =
+    sls_analyze_vertex_cache(indices, n_indices, n_vertices, cache_size);
+  sls_log_info("mesh optimized: ACMR %f -> %f, ATVR %f -> %f",
+               before.acmr,
+               after.acmr,
+               before.atvr,
+               after.atvr);
+
+  if (self->uploaded) {
+    sls_mesh_mark_vertices_dirty(self, 0, n_vertices);
+    sls_mesh_mark_indices_dirty(self, 0, n_indices);
+  }
+
+  return true;
+error:
+  return false;
+}
@@ -0,0 +1,76 @@
+/**
+ * @file slsmeshopt.h
+ * @brief index and vertex reordering for post-transform cache and fetch
+ * efficiency
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#ifndef DANGERENGINE_SLSMESHOPT_H
+#define DANGERENGINE_SLSMESHOPT_H
+
+#include "slsmesh.h"
+#include <slsmacros.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+SLS_BEGIN_CDECLS
+
+/**
+ * @brief cache size assumed by the optimiser and statistics when none is
+ * given. Matches the FIFO depth of most desktop hardware closely enough.
+ */
+#define SLS_VERTEX_CACHE_SIZE 16
+
+typedef struct slsVertexCacheStats {
+  /** @brief vertex shader invocations under a FIFO cache */
+  size_t transforms;
+  /** @brief average cache miss ratio: transforms per triangle. 0.5 - 3.0 */
+  float acmr;
+  /** @brief average transform to vertex ratio: 1.0 is optimal */
+  float atvr;
+} slsVertexCacheStats;
+
+/**
+ * @brief simulates a FIFO post-transform cache of `cache_size` entries over
+ * a triangle list
+ */
+slsVertexCacheStats sls_analyze_vertex_cache(uint32_t const* indices,
+                                             size_t n_indices,
+                                             size_t n_vertices,
+                                             size_t cache_size)
+  SLS_NONNULL(1);
+
+/**
+ * @brief reorders the triangles of an indexed triangle list in place, using
+ * Tipsify (Sander, Nehab & Barczak, 2007).
+ * @return false if memory could not be allocated; indices are unchanged
+ */
+bool sls_optimize_vertex_cache(uint32_t* indices,
+                               size_t n_indices,
+                               size_t n_vertices,
+                               size_t cache_size) SLS_NONNULL(1);
+
+/**
+ * @brief renumbers vertices in order of first use, so vertex fetches walk
+ * memory linearly. Unreferenced vertices are moved to the end.
+ * @return false if memory could not be allocated; nothing is changed
+ */
+bool sls_optimize_vertex_fetch(slsVertex* vertices,
+                               size_t n_vertices,
+                               uint32_t* indices,
+                               size_t n_indices) SLS_NONNULL(1, 3);
+
+/**
+ * @brief runs the cache and fetch optimisations on a triangle mesh's CPU
+ * copy. If the mesh was already uploaded, all of it is marked dirty.
+ * @return false if the mesh has no CPU copy, is not GL_TRIANGLES, or
+ * optimisation failed
+ */
+bool sls_mesh_optimize(slsMesh* self, size_t cache_size) SLS_NONNULL(1);
+
+SLS_END_CDECLS
+
+#endif // DANGERENGINE_SLSMESHOPT_H
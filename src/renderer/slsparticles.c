@@ -0,0 +1,590 @@
+/**
+ * @file slsparticles.c
+ * @brief
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#include "slsparticles.h"
+#include "slsshader.h"
+#include <slsutils.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SLS_PARTICLES_SSE 1
+#endif
+
+/** @brief arrays of one float per particle */
+#define SLS_PARTICLES_N_COMPONENTS 8
+
+static void sls_particles_components(slsParticleSystem* self,
+                                     float** out[SLS_PARTICLES_N_COMPONENTS])
+{
+  out[0] = &self->px;
+  out[1] = &self->py;
+  out[2] = &self->pz;
+  out[3] = &self->vx;
+  out[4] = &self->vy;
+  out[5] = &self->vz;
+  out[6] = &self->age;
+  out[7] = &self->lifetime;
+}
+
+slsParticleSystem* sls_particles_init(slsParticleSystem* self,
+                                      slsParticleEmitter const* emitter,
+                                      size_t capacity)
+{
+  *self = (slsParticleSystem){.emitter = *emitter, .seed = 0x9e3779b9u };
+  // each update chunk reads whole groups with aligned _mm_load_ps, so the
+  // 16 byte aligned arrays hold a multiple of four
+  self->capacity = (capacity + 3) & ~(size_t)3;
+  sls_check(self->capacity > 0, "particle system with no capacity");
+
+  float** components[SLS_PARTICLES_N_COMPONENTS];
+  sls_particles_components(self, components);
+  for (size_t c = 0; c < SLS_PARTICLES_N_COMPONENTS; ++c) {
+    *components[c] = aligned_alloc(16, self->capacity * sizeof(float));
+    sls_checkmem(*components[c]);
+    memset(*components[c], 0, self->capacity * sizeof(float));
+  }
+
+  size_t n_chunks =
+    (self->capacity + SLS_PARTICLES_GRAIN - 1) / SLS_PARTICLES_GRAIN;
+  self->chunk_alive = calloc(n_chunks, sizeof(size_t));
+  sls_checkmem(self->chunk_alive);
+  return self;
+error:
+  return sls_particles_dtor(self);
+}
+
+slsParticleSystem* sls_particles_dtor(slsParticleSystem* self)
+{
+  float** components[SLS_PARTICLES_N_COMPONENTS];
+  sls_particles_components(self, components);
+  for (size_t c = 0; c < SLS_PARTICLES_N_COMPONENTS; ++c) {
+    free(*components[c]);
+  }
+  free(self->chunk_alive);
+  if (self->vao) {
+    sls_streambuffer_dtor(&self->stream);
+    glDeleteVertexArrays(1, &self->vao);
+  }
+  *self = (slsParticleSystem){};
+  return self;
+}
+
+/**
+ * @brief runs `fn` over [0, count) in grain-sized chunks, on the job queue
+ * if given. Chunks are the same either way, so per-chunk state does not
+ * depend on scheduling.
+ */
+static void sls_particles_for(slsJobQueue* jobs_opt,
+                              size_t count,
+                              slsRangeFn fn,
+                              void* data)
+{
+  if (jobs_opt && count > SLS_PARTICLES_GRAIN) {
+    sls_jobqueue_parallel_for(jobs_opt, count, SLS_PARTICLES_GRAIN, fn, data);
+    return;
+  }
+  for (size_t begin = 0; begin < count; begin += SLS_PARTICLES_GRAIN) {
+    size_t end = begin + SLS_PARTICLES_GRAIN < count
+                   ? begin + SLS_PARTICLES_GRAIN
+                   : count;
+    fn(data, begin, end);
+  }
+}
+
+/*----------------------------------------*
+ * emission
+ *----------------------------------------*/
+
+static uint32_t sls_particles_mix(uint32_t x)
+{
+  x ^= x >> 16;
+  x *= 0x7feb352du;
+  x ^= x >> 15;
+  x *= 0x846ca68bu;
+  x ^= x >> 16;
+  return x ? x : 1;
+}
+
+typedef struct slsParticleSpawn {
+  slsParticleSystem* system;
+  /** @brief index of the first new particle */
+  size_t first;
+  uint32_t seed;
+} slsParticleSpawn;
+
+#ifdef SLS_PARTICLES_SSE
+
+/**
+ * @brief four xorshift streams, returning uniform floats in [-1, 1)
+ */
+static inline __m128 sls_particles_random(__m128i* state)
+{
+  __m128i x = *state;
+  x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+  x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+  x = _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+  *state = x;
+  // random mantissa under the exponent of 2.0 gives [2, 4)
+  __m128 two_to_four = _mm_castsi128_ps(
+    _mm_or_si128(_mm_srli_epi32(x, 9), _mm_set1_epi32(0x40000000)));
+  return _mm_sub_ps(two_to_four, _mm_set1_ps(3.f));
+}
+
+/**
+ * @brief spawns particles [first + begin, first + end)
+ */
+static void sls_particles_spawn(void* data, size_t begin, size_t end)
+{
+  slsParticleSpawn const* spawn = data;
+  slsParticleSystem* self = spawn->system;
+  slsParticleEmitter const* e = &self->emitter;
+  uint32_t chunk = (uint32_t)(begin / SLS_PARTICLES_GRAIN);
+  uint32_t lane_seed = sls_particles_mix(spawn->seed ^ chunk * 0x9e3779b9u);
+  __m128i state = _mm_set_epi32((int)sls_particles_mix(lane_seed + 3),
+                                (int)sls_particles_mix(lane_seed + 2),
+                                (int)sls_particles_mix(lane_seed + 1),
+                                (int)sls_particles_mix(lane_seed));
+
+  float const origin[6] = { e->position.x, e->position.y, e->position.z,
+                            e->velocity.x, e->velocity.y, e->velocity.z };
+  float const spread[6] = { e->extent.x, e->extent.y, e->extent.z,
+                            e->jitter.x, e->jitter.y, e->jitter.z };
+  float* dst[SLS_PARTICLES_N_COMPONENTS] = { self->px,  self->py,
+                                             self->pz,  self->vx,
+                                             self->vy,  self->vz,
+                                             self->age, self->lifetime };
+  __m128 life_mid = _mm_set1_ps(0.5f * (e->lifetime_min + e->lifetime_max));
+  __m128 life_half = _mm_set1_ps(0.5f * (e->lifetime_max - e->lifetime_min));
+
+  for (size_t i = begin; i < end; i += 4) {
+    __m128 v[SLS_PARTICLES_N_COMPONENTS];
+    for (int c = 0; c < 6; ++c) {
+      v[c] = _mm_add_ps(
+        _mm_set1_ps(origin[c]),
+        _mm_mul_ps(sls_particles_random(&state), _mm_set1_ps(spread[c])));
+    }
+    v[6] = _mm_setzero_ps();
+    v[7] = _mm_add_ps(life_mid,
+                      _mm_mul_ps(sls_particles_random(&state), life_half));
+
+    size_t at = spawn->first + i;
+    if (end - i >= 4) {
+      for (int c = 0; c < SLS_PARTICLES_N_COMPONENTS; ++c) {
+        _mm_storeu_ps(dst[c] + at, v[c]);
+      }
+    } else {
+      // the next chunk's particles may follow, so only write our own
+      float lanes[4];
+      for (int c = 0; c < SLS_PARTICLES_N_COMPONENTS; ++c) {
+        _mm_storeu_ps(lanes, v[c]);
+        memcpy(dst[c] + at, lanes, (end - i) * sizeof(float));
+      }
+    }
+  }
+}
+
+#else
+
+static inline float sls_particles_random(uint32_t* state)
+{
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  union {
+    uint32_t u;
+    float f;
+  } two_to_four = {.u = (x >> 9) | 0x40000000u };
+  return two_to_four.f - 3.f;
+}
+
+static void sls_particles_spawn(void* data, size_t begin, size_t end)
+{
+  slsParticleSpawn const* spawn = data;
+  slsParticleSystem* self = spawn->system;
+  slsParticleEmitter const* e = &self->emitter;
+  uint32_t chunk = (uint32_t)(begin / SLS_PARTICLES_GRAIN);
+  uint32_t lane_seed = sls_particles_mix(spawn->seed ^ chunk * 0x9e3779b9u);
+  // the same four streams as the vector path, one per lane
+  uint32_t state[4];
+  for (uint32_t lane = 0; lane < 4; ++lane) {
+    state[lane] = sls_particles_mix(lane_seed + lane);
+  }
+
+  float const origin[6] = { e->position.x, e->position.y, e->position.z,
+                            e->velocity.x, e->velocity.y, e->velocity.z };
+  float const spread[6] = { e->extent.x, e->extent.y, e->extent.z,
+                            e->jitter.x, e->jitter.y, e->jitter.z };
+  float* dst[SLS_PARTICLES_N_COMPONENTS] = { self->px,  self->py,
+                                             self->pz,  self->vx,
+                                             self->vy,  self->vz,
+                                             self->age, self->lifetime };
+  float life_mid = 0.5f * (e->lifetime_min + e->lifetime_max);
+  float life_half = 0.5f * (e->lifetime_max - e->lifetime_min);
+
+  for (size_t i = begin; i < end; i += 4) {
+    float v[SLS_PARTICLES_N_COMPONENTS][4];
+    for (int c = 0; c < 6; ++c) {
+      for (int lane = 0; lane < 4; ++lane) {
+        v[c][lane] =
+          origin[c] + sls_particles_random(state + lane) * spread[c];
+      }
+    }
+    for (int lane = 0; lane < 4; ++lane) {
+      v[6][lane] = 0.f;
+      v[7][lane] = life_mid + sls_particles_random(state + lane) * life_half;
+    }
+
+    size_t n_lanes = end - i < 4 ? end - i : 4;
+    for (int c = 0; c < SLS_PARTICLES_N_COMPONENTS; ++c) {
+      memcpy(dst[c] + spawn->first + i, v[c], n_lanes * sizeof(float));
+    }
+  }
+}
+
+#endif
+
+size_t sls_particles_emit(slsParticleSystem* self,
+                          size_t count,
+                          slsJobQueue* jobs_opt)
+{
+  size_t room = self->capacity - self->n_particles;
+  count = count < room ? count : room;
+  slsParticleSpawn spawn = {.system = self,
+                            .first = self->n_particles,
+                            .seed = self->seed };
+  self->seed = sls_particles_mix(self->seed + 1);
+  sls_particles_for(jobs_opt, count, sls_particles_spawn, &spawn);
+  self->n_particles += count;
+  return count;
+}
+
+/*----------------------------------------*
+ * simulation
+ *----------------------------------------*/
+
+typedef struct slsParticleStep {
+  slsParticleSystem* system;
+  float dt;
+} slsParticleStep;
+
+/**
+ * @brief integrates and ages particles [begin, end), then moves the
+ * survivors to the front of the range, in order
+ */
+static void sls_particles_step(void* data, size_t begin, size_t end)
+{
+  slsParticleStep const* step = data;
+  slsParticleSystem* self = step->system;
+  slsParticleEmitter const* e = &self->emitter;
+  float dt = step->dt;
+  float damping = 1.f - e->drag * dt;
+  damping = damping > 0.f ? damping : 0.f;
+  float* arrays[SLS_PARTICLES_N_COMPONENTS] = { self->px,  self->py,
+                                                self->pz,  self->vx,
+                                                self->vy,  self->vz,
+                                                self->age, self->lifetime };
+  size_t n_alive = begin;
+
+#ifdef SLS_PARTICLES_SSE
+  __m128 dt_v = _mm_set1_ps(dt);
+  __m128 damping_v = _mm_set1_ps(damping);
+  __m128 dv[3] = { _mm_set1_ps(e->gravity.x * dt),
+                   _mm_set1_ps(e->gravity.y * dt),
+                   _mm_set1_ps(e->gravity.z * dt) };
+
+  // chunks start on groups of four, and the arrays are padded, so every
+  // group is loaded whole; the padding lanes are never kept
+  for (size_t i = begin; i < end; i += 4) {
+    __m128 v[SLS_PARTICLES_N_COMPONENTS];
+    for (int axis = 0; axis < 3; ++axis) {
+      __m128 vel = _mm_load_ps(arrays[3 + axis] + i);
+      vel = _mm_mul_ps(_mm_add_ps(vel, dv[axis]), damping_v);
+      v[3 + axis] = vel;
+      v[axis] = _mm_add_ps(_mm_load_ps(arrays[axis] + i),
+                           _mm_mul_ps(vel, dt_v));
+    }
+    v[6] = _mm_add_ps(_mm_load_ps(self->age + i), dt_v);
+    v[7] = _mm_load_ps(self->lifetime + i);
+    int alive = _mm_movemask_ps(_mm_cmplt_ps(v[6], v[7]));
+    size_t n_lanes = end - i < 4 ? end - i : 4;
+    alive &= (1 << n_lanes) - 1;
+
+    if (alive == 0xf && n_alive == i) {
+      for (int c = 0; c < SLS_PARTICLES_N_COMPONENTS; ++c) {
+        _mm_store_ps(arrays[c] + i, v[c]);
+      }
+      n_alive += 4;
+      continue;
+    }
+
+    // every lane is written at the cursor, which only advances past
+    // survivors; the cursor never passes the lane being written
+    float lanes[SLS_PARTICLES_N_COMPONENTS][4];
+    for (int c = 0; c < SLS_PARTICLES_N_COMPONENTS; ++c) {
+      _mm_storeu_ps(lanes[c], v[c]);
+    }
+    for (size_t lane = 0; lane < n_lanes; ++lane) {
+      for (int c = 0; c < SLS_PARTICLES_N_COMPONENTS; ++c) {
+        arrays[c][n_alive] = lanes[c][lane];
+      }
+      n_alive += (alive >> lane) & 1;
+    }
+  }
+#else
+  float dv[3] = { e->gravity.x * dt, e->gravity.y * dt, e->gravity.z * dt };
+  for (size_t i = begin; i < end; ++i) {
+    float v[SLS_PARTICLES_N_COMPONENTS];
+    for (int axis = 0; axis < 3; ++axis) {
+      v[3 + axis] = (arrays[3 + axis][i] + dv[axis]) * damping;
+      v[axis] = arrays[axis][i] + v[3 + axis] * dt;
+    }
+    v[6] = self->age[i] + dt;
+    v[7] = self->lifetime[i];
+    for (int c = 0; c < SLS_PARTICLES_N_COMPONENTS; ++c) {
+      arrays[c][n_alive] = v[c];
+    }
+    n_alive += v[6] < v[7];
+  }
+#endif
+
+  self->chunk_alive[begin / SLS_PARTICLES_GRAIN] = n_alive - begin;
+}
+
+void sls_particles_update(slsParticleSystem* self,
+                          float dt,
+                          slsJobQueue* jobs_opt)
+{
+  size_t n_before = self->n_particles;
+  slsParticleStep step = {.system = self, .dt = dt };
+  sls_particles_for(jobs_opt, n_before, sls_particles_step, &step);
+
+  // close the gaps the dead left between chunks
+  float** components[SLS_PARTICLES_N_COMPONENTS];
+  sls_particles_components(self, components);
+  size_t n_alive = 0;
+  size_t n_chunks = (n_before + SLS_PARTICLES_GRAIN - 1) / SLS_PARTICLES_GRAIN;
+  for (size_t chunk = 0; chunk < n_chunks; ++chunk) {
+    size_t begin = chunk * SLS_PARTICLES_GRAIN;
+    size_t count = self->chunk_alive[chunk];
+    if (begin != n_alive && count > 0) {
+      for (size_t c = 0; c < SLS_PARTICLES_N_COMPONENTS; ++c) {
+        float* array = *components[c];
+        memmove(array + n_alive, array + begin, count * sizeof(float));
+      }
+    }
+    n_alive += count;
+  }
+  self->n_particles = n_alive;
+
+  float spawn = self->spawn_carry + self->emitter.rate * dt;
+  size_t n_spawn = spawn > 0.f ? (size_t)spawn : 0;
+  self->spawn_carry = spawn - (float)n_spawn;
+  n_spawn = sls_particles_emit(self, n_spawn, jobs_opt);
+
+  self->stats = (slsParticleStats){.n_alive = self->n_particles,
+                                   .n_spawned = n_spawn,
+                                   .n_died = n_before - n_alive };
+}
+
+/*----------------------------------------*
+ * drawing
+ *----------------------------------------*/
+
+typedef struct slsParticleFill {
+  slsParticleSystem const* system;
+  slsParticleVertex* dst;
+} slsParticleFill;
+
+static float sls_particles_channel(uint32_t color, int channel)
+{
+  return (float)((color >> (8 * channel)) & 0xff);
+}
+
+/**
+ * @brief writes the vertices of particles [begin, end)
+ */
+static void sls_particles_fill(void* data, size_t begin, size_t end)
+{
+  slsParticleFill const* fill = data;
+  slsParticleSystem const* self = fill->system;
+  slsParticleEmitter const* e = &self->emitter;
+  slsParticleVertex* dst = fill->dst;
+
+#ifdef SLS_PARTICLES_SSE
+  __m128 size0 = _mm_set1_ps(e->size_start);
+  __m128 size_delta = _mm_set1_ps(e->size_end - e->size_start);
+  __m128 const half = _mm_set1_ps(0.5f);
+  __m128 color0[4], color_delta[4];
+  for (int ch = 0; ch < 4; ++ch) {
+    float start = sls_particles_channel(e->color_start, ch);
+    color0[ch] = _mm_set1_ps(start);
+    color_delta[ch] =
+      _mm_set1_ps(sls_particles_channel(e->color_end, ch) - start);
+  }
+
+  for (size_t i = begin; i < end; i += 4) {
+    __m128 t = _mm_div_ps(_mm_load_ps(self->age + i),
+                          _mm_load_ps(self->lifetime + i));
+    t = _mm_min_ps(_mm_max_ps(t, _mm_setzero_ps()), _mm_set1_ps(1.f));
+
+    __m128i color = _mm_setzero_si128();
+    for (int ch = 0; ch < 4; ++ch) {
+      // add a half and truncate, as the scalar path does: the default
+      // rounding mode would round halves to even
+      __m128i channel = _mm_cvttps_epi32(_mm_add_ps(
+        _mm_add_ps(color0[ch], _mm_mul_ps(color_delta[ch], t)), half));
+      color = _mm_or_si128(color, _mm_slli_epi32(channel, 8 * ch));
+    }
+
+    __m128 x = _mm_load_ps(self->px + i);
+    __m128 y = _mm_load_ps(self->py + i);
+    __m128 z = _mm_load_ps(self->pz + i);
+    __m128 size = _mm_add_ps(size0, _mm_mul_ps(size_delta, t));
+    _MM_TRANSPOSE4_PS(x, y, z, size);
+    __m128 const rows[4] = { x, y, z, size };
+    uint32_t colors[4];
+    _mm_storeu_si128((__m128i*)colors, color);
+
+    size_t n_lanes = end - i < 4 ? end - i : 4;
+    for (size_t lane = 0; lane < n_lanes; ++lane) {
+      // position and size are contiguous, so one store writes both
+      _mm_storeu_ps(dst[i + lane].position, rows[lane]);
+      dst[i + lane].color = colors[lane];
+    }
+  }
+#else
+  for (size_t i = begin; i < end; ++i) {
+    float t = self->age[i] / self->lifetime[i];
+    t = t < 0.f ? 0.f : t > 1.f ? 1.f : t;
+    uint32_t color = 0;
+    for (int ch = 0; ch < 4; ++ch) {
+      float start = sls_particles_channel(e->color_start, ch);
+      float end_value = sls_particles_channel(e->color_end, ch);
+      uint32_t channel = (uint32_t)(start + (end_value - start) * t + 0.5f);
+      color |= channel << (8 * ch);
+    }
+    dst[i] = (slsParticleVertex){
+      .position = { self->px[i], self->py[i], self->pz[i] },
+      .size = e->size_start + (e->size_end - e->size_start) * t,
+      .color = color,
+    };
+  }
+#endif
+}
+
+void sls_particles_write_vertices(slsParticleSystem const* self,
+                                  slsParticleVertex* dst,
+                                  slsJobQueue* jobs_opt)
+{
+  slsParticleFill fill = {.system = self, .dst = dst };
+  sls_particles_for(jobs_opt, self->n_particles, sls_particles_fill, &fill);
+}
+
+static bool sls_particles_setup(slsParticleSystem* self)
+{
+  sls_streambuffer_init(&self->stream,
+                        self->capacity * sizeof(slsParticleVertex));
+  if (!self->stream.buffer) {
+    return false;
+  }
+  glGenVertexArrays(1, &self->vao);
+  glBindVertexArray(self->vao);
+  glEnableVertexAttribArray(SLS_ATTRIB_POSITION);
+  glEnableVertexAttribArray(SLS_ATTRIB_COLOR);
+  glBindVertexArray(0);
+  return true;
+}
+
+bool sls_particles_draw(slsParticleSystem* self,
+                        GLuint program,
+                        kmMat4 const* view_projection,
+                        float point_scale,
+                        slsJobQueue* jobs_opt)
+{
+  if (self->n_particles == 0) {
+    return true;
+  }
+  if (!self->vao && !sls_particles_setup(self)) {
+    return false;
+  }
+
+  sls_streambuffer_begin_frame(&self->stream);
+  GLintptr offset;
+  size_t size = self->n_particles * sizeof(slsParticleVertex);
+  slsParticleVertex* vertices = sls_streambuffer_alloc(
+    &self->stream, size, sizeof(slsParticleVertex), &offset);
+  if (!vertices) {
+    sls_streambuffer_end_frame(&self->stream);
+    return false;
+  }
+  sls_particles_write_vertices(self, vertices, jobs_opt);
+  sls_streambuffer_commit(&self->stream);
+
+  glUseProgram(program);
+  glUniformMatrix4fv(glGetUniformLocation(program, "particle_view_projection"),
+                     1,
+                     GL_FALSE,
+                     view_projection->mat);
+  glUniform1f(glGetUniformLocation(program, "particle_point_scale"),
+              point_scale);
+
+  // position and size lead the vertex
+  GLsizei stride = sizeof(slsParticleVertex);
+  glBindVertexArray(self->vao);
+  glBindBuffer(GL_ARRAY_BUFFER, self->stream.buffer);
+  glVertexAttribPointer(SLS_ATTRIB_POSITION,
+                        4,
+                        GL_FLOAT,
+                        GL_FALSE,
+                        stride,
+                        (void*)offset);
+  glVertexAttribPointer(SLS_ATTRIB_COLOR,
+                        4,
+                        GL_UNSIGNED_BYTE,
+                        GL_TRUE,
+                        stride,
+                        (void*)(offset + offsetof(slsParticleVertex, color)));
+
+  // additive blending, restoring the caller's state afterwards
+  GLboolean blend = glIsEnabled(GL_BLEND);
+  GLboolean point_size = glIsEnabled(GL_PROGRAM_POINT_SIZE);
+  GLint blend_func[4];
+  glGetIntegerv(GL_BLEND_SRC_RGB, blend_func);
+  glGetIntegerv(GL_BLEND_DST_RGB, blend_func + 1);
+  glGetIntegerv(GL_BLEND_SRC_ALPHA, blend_func + 2);
+  glGetIntegerv(GL_BLEND_DST_ALPHA, blend_func + 3);
+  GLboolean depth_mask;
+  glGetBooleanv(GL_DEPTH_WRITEMASK, &depth_mask);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+  glDepthMask(GL_FALSE);
+  glEnable(GL_PROGRAM_POINT_SIZE);
+
+  glDrawArrays(GL_POINTS, 0, (GLsizei)self->n_particles);
+
+  if (!point_size) {
+    glDisable(GL_PROGRAM_POINT_SIZE);
+  }
+  glDepthMask(depth_mask);
+  glBlendFuncSeparate((GLenum)blend_func[0],
+                      (GLenum)blend_func[1],
+                      (GLenum)blend_func[2],
+                      (GLenum)blend_func[3]);
+  if (!blend) {
+    glDisable(GL_BLEND);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindVertexArray(0);
+
+  sls_streambuffer_end_frame(&self->stream);
+  return true;
+}
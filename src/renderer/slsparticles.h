@@ -0,0 +1,189 @@
+/**
+ * @file slsparticles.h
+ * @brief CPU particle system simulated four particles at a time, drawn as
+ * point sprites
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#ifndef DANGERENGINE_SLSPARTICLES_H
+#define DANGERENGINE_SLSPARTICLES_H
+
+#include "../sls-gl.h"
+#include "../slsjobs.h"
+#include "slsstreambuffer.h"
+#include <kazmath/kazmath.h>
+#include <slsmacros.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+SLS_BEGIN_CDECLS
+
+/**
+ * @brief particles per job. A multiple of four, so every chunk starts on
+ * an aligned group of four
+ */
+#define SLS_PARTICLES_GRAIN 16384
+
+typedef struct slsParticleEmitter {
+  /** @brief centre and half extent of the box particles spawn in */
+  kmVec3 position;
+  kmVec3 extent;
+  /** @brief initial velocity, plus up to +/- jitter on each axis */
+  kmVec3 velocity;
+  kmVec3 jitter;
+  kmVec3 gravity;
+  /** @brief fraction of velocity lost per second */
+  float drag;
+  float lifetime_min;
+  float lifetime_max;
+  /** @brief world space size at birth and death */
+  float size_start;
+  float size_end;
+  /** @brief RGBA8, red in the lowest byte, at birth and death */
+  uint32_t color_start;
+  uint32_t color_end;
+  /** @brief particles spawned per second */
+  float rate;
+} slsParticleEmitter;
+
+static const slsParticleEmitter SLS_PARTICLES_DEFAULT_EMITTER = {
+  .velocity = { 0.f, 4.f, 0.f },
+  .jitter = { 1.f, 1.f, 1.f },
+  .gravity = { 0.f, -9.8f, 0.f },
+  .drag = 0.1f,
+  .lifetime_min = 1.f,
+  .lifetime_max = 2.f,
+  .size_start = 0.1f,
+  .size_end = 0.02f,
+  .color_start = 0xff40c0ffu,
+  .color_end = 0x000020ffu,
+  .rate = 1000.f,
+};
+
+/**
+ * @brief interleaved vertex of one point sprite: position and size read
+ * as a vec4 at SLS_ATTRIB_POSITION, color as normalized bytes at
+ * SLS_ATTRIB_COLOR
+ */
+typedef struct slsParticleVertex {
+  float position[3];
+  float size;
+  uint32_t color;
+} slsParticleVertex;
+
+typedef struct slsParticleStats {
+  size_t n_alive;
+  /** @brief particles spawned and retired by the last update */
+  size_t n_spawned;
+  size_t n_died;
+} slsParticleStats;
+
+/**
+ * @brief Particle system.
+ * @detail Particles are stored as 16-byte aligned arrays, one per
+ * component, padded to whole groups of four. Each update runs in chunks of
+ * SLS_PARTICLES_GRAIN particles, on the job queue when given one: a chunk
+ * integrates and ages its particles four at a time, then compacts the
+ * survivors to its front. The chunks' survivors are then moved together,
+ * and new particles are spawned after them, again four at a time from
+ * per-chunk random streams, so the result does not depend on how the
+ * chunks were scheduled.
+ *
+ * Drawing writes one vertex per particle into a stream buffer and draws
+ * them with a single glDrawArrays(GL_POINTS), using a program built from
+ * SLS_PARTICLE_VS and SLS_PARTICLE_FS.
+ */
+typedef struct slsParticleSystem {
+  slsParticleEmitter emitter;
+
+  float* px;
+  float* py;
+  float* pz;
+  float* vx;
+  float* vy;
+  float* vz;
+  float* age;
+  float* lifetime;
+  size_t n_particles;
+  /** @brief most particles alive at once */
+  size_t capacity;
+
+  /** @brief fractional particle left over from the last update's spawn */
+  float spawn_carry;
+  uint32_t seed;
+  /** @brief survivors of each chunk, between compaction and merging */
+  size_t* chunk_alive;
+  slsParticleStats stats;
+
+  /** @brief created by the first draw */
+  slsStreamBuffer stream;
+  GLuint vao;
+} slsParticleSystem;
+
+/**
+ * @param capacity most particles alive at once; spawning stops there
+ */
+slsParticleSystem* sls_particles_init(slsParticleSystem* self,
+                                      slsParticleEmitter const* emitter,
+                                      size_t capacity) SLS_NONNULL(1, 2);
+
+slsParticleSystem* sls_particles_dtor(slsParticleSystem* self)
+  SLS_NONNULL(1);
+
+static inline void sls_particles_clear(slsParticleSystem* self)
+{
+  self->n_particles = 0;
+  self->spawn_carry = 0.f;
+}
+
+/**
+ * @brief advances the particles by `dt` seconds, retires the expired ones
+ * and spawns the emitter's new ones. Makes no GL calls.
+ * @param jobs_opt if given, chunks are simulated across its workers
+ */
+void sls_particles_update(slsParticleSystem* self,
+                          float dt,
+                          slsJobQueue* jobs_opt) SLS_NONNULL(1);
+
+/**
+ * @brief spawns `count` particles, up to the capacity
+ * @return the number spawned
+ */
+size_t sls_particles_emit(slsParticleSystem* self,
+                          size_t count,
+                          slsJobQueue* jobs_opt) SLS_NONNULL(1);
+
+/**
+ * @brief writes a vertex per live particle, sizes and colors interpolated
+ * by age. Makes no GL calls.
+ * @param dst room for n_particles vertices
+ */
+void sls_particles_write_vertices(slsParticleSystem const* self,
+                                  slsParticleVertex* dst,
+                                  slsJobQueue* jobs_opt) SLS_NONNULL(1, 2);
+
+/**
+ * @brief streams the vertices and draws every particle with one call.
+ * Blending is additive, without depth writes.
+ * @param program built from SLS_PARTICLE_VS and SLS_PARTICLE_FS, with
+ * SLS_PARTICLE_UNIFORMS
+ * @param point_scale pixels per world unit at a distance of one, i.e.
+ * projection.mat[5] * viewport height / 2
+ * @return false if the stream buffer has no room for this frame
+ */
+bool sls_particles_draw(slsParticleSystem* self,
+                        GLuint program,
+                        kmMat4 const* view_projection,
+                        float point_scale,
+                        slsJobQueue* jobs_opt) SLS_NONNULL(1, 3);
+
+extern char const* SLS_PARTICLE_VS;
+extern char const* SLS_PARTICLE_FS;
+extern char const* SLS_PARTICLE_UNIFORMS;
+
+SLS_END_CDECLS
+
+#endif // DANGERENGINE_SLSPARTICLES_H
@@ -0,0 +1,526 @@
+/**
+ * @file slspostfx.c
+ * @brief
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#include "slspostfx.h"
+#include <slsutils.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+slsPostFx* sls_postfx_init(slsPostFx* self, slsShaderLibrary* shaders)
+{
+  *self = (slsPostFx){.shaders = shaders, .format = GL_RGBA16F };
+  sls_shaderlib_add_include(
+    shaders, "postfx/downsample.glsl", SLS_POSTFX_DOWNSAMPLE_FS);
+  return self;
+}
+
+slsPostFx* sls_postfx_dtor(slsPostFx* self)
+{
+  // programs belong to the shader library
+  if (self->vao) {
+    glDeleteVertexArrays(1, &self->vao);
+  }
+  *self = (slsPostFx){};
+  return self;
+}
+
+int sls_postfx_add(slsPostFx* self, slsPostFxEffect const* effect)
+{
+  if (self->n_effects == SLS_POSTFX_MAX_EFFECTS) {
+    sls_log_err("post-processing stack is full, dropping %s", effect->name);
+    return -1;
+  }
+  for (int i = 0; i < self->n_effects; ++i) {
+    if (strcmp(self->effects[i].name, effect->name) == 0) {
+      sls_log_err("post-processing effect %s added twice", effect->name);
+      return -1;
+    }
+  }
+
+  char include[64];
+  snprintf(include, sizeof(include), "postfx/%s.glsl", effect->name);
+  sls_shaderlib_add_include(self->shaders, include, effect->source);
+
+  int index = self->n_effects++;
+  self->effects[index] = *effect;
+  self->enabled[index] = true;
+  self->downsample_programs[index] = 0;
+  self->planned = false;
+  return index;
+}
+
+void sls_postfx_set_enabled(slsPostFx* self, int effect, bool enabled)
+{
+  if (effect >= 0 && effect < self->n_effects &&
+      self->enabled[effect] != enabled) {
+    self->enabled[effect] = enabled;
+    self->planned = false;
+  }
+}
+
+/**
+ * @brief halvings needed to reach a blur effect's scale
+ */
+static int sls_postfx_levels(slsPostFxEffect const* effect)
+{
+  int levels = 1;
+  float scale = 0.5f;
+  while (scale > effect->scale * 1.001f && levels < SLS_POSTFX_MAX_LEVELS) {
+    scale *= 0.5f;
+    levels++;
+  }
+  return levels;
+}
+
+int sls_postfx_plan(slsPostFx* self)
+{
+  self->n_groups = 0;
+  self->stats = (slsPostFxStats){};
+  slsPostFxGroup* group = NULL;
+
+  for (int i = 0; i < self->n_effects; ++i) {
+    if (!self->enabled[i]) {
+      continue;
+    }
+    slsPostFxEffect const* effect = self->effects + i;
+    self->stats.n_unfused++;
+
+    // blur effects read the group's input, so nothing may come before
+    // them but other blur composites
+    bool split = group == NULL || effect->kind == SLS_POSTFX_NEIGHBORHOOD;
+    for (int j = 0; !split && effect->kind == SLS_POSTFX_BLUR &&
+                    j < group->n_effects;
+         ++j) {
+      split = self->effects[group->effects[j]].kind != SLS_POSTFX_BLUR;
+    }
+    if (split) {
+      group = self->groups + self->n_groups++;
+      *group = (slsPostFxGroup){};
+    }
+    group->effects[group->n_effects++] = i;
+
+    if (effect->kind == SLS_POSTFX_BLUR) {
+      self->stats.n_reduced +=
+        sls_postfx_levels(effect) + 2 * effect->iterations;
+    }
+  }
+
+  for (int g = 0; g < self->n_groups; ++g) {
+    group = self->groups + g;
+    int length = snprintf(group->key, sizeof(group->key), "postfx");
+    for (int j = 0; j < group->n_effects; ++j) {
+      char const* name = self->effects[group->effects[j]].name;
+      if (length >= 0 && (size_t)length < sizeof(group->key)) {
+        length += snprintf(group->key + length,
+                           sizeof(group->key) - (size_t)length,
+                           "%c%s",
+                           j == 0 ? '/' : '+',
+                           name);
+      }
+    }
+    if (length < 0 || (size_t)length >= sizeof(group->key)) {
+      // too long to spell out, the hash keeps it unique
+      uint64_t hash = sls_hash_sizeddata(
+        group->effects, (size_t)group->n_effects * sizeof(int));
+      snprintf(group->key,
+               sizeof(group->key),
+               "postfx/%016llx",
+               (unsigned long long)hash);
+    }
+  }
+
+  self->stats.n_fullscreen = self->n_groups;
+  self->planned = true;
+  return self->n_groups;
+}
+
+char* sls_postfx_group_source(slsPostFx const* self, int group_index)
+{
+  if (group_index < 0 || group_index >= self->n_groups) {
+    return NULL;
+  }
+  slsPostFxGroup const* group = self->groups + group_index;
+
+  size_t size = 256;
+  for (int j = 0; j < group->n_effects; ++j) {
+    size += 64 + 2 * strlen(self->effects[group->effects[j]].name);
+  }
+  char* source = malloc(size);
+  if (!source) {
+    return NULL;
+  }
+
+  size_t length = 0;
+#define SLS_POSTFX_EMIT(...)                                                 \
+  length += (size_t)snprintf(source + length, size - length, __VA_ARGS__)
+
+  SLS_POSTFX_EMIT("in vec2 frag_uv;\nout vec4 out_color;\n\n");
+  for (int j = 0; j < group->n_effects; ++j) {
+    SLS_POSTFX_EMIT("#include \"postfx/%s.glsl\"\n",
+                    self->effects[group->effects[j]].name);
+  }
+  SLS_POSTFX_EMIT("\nvoid main(void)\n{\n");
+
+  int first = 0;
+  slsPostFxEffect const* head = self->effects + group->effects[0];
+  if (head->kind == SLS_POSTFX_NEIGHBORHOOD) {
+    SLS_POSTFX_EMIT(
+      "  vec4 color = %s(postfx_src, frag_uv, postfx_texel);\n", head->name);
+    first = 1;
+  } else {
+    SLS_POSTFX_EMIT("  vec4 color = texture(postfx_src, frag_uv);\n");
+  }
+  for (int j = first; j < group->n_effects; ++j) {
+    SLS_POSTFX_EMIT("  color = %s(color, frag_uv);\n",
+                    self->effects[group->effects[j]].name);
+  }
+  SLS_POSTFX_EMIT("  out_color = color;\n}\n");
+
+#undef SLS_POSTFX_EMIT
+  return source;
+}
+
+/*----------------------------------------*
+ * drawing
+ *----------------------------------------*/
+
+static GLuint sls_postfx_program(slsPostFx* self,
+                                 char const* name,
+                                 char const* fs_source)
+{
+  slsShaderDesc desc = {.name = name,
+                        .vs_source = SLS_POSTFX_VS,
+                        .fs_source = fs_source,
+                        .uniforms = SLS_POSTFX_UNIFORMS };
+  return sls_shaderlib_program(self->shaders, &desc, 0);
+}
+
+/**
+ * @brief builds the programs the plan needs. The library caches them by
+ * name, so replanning to a previous chain does not recompile.
+ */
+static bool sls_postfx_build(slsPostFx* self)
+{
+  if (!self->downsample_program) {
+    self->downsample_program =
+      sls_postfx_program(self, "postfx/downsample", SLS_POSTFX_DOWNSAMPLE_FS);
+    self->blur_program =
+      sls_postfx_program(self, "postfx/blur", SLS_POSTFX_BLUR_FS);
+    sls_check(self->downsample_program && self->blur_program,
+              "could not build the post-processing blur programs");
+  }
+
+  for (int g = 0; g < self->n_groups; ++g) {
+    slsPostFxGroup* group = self->groups + g;
+    for (int j = 0; j < group->n_effects; ++j) {
+      int e = group->effects[j];
+      if (self->effects[e].kind != SLS_POSTFX_BLUR ||
+          self->downsample_programs[e]) {
+        continue;
+      }
+      char const* name = self->effects[e].name;
+      char key[96], source[256];
+      snprintf(key, sizeof(key), "postfx/%s_prefilter", name);
+      snprintf(source,
+               sizeof(source),
+               "#define POSTFX_PREFILTER %s_prefilter\n"
+               "#include \"postfx/%s.glsl\"\n"
+               "#include \"postfx/downsample.glsl\"\n",
+               name,
+               name);
+      self->downsample_programs[e] = sls_postfx_program(self, key, source);
+      sls_check(self->downsample_programs[e], "could not build %s", key);
+    }
+
+    if (!group->program) {
+      char* source = sls_postfx_group_source(self, g);
+      sls_checkmem(source);
+      group->program = sls_postfx_program(self, group->key, source);
+      free(source);
+      sls_check(group->program, "could not build %s", group->key);
+    }
+  }
+
+  if (!self->vao) {
+    glGenVertexArrays(1, &self->vao);
+  }
+  return true;
+error:
+  return false;
+}
+
+static void sls_postfx_draw(slsRenderGraph const* graph, int index, void* data)
+{
+  slsPostFxPass const* pass = data;
+  slsPostFx* self = pass->stack;
+  GLuint program = pass->program;
+
+  glDisable(GL_DEPTH_TEST);
+  glDisable(GL_BLEND);
+  glUseProgram(program);
+
+  int width, height;
+  sls_rendergraph_texture_size(graph, pass->src, &width, &height);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, sls_rendergraph_texture(graph, pass->src));
+  glUniform1i(glGetUniformLocation(program, "postfx_src"), 0);
+  glUniform2f(glGetUniformLocation(program, "postfx_texel"),
+              1.f / (float)width,
+              1.f / (float)height);
+  glUniform2f(glGetUniformLocation(program, "postfx_direction"),
+              pass->direction[0],
+              pass->direction[1]);
+
+  if (pass->kind == SLS_POSTFX_PASS_GROUP) {
+    slsPostFxGroup const* group = self->groups + pass->index;
+    GLint unit = 1;
+    for (int j = 0; j < group->n_effects; ++j) {
+      slsPostFxEffect const* effect = self->effects + group->effects[j];
+      if (effect->kind == SLS_POSTFX_BLUR) {
+        char sampler[64];
+        snprintf(sampler, sizeof(sampler), "%s_tex", effect->name);
+        glActiveTexture(GL_TEXTURE0 + (GLenum)unit);
+        glBindTexture(
+          GL_TEXTURE_2D,
+          sls_rendergraph_texture(graph, self->blurred[group->effects[j]]));
+        glUniform1i(glGetUniformLocation(program, sampler), unit++);
+      }
+      if (effect->bind) {
+        effect->bind(program, effect->data);
+      }
+    }
+    glActiveTexture(GL_TEXTURE0);
+  } else if (program == self->downsample_programs[pass->index]) {
+    slsPostFxEffect const* effect = self->effects + pass->index;
+    if (effect->bind) {
+      effect->bind(program, effect->data);
+    }
+  }
+
+  glBindVertexArray(self->vao);
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+  glBindVertexArray(0);
+}
+
+static slsPostFxPass* sls_postfx_add_pass(slsPostFx* self,
+                                          slsRenderGraph* graph,
+                                          char const* name,
+                                          slsPostFxPassKind kind,
+                                          int index,
+                                          GLuint program,
+                                          slsRGResource src,
+                                          slsRGResource dst)
+{
+  if (self->n_passes == SLS_POSTFX_MAX_PASSES) {
+    sls_log_err("post-processing needs more than %d passes",
+                SLS_POSTFX_MAX_PASSES);
+    return NULL;
+  }
+  slsPostFxPass* pass = self->passes + self->n_passes++;
+  *pass = (slsPostFxPass){.stack = self,
+                          .kind = kind,
+                          .index = index,
+                          .program = program,
+                          .src = src };
+
+  int p = sls_rendergraph_add_pass(graph, name, sls_postfx_draw, pass);
+  if (p < 0) {
+    return NULL;
+  }
+  sls_rendergraph_read(graph, p, src);
+  sls_rendergraph_write(graph, p, dst);
+  return pass;
+}
+
+/**
+ * @brief declares the downsample and blur chain of a blur effect
+ * @return the blurred texture, or SLS_RG_NONE
+ */
+static slsRGResource sls_postfx_declare_blur(slsPostFx* self,
+                                             slsRenderGraph* graph,
+                                             int e,
+                                             slsRGResource src)
+{
+  slsPostFxEffect const* effect = self->effects + e;
+  char name[32];
+  float scale = 1.f;
+  int levels = sls_postfx_levels(effect);
+
+  for (int level = 0; level < levels; ++level) {
+    scale *= 0.5f;
+    snprintf(name, sizeof(name), "%s_down%d", effect->name, level);
+    slsRGResource dst = sls_rendergraph_create_texture(
+      graph,
+      name,
+      (slsRGTextureDesc){.scale = scale, .internal_format = self->format });
+    GLuint program = level == 0 ? self->downsample_programs[e]
+                                : self->downsample_program;
+    if (!sls_postfx_add_pass(self,
+                             graph,
+                             name,
+                             SLS_POSTFX_PASS_DOWNSAMPLE,
+                             e,
+                             program,
+                             src,
+                             dst)) {
+      return SLS_RG_NONE;
+    }
+    src = dst;
+  }
+
+  // each blur pass writes a new transient; the graph aliases them back
+  // onto a ping-pong pair
+  slsRGTextureDesc desc = {.scale = scale, .internal_format = self->format };
+  for (int i = 0; i < 2 * effect->iterations; ++i) {
+    bool vertical = i % 2 == 1;
+    snprintf(
+      name, sizeof(name), "%s_blur%d%c", effect->name, i / 2, "hv"[vertical]);
+    slsRGResource dst = sls_rendergraph_create_texture(graph, name, desc);
+    slsPostFxPass* pass = sls_postfx_add_pass(self,
+                                              graph,
+                                              name,
+                                              SLS_POSTFX_PASS_BLUR,
+                                              e,
+                                              self->blur_program,
+                                              src,
+                                              dst);
+    if (!pass) {
+      return SLS_RG_NONE;
+    }
+    pass->direction[0] = vertical ? 0.f : 1.f;
+    pass->direction[1] = vertical ? 1.f : 0.f;
+    src = dst;
+  }
+  return src;
+}
+
+bool sls_postfx_declare(slsPostFx* self,
+                        slsRenderGraph* graph,
+                        slsRGResource input,
+                        slsRGResource output)
+{
+  if (!self->planned) {
+    sls_postfx_plan(self);
+  }
+  if (self->n_groups == 0 || !sls_postfx_build(self)) {
+    return false;
+  }
+
+  self->n_passes = 0;
+  slsRGResource src = input;
+  for (int g = 0; g < self->n_groups; ++g) {
+    slsPostFxGroup const* group = self->groups + g;
+    for (int j = 0; j < group->n_effects; ++j) {
+      int e = group->effects[j];
+      if (self->effects[e].kind == SLS_POSTFX_BLUR) {
+        self->blurred[e] = sls_postfx_declare_blur(self, graph, e, src);
+        if (self->blurred[e] == SLS_RG_NONE) {
+          return false;
+        }
+      }
+    }
+
+    slsRGResource dst = output;
+    if (g + 1 < self->n_groups) {
+      char name[32];
+      snprintf(name, sizeof(name), "postfx%d", g);
+      dst = sls_rendergraph_create_texture(
+        graph,
+        name,
+        (slsRGTextureDesc){.scale = 1.f, .internal_format = self->format });
+    }
+    if (!sls_postfx_add_pass(self,
+                             graph,
+                             group->key,
+                             SLS_POSTFX_PASS_GROUP,
+                             g,
+                             group->program,
+                             src,
+                             dst)) {
+      return false;
+    }
+    // the composite samples each blurred texture too
+    int p = graph->n_passes - 1;
+    for (int j = 0; j < group->n_effects; ++j) {
+      int e = group->effects[j];
+      if (self->effects[e].kind == SLS_POSTFX_BLUR) {
+        sls_rendergraph_read(graph, p, self->blurred[e]);
+      }
+    }
+    src = dst;
+  }
+  return true;
+}
+
+/*----------------------------------------*
+ * built-in effects
+ *----------------------------------------*/
+
+static void sls_postfx_bind_bloom(GLuint program, void* data)
+{
+  slsPostFxBloom const* params = data;
+  glUniform1f(glGetUniformLocation(program, "bloom_threshold"),
+              params->threshold);
+  glUniform1f(glGetUniformLocation(program, "bloom_intensity"),
+              params->intensity);
+}
+
+static void sls_postfx_bind_tonemap(GLuint program, void* data)
+{
+  slsPostFxTonemap const* params = data;
+  glUniform1f(glGetUniformLocation(program, "tonemap_exposure"),
+              params->exposure);
+}
+
+static void sls_postfx_bind_grade(GLuint program, void* data)
+{
+  slsPostFxGrade const* params = data;
+  glUniform3fv(glGetUniformLocation(program, "grade_lift"), 1, params->lift);
+  glUniform3fv(glGetUniformLocation(program, "grade_gain"), 1, params->gain);
+  glUniform1f(glGetUniformLocation(program, "grade_contrast"),
+              params->contrast);
+  glUniform1f(glGetUniformLocation(program, "grade_saturation"),
+              params->saturation);
+}
+
+slsPostFxEffect sls_postfx_bloom(slsPostFxBloom* params, float scale)
+{
+  return (slsPostFxEffect){.name = "bloom",
+                           .kind = SLS_POSTFX_BLUR,
+                           .source = SLS_POSTFX_BLOOM_GLSL,
+                           .bind = sls_postfx_bind_bloom,
+                           .data = params,
+                           .scale = scale,
+                           .iterations = 2 };
+}
+
+slsPostFxEffect sls_postfx_tonemap(slsPostFxTonemap* params)
+{
+  return (slsPostFxEffect){.name = "tonemap",
+                           .kind = SLS_POSTFX_PIXEL,
+                           .source = SLS_POSTFX_TONEMAP_GLSL,
+                           .bind = sls_postfx_bind_tonemap,
+                           .data = params };
+}
+
+slsPostFxEffect sls_postfx_grade(slsPostFxGrade* params)
+{
+  return (slsPostFxEffect){.name = "grade",
+                           .kind = SLS_POSTFX_PIXEL,
+                           .source = SLS_POSTFX_GRADE_GLSL,
+                           .bind = sls_postfx_bind_grade,
+                           .data = params };
+}
+
+slsPostFxEffect sls_postfx_fxaa()
+{
+  return (slsPostFxEffect){.name = "fxaa",
+                           .kind = SLS_POSTFX_NEIGHBORHOOD,
+                           .source = SLS_POSTFX_FXAA_GLSL };
+}
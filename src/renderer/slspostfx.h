@@ -0,0 +1,225 @@
+/**
+ * @file slspostfx.h
+ * @brief post-processing stack, fusing adjacent per-pixel effects into one
+ * pass
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#ifndef DANGERENGINE_SLSPOSTFX_H
+#define DANGERENGINE_SLSPOSTFX_H
+
+#include "../sls-gl.h"
+#include "slsrendergraph.h"
+#include "slsshaderlib.h"
+#include <slsmacros.h>
+#include <stdbool.h>
+
+SLS_BEGIN_CDECLS
+
+#define SLS_POSTFX_MAX_EFFECTS 16
+#define SLS_POSTFX_MAX_PASSES 48
+/** @brief halvings of a blur effect's resolution */
+#define SLS_POSTFX_MAX_LEVELS 3
+
+/**
+ * @brief sets an effect's uniforms, with its pass's program bound
+ */
+typedef void (*slsPostFxBindFn)(GLuint program, void* data);
+
+typedef enum slsPostFxKind {
+  /**
+   * @brief maps each pixel on its own. The source defines
+   * `vec4 <name>(vec4 color, vec2 uv)`, and is fused with its neighbours.
+   */
+  SLS_POSTFX_PIXEL,
+  /**
+   * @brief samples around each pixel, e.g. antialiasing. The source defines
+   * `vec4 <name>(sampler2D src, vec2 uv, vec2 texel)`, so the effect needs
+   * its input in a texture, and starts a new pass.
+   */
+  SLS_POSTFX_NEIGHBORHOOD,
+  /**
+   * @brief blurs a prefiltered copy of its input at reduced resolution,
+   * then composites it per pixel. The source defines
+   * `vec4 <name>_prefilter(vec4 color)`, `uniform sampler2D <name>_tex`
+   * and the composite `vec4 <name>(vec4 color, vec2 uv)`, which is fused
+   * with the per-pixel effects after it.
+   */
+  SLS_POSTFX_BLUR,
+} slsPostFxKind;
+
+typedef struct slsPostFxEffect {
+  /** @brief GLSL function name, unique within a stack */
+  char const* name;
+  slsPostFxKind kind;
+  char const* source;
+  slsPostFxBindFn bind;
+  void* data;
+  /** @brief blur only: resolution relative to the input, 0.5 or 0.25 */
+  float scale;
+  /** @brief blur only: horizontal and vertical blur pairs */
+  int iterations;
+} slsPostFxEffect;
+
+/**
+ * @brief effects drawn in one full-screen pass
+ */
+typedef struct slsPostFxGroup {
+  int effects[SLS_POSTFX_MAX_EFFECTS];
+  int n_effects;
+  /** @brief shader name, joining the effect names */
+  char key[128];
+  GLuint program;
+} slsPostFxGroup;
+
+typedef enum slsPostFxPassKind {
+  SLS_POSTFX_PASS_GROUP,
+  SLS_POSTFX_PASS_DOWNSAMPLE,
+  SLS_POSTFX_PASS_BLUR,
+} slsPostFxPassKind;
+
+typedef struct slsPostFxPass {
+  struct slsPostFx* stack;
+  slsPostFxPassKind kind;
+  /** @brief group, or blur effect */
+  int index;
+  GLuint program;
+  slsRGResource src;
+  /** @brief blur direction in texels */
+  float direction[2];
+} slsPostFxPass;
+
+typedef struct slsPostFxStats {
+  /** @brief full-resolution passes, and passes at reduced resolution */
+  int n_fullscreen;
+  int n_reduced;
+  /** @brief full-resolution passes the effects would take unfused */
+  int n_unfused;
+} slsPostFxStats;
+
+/**
+ * @brief Post-processing stack.
+ * @detail Effects run in the order they were added. Planning splits the
+ * enabled effects into groups, each drawn by one generated shader: a group
+ * starts at the first effect, at each neighborhood effect, and at each
+ * blur effect that follows a per-pixel or neighborhood one, since those
+ * read the group's input as a texture. Blur effects downsample their
+ * prefiltered input by halves, then blur it with ping-pong passes; as
+ * declared transients of the render graph, the ping-pong targets alias
+ * onto two textures.
+ */
+typedef struct slsPostFx {
+  /** @brief compiles and owns the generated programs */
+  slsShaderLibrary* shaders;
+  /** @brief format of intermediate and blur targets */
+  GLenum format;
+
+  slsPostFxEffect effects[SLS_POSTFX_MAX_EFFECTS];
+  bool enabled[SLS_POSTFX_MAX_EFFECTS];
+  int n_effects;
+
+  slsPostFxGroup groups[SLS_POSTFX_MAX_EFFECTS];
+  int n_groups;
+  bool planned;
+  /** @brief blurred result of each blur effect, in the frame's graph */
+  slsRGResource blurred[SLS_POSTFX_MAX_EFFECTS];
+
+  slsPostFxPass passes[SLS_POSTFX_MAX_PASSES];
+  int n_passes;
+  slsPostFxStats stats;
+
+  GLuint vao;
+  GLuint downsample_programs[SLS_POSTFX_MAX_EFFECTS];
+  GLuint downsample_program;
+  GLuint blur_program;
+} slsPostFx;
+
+/**
+ * @param shaders library the generated shaders are compiled by. Effect
+ * sources are registered with it as `postfx/<name>.glsl` includes.
+ */
+slsPostFx* sls_postfx_init(slsPostFx* self, slsShaderLibrary* shaders)
+  SLS_NONNULL(1, 2);
+
+slsPostFx* sls_postfx_dtor(slsPostFx* self) SLS_NONNULL(1);
+
+/**
+ * @brief appends an enabled effect
+ * @return the effect's index, or -1 if the stack is full or the name is
+ * taken
+ */
+int sls_postfx_add(slsPostFx* self, slsPostFxEffect const* effect)
+  SLS_NONNULL(1, 2);
+
+void sls_postfx_set_enabled(slsPostFx* self, int effect, bool enabled)
+  SLS_NONNULL(1);
+
+/**
+ * @brief splits the enabled effects into groups. Makes no GL calls.
+ * @return the number of groups
+ */
+int sls_postfx_plan(slsPostFx* self) SLS_NONNULL(1);
+
+/**
+ * @brief generates the fragment shader of a planned group
+ * @return heap-allocated source, resolved by the shader library
+ */
+char* sls_postfx_group_source(slsPostFx const* self, int group)
+  SLS_NONNULL(1);
+
+/**
+ * @brief declares the stack's passes in a render graph frame, from `input`
+ * to `output`, planning first if the effects changed
+ * @param input a texture, transient or imported
+ * @param output a texture or framebuffer the last pass writes
+ * @return false if a program failed to build, or there is nothing to draw
+ */
+bool sls_postfx_declare(slsPostFx* self,
+                        slsRenderGraph* graph,
+                        slsRGResource input,
+                        slsRGResource output) SLS_NONNULL(1, 2);
+
+/*----------------------------------------*
+ * built-in effects
+ *----------------------------------------*/
+
+typedef struct slsPostFxBloom {
+  /** @brief brightness where bloom starts */
+  float threshold;
+  float intensity;
+} slsPostFxBloom;
+
+typedef struct slsPostFxTonemap {
+  float exposure;
+} slsPostFxTonemap;
+
+typedef struct slsPostFxGrade {
+  float lift[3];
+  float gain[3];
+  float contrast;
+  float saturation;
+} slsPostFxGrade;
+
+/**
+ * @brief effects reading their parameters from `params` each frame
+ */
+slsPostFxEffect sls_postfx_bloom(slsPostFxBloom* params, float scale)
+  SLS_NONNULL(1);
+slsPostFxEffect sls_postfx_tonemap(slsPostFxTonemap* params) SLS_NONNULL(1);
+slsPostFxEffect sls_postfx_grade(slsPostFxGrade* params) SLS_NONNULL(1);
+slsPostFxEffect sls_postfx_fxaa();
+
+extern char const* SLS_POSTFX_VS;
+extern char const* SLS_POSTFX_UNIFORMS;
+extern char const* SLS_POSTFX_DOWNSAMPLE_FS;
+extern char const* SLS_POSTFX_BLUR_FS;
+extern char const* SLS_POSTFX_BLOOM_GLSL;
+extern char const* SLS_POSTFX_TONEMAP_GLSL;
+extern char const* SLS_POSTFX_GRADE_GLSL;
+extern char const* SLS_POSTFX_FXAA_GLSL;
+
+SLS_END_CDECLS
+
+#endif // DANGERENGINE_SLSPOSTFX_H
@@ -0,0 +1,652 @@
+/**
+ * @file slsprimitives.c
+ * @brief
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#include "slsprimitives.h"
+#include "slsmeshopt.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static const slsCallbackTable sls_primitive_string_keys = {
+  .copy_fn = sls_copy_string, .free_fn = free, .cmp_fn = sls_cmp_string
+};
+
+slsGeometry* sls_geometry_dtor(slsGeometry* self)
+{
+  free(self->vertices);
+  free(self->indices);
+  *self = (slsGeometry){};
+  return self;
+}
+
+static slsVertex sls_primitive_vertex(kmVec3 position,
+                                      kmVec3 normal,
+                                      float u,
+                                      float v)
+{
+  return (slsVertex){.position = { position.x, position.y, position.z },
+                     .normal = { normal.x, normal.y, normal.z },
+                     .uv = { u, v },
+                     .color = { 1.f, 1.f, 1.f, 1.f } };
+}
+
+/**
+ * @brief runs `fn` over [0, count) items of about `item_vertices` each,
+ * across the job queue when there is enough work
+ */
+static void sls_primitive_for(slsJobQueue* jobs_opt,
+                              size_t count,
+                              size_t item_vertices,
+                              slsRangeFn fn,
+                              void* data)
+{
+  item_vertices = item_vertices > 0 ? item_vertices : 1;
+  if (jobs_opt && count > 1 && count * item_vertices > SLS_PRIMITIVES_GRAIN) {
+    size_t grain = SLS_PRIMITIVES_GRAIN / item_vertices;
+    sls_jobqueue_parallel_for(
+      jobs_opt, count, grain > 0 ? grain : 1, fn, data);
+  } else {
+    fn(data, 0, count);
+  }
+}
+
+/*----------------------------------------*
+ * icosphere
+ *----------------------------------------*/
+
+#define SLS_ICOSAHEDRON_VERTICES 12
+#define SLS_ICOSAHEDRON_EDGES 30
+#define SLS_ICOSAHEDRON_FACES 20
+
+static const uint8_t sls_icosahedron_faces[SLS_ICOSAHEDRON_FACES][3] = {
+  { 0, 11, 5 }, { 0, 5, 1 },  { 0, 1, 7 },   { 0, 7, 10 }, { 0, 10, 11 },
+  { 1, 5, 9 },  { 5, 11, 4 }, { 11, 10, 2 }, { 10, 7, 6 }, { 7, 1, 8 },
+  { 3, 9, 4 },  { 3, 4, 2 },  { 3, 2, 6 },   { 3, 6, 8 },  { 3, 8, 9 },
+  { 4, 9, 5 },  { 2, 4, 11 }, { 6, 2, 10 },  { 8, 6, 7 },  { 9, 8, 1 },
+};
+
+typedef struct slsIcosphere {
+  slsGeometry* out;
+  uint32_t n;
+  kmVec3 corners[SLS_ICOSAHEDRON_VERTICES];
+  /** @brief corners of each edge, lowest first */
+  uint8_t edges[SLS_ICOSAHEDRON_EDGES][2];
+  /** @brief edges AB, BC and CA of each face */
+  uint8_t face_edges[SLS_ICOSAHEDRON_FACES][3];
+} slsIcosphere;
+
+static slsVertex sls_icosphere_vertex(kmVec3 p)
+{
+  kmVec3Normalize(&p, &p);
+  float u = 0.5f + atan2f(p.z, p.x) / (2.f * (float)M_PI);
+  float v = 0.5f + asinf(p.y < -1.f ? -1.f : p.y > 1.f ? 1.f : p.y) /
+                     (float)M_PI;
+  return sls_primitive_vertex(p, p, u, v);
+}
+
+/**
+ * @brief corner a * (n - i - j) / n + b * i / n + c * j / n
+ */
+static kmVec3 sls_icosphere_blend(slsIcosphere const* ico,
+                                  uint8_t const* face,
+                                  uint32_t i,
+                                  uint32_t j)
+{
+  float n = (float)ico->n;
+  float wa = (n - (float)(i + j)) / n, wb = (float)i / n, wc = (float)j / n;
+  kmVec3 const* a = ico->corners + face[0];
+  kmVec3 const* b = ico->corners + face[1];
+  kmVec3 const* c = ico->corners + face[2];
+  return (kmVec3){ a->x * wa + b->x * wb + c->x * wc,
+                   a->y * wa + b->y * wb + c->y * wc,
+                   a->z * wa + b->z * wb + c->z * wc };
+}
+
+/**
+ * @brief index of the k-th of n - 1 vertices inside the edge from corner
+ * `from`
+ */
+static uint32_t sls_icosphere_edge_vertex(slsIcosphere const* ico,
+                                          int edge,
+                                          uint8_t from,
+                                          uint32_t k)
+{
+  uint32_t n = ico->n;
+  if (ico->edges[edge][0] != from) {
+    k = n - k;
+  }
+  return SLS_ICOSAHEDRON_VERTICES + (uint32_t)edge * (n - 1) + k - 1;
+}
+
+/**
+ * @brief index of grid point (i, j) of a face. Corners and edges are
+ * shared with the neighbouring faces; the inside belongs to the face.
+ */
+static uint32_t sls_icosphere_index(slsIcosphere const* ico,
+                                    size_t f,
+                                    uint32_t i,
+                                    uint32_t j)
+{
+  uint32_t n = ico->n;
+  uint8_t const* face = sls_icosahedron_faces[f];
+  uint8_t const* edges = ico->face_edges[f];
+  if (j == 0 && (i == 0 || i == n)) {
+    return i == 0 ? face[0] : face[1];
+  }
+  if (j == 0) {
+    return sls_icosphere_edge_vertex(ico, edges[0], face[0], i);
+  }
+  if (i == 0) {
+    return j == n ? face[2]
+                  : sls_icosphere_edge_vertex(ico, edges[2], face[0], j);
+  }
+  if (i + j == n) {
+    return sls_icosphere_edge_vertex(ico, edges[1], face[1], j);
+  }
+  // rows of the inside, each one shorter than the last
+  uint32_t row_start = (j - 1) * (n - 1) - (j - 1) * j / 2;
+  uint32_t first_inside = SLS_ICOSAHEDRON_VERTICES +
+                          SLS_ICOSAHEDRON_EDGES * (n - 1) +
+                          (uint32_t)f * (n - 1) * (n - 2) / 2;
+  return first_inside + row_start + i - 1;
+}
+
+/**
+ * @brief writes the inside vertices and the triangles of faces [begin, end)
+ */
+static void sls_icosphere_faces(void* data, size_t begin, size_t end)
+{
+  slsIcosphere const* ico = data;
+  uint32_t n = ico->n;
+  slsVertex* vertices = ico->out->vertices;
+  for (size_t f = begin; f < end; ++f) {
+    uint8_t const* face = sls_icosahedron_faces[f];
+    for (uint32_t j = 1; j + 1 < n; ++j) {
+      for (uint32_t i = 1; i + j < n; ++i) {
+        vertices[sls_icosphere_index(ico, f, i, j)] =
+          sls_icosphere_vertex(sls_icosphere_blend(ico, face, i, j));
+      }
+    }
+
+    uint32_t* tri = ico->out->indices + f * n * n * 3;
+    for (uint32_t j = 0; j < n; ++j) {
+      for (uint32_t i = 0; i + j < n; ++i) {
+        uint32_t a = sls_icosphere_index(ico, f, i, j);
+        uint32_t b = sls_icosphere_index(ico, f, i + 1, j);
+        uint32_t c = sls_icosphere_index(ico, f, i, j + 1);
+        *tri++ = a;
+        *tri++ = b;
+        *tri++ = c;
+        if (i + j + 1 < n) {
+          *tri++ = b;
+          *tri++ = sls_icosphere_index(ico, f, i + 1, j + 1);
+          *tri++ = c;
+        }
+      }
+    }
+  }
+}
+
+/**
+ * @brief triangles whose u spans more than half the texture cross the
+ * seam at u = 0/1. Like the uv sphere's repeated seam column, their
+ * corners on the low side are replaced by copies with u + 1.
+ */
+static bool sls_icosphere_split_seam(slsGeometry* out)
+{
+  uint32_t* twins = malloc(out->n_vertices * sizeof(uint32_t));
+  if (!twins) {
+    return false;
+  }
+  for (size_t i = 0; i < out->n_vertices; ++i) {
+    twins[i] = UINT32_MAX;
+  }
+
+  uint32_t n_twins = 0;
+  for (size_t t = 0; t < out->n_indices; t += 3) {
+    uint32_t* tri = out->indices + t;
+    float lo = 1.f, hi = 0.f;
+    for (int k = 0; k < 3; ++k) {
+      float u = out->vertices[tri[k]].uv[0];
+      lo = fminf(lo, u);
+      hi = fmaxf(hi, u);
+    }
+    if (hi - lo <= 0.5f) {
+      continue;
+    }
+    for (int k = 0; k < 3; ++k) {
+      if (out->vertices[tri[k]].uv[0] >= 0.5f) {
+        continue;
+      }
+      if (twins[tri[k]] == UINT32_MAX) {
+        twins[tri[k]] = (uint32_t)out->n_vertices + n_twins++;
+      }
+      tri[k] = twins[tri[k]];
+    }
+  }
+
+  slsVertex* vertices =
+    realloc(out->vertices, (out->n_vertices + n_twins) * sizeof(slsVertex));
+  if (!vertices) {
+    free(twins);
+    return false;
+  }
+  for (size_t i = 0; i < out->n_vertices; ++i) {
+    if (twins[i] != UINT32_MAX) {
+      vertices[twins[i]] = vertices[i];
+      vertices[twins[i]].uv[0] += 1.f;
+    }
+  }
+  out->vertices = vertices;
+  out->n_vertices += n_twins;
+  free(twins);
+  return true;
+}
+
+static bool sls_icosphere_generate(slsGeometry* out,
+                                   uint32_t n,
+                                   slsJobQueue* jobs_opt)
+{
+  slsIcosphere ico = {.out = out, .n = n };
+  float t = (1.f + sqrtf(5.f)) * 0.5f;
+  float const corners[SLS_ICOSAHEDRON_VERTICES][3] = {
+    { -1.f, t, 0.f }, { 1.f, t, 0.f },  { -1.f, -t, 0.f }, { 1.f, -t, 0.f },
+    { 0.f, -1.f, t }, { 0.f, 1.f, t },  { 0.f, -1.f, -t }, { 0.f, 1.f, -t },
+    { t, 0.f, -1.f }, { t, 0.f, 1.f },  { -t, 0.f, -1.f }, { -t, 0.f, 1.f },
+  };
+  for (int k = 0; k < SLS_ICOSAHEDRON_VERTICES; ++k) {
+    kmVec3 c = { corners[k][0], corners[k][1], corners[k][2] };
+    kmVec3Normalize(ico.corners + k, &c);
+    out->vertices[k] = sls_icosphere_vertex(c);
+  }
+
+  int n_edges = 0;
+  for (int f = 0; f < SLS_ICOSAHEDRON_FACES; ++f) {
+    for (int k = 0; k < 3; ++k) {
+      uint8_t a = sls_icosahedron_faces[f][k];
+      uint8_t b = sls_icosahedron_faces[f][(k + 1) % 3];
+      uint8_t lo = a < b ? a : b, hi = a < b ? b : a;
+      int e = 0;
+      while (e < n_edges && (ico.edges[e][0] != lo || ico.edges[e][1] != hi)) {
+        e++;
+      }
+      if (e == n_edges) {
+        ico.edges[n_edges][0] = lo;
+        ico.edges[n_edges][1] = hi;
+        n_edges++;
+      }
+      ico.face_edges[f][k] = (uint8_t)e;
+    }
+  }
+  assert(n_edges == SLS_ICOSAHEDRON_EDGES);
+
+  // each edge's vertices are written once, so both faces see the same ones
+  for (int e = 0; e < SLS_ICOSAHEDRON_EDGES; ++e) {
+    uint8_t const edge_face[3] = { ico.edges[e][0], ico.edges[e][1], 0 };
+    for (uint32_t k = 1; k < n; ++k) {
+      uint32_t index = sls_icosphere_edge_vertex(&ico, e, edge_face[0], k);
+      out->vertices[index] =
+        sls_icosphere_vertex(sls_icosphere_blend(&ico, edge_face, k, 0));
+    }
+  }
+
+  sls_primitive_for(jobs_opt,
+                    SLS_ICOSAHEDRON_FACES,
+                    (size_t)n * n / 2,
+                    sls_icosphere_faces,
+                    &ico);
+  return sls_icosphere_split_seam(out);
+}
+
+/*----------------------------------------*
+ * uv sphere and capsule
+ *----------------------------------------*/
+
+/**
+ * @brief rows of vertices around y, from the top pole to the bottom one.
+ * The poles are single vertices; every other row has segments + 1, the
+ * last repeating the first with u = 1.
+ */
+typedef struct slsLathe {
+  slsGeometry* out;
+  uint32_t segments;
+  uint32_t rings;
+  uint32_t n_rows;
+  /** @brief capsules repeat the equator, half the length above and below */
+  float half_length;
+} slsLathe;
+
+static uint32_t sls_lathe_row_start(slsLathe const* lathe, uint32_t row)
+{
+  return row == 0 ? 0 : 1 + (row - 1) * (lathe->segments + 1);
+}
+
+/**
+ * @brief writes rows [begin, end), and the band of triangles below each
+ */
+static void sls_lathe_rows(void* data, size_t begin, size_t end)
+{
+  slsLathe const* lathe = data;
+  uint32_t segments = lathe->segments;
+  uint32_t last = lathe->n_rows - 1;
+  bool capsule = lathe->n_rows > lathe->rings + 1;
+  for (uint32_t row = (uint32_t)begin; row < end; ++row) {
+    // a capsule's rows below the equator continue the sphere's
+    bool upper = row <= lathe->rings / 2;
+    uint32_t ring = capsule && !upper ? row - 1 : row;
+    float phi = (float)M_PI * (float)ring / (float)lathe->rings;
+    float offset = capsule ? (upper ? lathe->half_length : -lathe->half_length)
+                           : 0.f;
+    float v = 1.f - (float)row / (float)last;
+
+    uint32_t start = sls_lathe_row_start(lathe, row);
+    uint32_t n_columns = row == 0 || row == last ? 1 : segments + 1;
+    for (uint32_t s = 0; s < n_columns; ++s) {
+      float theta = 2.f * (float)M_PI * (float)s / (float)segments;
+      kmVec3 normal = { sinf(phi) * cosf(theta),
+                        cosf(phi),
+                        -sinf(phi) * sinf(theta) };
+      if (n_columns == 1) {
+        normal = (kmVec3){ 0.f, row == 0 ? 1.f : -1.f, 0.f };
+      }
+      kmVec3 position = { normal.x, normal.y + offset, normal.z };
+      float u = n_columns == 1 ? 0.5f : (float)s / (float)segments;
+      lathe->out->vertices[start + s] =
+        sls_primitive_vertex(position, normal, u, v);
+    }
+
+    if (row == last) {
+      continue;
+    }
+    // the bands at the poles have one triangle per segment
+    size_t first_tri =
+      row == 0 ? 0 : segments + (size_t)(row - 1) * 2 * segments;
+    uint32_t* tri = lathe->out->indices + first_tri * 3;
+    uint32_t below = sls_lathe_row_start(lathe, row + 1);
+    for (uint32_t s = 0; s < segments; ++s) {
+      if (row == 0) {
+        uint32_t quad[3] = { 0, below + s, below + s + 1 };
+        memcpy(tri, quad, sizeof(quad));
+        tri += 3;
+      } else if (row + 1 == last) {
+        uint32_t quad[3] = { start + s, below, start + s + 1 };
+        memcpy(tri, quad, sizeof(quad));
+        tri += 3;
+      } else {
+        uint32_t quad[6] = { start + s,     below + s,     below + s + 1,
+                             start + s,     below + s + 1, start + s + 1 };
+        memcpy(tri, quad, sizeof(quad));
+        tri += 6;
+      }
+    }
+  }
+}
+
+/*----------------------------------------*
+ * plane and box
+ *----------------------------------------*/
+
+typedef struct slsGridFace {
+  kmVec3 origin;
+  kmVec3 u;
+  kmVec3 v;
+  kmVec3 normal;
+} slsGridFace;
+
+/**
+ * @brief faces of (nu + 1) * (nv + 1) vertices spanning origin +/- u and
+ * +/- v, with u x v facing outwards
+ */
+typedef struct slsGrid {
+  slsGeometry* out;
+  slsGridFace const* faces;
+  uint32_t nu;
+  uint32_t nv;
+} slsGrid;
+
+static const slsGridFace sls_plane_face = {
+  .origin = { 0.f, 0.f, 0.f },
+  .u = { 1.f, 0.f, 0.f },
+  .v = { 0.f, 1.f, 0.f },
+  .normal = { 0.f, 0.f, 1.f },
+};
+
+/** @brief origin, u, v and normal; the origin is the normal */
+static const slsGridFace sls_box_faces[6] = {
+  { { 1, 0, 0 }, { 0, 0, -1 }, { 0, 1, 0 }, { 1, 0, 0 } },
+  { { -1, 0, 0 }, { 0, 0, 1 }, { 0, 1, 0 }, { -1, 0, 0 } },
+  { { 0, 1, 0 }, { 1, 0, 0 }, { 0, 0, -1 }, { 0, 1, 0 } },
+  { { 0, -1, 0 }, { 1, 0, 0 }, { 0, 0, 1 }, { 0, -1, 0 } },
+  { { 0, 0, 1 }, { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } },
+  { { 0, 0, -1 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, 0, -1 } },
+};
+
+/**
+ * @brief writes rows [begin, end), counted across all faces, and the band
+ * of quads above each
+ */
+static void sls_grid_rows(void* data, size_t begin, size_t end)
+{
+  slsGrid const* grid = data;
+  uint32_t nu = grid->nu, nv = grid->nv;
+  for (size_t k = begin; k < end; ++k) {
+    size_t f = k / (nv + 1);
+    uint32_t row = (uint32_t)(k % (nv + 1));
+    slsGridFace const* face = grid->faces + f;
+    uint32_t start = (uint32_t)(f * (nu + 1) * (nv + 1) + row * (nu + 1));
+    float fv = (float)row / (float)nv;
+    for (uint32_t col = 0; col <= nu; ++col) {
+      float fu = (float)col / (float)nu;
+      float su = 2.f * fu - 1.f, sv = 2.f * fv - 1.f;
+      kmVec3 p = { face->origin.x + face->u.x * su + face->v.x * sv,
+                   face->origin.y + face->u.y * su + face->v.y * sv,
+                   face->origin.z + face->u.z * su + face->v.z * sv };
+      grid->out->vertices[start + col] =
+        sls_primitive_vertex(p, face->normal, fu, fv);
+    }
+
+    if (row == nv) {
+      continue;
+    }
+    uint32_t* tri = grid->out->indices + (f * nu * nv + row * nu) * 6;
+    for (uint32_t col = 0; col < nu; ++col) {
+      uint32_t a = start + col, b = a + 1, c = b + nu + 1, d = a + nu + 1;
+      uint32_t quad[6] = { a, b, c, a, c, d };
+      memcpy(tri, quad, sizeof(quad));
+      tri += 6;
+    }
+  }
+}
+
+/*----------------------------------------*
+ * generation
+ *----------------------------------------*/
+
+bool sls_primitive_generate(slsGeometry* out,
+                            slsPrimitiveDesc const* desc,
+                            slsJobQueue* jobs_opt)
+{
+  *out = (slsGeometry){};
+  uint64_t n_vertices = 0, n_triangles = 0;
+  uint64_t segments = desc->segments, rings = desc->rings;
+  bool capsule = desc->kind == SLS_PRIMITIVE_CAPSULE;
+  switch (desc->kind) {
+    case SLS_PRIMITIVE_ICOSPHERE:
+      sls_check(segments >= 1, "icosphere needs a segment per edge");
+      n_vertices = 10 * segments * segments + 2;
+      n_triangles = 20 * segments * segments;
+      break;
+    case SLS_PRIMITIVE_UV_SPHERE:
+    case SLS_PRIMITIVE_CAPSULE:
+      sls_check(segments >= 3 && rings >= 2,
+                "sphere of %lu segments and %lu rings",
+                (unsigned long)segments,
+                (unsigned long)rings);
+      sls_check(!capsule || (rings % 2 == 0 && desc->length >= 0.f),
+                "capsules need an even number of rings and a length");
+      n_vertices = 2 + (rings - 1 + capsule) * (segments + 1);
+      n_triangles = 2 * segments * (rings + capsule - 1);
+      break;
+    case SLS_PRIMITIVE_PLANE:
+    case SLS_PRIMITIVE_BOX: {
+      uint64_t n_faces = desc->kind == SLS_PRIMITIVE_BOX ? 6 : 1;
+      uint64_t nv = desc->kind == SLS_PRIMITIVE_BOX ? segments : rings;
+      sls_check(segments >= 1 && nv >= 1, "grid needs a quad");
+      n_vertices = n_faces * (segments + 1) * (nv + 1);
+      n_triangles = n_faces * segments * nv * 2;
+    } break;
+    default:
+      sls_check(false, "unknown primitive %d", (int)desc->kind);
+  }
+  sls_check(n_vertices <= UINT32_MAX && n_triangles * 3 <= SIZE_MAX / 4,
+            "primitive too large");
+
+  out->n_vertices = (size_t)n_vertices;
+  out->n_indices = (size_t)n_triangles * 3;
+  out->vertices = calloc(out->n_vertices, sizeof(slsVertex));
+  out->indices = calloc(out->n_indices, sizeof(uint32_t));
+  sls_checkmem(out->vertices && out->indices);
+
+  switch (desc->kind) {
+    case SLS_PRIMITIVE_ICOSPHERE:
+      sls_checkmem(sls_icosphere_generate(out, desc->segments, jobs_opt));
+      break;
+    case SLS_PRIMITIVE_UV_SPHERE:
+    case SLS_PRIMITIVE_CAPSULE: {
+      slsLathe lathe = {.out = out,
+                        .segments = desc->segments,
+                        .rings = desc->rings,
+                        .n_rows = desc->rings + 1 + capsule,
+                        .half_length = capsule ? 0.5f * desc->length : 0.f };
+      sls_primitive_for(
+        jobs_opt, lathe.n_rows, segments + 1, sls_lathe_rows, &lathe);
+    } break;
+    case SLS_PRIMITIVE_PLANE:
+    case SLS_PRIMITIVE_BOX: {
+      bool box = desc->kind == SLS_PRIMITIVE_BOX;
+      slsGrid grid = {.out = out,
+                      .faces = box ? sls_box_faces : &sls_plane_face,
+                      .nu = desc->segments,
+                      .nv = box ? desc->segments : desc->rings };
+      size_t n_rows = (box ? 6 : 1) * ((size_t)grid.nv + 1);
+      sls_primitive_for(jobs_opt, n_rows, segments + 1, sls_grid_rows, &grid);
+    } break;
+  }
+
+  sls_check(sls_optimize_vertex_cache(out->indices,
+                                      out->n_indices,
+                                      out->n_vertices,
+                                      SLS_VERTEX_CACHE_SIZE) &&
+              sls_optimize_vertex_fetch(
+                out->vertices, out->n_vertices, out->indices, out->n_indices),
+            "could not optimise primitive");
+  return true;
+error:
+  sls_geometry_dtor(out);
+  return false;
+}
+
+slsMesh* sls_primitive_mesh(slsPrimitiveDesc const* desc,
+                            slsJobQueue* jobs_opt)
+{
+  slsGeometry geometry;
+  if (!sls_primitive_generate(&geometry, desc, jobs_opt)) {
+    return NULL;
+  }
+  slsMesh* mesh = sls_mesh_new(geometry.vertices,
+                               geometry.n_vertices,
+                               geometry.indices,
+                               geometry.n_indices);
+  sls_geometry_dtor(&geometry);
+  return mesh;
+}
+
+void sls_primitive_key(slsPrimitiveDesc const* desc, char* key, size_t size)
+{
+  switch (desc->kind) {
+    case SLS_PRIMITIVE_ICOSPHERE:
+      snprintf(key, size, "icosphere/%u", desc->segments);
+      break;
+    case SLS_PRIMITIVE_UV_SPHERE:
+      snprintf(key, size, "uvsphere/%u/%u", desc->segments, desc->rings);
+      break;
+    case SLS_PRIMITIVE_PLANE:
+      snprintf(key, size, "plane/%u/%u", desc->segments, desc->rings);
+      break;
+    case SLS_PRIMITIVE_BOX:
+      snprintf(key, size, "box/%u", desc->segments);
+      break;
+    case SLS_PRIMITIVE_CAPSULE:
+      snprintf(key,
+               size,
+               "capsule/%u/%u/%a",
+               desc->segments,
+               desc->rings,
+               (double)desc->length);
+      break;
+    default:
+      snprintf(key, size, "unknown/%d", (int)desc->kind);
+  }
+}
+
+/*----------------------------------------*
+ * cache
+ *----------------------------------------*/
+
+slsPrimitiveCache* sls_primitive_cache_init(slsPrimitiveCache* self,
+                                            slsShader* shader_opt,
+                                            slsJobQueue* jobs_opt)
+{
+  *self = (slsPrimitiveCache){.shader = shader_opt, .jobs = jobs_opt };
+  sls_checkmem(sls_hashtable_init(&self->meshes,
+                                  16,
+                                  sls_hash_fn_default,
+                                  &sls_primitive_string_keys,
+                                  NULL));
+  return self;
+error:
+  return sls_primitive_cache_dtor(self);
+}
+
+slsPrimitiveCache* sls_primitive_cache_dtor(slsPrimitiveCache* self)
+{
+  if (self->meshes.keys) {
+    slsHashItor itor;
+    for (slsHashItor* i = sls_hashitor_first(&self->meshes, &itor); i;
+         i = sls_hashitor_next(i)) {
+      sls_mesh_delete(*i->val);
+    }
+    sls_hashtable_dtor(&self->meshes);
+  }
+  *self = (slsPrimitiveCache){};
+  return self;
+}
+
+slsMesh* sls_primitive_cache_get(slsPrimitiveCache* self,
+                                 slsPrimitiveDesc const* desc)
+{
+  char key[96];
+  sls_primitive_key(desc, key, sizeof(key));
+  slsMesh* mesh = sls_hashtable_find(&self->meshes, key, SLS_STRING_LENGTH);
+  if (mesh) {
+    self->n_hits++;
+    return mesh;
+  }
+
+  mesh = sls_primitive_mesh(desc, self->jobs);
+  if (!mesh) {
+    sls_log_err("could not generate primitive %s", key);
+    return NULL;
+  }
+  if (self->shader) {
+    sls_mesh_setup_buffers(mesh, self->shader);
+  }
+  sls_hashtable_insert(&self->meshes, key, SLS_STRING_LENGTH, mesh);
+  self->n_generated++;
+  return mesh;
+}
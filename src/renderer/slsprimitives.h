@@ -0,0 +1,177 @@
+/**
+ * @file slsprimitives.h
+ * @brief procedural meshes with shared vertices, and a cache of their GPU
+ * meshes
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#ifndef DANGERENGINE_SLSPRIMITIVES_H
+#define DANGERENGINE_SLSPRIMITIVES_H
+
+#include "../data-types/hashtable.h"
+#include "../slsjobs.h"
+#include "slsmesh.h"
+#include <slsmacros.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+SLS_BEGIN_CDECLS
+
+/**
+ * @brief vertices per job when generating in parallel
+ */
+#define SLS_PRIMITIVES_GRAIN 4096
+
+typedef enum slsPrimitiveKind {
+  /**
+   * @brief geodesic sphere: icosahedron faces split into triangle grids.
+   * Vertices on the u seam are repeated for the triangles that cross it,
+   * which see u beyond 1: sample with GL_REPEAT.
+   */
+  SLS_PRIMITIVE_ICOSPHERE,
+  /** @brief sphere of latitude rings and longitude segments */
+  SLS_PRIMITIVE_UV_SPHERE,
+  /** @brief grid in the xy plane, facing +z */
+  SLS_PRIMITIVE_PLANE,
+  /** @brief cube with a grid on each face */
+  SLS_PRIMITIVE_BOX,
+  /** @brief cylinder along y capped by hemispheres */
+  SLS_PRIMITIVE_CAPSULE,
+} slsPrimitiveKind;
+
+/**
+ * @brief parameters of a primitive. Spheres and capsules have a radius of
+ * one; planes and boxes span [-1, 1].
+ */
+typedef struct slsPrimitiveDesc {
+  slsPrimitiveKind kind;
+  /**
+   * @brief icosphere: segments along each icosahedron edge.
+   * uv sphere, capsule: segments around y. plane: quads along x.
+   * box: quads along each edge.
+   */
+  uint32_t segments;
+  /**
+   * @brief uv sphere, capsule: rings from pole to pole, even for capsules.
+   * plane: quads along y.
+   */
+  uint32_t rings;
+  /** @brief capsule: length of the cylinder between the caps */
+  float length;
+} slsPrimitiveDesc;
+
+static inline slsPrimitiveDesc sls_primitive_icosphere(uint32_t segments)
+{
+  return (slsPrimitiveDesc){.kind = SLS_PRIMITIVE_ICOSPHERE,
+                            .segments = segments };
+}
+
+static inline slsPrimitiveDesc sls_primitive_uv_sphere(uint32_t segments,
+                                                       uint32_t rings)
+{
+  return (slsPrimitiveDesc){.kind = SLS_PRIMITIVE_UV_SPHERE,
+                            .segments = segments,
+                            .rings = rings };
+}
+
+static inline slsPrimitiveDesc sls_primitive_plane(uint32_t segments_x,
+                                                   uint32_t segments_y)
+{
+  return (slsPrimitiveDesc){.kind = SLS_PRIMITIVE_PLANE,
+                            .segments = segments_x,
+                            .rings = segments_y };
+}
+
+static inline slsPrimitiveDesc sls_primitive_box(uint32_t segments)
+{
+  return (slsPrimitiveDesc){.kind = SLS_PRIMITIVE_BOX, .segments = segments };
+}
+
+static inline slsPrimitiveDesc sls_primitive_capsule(uint32_t segments,
+                                                     uint32_t rings,
+                                                     float length)
+{
+  return (slsPrimitiveDesc){.kind = SLS_PRIMITIVE_CAPSULE,
+                            .segments = segments,
+                            .rings = rings,
+                            .length = length };
+}
+
+/**
+ * @brief indexed triangle list on the heap
+ */
+typedef struct slsGeometry {
+  slsVertex* vertices;
+  size_t n_vertices;
+  uint32_t* indices;
+  size_t n_indices;
+} slsGeometry;
+
+slsGeometry* sls_geometry_dtor(slsGeometry* self) SLS_NONNULL(1);
+
+/**
+ * @brief generates a primitive, with vertices shared between the triangles
+ * that meet at them, triangles reordered for the post-transform cache and
+ * vertices in order of first use. Triangles wind counter-clockwise seen
+ * from outside.
+ * @param jobs_opt if given, large primitives are generated across its
+ * workers. The result is the same either way.
+ * @return false for invalid parameters or when out of memory
+ */
+bool sls_primitive_generate(slsGeometry* out,
+                            slsPrimitiveDesc const* desc,
+                            slsJobQueue* jobs_opt) SLS_NONNULL(1, 2);
+
+/**
+ * @brief generates a primitive into a new mesh
+ */
+slsMesh* sls_primitive_mesh(slsPrimitiveDesc const* desc,
+                            slsJobQueue* jobs_opt) SLS_NONNULL(1);
+
+/**
+ * @brief writes the cache key of a primitive, ignoring the parameters its
+ * kind does not use
+ */
+void sls_primitive_key(slsPrimitiveDesc const* desc, char* key, size_t size)
+  SLS_NONNULL(1, 2);
+
+/**
+ * @brief Meshes of generated primitives, shared between every request with
+ * the same parameters.
+ */
+typedef struct slsPrimitiveCache {
+  /** @brief primitive key -> slsMesh */
+  slsHashTable meshes;
+  /** @brief if set, new meshes' buffers are set up with it */
+  slsShader* shader;
+  slsJobQueue* jobs;
+
+  size_t n_generated;
+  size_t n_hits;
+} slsPrimitiveCache;
+
+slsPrimitiveCache* sls_primitive_cache_init(slsPrimitiveCache* self,
+                                            slsShader* shader_opt,
+                                            slsJobQueue* jobs_opt)
+  SLS_NONNULL(1);
+
+/**
+ * @brief deletes every cached mesh
+ */
+slsPrimitiveCache* sls_primitive_cache_dtor(slsPrimitiveCache* self)
+  SLS_NONNULL(1);
+
+/**
+ * @brief finds or generates the mesh of a primitive
+ * @return a mesh owned by the cache, or NULL if generation failed
+ */
+slsMesh* sls_primitive_cache_get(slsPrimitiveCache* self,
+                                 slsPrimitiveDesc const* desc)
+  SLS_NONNULL(1, 2);
+
+SLS_END_CDECLS
+
+#endif // DANGERENGINE_SLSPRIMITIVES_H
@@ -0,0 +1,381 @@
+/**
+ * @file slsprofiler.c
+ * @brief
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#include "slsprofiler.h"
+#include "../sls-uilib.h"
+#include <math.h>
+#include <slsutils.h>
+#include <string.h>
+
+slsProfiler* sls_profiler_init(slsProfiler* self, bool gpu)
+{
+  memset(self, 0, sizeof(*self));
+  self->tick_ms = 1000.0 / (double)SDL_GetPerformanceFrequency();
+
+#ifndef __EMSCRIPTEN__
+  self->gpu_enabled = gpu && (GLAD_GL_VERSION_3_3 || GLAD_GL_ARB_timer_query);
+#endif
+  if (self->gpu_enabled) {
+    glGenQueries(SLS_PROFILER_LATENCY * SLS_PROFILER_MAX_QUERIES * 2,
+                 &self->query_pool[0][0]);
+  } else if (gpu) {
+    sls_log_warn("timer queries unavailable, profiling CPU only");
+  }
+
+  return self;
+}
+
+slsProfiler* sls_profiler_dtor(slsProfiler* self)
+{
+  if (self->gpu_enabled) {
+    glDeleteQueries(SLS_PROFILER_LATENCY * SLS_PROFILER_MAX_QUERIES * 2,
+                    &self->query_pool[0][0]);
+  }
+  memset(self, 0, sizeof(*self));
+  return self;
+}
+
+static void sls_profile_history_push(slsProfileHistory* self, double sample)
+{
+  self->samples[self->head] = sample;
+  self->head = (self->head + 1) % SLS_PROFILER_HISTORY;
+  if (self->n_samples < SLS_PROFILER_HISTORY) {
+    self->n_samples++;
+  }
+}
+
+/**
+ * @brief i-th sample in chronological order
+ */
+static double sls_profile_history_at(slsProfileHistory const* self, size_t i)
+{
+  size_t oldest =
+    (self->head + SLS_PROFILER_HISTORY - self->n_samples) % SLS_PROFILER_HISTORY;
+  return self->samples[(oldest + i) % SLS_PROFILER_HISTORY];
+}
+
+static int sls_cmp_double(void const* a, void const* b)
+{
+  double x = *(double const*)a, y = *(double const*)b;
+  return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+slsProfileStats sls_profile_history_stats(slsProfileHistory const* history)
+{
+  slsProfileStats stats = {};
+  size_t n = history->n_samples;
+  if (n == 0) {
+    return stats;
+  }
+
+  double sorted[SLS_PROFILER_HISTORY];
+  double sum = 0.0;
+  for (size_t i = 0; i < n; ++i) {
+    sorted[i] = sls_profile_history_at(history, i);
+    sum += sorted[i];
+  }
+  qsort(sorted, n, sizeof(double), sls_cmp_double);
+
+  size_t p99 = (size_t)ceil(0.99 * (double)n);
+  stats.min = sorted[0];
+  stats.avg = sum / (double)n;
+  stats.p99 = sorted[p99 > 0 ? p99 - 1 : 0];
+  stats.last = sls_profile_history_at(history, n - 1);
+  return stats;
+}
+
+int sls_profiler_find(slsProfiler const* self, char const* name, int parent)
+{
+  for (size_t i = 0; i < self->n_scopes; ++i) {
+    slsProfileScope const* scope = self->scopes + i;
+    if (scope->parent == parent && strcmp(scope->name, name) == 0) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+static int sls_profiler_add_scope(slsProfiler* self,
+                                  char const* name,
+                                  int parent)
+{
+  if (self->n_scopes == SLS_PROFILER_MAX_SCOPES) {
+    return -1;
+  }
+
+  int index = (int)self->n_scopes++;
+  slsProfileScope* scope = self->scopes + index;
+  memset(scope, 0, sizeof(*scope));
+  snprintf(scope->name, sizeof(scope->name), "%s", name);
+  scope->parent = parent;
+  scope->depth = parent >= 0 ? self->scopes[parent].depth + 1 : 0;
+  return index;
+}
+
+void sls_profiler_begin(slsProfiler* self, char const* name)
+{
+  if (self->depth == SLS_PROFILER_MAX_DEPTH) {
+    self->overflow++;
+    return;
+  }
+
+  int parent = self->depth > 0 ? self->stack[self->depth - 1] : -1;
+  int index = sls_profiler_find(self, name, parent);
+  if (index < 0) {
+    index = sls_profiler_add_scope(self, name, parent);
+  }
+
+  int query = -1;
+  slsProfileFrame* frame = self->frames + self->frame_n % SLS_PROFILER_LATENCY;
+  if (index >= 0 && self->gpu_enabled && self->in_frame &&
+      frame->n_queries < SLS_PROFILER_MAX_QUERIES) {
+    size_t slot = self->frame_n % SLS_PROFILER_LATENCY;
+    query = (int)frame->n_queries++;
+    slsProfileQuery* q = frame->queries + query;
+    q->scope = index;
+    q->begin = self->query_pool[slot][query * 2];
+    q->end = self->query_pool[slot][query * 2 + 1];
+    glQueryCounter(q->begin, GL_TIMESTAMP);
+  }
+
+  self->stack[self->depth] = index;
+  self->stack_queries[self->depth] = query;
+  self->depth++;
+
+  if (index >= 0) {
+    self->scopes[index].cpu_start = SDL_GetPerformanceCounter();
+  }
+}
+
+void sls_profiler_end(slsProfiler* self)
+{
+  if (self->overflow > 0) {
+    self->overflow--;
+    return;
+  }
+  if (self->depth == 0) {
+    return;
+  }
+
+  self->depth--;
+  int index = self->stack[self->depth];
+  if (index >= 0) {
+    slsProfileScope* scope = self->scopes + index;
+    scope->cpu_frame_ticks += SDL_GetPerformanceCounter() - scope->cpu_start;
+    scope->cpu_touched = true;
+  }
+
+  int query = self->stack_queries[self->depth];
+  if (query >= 0) {
+    slsProfileFrame* frame =
+      self->frames + self->frame_n % SLS_PROFILER_LATENCY;
+    glQueryCounter(frame->queries[query].end, GL_TIMESTAMP);
+  }
+}
+
+/**
+ * @brief collects the GPU times of the frame that last used this slot
+ */
+static void sls_profiler_read_back(slsProfiler* self, slsProfileFrame* frame)
+{
+  if (frame->n_queries == 0) {
+    return;
+  }
+
+  // timestamps complete in order: if the last one is available, all are
+  GLint available = GL_FALSE;
+  glGetQueryObjectiv(frame->queries[frame->n_queries - 1].end,
+                     GL_QUERY_RESULT_AVAILABLE,
+                     &available);
+  if (!available) {
+    frame->n_queries = 0;
+    return;
+  }
+
+  for (size_t i = 0; i < frame->n_queries; ++i) {
+    slsProfileQuery const* q = frame->queries + i;
+    GLuint64 begin = 0, end = 0;
+    glGetQueryObjectui64v(q->begin, GL_QUERY_RESULT, &begin);
+    glGetQueryObjectui64v(q->end, GL_QUERY_RESULT, &end);
+
+    slsProfileScope* scope = self->scopes + q->scope;
+    scope->gpu_frame_ns += end > begin ? end - begin : 0;
+    scope->gpu_touched = true;
+  }
+  frame->n_queries = 0;
+
+  for (size_t i = 0; i < self->n_scopes; ++i) {
+    slsProfileScope* scope = self->scopes + i;
+    if (scope->gpu_touched) {
+      sls_profile_history_push(&scope->gpu, scope->gpu_frame_ns / 1.0e6);
+      scope->gpu_frame_ns = 0;
+      scope->gpu_touched = false;
+    }
+  }
+}
+
+void sls_profiler_begin_frame(slsProfiler* self)
+{
+  slsProfileFrame* frame = self->frames + self->frame_n % SLS_PROFILER_LATENCY;
+  if (self->gpu_enabled) {
+    sls_profiler_read_back(self, frame);
+  }
+  frame->n_queries = 0;
+
+  self->in_frame = true;
+  sls_profiler_begin(self, "frame");
+}
+
+void sls_profiler_end_frame(slsProfiler* self)
+{
+  if (self->depth + self->overflow > 1) {
+    sls_log_warn("profiler: %lu scopes left open at end of frame",
+                 self->depth + self->overflow - 1);
+  }
+  self->overflow = 0;
+  while (self->depth > 0) {
+    sls_profiler_end(self);
+  }
+
+  for (size_t i = 0; i < self->n_scopes; ++i) {
+    slsProfileScope* scope = self->scopes + i;
+    if (scope->cpu_touched) {
+      sls_profile_history_push(&scope->cpu,
+                               (double)scope->cpu_frame_ticks * self->tick_ms);
+      scope->cpu_frame_ticks = 0;
+      scope->cpu_touched = false;
+    }
+  }
+
+  self->in_frame = false;
+  self->frame_n++;
+}
+
+/*================================
+ * reporting
+ *================================*/
+
+static void sls_profiler_json_history(slsProfileHistory const* history,
+                                      FILE* fp)
+{
+  slsProfileStats stats = sls_profile_history_stats(history);
+  fprintf(fp,
+          "{\"min\": %.4f, \"avg\": %.4f, \"p99\": %.4f, \"last\": %.4f, "
+          "\"samples\": [",
+          stats.min,
+          stats.avg,
+          stats.p99,
+          stats.last);
+  for (size_t i = 0; i < history->n_samples; ++i) {
+    fprintf(fp, "%s%.4f", i ? ", " : "", sls_profile_history_at(history, i));
+  }
+  fprintf(fp, "]}");
+}
+
+void sls_profiler_dump_json(slsProfiler const* self, FILE* fp)
+{
+  fprintf(fp,
+          "{\n  \"frames\": %llu,\n  \"gpu\": %s,\n  \"scopes\": [\n",
+          (unsigned long long)self->frame_n,
+          self->gpu_enabled ? "true" : "false");
+
+  for (size_t i = 0; i < self->n_scopes; ++i) {
+    slsProfileScope const* scope = self->scopes + i;
+
+    fprintf(fp, "    {\"name\": \"");
+    for (char const* c = scope->name; *c; ++c) {
+      if (*c == '"' || *c == '\\') {
+        fputc('\\', fp);
+      }
+      fputc((unsigned char)*c < 0x20 ? ' ' : *c, fp);
+    }
+    fprintf(fp,
+            "\", \"parent\": %d, \"depth\": %d,\n     \"cpu_ms\": ",
+            scope->parent,
+            scope->depth);
+    sls_profiler_json_history(&scope->cpu, fp);
+    fprintf(fp, ",\n     \"gpu_ms\": ");
+    sls_profiler_json_history(&scope->gpu, fp);
+    fprintf(fp, "}%s\n", i + 1 < self->n_scopes ? "," : "");
+  }
+
+  fprintf(fp, "  ]\n}\n");
+}
+
+bool sls_profiler_save_json(slsProfiler const* self, char const* path)
+{
+  FILE* fp = fopen(path, "w");
+  if (!fp) {
+    sls_log_err("could not open %s", path);
+    return false;
+  }
+  sls_profiler_dump_json(self, fp);
+  bool ok = fclose(fp) == 0;
+  if (ok) {
+    sls_log_info("wrote profile to %s", path);
+  }
+  return ok;
+}
+
+/**
+ * @brief rows for `parent`'s children, depth first
+ */
+static void sls_profiler_overlay_rows(slsProfiler const* self,
+                                      struct nk_context* nk,
+                                      int parent)
+{
+  for (size_t i = 0; i < self->n_scopes; ++i) {
+    slsProfileScope const* scope = self->scopes + i;
+    if (scope->parent != parent) {
+      continue;
+    }
+
+    slsProfileStats cpu = sls_profile_history_stats(&scope->cpu);
+    slsProfileStats gpu = sls_profile_history_stats(&scope->gpu);
+    nk_labelf(nk, NK_TEXT_LEFT, "%*s%s", scope->depth * 2, "", scope->name);
+    nk_labelf(nk, NK_TEXT_RIGHT, "%.2f", cpu.avg);
+    nk_labelf(nk, NK_TEXT_RIGHT, "%.2f", cpu.p99);
+    nk_labelf(nk, NK_TEXT_RIGHT, "%.2f", gpu.avg);
+    nk_labelf(nk, NK_TEXT_RIGHT, "%.2f", gpu.p99);
+
+    sls_profiler_overlay_rows(self, nk, (int)i);
+  }
+}
+
+void sls_profiler_draw_overlay(slsProfiler const* self, struct nk_context* nk)
+{
+  nk_flags flags = NK_WINDOW_BORDER | NK_WINDOW_MOVABLE | NK_WINDOW_SCALABLE |
+                   NK_WINDOW_MINIMIZABLE | NK_WINDOW_TITLE;
+  if (!nk_begin(nk, "profiler", nk_rect(10, 10, 440, 260), flags)) {
+    nk_end(nk);
+    return;
+  }
+
+  int root = sls_profiler_find(self, "frame", -1);
+  if (root >= 0) {
+    slsProfileStats cpu = sls_profile_history_stats(&self->scopes[root].cpu);
+    slsProfileStats gpu = sls_profile_history_stats(&self->scopes[root].gpu);
+    nk_layout_row_dynamic(nk, 18, 1);
+    nk_labelf(nk,
+              NK_TEXT_LEFT,
+              "frame: cpu %.2f ms, gpu %.2f ms (%s bound)",
+              cpu.avg,
+              gpu.avg,
+              !self->gpu_enabled || cpu.avg >= gpu.avg ? "cpu" : "gpu");
+  }
+
+  nk_layout_row_dynamic(nk, 18, 5);
+  nk_label(nk, "scope (ms)", NK_TEXT_LEFT);
+  nk_label(nk, "cpu avg", NK_TEXT_RIGHT);
+  nk_label(nk, "cpu p99", NK_TEXT_RIGHT);
+  nk_label(nk, "gpu avg", NK_TEXT_RIGHT);
+  nk_label(nk, "gpu p99", NK_TEXT_RIGHT);
+  sls_profiler_overlay_rows(self, nk, -1);
+
+  nk_end(nk);
+}
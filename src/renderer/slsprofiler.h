@@ -0,0 +1,164 @@
+/**
+ * @file slsprofiler.h
+ * @brief CPU and GPU frame profiler with nestable named scopes
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#ifndef DANGERENGINE_SLSPROFILER_H
+#define DANGERENGINE_SLSPROFILER_H
+
+#include "../sls-gl.h"
+#include <slsmacros.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+SLS_BEGIN_CDECLS
+
+#define SLS_PROFILER_MAX_SCOPES 64
+#define SLS_PROFILER_MAX_DEPTH 16
+/** @brief timed scope invocations per frame */
+#define SLS_PROFILER_MAX_QUERIES 128
+/**
+ * @brief frames between issuing GPU queries and reading them back. Large
+ * enough that results are available without stalling.
+ */
+#define SLS_PROFILER_LATENCY 4
+/** @brief samples per scope kept for statistics */
+#define SLS_PROFILER_HISTORY 240
+
+typedef struct slsProfileStats {
+  double min;
+  double avg;
+  double p99;
+  double last;
+} slsProfileStats;
+
+/**
+ * @brief ring buffer of per-frame durations in milliseconds
+ */
+typedef struct slsProfileHistory {
+  double samples[SLS_PROFILER_HISTORY];
+  size_t head;
+  size_t n_samples;
+} slsProfileHistory;
+
+typedef struct slsProfileScope {
+  char name[48];
+  /** @brief enclosing scope, -1 for roots */
+  int parent;
+  int depth;
+
+  slsProfileHistory cpu;
+  slsProfileHistory gpu;
+
+  /** @brief CPU time accumulated in the current frame, in counter ticks */
+  uint64_t cpu_frame_ticks;
+  uint64_t cpu_start;
+  bool cpu_touched;
+  /** @brief GPU time accumulated while reading back one frame */
+  uint64_t gpu_frame_ns;
+  bool gpu_touched;
+} slsProfileScope;
+
+/**
+ * @brief one timed invocation within a frame
+ */
+typedef struct slsProfileQuery {
+  int scope;
+  GLuint begin;
+  GLuint end;
+} slsProfileQuery;
+
+typedef struct slsProfileFrame {
+  slsProfileQuery queries[SLS_PROFILER_MAX_QUERIES];
+  size_t n_queries;
+} slsProfileFrame;
+
+/**
+ * @brief Frame profiler.
+ * @detail Scopes are identified by name and parent, so the same name may
+ * appear under different parents. A scope entered several times in one
+ * frame reports the sum. GPU times come from GL_TIMESTAMP queries, which
+ * unlike GL_TIME_ELAPSED may nest, and are read back
+ * SLS_PROFILER_LATENCY frames later. Results not ready by then are
+ * dropped rather than waited for.
+ */
+typedef struct slsProfiler {
+  slsProfileScope scopes[SLS_PROFILER_MAX_SCOPES];
+  size_t n_scopes;
+
+  int stack[SLS_PROFILER_MAX_DEPTH];
+  /** @brief query index matching each stack entry, or -1 */
+  int stack_queries[SLS_PROFILER_MAX_DEPTH];
+  size_t depth;
+  /** @brief begins nested too deep, ignored along with their ends */
+  size_t overflow;
+
+  bool gpu_enabled;
+  GLuint query_pool[SLS_PROFILER_LATENCY][SLS_PROFILER_MAX_QUERIES * 2];
+  slsProfileFrame frames[SLS_PROFILER_LATENCY];
+
+  uint64_t frame_n;
+  bool in_frame;
+  double tick_ms;
+} slsProfiler;
+
+/**
+ * @param gpu time GPU work too. Requires a current GL context, and is
+ * ignored where timer queries are unavailable.
+ */
+slsProfiler* sls_profiler_init(slsProfiler* self, bool gpu) SLS_NONNULL(1);
+
+slsProfiler* sls_profiler_dtor(slsProfiler* self) SLS_NONNULL(1);
+
+/**
+ * @brief reads back finished GPU queries and opens the "frame" root scope
+ */
+void sls_profiler_begin_frame(slsProfiler* self) SLS_NONNULL(1);
+
+/**
+ * @brief closes the root scope and records this frame's CPU times
+ */
+void sls_profiler_end_frame(slsProfiler* self) SLS_NONNULL(1);
+
+void sls_profiler_begin(slsProfiler* self, char const* name)
+  SLS_NONNULL(1, 2);
+
+void sls_profiler_end(slsProfiler* self) SLS_NONNULL(1);
+
+/**
+ * @return the scope with `name` under `parent`, or -1
+ */
+int sls_profiler_find(slsProfiler const* self, char const* name, int parent)
+  SLS_NONNULL(1, 2);
+
+slsProfileStats sls_profile_history_stats(slsProfileHistory const* history)
+  SLS_NONNULL(1);
+
+/**
+ * @brief writes every scope's statistics and samples as JSON
+ */
+void sls_profiler_dump_json(slsProfiler const* self, FILE* fp)
+  SLS_NONNULL(1, 2);
+
+/**
+ * @brief convenience wrapper of sls_profiler_dump_json
+ */
+bool sls_profiler_save_json(slsProfiler const* self, char const* path)
+  SLS_NONNULL(1, 2);
+
+struct nk_context;
+
+/**
+ * @brief draws a window listing the scopes. Call between nk_input_end and
+ * nk_sdl_render.
+ */
+void sls_profiler_draw_overlay(slsProfiler const* self,
+                               struct nk_context* nk) SLS_NONNULL(1, 2);
+
+SLS_END_CDECLS
+
+#endif // DANGERENGINE_SLSPROFILER_H
@@ -0,0 +1,168 @@
+/**
+ * @file slsprogrambuild.c
+ * @brief
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#include "slsprogrambuild.h"
+#include "shaderutils.h"
+#include "slsshader.h"
+#include <slsutils.h>
+
+static bool sls_program_build_parallel = false;
+static bool sls_program_build_configured = false;
+
+bool sls_program_build_enable_parallel()
+{
+  if (sls_program_build_configured) {
+    return sls_program_build_parallel;
+  }
+  sls_program_build_configured = true;
+
+#ifndef __EMSCRIPTEN__
+  // 0xffffffff: let the implementation pick the thread count
+  if (GLAD_GL_KHR_parallel_shader_compile) {
+    glMaxShaderCompilerThreadsKHR(0xffffffff);
+    sls_program_build_parallel = true;
+  } else if (GLAD_GL_ARB_parallel_shader_compile) {
+    glMaxShaderCompilerThreadsARB(0xffffffff);
+    sls_program_build_parallel = true;
+  }
+#endif
+
+  sls_log_info("shader compilation: %s",
+               sls_program_build_parallel ? "parallel" : "serial");
+  return sls_program_build_parallel;
+}
+
+static slsProgramBuild* sls_program_build_start(slsProgramBuild* self,
+                                                char const* vs_source,
+                                                char const* fs_source,
+                                                char const* uniforms,
+                                                bool retrievable)
+{
+  *self = (slsProgramBuild){.status = SLS_PROGRAM_PENDING };
+  sls_program_build_enable_parallel();
+
+  self->program = glCreateProgram();
+  self->vs = sls_submit_shader(vs_source, uniforms, GL_VERTEX_SHADER);
+  self->fs = sls_submit_shader(fs_source, uniforms, GL_FRAGMENT_SHADER);
+
+  glAttachShader(self->program, self->vs);
+  glAttachShader(self->program, self->fs);
+  sls_shader_bind_attrib_locations(self->program);
+
+  if (retrievable) {
+    glProgramParameteri(
+      self->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
+
+  // linking may be requested before compilation finishes. A failed
+  // compile simply makes the link fail, which is reported when polled
+  glLinkProgram(self->program);
+
+  return self;
+}
+
+slsProgramBuild* sls_program_build_submit(slsProgramBuild* self,
+                                          char const* vs_source,
+                                          char const* fs_source,
+                                          char const* uniforms)
+{
+  return sls_program_build_start(self, vs_source, fs_source, uniforms, false);
+}
+
+slsProgramBuild* sls_program_build_submit_retrievable(slsProgramBuild* self,
+                                                      char const* vs_source,
+                                                      char const* fs_source,
+                                                      char const* uniforms)
+{
+  return sls_program_build_start(self, vs_source, fs_source, uniforms, true);
+}
+
+slsProgramBuild* sls_program_build_dtor(slsProgramBuild* self)
+{
+  if (self->vs) {
+    glDeleteShader(self->vs);
+  }
+  if (self->fs) {
+    glDeleteShader(self->fs);
+  }
+  if (self->program) {
+    glDeleteProgram(self->program);
+  }
+  *self = (slsProgramBuild){.status = SLS_PROGRAM_FAILED };
+
+  return self;
+}
+
+/**
+ * @brief reads the final link status, reporting the logs of whichever
+ * stage failed, and releases the shader objects
+ */
+static slsProgramStatus sls_program_build_finish(slsProgramBuild* self)
+{
+  GLint link_ok = GL_FALSE;
+  glGetProgramiv(self->program, GL_LINK_STATUS, &link_ok);
+
+  if (!link_ok) {
+    GLuint shaders[] = { self->vs, self->fs };
+    for (size_t i = 0; i < SLS_ARRAY_COUNT(shaders); ++i) {
+      GLint compile_ok = GL_FALSE;
+      glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &compile_ok);
+      if (!compile_ok) {
+        sls_print_log(shaders[i], "shader");
+      }
+    }
+    sls_print_log(self->program, "program");
+  }
+
+  glDetachShader(self->program, self->vs);
+  glDetachShader(self->program, self->fs);
+  glDeleteShader(self->vs);
+  glDeleteShader(self->fs);
+  self->vs = 0;
+  self->fs = 0;
+
+  if (!link_ok) {
+    glDeleteProgram(self->program);
+    self->program = 0;
+  }
+
+  self->status = link_ok ? SLS_PROGRAM_READY : SLS_PROGRAM_FAILED;
+  return self->status;
+}
+
+slsProgramStatus sls_program_build_poll(slsProgramBuild* self)
+{
+  if (self->status != SLS_PROGRAM_PENDING) {
+    return self->status;
+  }
+
+  if (sls_program_build_parallel) {
+    GLint done = GL_FALSE;
+    glGetProgramiv(self->program, GL_COMPLETION_STATUS_KHR, &done);
+    if (!done) {
+      return SLS_PROGRAM_PENDING;
+    }
+  }
+
+  // without the extension there is no way to ask without waiting
+  return sls_program_build_finish(self);
+}
+
+slsProgramStatus sls_program_build_wait(slsProgramBuild* self)
+{
+  if (self->status != SLS_PROGRAM_PENDING) {
+    return self->status;
+  }
+  return sls_program_build_finish(self);
+}
+
+GLuint sls_program_build_select(slsProgramBuild* self, GLuint fallback)
+{
+  return sls_program_build_poll(self) == SLS_PROGRAM_READY ? self->program
+                                                           : fallback;
+}
@@ -0,0 +1,94 @@
+/**
+ * @file slsprogrambuild.h
+ * @brief non-blocking shader program compilation
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#ifndef DANGERENGINE_SLSPROGRAMBUILD_H
+#define DANGERENGINE_SLSPROGRAMBUILD_H
+
+#include "../sls-gl.h"
+#include <slsmacros.h>
+#include <stdbool.h>
+
+SLS_BEGIN_CDECLS
+
+typedef enum slsProgramStatus {
+  SLS_PROGRAM_PENDING,
+  SLS_PROGRAM_READY,
+  SLS_PROGRAM_FAILED
+} slsProgramStatus;
+
+/**
+ * @brief a program whose compile and link have been submitted to the
+ * driver, but whose result has not been queried yet.
+ * @detail Querying GL_COMPILE_STATUS or GL_LINK_STATUS forces the driver
+ * to finish the build, so nothing is queried until the program is polled.
+ * Submit every program first, then poll: with
+ * GL_KHR_parallel_shader_compile the driver builds them on its own
+ * threads and polling never blocks.
+ */
+typedef struct slsProgramBuild {
+  GLuint program;
+  GLuint vs, fs;
+  slsProgramStatus status;
+} slsProgramBuild;
+
+/**
+ * @brief lets the driver use as many compiler threads as it wants. Called
+ * by the first submission; safe to call repeatedly.
+ * @return true if the driver compiles in parallel
+ */
+bool sls_program_build_enable_parallel();
+
+/**
+ * @brief submits compilation and linking of a program without waiting on
+ * the result
+ */
+slsProgramBuild* sls_program_build_submit(slsProgramBuild* self,
+                                          char const* vs_source,
+                                          char const* fs_source,
+                                          char const* uniforms)
+  SLS_NONNULL(1, 2, 3, 4);
+
+/**
+ * @brief like sls_program_build_submit, but asks the driver to keep the
+ * linked binary retrievable with glGetProgramBinary
+ */
+slsProgramBuild* sls_program_build_submit_retrievable(slsProgramBuild* self,
+                                                      char const* vs_source,
+                                                      char const* fs_source,
+                                                      char const* uniforms)
+  SLS_NONNULL(1, 2, 3, 4);
+
+/**
+ * @brief deletes the program, finished or not
+ */
+slsProgramBuild* sls_program_build_dtor(slsProgramBuild* self)
+  SLS_NONNULL(1);
+
+/**
+ * @brief checks whether the build finished, without blocking when the
+ * driver compiles in parallel. Errors are logged once the build fails.
+ */
+slsProgramStatus sls_program_build_poll(slsProgramBuild* self)
+  SLS_NONNULL(1);
+
+/**
+ * @brief blocks until the build finishes
+ */
+slsProgramStatus sls_program_build_wait(slsProgramBuild* self)
+  SLS_NONNULL(1);
+
+/**
+ * @brief the program to draw with: the build's program once ready,
+ * otherwise `fallback`
+ */
+GLuint sls_program_build_select(slsProgramBuild* self, GLuint fallback)
+  SLS_NONNULL(1);
+
+SLS_END_CDECLS
+
+#endif // DANGERENGINE_SLSPROGRAMBUILD_H
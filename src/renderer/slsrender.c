@@ -1,5 +1,15 @@
 #include "slsrender.h"
 
+/**
+ * @brief bytes of uniform data each frame may upload through the ring
+ */
+#define SLS_RENDERER_UNIFORM_FRAME_SIZE (256 * 1024)
+
+/**
+ * @brief bytes of dynamic geometry each frame may stream
+ */
+#define SLS_RENDERER_STREAM_FRAME_SIZE (4 * 1024 * 1024)
+
 static void scene_setup(slsRendererGL* self);
 
 slsRendererGL* sls_renderer_init(slsRendererGL* self, int width, int height)
@@ -14,6 +24,11 @@ slsRendererGL* sls_renderer_init(slsRendererGL* self, int width, int height)
 
   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
+  sls_uniform_ring_init(&self->uniform_ring, SLS_RENDERER_UNIFORM_FRAME_SIZE);
+  sls_streambuffer_init(&self->stream, SLS_RENDERER_STREAM_FRAME_SIZE);
+
+  self->jobs = NULL;
+
   scene_setup(self);
   sls_renderer_resize(self, width, height);
 
@@ -28,9 +43,31 @@ static void scene_setup(slsRendererGL* self)
 
 slsRendererGL* sls_renderer_dtor(slsRendererGL* self)
 {
+  sls_streambuffer_dtor(&self->stream);
+  sls_uniform_ring_dtor(&self->uniform_ring);
   return self;
 }
 
+void sls_renderer_begin_frame(slsRendererGL* self)
+{
+  sls_uniform_ring_begin_frame(&self->uniform_ring);
+  sls_streambuffer_begin_frame(&self->stream);
+  sls_cull_camera_init(&self->camera, &self->root_modelview, &self->projection);
+}
+
+void sls_renderer_end_frame(slsRendererGL* self)
+{
+  sls_uniform_ring_end_frame(&self->uniform_ring);
+  sls_streambuffer_end_frame(&self->stream);
+}
+
+size_t sls_renderer_cull(slsRendererGL* self,
+                         slsCullSet const* set,
+                         uint32_t* visible_out)
+{
+  return sls_cull(&self->camera, set, visible_out, self->jobs);
+}
+
 void sls_renderer_resize(slsRendererGL* self, int width, int height)
 {
   self->width = width;
@@ -9,7 +9,10 @@
 #ifndef SLS_RENDERER_H
 #define SLS_RENDERER_H
 
+#include "slscull.h"
 #include "slsmesh.h"
+#include "slsstreambuffer.h"
+#include "slsuniformbuffer.h"
 #include <kazmath/kazmath.h>
 #include <slsmacros.h>
 #include <slscontext.h>
@@ -31,6 +34,21 @@ struct slsRendererGL {
   kmMat4 root_modelview;
   kmMat4 projection;
 
+  slsUniformRing uniform_ring;
+  /**
+   * @brief per-frame dynamic vertex/index data (sprites, particles, debug
+   * lines, UI) is written here instead of re-specifying buffer objects
+   */
+  slsStreamBuffer stream;
+
+  /** @brief view of root_modelview and projection, refreshed each frame */
+  slsCullCamera camera;
+  /**
+   * @brief optional, not owned, set after init. Splits culling of large
+   * sets across workers.
+   */
+  slsJobQueue *jobs;
+
   int width, height;
 };
 
@@ -61,6 +79,26 @@ SLS_NONNULL(1);
  */
 slsRendererGL *sls_renderer_dtor(slsRendererGL *self) SLS_NONNULL(1);
 
+/**
+ * Prepares per-frame renderer resources. Call before issuing any draws.
+ */
+void sls_renderer_begin_frame(slsRendererGL *self) SLS_NONNULL(1);
+
+/**
+ * Fences per-frame renderer resources. Call after the frame's last draw.
+ */
+void sls_renderer_end_frame(slsRendererGL *self) SLS_NONNULL(1);
+
+/**
+ * Writes the indices of the objects in `set` that the camera sees, in
+ * ascending order, for the render queue to draw.
+ * @param visible_out room for set->n indices
+ * @return count of visible objects
+ */
+size_t sls_renderer_cull(slsRendererGL *self,
+                         slsCullSet const *set,
+                         uint32_t *visible_out) SLS_NONNULL(1, 2, 3);
+
 static void sls_renderer_clear(slsRendererGL *self){
   glClear(GL_COLOR_BUFFER_BIT);
 }
@@ -0,0 +1,801 @@
+/**
+ * @file slsrendergraph.c
+ * @brief
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#include "slsrendergraph.h"
+#include <data-types/hashtable.h>
+#include <limits.h>
+#include <math.h>
+#include <slsutils.h>
+#include <stdio.h>
+#include <string.h>
+
+/*----------------------------------------*
+ * formats
+ *----------------------------------------*/
+
+static bool sls_rg_is_depth(GLenum internal_format)
+{
+  switch (internal_format) {
+    case GL_DEPTH_COMPONENT16:
+    case GL_DEPTH_COMPONENT24:
+    case GL_DEPTH_COMPONENT32F:
+    case GL_DEPTH24_STENCIL8:
+    case GL_DEPTH32F_STENCIL8:
+      return true;
+    default:
+      return false;
+  }
+}
+
+static size_t sls_rg_bytes_per_pixel(GLenum internal_format)
+{
+  switch (internal_format) {
+    case GL_R8:
+      return 1;
+    case GL_RG8:
+    case GL_R16F:
+    case GL_DEPTH_COMPONENT16:
+      return 2;
+    case GL_RGBA16F:
+    case GL_RG32F:
+    case GL_DEPTH32F_STENCIL8:
+      return 8;
+    case GL_RGBA32F:
+      return 16;
+    default:
+      return 4;
+  }
+}
+
+/*----------------------------------------*
+ * declarations
+ *----------------------------------------*/
+
+slsRenderGraph* sls_rendergraph_init(slsRenderGraph* self)
+{
+  memset(self, 0, sizeof(*self));
+  return self;
+}
+
+slsRenderGraph* sls_rendergraph_dtor(slsRenderGraph* self)
+{
+  for (int i = 0; i < self->n_physical; ++i) {
+    if (self->physical[i].texture) {
+      glDeleteTextures(1, &self->physical[i].texture);
+    }
+  }
+  for (int i = 0; i < self->n_fbos; ++i) {
+    if (self->fbos[i].fbo) {
+      glDeleteFramebuffers(1, &self->fbos[i].fbo);
+    }
+  }
+  memset(self, 0, sizeof(*self));
+  return self;
+}
+
+void sls_rendergraph_begin(slsRenderGraph* self, int width, int height)
+{
+  // declarations are hashed whole, so padding must be deterministic
+  memset(self->passes, 0, sizeof(self->passes));
+  memset(self->resources, 0, sizeof(self->resources));
+  memset(self->outputs, 0, sizeof(self->outputs));
+  self->n_passes = 0;
+  self->n_resources = 0;
+  self->output_width = width > 0 ? width : 1;
+  self->output_height = height > 0 ? height : 1;
+  self->invalid = false;
+}
+
+static slsRGResource sls_rendergraph_add_resource(slsRenderGraph* self,
+                                                  char const* name,
+                                                  slsRGResourceKind kind,
+                                                  slsRGTextureDesc desc,
+                                                  GLuint object)
+{
+  if (self->n_resources == SLS_RENDERGRAPH_MAX_RESOURCES) {
+    sls_log_err("render graph: too many resources, dropping %s", name);
+    self->invalid = true;
+    return SLS_RG_NONE;
+  }
+  slsRGResourceNode* node = self->resources + self->n_resources;
+  snprintf(node->name, sizeof(node->name), "%s", name);
+  node->kind = kind;
+  node->desc = desc;
+  node->object = object;
+  return (slsRGResource)self->n_resources++;
+}
+
+slsRGResource sls_rendergraph_create_texture(slsRenderGraph* self,
+                                             char const* name,
+                                             slsRGTextureDesc desc)
+{
+  if (desc.width <= 0 || desc.height <= 0) {
+    desc.width = 0;
+    desc.height = 0;
+    desc.scale = desc.scale > 0.f ? desc.scale : 1.f;
+  }
+  return sls_rendergraph_add_resource(self, name, SLS_RG_TRANSIENT, desc, 0);
+}
+
+slsRGResource sls_rendergraph_import_texture(slsRenderGraph* self,
+                                             char const* name,
+                                             GLuint texture,
+                                             int width,
+                                             int height)
+{
+  slsRGTextureDesc desc = {.width = width, .height = height };
+  return sls_rendergraph_add_resource(
+    self, name, SLS_RG_IMPORTED_TEXTURE, desc, texture);
+}
+
+slsRGResource sls_rendergraph_import_framebuffer(slsRenderGraph* self,
+                                                 char const* name,
+                                                 GLuint fbo,
+                                                 int width,
+                                                 int height)
+{
+  slsRGTextureDesc desc = {.width = width, .height = height };
+  return sls_rendergraph_add_resource(
+    self, name, SLS_RG_IMPORTED_FRAMEBUFFER, desc, fbo);
+}
+
+static bool sls_rendergraph_valid(slsRenderGraph* self,
+                                  int pass,
+                                  slsRGResource resource)
+{
+  if (pass < 0 || pass >= self->n_passes ||
+      resource >= (slsRGResource)self->n_resources) {
+    sls_log_err("render graph: invalid pass %d or resource %u",
+                pass,
+                resource);
+    self->invalid = true;
+    return false;
+  }
+  return true;
+}
+
+void sls_rendergraph_set_output(slsRenderGraph* self, slsRGResource resource)
+{
+  if (resource < (slsRGResource)self->n_resources) {
+    self->outputs[resource] = true;
+  }
+}
+
+int sls_rendergraph_add_pass(slsRenderGraph* self,
+                             char const* name,
+                             slsRenderPassFn fn,
+                             void* data)
+{
+  if (self->n_passes == SLS_RENDERGRAPH_MAX_PASSES) {
+    sls_log_err("render graph: too many passes, dropping %s", name);
+    self->invalid = true;
+    return -1;
+  }
+  slsRGPassNode* node = self->passes + self->n_passes;
+  snprintf(node->name, sizeof(node->name), "%s", name);
+  node->fn = fn;
+  node->data = data;
+  node->depth = SLS_RG_NONE;
+  return self->n_passes++;
+}
+
+void sls_rendergraph_read(slsRenderGraph* self,
+                          int pass,
+                          slsRGResource resource)
+{
+  if (!sls_rendergraph_valid(self, pass, resource)) {
+    return;
+  }
+  slsRGPassNode* node = self->passes + pass;
+  if (node->n_reads == SLS_RENDERPASS_MAX_READS) {
+    sls_log_err("render graph: pass %s reads too much", node->name);
+    self->invalid = true;
+    return;
+  }
+  node->reads[node->n_reads++] = resource;
+}
+
+void sls_rendergraph_write(slsRenderGraph* self,
+                           int pass,
+                           slsRGResource resource)
+{
+  if (!sls_rendergraph_valid(self, pass, resource)) {
+    return;
+  }
+  slsRGPassNode* node = self->passes + pass;
+  if (node->n_colors == SLS_RENDERPASS_MAX_COLORS) {
+    sls_log_err("render graph: pass %s has too many attachments", node->name);
+    self->invalid = true;
+    return;
+  }
+  node->colors[node->n_colors++] = resource;
+}
+
+void sls_rendergraph_write_depth(slsRenderGraph* self,
+                                 int pass,
+                                 slsRGResource resource)
+{
+  if (sls_rendergraph_valid(self, pass, resource)) {
+    self->passes[pass].depth = resource;
+  }
+}
+
+/*----------------------------------------*
+ * compilation
+ *----------------------------------------*/
+
+void sls_rendergraph_texture_size(slsRenderGraph const* self,
+                                  slsRGResource resource,
+                                  int* width,
+                                  int* height)
+{
+  slsRGTextureDesc const* desc = &self->resources[resource].desc;
+  if (desc->width > 0) {
+    *width = desc->width;
+    *height = desc->height;
+    return;
+  }
+  *width = (int)ceilf((float)self->output_width * desc->scale);
+  *height = (int)ceilf((float)self->output_height * desc->scale);
+  *width = *width > 0 ? *width : 1;
+  *height = *height > 0 ? *height : 1;
+}
+
+static uint64_t sls_rendergraph_hash(slsRenderGraph const* self)
+{
+  struct {
+    uint64_t passes;
+    uint64_t resources;
+    uint64_t outputs;
+    int width;
+    int height;
+  } parts;
+  memset(&parts, 0, sizeof(parts));
+  parts.passes = sls_hash_sizeddata(
+    self->passes, (size_t)self->n_passes * sizeof(*self->passes));
+  parts.resources = sls_hash_sizeddata(
+    self->resources, (size_t)self->n_resources * sizeof(*self->resources));
+  parts.outputs = sls_hash_sizeddata(self->outputs, sizeof(self->outputs));
+  parts.width = self->output_width;
+  parts.height = self->output_height;
+  return sls_hash_sizeddata(&parts, sizeof(parts));
+}
+
+/**
+ * @brief checks that transients are written before they are read, and
+ * that each pass writes attachments of one size
+ */
+static bool sls_rendergraph_validate(slsRenderGraph const* self)
+{
+  bool written[SLS_RENDERGRAPH_MAX_RESOURCES] = { false };
+
+  for (int p = 0; p < self->n_passes; ++p) {
+    slsRGPassNode const* pass = self->passes + p;
+    for (int i = 0; i < pass->n_reads; ++i) {
+      slsRGResource r = pass->reads[i];
+      if (self->resources[r].kind == SLS_RG_TRANSIENT && !written[r]) {
+        sls_log_err("render graph: %s reads %s before any pass writes it",
+                    pass->name,
+                    self->resources[r].name);
+        return false;
+      }
+    }
+
+    if (pass->n_colors == 0 && pass->depth == SLS_RG_NONE) {
+      sls_log_err("render graph: %s writes nothing", pass->name);
+      return false;
+    }
+    int width = -1, height = -1;
+    for (int i = 0; i <= pass->n_colors; ++i) {
+      slsRGResource r = i < pass->n_colors ? pass->colors[i] : pass->depth;
+      if (r == SLS_RG_NONE) {
+        continue;
+      }
+      if (self->resources[r].kind == SLS_RG_IMPORTED_FRAMEBUFFER &&
+          (pass->n_colors != 1 || pass->depth != SLS_RG_NONE)) {
+        sls_log_err("render graph: %s must write %s alone",
+                    pass->name,
+                    self->resources[r].name);
+        return false;
+      }
+      int w, h;
+      sls_rendergraph_texture_size(self, r, &w, &h);
+      if (width >= 0 && (w != width || h != height)) {
+        sls_log_err("render graph: attachments of %s differ in size",
+                    pass->name);
+        return false;
+      }
+      width = w;
+      height = h;
+      written[r] = true;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief walks the passes backwards from the outputs, keeping the passes
+ * that write something needed, and needing what they read
+ */
+static void sls_rendergraph_cull(slsRenderGraph* self)
+{
+  bool needed[SLS_RENDERGRAPH_MAX_RESOURCES];
+  for (int r = 0; r < self->n_resources; ++r) {
+    needed[r] =
+      self->outputs[r] || self->resources[r].kind != SLS_RG_TRANSIENT;
+  }
+
+  for (int p = self->n_passes - 1; p >= 0; --p) {
+    slsRGPassNode const* pass = self->passes + p;
+    bool live = pass->depth != SLS_RG_NONE && needed[pass->depth];
+    for (int i = 0; i < pass->n_colors && !live; ++i) {
+      live = needed[pass->colors[i]];
+    }
+    self->culled[p] = !live;
+    if (live) {
+      for (int i = 0; i < pass->n_reads; ++i) {
+        needed[pass->reads[i]] = true;
+      }
+    }
+  }
+
+  self->n_order = 0;
+  for (int p = 0; p < self->n_passes; ++p) {
+    if (!self->culled[p]) {
+      self->order[self->n_order++] = p;
+    }
+  }
+}
+
+static void sls_rendergraph_lifetimes(slsRenderGraph* self)
+{
+  for (int r = 0; r < self->n_resources; ++r) {
+    self->first_use[r] = INT_MAX;
+    self->last_use[r] = -1;
+  }
+  for (int i = 0; i < self->n_order; ++i) {
+    slsRGPassNode const* pass = self->passes + self->order[i];
+    slsRGResource used[SLS_RENDERPASS_MAX_READS + SLS_RENDERPASS_MAX_COLORS +
+                       1];
+    int n_used = 0;
+    for (int j = 0; j < pass->n_reads; ++j) {
+      used[n_used++] = pass->reads[j];
+    }
+    for (int j = 0; j < pass->n_colors; ++j) {
+      used[n_used++] = pass->colors[j];
+    }
+    if (pass->depth != SLS_RG_NONE) {
+      used[n_used++] = pass->depth;
+    }
+    for (int j = 0; j < n_used; ++j) {
+      slsRGResource r = used[j];
+      self->first_use[r] = i < self->first_use[r] ? i : self->first_use[r];
+      self->last_use[r] = i > self->last_use[r] ? i : self->last_use[r];
+    }
+  }
+}
+
+/**
+ * @brief assigns live transients to physical textures, first fit in order
+ * of first use. Physical textures outlive compilations, so a transient
+ * keeps reusing the same GL texture while nothing changes.
+ */
+static void sls_rendergraph_alias(slsRenderGraph* self)
+{
+  for (int i = 0; i < self->n_physical; ++i) {
+    self->physical[i].busy_until = -1;
+    self->physical[i].used = false;
+  }
+  self->stats.n_transients = 0;
+  self->stats.aliased_bytes = 0;
+  self->stats.unaliased_bytes = 0;
+
+  for (int pos = 0; pos < self->n_order; ++pos) {
+    for (int r = 0; r < self->n_resources; ++r) {
+      if (self->resources[r].kind != SLS_RG_TRANSIENT ||
+          self->first_use[r] != pos) {
+        continue;
+      }
+      int width, height;
+      sls_rendergraph_texture_size(self, (slsRGResource)r, &width, &height);
+      GLenum format = self->resources[r].desc.internal_format;
+
+      int match = -1;
+      for (int i = 0; i < self->n_physical && match < 0; ++i) {
+        slsRGPhysical const* phys = self->physical + i;
+        if (phys->width == width && phys->height == height &&
+            phys->internal_format == format && phys->busy_until < pos) {
+          match = i;
+        }
+      }
+      if (match < 0) {
+        // repurpose a slot this compilation does not use, preferring one
+        // without a texture to recreate
+        for (int i = 0; i < self->n_physical; ++i) {
+          if (!self->physical[i].used && self->physical[i].busy_until < 0 &&
+              (match < 0 || self->physical[i].texture == 0)) {
+            match = i;
+          }
+        }
+        if (match < 0) {
+          match = self->n_physical++;
+        }
+        slsRGPhysical* phys = self->physical + match;
+        phys->width = width;
+        phys->height = height;
+        phys->internal_format = format;
+      }
+
+      slsRGPhysical* phys = self->physical + match;
+      phys->busy_until = self->last_use[r];
+      size_t bytes =
+        (size_t)width * (size_t)height * sls_rg_bytes_per_pixel(format);
+      if (!phys->used) {
+        self->stats.aliased_bytes += bytes;
+      }
+      phys->used = true;
+      self->physical_of[r] = match;
+      self->stats.n_transients++;
+      self->stats.unaliased_bytes += bytes;
+    }
+  }
+
+  self->stats.n_physical = 0;
+  for (int i = 0; i < self->n_physical; ++i) {
+    self->stats.n_physical += self->physical[i].used;
+  }
+}
+
+/**
+ * @brief cache key of a transient's physical texture, or of an imported
+ * texture
+ */
+static uint32_t sls_rendergraph_attachment(slsRenderGraph const* self,
+                                           slsRGResource resource)
+{
+  if (resource == SLS_RG_NONE) {
+    return SLS_RG_NONE;
+  }
+  if (self->resources[resource].kind == SLS_RG_TRANSIENT) {
+    return SLS_RG_PHYSICAL_BIT | (uint32_t)self->physical_of[resource];
+  }
+  return self->resources[resource].object;
+}
+
+/**
+ * @brief the attachments of a pass, as a framebuffer cache key
+ * @return false if the pass draws to an imported framebuffer
+ */
+static bool sls_rendergraph_fbo_key(slsRenderGraph const* self,
+                                    int p,
+                                    slsRGFramebuffer* key)
+{
+  slsRGPassNode const* pass = self->passes + p;
+  slsRGResource target = pass->n_colors > 0 ? pass->colors[0] : pass->depth;
+  if (self->resources[target].kind == SLS_RG_IMPORTED_FRAMEBUFFER) {
+    return false;
+  }
+  *key = (slsRGFramebuffer){.n_colors = pass->n_colors,
+                            .depth = sls_rendergraph_attachment(self,
+                                                                pass->depth) };
+  for (int j = 0; j < pass->n_colors; ++j) {
+    key->colors[j] = sls_rendergraph_attachment(self, pass->colors[j]);
+  }
+  return true;
+}
+
+static bool sls_rendergraph_same_fbo(slsRGFramebuffer const* a,
+                                     slsRGFramebuffer const* b)
+{
+  return a->n_colors == b->n_colors && a->depth == b->depth &&
+         memcmp(a->colors, b->colors, sizeof(a->colors)) == 0;
+}
+
+/**
+ * @return the number of distinct framebuffers the live passes draw to
+ */
+static int sls_rendergraph_count_fbos(slsRenderGraph const* self)
+{
+  slsRGFramebuffer keys[SLS_RENDERGRAPH_MAX_PASSES];
+  int n_keys = 0;
+  for (int i = 0; i < self->n_order; ++i) {
+    slsRGFramebuffer key;
+    if (!sls_rendergraph_fbo_key(self, self->order[i], &key)) {
+      continue;
+    }
+    bool found = false;
+    for (int j = 0; j < n_keys && !found; ++j) {
+      found = sls_rendergraph_same_fbo(keys + j, &key);
+    }
+    if (!found) {
+      keys[n_keys++] = key;
+    }
+  }
+  return n_keys;
+}
+
+bool sls_rendergraph_compile(slsRenderGraph* self)
+{
+  if (self->invalid) {
+    return false;
+  }
+  uint64_t hash = sls_rendergraph_hash(self);
+  if (self->compiled && hash == self->compiled_hash) {
+    self->stats.n_cached++;
+    return true;
+  }
+  self->compiled = false;
+
+  if (!sls_rendergraph_validate(self)) {
+    self->invalid = true;
+    return false;
+  }
+  for (int r = 0; r < self->n_resources; ++r) {
+    self->physical_of[r] = -1;
+  }
+  sls_rendergraph_cull(self);
+  sls_rendergraph_lifetimes(self);
+  sls_rendergraph_alias(self);
+
+  int n_fbos = sls_rendergraph_count_fbos(self);
+  if (n_fbos > SLS_RENDERGRAPH_MAX_FBOS) {
+    sls_log_err("render graph: %d distinct attachment sets, at most %d",
+                n_fbos,
+                SLS_RENDERGRAPH_MAX_FBOS);
+    self->invalid = true;
+    return false;
+  }
+
+  self->stats.n_passes = self->n_passes;
+  self->stats.n_culled = self->n_passes - self->n_order;
+  self->compiled_hash = hash;
+  self->compiled = true;
+  self->realized = false;
+  return true;
+}
+
+/*----------------------------------------*
+ * execution
+ *----------------------------------------*/
+
+static GLuint sls_rendergraph_attachment_texture(slsRenderGraph const* self,
+                                                 uint32_t id)
+{
+  return id & SLS_RG_PHYSICAL_BIT
+           ? self->physical[id & ~SLS_RG_PHYSICAL_BIT].texture
+           : id;
+}
+
+static void sls_rendergraph_forget_fbo(slsRGFramebuffer* fbo)
+{
+  if (fbo->fbo) {
+    glDeleteFramebuffers(1, &fbo->fbo);
+  }
+  *fbo = (slsRGFramebuffer){.n_colors = -1 };
+}
+
+/**
+ * @brief deletes physical textures that are unused or were repurposed,
+ * along with the framebuffers they are attached to, then creates the
+ * missing ones
+ */
+static void sls_rendergraph_realize_textures(slsRenderGraph* self)
+{
+  for (int i = 0; i < self->n_physical; ++i) {
+    slsRGPhysical* phys = self->physical + i;
+    bool stale = phys->texture &&
+                 (!phys->used || phys->texture_width != phys->width ||
+                  phys->texture_height != phys->height ||
+                  phys->texture_format != phys->internal_format);
+    if (!stale) {
+      continue;
+    }
+    uint32_t id = SLS_RG_PHYSICAL_BIT | (uint32_t)i;
+    for (int j = 0; j < self->n_fbos; ++j) {
+      slsRGFramebuffer* fbo = self->fbos + j;
+      bool attached = fbo->depth == id;
+      for (int k = 0; k < fbo->n_colors; ++k) {
+        attached = attached || fbo->colors[k] == id;
+      }
+      if (attached) {
+        sls_rendergraph_forget_fbo(fbo);
+      }
+    }
+    glDeleteTextures(1, &phys->texture);
+    phys->texture = 0;
+  }
+  while (self->n_physical > 0 &&
+         !self->physical[self->n_physical - 1].used) {
+    self->physical[--self->n_physical] = (slsRGPhysical){};
+  }
+
+  for (int i = 0; i < self->n_physical; ++i) {
+    slsRGPhysical* phys = self->physical + i;
+    if (!phys->used || phys->texture) {
+      continue;
+    }
+    bool depth = sls_rg_is_depth(phys->internal_format);
+    glGenTextures(1, &phys->texture);
+    glBindTexture(GL_TEXTURE_2D, phys->texture);
+    glTexImage2D(GL_TEXTURE_2D,
+                 0,
+                 (GLint)phys->internal_format,
+                 phys->width,
+                 phys->height,
+                 0,
+                 depth ? GL_DEPTH_COMPONENT : GL_RGBA,
+                 depth ? GL_FLOAT : GL_UNSIGNED_BYTE,
+                 NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    phys->texture_width = phys->width;
+    phys->texture_height = phys->height;
+    phys->texture_format = phys->internal_format;
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+static void sls_rendergraph_create_fbo(slsRenderGraph const* self,
+                                       slsRGFramebuffer* fbo)
+{
+  glGenFramebuffers(1, &fbo->fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo->fbo);
+
+  GLenum draw_buffers[SLS_RENDERPASS_MAX_COLORS];
+  for (int k = 0; k < fbo->n_colors; ++k) {
+    draw_buffers[k] = GL_COLOR_ATTACHMENT0 + (GLenum)k;
+    glFramebufferTexture2D(
+      GL_FRAMEBUFFER,
+      draw_buffers[k],
+      GL_TEXTURE_2D,
+      sls_rendergraph_attachment_texture(self, fbo->colors[k]),
+      0);
+  }
+  if (fbo->depth != SLS_RG_NONE) {
+    // imported depth textures are assumed to have no stencil
+    GLenum format = fbo->depth & SLS_RG_PHYSICAL_BIT
+                      ? self->physical[fbo->depth & ~SLS_RG_PHYSICAL_BIT]
+                          .internal_format
+                      : GL_DEPTH_COMPONENT24;
+    GLenum attachment =
+      format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8
+        ? GL_DEPTH_STENCIL_ATTACHMENT
+        : GL_DEPTH_ATTACHMENT;
+    glFramebufferTexture2D(
+      GL_FRAMEBUFFER,
+      attachment,
+      GL_TEXTURE_2D,
+      sls_rendergraph_attachment_texture(self, fbo->depth),
+      0);
+  }
+  if (fbo->n_colors > 0) {
+    glDrawBuffers(fbo->n_colors, draw_buffers);
+  } else {
+    glDrawBuffer(GL_NONE);
+  }
+
+  GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    sls_log_warn("render graph: incomplete framebuffer: 0x%x", status);
+  }
+}
+
+/**
+ * @brief finds or creates a cached framebuffer for each live pass,
+ * evicting those the frame does not use
+ * @return false if the cache has no room left
+ */
+static bool sls_rendergraph_realize_fbos(slsRenderGraph* self)
+{
+  for (int i = 0; i < self->n_fbos; ++i) {
+    self->fbos[i].live = false;
+  }
+
+  for (int i = 0; i < self->n_order; ++i) {
+    int p = self->order[i];
+    slsRGFramebuffer key;
+    if (!sls_rendergraph_fbo_key(self, p, &key)) {
+      self->pass_fbo[p] = -1;
+      continue;
+    }
+
+    int match = -1;
+    for (int j = 0; j < self->n_fbos && match < 0; ++j) {
+      if (sls_rendergraph_same_fbo(self->fbos + j, &key)) {
+        match = j;
+      }
+    }
+    if (match < 0) {
+      // compilation bounds the distinct live keys by the entries, so an
+      // entry the frame does not use is always found once all are taken
+      for (int j = 0; j < self->n_fbos; ++j) {
+        if (!self->fbos[j].live && (match < 0 || self->fbos[j].fbo == 0)) {
+          match = j;
+        }
+      }
+      if (self->n_fbos < SLS_RENDERGRAPH_MAX_FBOS &&
+          (match < 0 || self->fbos[match].fbo)) {
+        match = self->n_fbos++;
+      }
+      if (match < 0) {
+        sls_log_err("render graph: framebuffer cache full");
+        return false;
+      }
+      sls_rendergraph_forget_fbo(self->fbos + match);
+      self->fbos[match] = key;
+      sls_rendergraph_create_fbo(self, self->fbos + match);
+    }
+    self->fbos[match].live = true;
+    self->pass_fbo[p] = match;
+  }
+  return true;
+}
+
+void sls_rendergraph_execute(slsRenderGraph* self)
+{
+  if (!sls_rendergraph_compile(self)) {
+    return;
+  }
+
+  // restored afterwards: the caller's target may not be framebuffer 0
+  GLint previous = 0;
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+
+  if (!self->realized) {
+    sls_rendergraph_realize_textures(self);
+    if (!sls_rendergraph_realize_fbos(self)) {
+      self->invalid = true;
+      return;
+    }
+    self->realized = true;
+  }
+
+  GLuint bound = (GLuint)previous;
+  for (int i = 0; i < self->n_order; ++i) {
+    int p = self->order[i];
+    slsRGPassNode const* pass = self->passes + p;
+    slsRGResource target = pass->n_colors > 0 ? pass->colors[0] : pass->depth;
+    GLuint fbo = self->pass_fbo[p] < 0 ? self->resources[target].object
+                                       : self->fbos[self->pass_fbo[p]].fbo;
+    if (fbo != bound) {
+      glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+      bound = fbo;
+    }
+
+    int width, height;
+    sls_rendergraph_texture_size(self, target, &width, &height);
+    glViewport(0, 0, width, height);
+    if (pass->fn) {
+      pass->fn(self, p, pass->data);
+    }
+  }
+
+  glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)previous);
+  glViewport(0, 0, self->output_width, self->output_height);
+}
+
+GLuint sls_rendergraph_texture(slsRenderGraph const* self,
+                               slsRGResource resource)
+{
+  if (resource >= (slsRGResource)self->n_resources) {
+    return 0;
+  }
+  slsRGResourceNode const* node = self->resources + resource;
+  switch (node->kind) {
+    case SLS_RG_TRANSIENT:
+      return self->physical_of[resource] >= 0
+               ? self->physical[self->physical_of[resource]].texture
+               : 0;
+    case SLS_RG_IMPORTED_TEXTURE:
+      return node->object;
+    default:
+      return 0;
+  }
+}
@@ -0,0 +1,274 @@
+/**
+ * @file slsrendergraph.h
+ * @brief frame graph of render passes, with pass culling and aliasing of
+ * transient textures
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#ifndef DANGERENGINE_SLSRENDERGRAPH_H
+#define DANGERENGINE_SLSRENDERGRAPH_H
+
+#include "../sls-gl.h"
+#include <slsmacros.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+SLS_BEGIN_CDECLS
+
+#define SLS_RENDERGRAPH_MAX_PASSES 64
+#define SLS_RENDERGRAPH_MAX_RESOURCES 64
+#define SLS_RENDERGRAPH_MAX_FBOS 64
+#define SLS_RENDERPASS_MAX_READS 8
+/** @brief color attachments of one pass */
+#define SLS_RENDERPASS_MAX_COLORS 4
+
+/** @brief no resource */
+#define SLS_RG_NONE UINT32_MAX
+#define SLS_RG_PHYSICAL_BIT 0x80000000u
+
+typedef uint32_t slsRGResource;
+typedef struct slsRenderGraph slsRenderGraph;
+
+/**
+ * @brief draws a pass. Its attachments are bound, and the viewport covers
+ * them.
+ */
+typedef void (*slsRenderPassFn)(slsRenderGraph const* graph,
+                                int pass,
+                                void* data);
+
+typedef enum slsRGResourceKind {
+  /** @brief texture owned by the graph, only alive within the frame */
+  SLS_RG_TRANSIENT,
+  /** @brief texture owned by the caller */
+  SLS_RG_IMPORTED_TEXTURE,
+  /** @brief framebuffer owned by the caller, e.g. the window */
+  SLS_RG_IMPORTED_FRAMEBUFFER,
+} slsRGResourceKind;
+
+/**
+ * @brief size and format of a transient texture
+ */
+typedef struct slsRGTextureDesc {
+  /** @brief in pixels. 0 uses `scale` times the graph's output size */
+  int width;
+  int height;
+  float scale;
+  GLenum internal_format;
+} slsRGTextureDesc;
+
+typedef struct slsRGResourceNode {
+  char name[32];
+  slsRGResourceKind kind;
+  slsRGTextureDesc desc;
+  /** @brief imported texture, or imported framebuffer */
+  GLuint object;
+} slsRGResourceNode;
+
+typedef struct slsRGPassNode {
+  char name[32];
+  slsRenderPassFn fn;
+  void* data;
+  slsRGResource reads[SLS_RENDERPASS_MAX_READS];
+  int n_reads;
+  slsRGResource colors[SLS_RENDERPASS_MAX_COLORS];
+  int n_colors;
+  slsRGResource depth;
+} slsRGPassNode;
+
+/**
+ * @brief a GL texture backing every transient with the same size and
+ * format whose lifetimes do not overlap
+ */
+typedef struct slsRGPhysical {
+  int width;
+  int height;
+  GLenum internal_format;
+  GLuint texture;
+  /** @brief what `texture` was created with, which may be stale */
+  int texture_width;
+  int texture_height;
+  GLenum texture_format;
+  /** @brief position of the last pass using it, while assigning */
+  int busy_until;
+  /** @brief backs a transient of the current compilation */
+  bool used;
+} slsRGPhysical;
+
+/**
+ * @brief a cached framebuffer. Attachments are identified by the imported
+ * texture, or by SLS_RG_PHYSICAL_BIT with the physical texture's index.
+ */
+typedef struct slsRGFramebuffer {
+  uint32_t colors[SLS_RENDERPASS_MAX_COLORS];
+  int n_colors;
+  uint32_t depth;
+  GLuint fbo;
+  /** @brief used by the current frame */
+  bool live;
+} slsRGFramebuffer;
+
+typedef struct slsRenderGraphStats {
+  int n_passes;
+  int n_culled;
+  int n_transients;
+  int n_physical;
+  /** @brief transient texture memory, with and without aliasing */
+  size_t aliased_bytes;
+  size_t unaliased_bytes;
+  /** @brief compilations skipped because nothing changed */
+  uint64_t n_cached;
+} slsRenderGraphStats;
+
+/**
+ * @brief Render graph.
+ * @detail Each frame, the passes and the resources they read and write are
+ * declared again, in execution order, between sls_rendergraph_begin and
+ * sls_rendergraph_execute. Compilation culls passes that contribute
+ * nothing to an output or an imported resource, then assigns transient
+ * textures to physical textures greedily in pass order, so transients
+ * whose lifetimes do not overlap share one. If the declarations hash the
+ * same as the previous frame's, the previous compilation is reused.
+ * Framebuffers are cached by their attachments, and consecutive passes
+ * with the same attachments are not rebound.
+ */
+struct slsRenderGraph {
+  slsRGPassNode passes[SLS_RENDERGRAPH_MAX_PASSES];
+  int n_passes;
+  slsRGResourceNode resources[SLS_RENDERGRAPH_MAX_RESOURCES];
+  int n_resources;
+  /** @brief resources that must be produced */
+  bool outputs[SLS_RENDERGRAPH_MAX_RESOURCES];
+  int output_width;
+  int output_height;
+
+  /*
+   * compiled, and kept while the declarations hash the same
+   */
+  /** @brief live passes, in execution order */
+  int order[SLS_RENDERGRAPH_MAX_PASSES];
+  int n_order;
+  bool culled[SLS_RENDERGRAPH_MAX_PASSES];
+  /** @brief position in the order of each resource's first and last use */
+  int first_use[SLS_RENDERGRAPH_MAX_RESOURCES];
+  int last_use[SLS_RENDERGRAPH_MAX_RESOURCES];
+  /** @brief physical texture of each transient, or -1 */
+  int physical_of[SLS_RENDERGRAPH_MAX_RESOURCES];
+
+  slsRGPhysical physical[SLS_RENDERGRAPH_MAX_RESOURCES];
+  int n_physical;
+  slsRGFramebuffer fbos[SLS_RENDERGRAPH_MAX_FBOS];
+  int n_fbos;
+  /** @brief framebuffer cache entry, -1 for imported framebuffers */
+  int pass_fbo[SLS_RENDERGRAPH_MAX_PASSES];
+
+  uint64_t compiled_hash;
+  bool compiled;
+  /** @brief GL objects match the compilation */
+  bool realized;
+  /** @brief a declaration failed, so the frame is not executed */
+  bool invalid;
+  slsRenderGraphStats stats;
+};
+
+slsRenderGraph* sls_rendergraph_init(slsRenderGraph* self) SLS_NONNULL(1);
+
+/**
+ * @brief deletes the graph's textures and framebuffers
+ */
+slsRenderGraph* sls_rendergraph_dtor(slsRenderGraph* self) SLS_NONNULL(1);
+
+/**
+ * @brief starts declaring a frame
+ * @param width, height output size, which relative sizes refer to
+ */
+void sls_rendergraph_begin(slsRenderGraph* self, int width, int height)
+  SLS_NONNULL(1);
+
+slsRGResource sls_rendergraph_create_texture(slsRenderGraph* self,
+                                             char const* name,
+                                             slsRGTextureDesc desc)
+  SLS_NONNULL(1, 2);
+
+slsRGResource sls_rendergraph_import_texture(slsRenderGraph* self,
+                                             char const* name,
+                                             GLuint texture,
+                                             int width,
+                                             int height) SLS_NONNULL(1, 2);
+
+/**
+ * @brief a framebuffer passes may render to as a whole, e.g. 0 for the
+ * window. Passes writing it take it as their only attachment.
+ */
+slsRGResource sls_rendergraph_import_framebuffer(slsRenderGraph* self,
+                                                 char const* name,
+                                                 GLuint fbo,
+                                                 int width,
+                                                 int height)
+  SLS_NONNULL(1, 2);
+
+/**
+ * @brief marks a resource as needed after the frame, so its producers are
+ * never culled. Imported resources written by a pass are always kept.
+ */
+void sls_rendergraph_set_output(slsRenderGraph* self, slsRGResource resource)
+  SLS_NONNULL(1);
+
+/**
+ * @return the pass index, or -1 if the graph is full
+ */
+int sls_rendergraph_add_pass(slsRenderGraph* self,
+                             char const* name,
+                             slsRenderPassFn fn,
+                             void* data) SLS_NONNULL(1, 2);
+
+void sls_rendergraph_read(slsRenderGraph* self,
+                          int pass,
+                          slsRGResource resource) SLS_NONNULL(1);
+
+/**
+ * @brief adds a color attachment, or the framebuffer for imported
+ * framebuffers
+ */
+void sls_rendergraph_write(slsRenderGraph* self,
+                           int pass,
+                           slsRGResource resource) SLS_NONNULL(1);
+
+void sls_rendergraph_write_depth(slsRenderGraph* self,
+                                 int pass,
+                                 slsRGResource resource) SLS_NONNULL(1);
+
+/**
+ * @brief orders, culls and aliases the declared frame. Makes no GL
+ * calls.
+ * @return false if the declarations are inconsistent
+ */
+bool sls_rendergraph_compile(slsRenderGraph* self) SLS_NONNULL(1);
+
+/**
+ * @brief compiles if needed, creates missing GL objects, and runs the live
+ * passes
+ */
+void sls_rendergraph_execute(slsRenderGraph* self) SLS_NONNULL(1);
+
+/**
+ * @brief the texture behind a resource, for passes to sample
+ */
+GLuint sls_rendergraph_texture(slsRenderGraph const* self,
+                               slsRGResource resource) SLS_NONNULL(1);
+
+/**
+ * @brief a resource's size in pixels, resolving relative sizes against the
+ * output size
+ */
+void sls_rendergraph_texture_size(slsRenderGraph const* self,
+                                  slsRGResource resource,
+                                  int* width,
+                                  int* height) SLS_NONNULL(1, 3, 4);
+
+SLS_END_CDECLS
+
+#endif // DANGERENGINE_SLSRENDERGRAPH_H
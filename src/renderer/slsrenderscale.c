@@ -0,0 +1,187 @@
+/**
+ * @file slsrenderscale.c
+ * @brief
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#include "slsrenderscale.h"
+#include <math.h>
+
+/** @brief weight of each new sample in the moving average */
+#define SLS_RENDERSCALE_SMOOTHING 0.2
+
+slsRenderScale* sls_renderscale_init(slsRenderScale* self,
+                                     slsRenderScaleParams const* params)
+{
+  *self = (slsRenderScale){.params = *params,
+                           .scale = params->max_scale,
+                           .smoothed_ms = -1.0 };
+  return self;
+}
+
+slsRenderScale* sls_renderscale_dtor(slsRenderScale* self)
+{
+  if (self->fbo) {
+    glDeleteFramebuffers(1, &self->fbo);
+    glDeleteRenderbuffers(1, &self->color);
+    glDeleteRenderbuffers(1, &self->depth);
+  }
+  *self = (slsRenderScale){};
+  return self;
+}
+
+bool sls_renderscale_feed(slsRenderScale* self, double gpu_ms)
+{
+  slsRenderScaleParams const* p = &self->params;
+  if (self->n_stale > 0) {
+    self->n_stale--;
+    return false;
+  }
+  if (self->smoothed_ms < 0.0) {
+    self->smoothed_ms = gpu_ms;
+  } else {
+    self->smoothed_ms +=
+      SLS_RENDERSCALE_SMOOTHING * (gpu_ms - self->smoothed_ms);
+  }
+
+  if (self->smoothed_ms > p->target_ms) {
+    self->n_over++;
+    self->n_under = 0;
+  } else if (self->smoothed_ms < p->target_ms * (1.0 - p->headroom)) {
+    self->n_under++;
+    self->n_over = 0;
+  } else {
+    self->n_over = 0;
+    self->n_under = 0;
+  }
+
+  float scale = self->scale;
+  if (self->n_over >= p->samples_down) {
+    scale -= p->step;
+  } else if (self->n_under >= p->samples_up) {
+    scale += p->step;
+  } else {
+    return false;
+  }
+  self->n_over = 0;
+  self->n_under = 0;
+
+  scale = fminf(fmaxf(scale, p->min_scale), p->max_scale);
+  if (fabsf(scale - self->scale) < 1e-4f) {
+    return false;
+  }
+  self->scale = scale;
+  // timings at the old scale say nothing about the new one, including
+  // those of frames already submitted
+  self->smoothed_ms = -1.0;
+  self->n_stale = p->latency;
+  return true;
+}
+
+bool sls_renderscale_feed_profiler(slsRenderScale* self,
+                                   slsProfiler const* profiler,
+                                   char const* scope)
+{
+  // sls_profiler_begin_frame opens "frame", so it parents every other
+  // scope of the frame
+  int frame = sls_profiler_find(profiler, "frame", -1);
+  int index = frame < 0 ? -1 : sls_profiler_find(profiler, scope, frame);
+  if (index < 0) {
+    return false;
+  }
+
+  slsProfileHistory const* history = &profiler->scopes[index].gpu;
+  if (history->n_samples == 0 || history->head == self->profiler_head) {
+    return false;
+  }
+  self->profiler_head = history->head;
+
+  size_t last = (history->head + SLS_PROFILER_HISTORY - 1) %
+                SLS_PROFILER_HISTORY;
+  return sls_renderscale_feed(self, history->samples[last]);
+}
+
+static int sls_renderscale_apply(int size, float scale)
+{
+  int scaled = (int)ceilf((float)size * scale);
+  return scaled > 0 ? scaled : 1;
+}
+
+void sls_renderscale_resize(slsRenderScale* self,
+                            int output_width,
+                            int output_height)
+{
+  self->output_width = output_width > 0 ? output_width : 1;
+  self->output_height = output_height > 0 ? output_height : 1;
+
+  int width =
+    sls_renderscale_apply(self->output_width, self->params.max_scale);
+  int height =
+    sls_renderscale_apply(self->output_height, self->params.max_scale);
+  if (self->fbo && width == self->target_width &&
+      height == self->target_height) {
+    return;
+  }
+  self->target_width = width;
+  self->target_height = height;
+
+  if (!self->fbo) {
+    glGenFramebuffers(1, &self->fbo);
+    glGenRenderbuffers(1, &self->color);
+    glGenRenderbuffers(1, &self->depth);
+  }
+  glBindRenderbuffer(GL_RENDERBUFFER, self->color);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+  glBindRenderbuffer(GL_RENDERBUFFER, self->depth);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  GLint bound = 0;
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &bound);
+  glBindFramebuffer(GL_FRAMEBUFFER, self->fbo);
+  glFramebufferRenderbuffer(
+    GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, self->color);
+  glFramebufferRenderbuffer(
+    GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, self->depth);
+  glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)bound);
+}
+
+void sls_renderscale_size(slsRenderScale const* self, int* width, int* height)
+{
+  *width = sls_renderscale_apply(self->output_width, self->scale);
+  *height = sls_renderscale_apply(self->output_height, self->scale);
+}
+
+void sls_renderscale_begin(slsRenderScale* self)
+{
+  int width, height;
+  sls_renderscale_size(self, &width, &height);
+  glBindFramebuffer(GL_FRAMEBUFFER, self->fbo);
+  glViewport(0, 0, width, height);
+}
+
+void sls_renderscale_end(slsRenderScale* self, GLuint output_fbo)
+{
+  int width, height;
+  sls_renderscale_size(self, &width, &height);
+  bool native =
+    width == self->output_width && height == self->output_height;
+
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, self->fbo);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, output_fbo);
+  glBlitFramebuffer(0,
+                    0,
+                    width,
+                    height,
+                    0,
+                    0,
+                    self->output_width,
+                    self->output_height,
+                    GL_COLOR_BUFFER_BIT,
+                    native ? GL_NEAREST : GL_LINEAR);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, output_fbo);
+  glViewport(0, 0, self->output_width, self->output_height);
+}
@@ -0,0 +1,145 @@
+/**
+ * @file slsrenderscale.h
+ * @brief dynamic resolution: renders the scene offscreen at a scale that
+ * follows the GPU frame time, then upscales it to the output
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#ifndef DANGERENGINE_SLSRENDERSCALE_H
+#define DANGERENGINE_SLSRENDERSCALE_H
+
+#include "../sls-gl.h"
+#include "slsprofiler.h"
+#include <slsmacros.h>
+#include <stdbool.h>
+
+SLS_BEGIN_CDECLS
+
+typedef struct slsRenderScaleParams {
+  /** @brief GPU time the scene should take, in milliseconds */
+  double target_ms;
+  /** @brief bounds of the scale applied to each output dimension */
+  float min_scale;
+  float max_scale;
+  /** @brief scale change per adjustment */
+  float step;
+  /**
+   * @brief fraction of the target the smoothed time must fall under
+   * before the scale rises, so it does not oscillate around the target
+   */
+  double headroom;
+  /** @brief consecutive samples over budget before the scale drops */
+  int samples_down;
+  /** @brief consecutive samples under budget before the scale rises */
+  int samples_up;
+  /**
+   * @brief samples already in flight when the scale changes. They were
+   * rendered at the old scale, so they are skipped.
+   */
+  int latency;
+} slsRenderScaleParams;
+
+/**
+ * @brief defaults for a 60 Hz display, leaving room for the overlay and
+ * the upscale
+ */
+static const slsRenderScaleParams SLS_RENDERSCALE_DEFAULT_PARAMS = {
+  .target_ms = 14.0,
+  .min_scale = 0.5f,
+  .max_scale = 1.f,
+  .step = 0.1f,
+  .headroom = 0.2,
+  .samples_down = 4,
+  .samples_up = 30,
+  .latency = SLS_PROFILER_LATENCY,
+};
+
+/**
+ * @brief Render scale controller and its offscreen target.
+ * @detail The target is allocated once at max_scale times the output
+ * size, and lower scales render into its lower left corner, so changing
+ * scale only changes the viewport. Timings are smoothed with an
+ * exponential moving average. The scale drops quickly when over budget,
+ * and rises slowly when comfortably under it.
+ */
+typedef struct slsRenderScale {
+  slsRenderScaleParams params;
+  float scale;
+  /** @brief smoothed GPU time, negative before the first sample */
+  double smoothed_ms;
+  int n_over;
+  int n_under;
+  /** @brief samples still to skip since the last change */
+  int n_stale;
+  /** @brief head of the profiled scope's GPU history at the last sample */
+  size_t profiler_head;
+
+  GLuint fbo;
+  GLuint color;
+  GLuint depth;
+  int output_width;
+  int output_height;
+  /** @brief size of the allocated target */
+  int target_width;
+  int target_height;
+} slsRenderScale;
+
+/**
+ * @brief sets up the controller. GL objects are created by the first
+ * sls_renderscale_resize.
+ */
+slsRenderScale* sls_renderscale_init(slsRenderScale* self,
+                                     slsRenderScaleParams const* params)
+  SLS_NONNULL(1, 2);
+
+slsRenderScale* sls_renderscale_dtor(slsRenderScale* self) SLS_NONNULL(1);
+
+/**
+ * @brief takes a GPU time sample and adjusts the scale
+ * @return true if the scale changed
+ */
+bool sls_renderscale_feed(slsRenderScale* self, double gpu_ms)
+  SLS_NONNULL(1);
+
+/**
+ * @brief feeds the newest GPU time of `scope`, a scope opened directly
+ * inside the profiler's "frame" scope, if it has a sample not fed yet
+ * @return true if the scale changed
+ */
+bool sls_renderscale_feed_profiler(slsRenderScale* self,
+                                   slsProfiler const* profiler,
+                                   char const* scope) SLS_NONNULL(1, 2, 3);
+
+/**
+ * @brief reallocates the target for a new output size, in pixels
+ */
+void sls_renderscale_resize(slsRenderScale* self,
+                            int output_width,
+                            int output_height) SLS_NONNULL(1);
+
+/**
+ * @brief size the scene renders at
+ */
+void sls_renderscale_size(slsRenderScale const* self, int* width, int* height)
+  SLS_NONNULL(1, 2, 3);
+
+/**
+ * @brief binds the offscreen target and sets the viewport to the scaled
+ * size
+ */
+void sls_renderscale_begin(slsRenderScale* self) SLS_NONNULL(1);
+
+/**
+ * @brief upscales the scene into `output_fbo`, which stays bound with a
+ * full-size viewport
+ * @param output_fbo 0 for the window, or e.g. a headless context's
+ * framebuffer
+ */
+void sls_renderscale_end(slsRenderScale* self, GLuint output_fbo)
+  SLS_NONNULL(1);
+
+SLS_END_CDECLS
+
+#endif // DANGERENGINE_SLSRENDERSCALE_H
@@ -33,10 +33,9 @@ slsShader* sls_shader_init(slsShader* self, GLuint program)
   self->program = program;
 
   // bind hardcoded active_shader attributes and uniforms
-  glBindAttribLocation(program, SLS_ATTRIB_POSITION, "position");
-  glBindAttribLocation(program, SLS_ATTRIB_NORMAL, "normal");
-  glBindAttribLocation(program, SLS_ATTRIB_UV, "uv");
-  glBindAttribLocation(program, SLS_ATTRIB_COLOR, "color");
+  sls_shader_bind_attrib_locations(program);
+
+  sls_shader_bind_uniform_blocks(self);
 
   return self;
 error:
@@ -54,6 +53,30 @@ slsShader* sls_shader_dtor(slsShader* self)
   return self;
 }
 
+void sls_shader_bind_attrib_locations(GLuint program)
+{
+  glBindAttribLocation(program, SLS_ATTRIB_POSITION, "position");
+  glBindAttribLocation(program, SLS_ATTRIB_NORMAL, "normal");
+  glBindAttribLocation(program, SLS_ATTRIB_UV, "uv");
+  glBindAttribLocation(program, SLS_ATTRIB_COLOR, "color");
+}
+
+void sls_shader_bind_uniform_blocks(slsShader* self)
+{
+  struct {
+    char const* name;
+    GLuint binding;
+  } blocks[] = { { "Material", SLS_UBO_BINDING_MATERIAL },
+                 { "Lights", SLS_UBO_BINDING_LIGHTS } };
+
+  for (size_t i = 0; i < SLS_ARRAY_COUNT(blocks); ++i) {
+    GLuint idx = glGetUniformBlockIndex(self->program, blocks[i].name);
+    if (idx != GL_INVALID_INDEX) {
+      glUniformBlockBinding(self->program, idx, blocks[i].binding);
+    }
+  }
+}
+
 void sls_shader_use(slsShader* self)
 {
   GLuint prg = self ? self->program : 0;
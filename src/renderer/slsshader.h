@@ -62,6 +62,17 @@ enum slsDefaultAttribLocations {
 
 typedef enum slsDefaultAttribLocations slsDefaultAttribLocations;
 
+/**
+ * @brief fixed binding points for the uniform blocks in uniforms.glsl
+ */
+enum slsUniformBlockBindings {
+  SLS_UBO_BINDING_MATERIAL = 0,
+  SLS_UBO_BINDING_LIGHTS = 1,
+  SLS_UBO_BINDING_LAST
+};
+
+typedef enum slsUniformBlockBindings slsUniformBlockBindings;
+
 
 /**
  * @brief struct storing attribute locations for default shaders
@@ -111,6 +122,18 @@ slsShader *sls_shader_dtor(slsShader *self) SLS_NONNULL(1);
 
 void sls_setup_attribs(slsShader *self);
 
+/**
+ * @brief binds the slsDefaultAttribLocations names. Only takes effect at
+ * the program's next link.
+ */
+void sls_shader_bind_attrib_locations(GLuint program);
+
+/**
+ * @brief assigns the `Material` and `Lights` blocks of the program to
+ * slsUniformBlockBindings, if the program declares them
+ */
+void sls_shader_bind_uniform_blocks(slsShader *self) SLS_NONNULL(1);
+
 void sls_shader_use(slsShader *self_opt);
 
 void sls_shader_bind_vec3(slsShader *self, GLuint location, kmVec3 vec)
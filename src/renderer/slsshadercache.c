@@ -0,0 +1,348 @@
+/**
+ * @file slsshadercache.c
+ * @brief
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#include "slsshadercache.h"
+#include "shaderutils.h"
+#include <data-types/hashtable.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <slsutils.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#define sls_mkdir(path) _mkdir(path)
+#else
+#define sls_mkdir(path) mkdir((path), 0755)
+#endif
+
+#define SLS_PROGRAM_BINARY_MAGIC 0x504c5353u // "SSLP"
+#define SLS_PROGRAM_BINARY_VERSION 1u
+
+/**
+ * @brief header written in front of the driver's program binary
+ */
+typedef struct slsProgramBinaryHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t key;
+  uint32_t format;
+  uint32_t length;
+} slsProgramBinaryHeader;
+
+static double sls_shadercache_now()
+{
+  return SDL_GetPerformanceCounter() / (double)SDL_GetPerformanceFrequency();
+}
+
+static char* sls_shadercache_strdup(char const* str)
+{
+  size_t len = strlen(str);
+  char* res = malloc(len + 1);
+  if (res) {
+    memcpy(res, str, len + 1);
+  }
+  return res;
+}
+
+slsShaderCache* sls_shadercache_init(slsShaderCache* self,
+                                     char const* directory_opt)
+{
+  *self = (slsShaderCache){};
+
+  if (directory_opt) {
+    size_t len = strlen(directory_opt);
+    bool has_sep = len > 0 && (directory_opt[len - 1] == '/' ||
+                               directory_opt[len - 1] == '\\');
+    self->directory = malloc(len + 2);
+    sls_checkmem(self->directory);
+    snprintf(self->directory,
+             len + 2,
+             "%s%s",
+             directory_opt,
+             has_sep ? "" : "/");
+    if (sls_mkdir(self->directory) != 0 && errno != EEXIST) {
+      sls_log_warn("shader cache: cannot create %s", self->directory);
+    }
+  } else {
+    char* pref = SDL_GetPrefPath("dangerengine", "shadercache");
+    sls_check(pref, "shader cache: %s", SDL_GetError());
+    self->directory = sls_shadercache_strdup(pref);
+    SDL_free(pref);
+    sls_checkmem(self->directory);
+  }
+
+  char const* vendor = (char const*)glGetString(GL_VENDOR);
+  char const* renderer = (char const*)glGetString(GL_RENDERER);
+  char const* version = (char const*)glGetString(GL_VERSION);
+  size_t device_len = strlen(vendor ? vendor : "") +
+                      strlen(renderer ? renderer : "") +
+                      strlen(version ? version : "") + 3;
+  self->device = malloc(device_len);
+  sls_checkmem(self->device);
+  snprintf(self->device,
+           device_len,
+           "%s\n%s\n%s",
+           vendor ? vendor : "",
+           renderer ? renderer : "",
+           version ? version : "");
+
+  GLint n_formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &n_formats);
+  self->enabled = n_formats > 0;
+  if (!self->enabled) {
+    sls_log_info("shader cache: driver exposes no program binary formats");
+  }
+
+  return self;
+error:
+  return sls_shadercache_dtor(self);
+}
+
+slsShaderCache* sls_shadercache_dtor(slsShaderCache* self)
+{
+  free(self->directory);
+  free(self->device);
+  self->directory = NULL;
+  self->device = NULL;
+  self->enabled = false;
+  return self;
+}
+
+uint64_t sls_shadercache_key(slsShaderCache const* self,
+                             char const* vs_source,
+                             char const* fs_source,
+                             char const* uniforms)
+{
+  char const* parts[] = { sls_shader_preamble(), uniforms, vs_source,
+                          fs_source, self->device ? self->device : "" };
+
+  size_t total = 0;
+  for (size_t i = 0; i < SLS_ARRAY_COUNT(parts); ++i) {
+    total += strlen(parts[i]) + 1;
+  }
+
+  // hash the parts NUL-separated, so moving text between them changes
+  // the key
+  char* buffer = malloc(total);
+  if (!buffer) {
+    return 0;
+  }
+  char* p = buffer;
+  for (size_t i = 0; i < SLS_ARRAY_COUNT(parts); ++i) {
+    size_t len = strlen(parts[i]) + 1;
+    memcpy(p, parts[i], len);
+    p += len;
+  }
+
+  uint64_t key = sls_hash_sizeddata(buffer, total);
+  free(buffer);
+
+  return key;
+}
+
+static void sls_shadercache_path(slsShaderCache const* self,
+                                 uint64_t key,
+                                 char* out,
+                                 size_t out_size)
+{
+  snprintf(out, out_size, "%s%016" PRIx64 ".bin", self->directory, key);
+}
+
+/**
+ * @brief reads and links a cached binary
+ * @return the program, or 0 if there was no usable binary for `key`
+ */
+static GLuint sls_shadercache_load(slsShaderCache* self,
+                                   char const* path,
+                                   uint64_t key)
+{
+  GLuint program = 0;
+  void* binary = NULL;
+  slsProgramBinaryHeader header;
+
+  FILE* file = fopen(path, "rb");
+  if (!file) {
+    return 0;
+  }
+
+  sls_check(fread(&header, sizeof(header), 1, file) == 1,
+            "shader cache: truncated header in %s",
+            path);
+  sls_check(header.magic == SLS_PROGRAM_BINARY_MAGIC &&
+              header.version == SLS_PROGRAM_BINARY_VERSION &&
+              header.key == key,
+            "shader cache: stale entry %s",
+            path);
+
+  binary = malloc(header.length + 1);
+  sls_checkmem(binary);
+  sls_check(fread(binary, 1, header.length, file) == header.length,
+            "shader cache: truncated binary in %s",
+            path);
+
+  program = glCreateProgram();
+  glProgramBinary(program, header.format, binary, (GLsizei)header.length);
+
+  GLint link_ok = GL_FALSE;
+  glGetProgramiv(program, GL_LINK_STATUS, &link_ok);
+  if (!link_ok) {
+    // drivers reject binaries after updates: recompile and overwrite
+    sls_log_info("shader cache: driver rejected %s", path);
+    self->stats.rejected++;
+    glDeleteProgram(program);
+    program = 0;
+  }
+
+error:
+  fclose(file);
+  free(binary);
+  return program;
+}
+
+static void sls_shadercache_store(slsShaderCache* self,
+                                  char const* path,
+                                  uint64_t key,
+                                  GLuint program)
+{
+  void* binary = NULL;
+  FILE* file = NULL;
+
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  }
+
+  binary = malloc((size_t)length);
+  sls_checkmem(binary);
+
+  GLenum format = 0;
+  GLsizei written = 0;
+  glGetProgramBinary(program, length, &written, &format, binary);
+  sls_check(written > 0, "shader cache: could not retrieve program binary");
+
+  slsProgramBinaryHeader header = {.magic = SLS_PROGRAM_BINARY_MAGIC,
+                                   .version = SLS_PROGRAM_BINARY_VERSION,
+                                   .key = key,
+                                   .format = format,
+                                   .length = (uint32_t)written };
+
+  file = fopen(path, "wb");
+  sls_check(file, "shader cache: cannot write %s", path);
+  sls_check(fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(binary, 1, (size_t)written, file) == (size_t)written,
+            "shader cache: failed writing %s",
+            path);
+
+error:
+  if (file) {
+    fclose(file);
+  }
+  free(binary);
+}
+
+slsShaderCacheBuild* sls_shadercache_submit(slsShaderCache* self,
+                                            slsShaderCacheBuild* pending,
+                                            char const* vs_source,
+                                            char const* fs_source,
+                                            char const* uniforms)
+{
+  *pending = (slsShaderCacheBuild){.start = sls_shadercache_now() };
+
+  if (self->enabled) {
+    char path[4096];
+    pending->key = sls_shadercache_key(self, vs_source, fs_source, uniforms);
+    sls_shadercache_path(self, pending->key, path, sizeof(path));
+
+    GLuint program = sls_shadercache_load(self, path, pending->key);
+    if (program) {
+      pending->build = (slsProgramBuild){.program = program,
+                                         .status = SLS_PROGRAM_READY };
+      self->stats.hits++;
+      self->stats.hit_seconds += sls_shadercache_now() - pending->start;
+      return pending;
+    }
+
+    // binaries are only retrievable if asked for before linking
+    sls_program_build_submit_retrievable(
+      &pending->build, vs_source, fs_source, uniforms);
+  } else {
+    sls_program_build_submit(&pending->build, vs_source, fs_source, uniforms);
+  }
+
+  pending->missed = true;
+  return pending;
+}
+
+/**
+ * @brief stores and counts a miss once its build finished
+ */
+static slsProgramStatus sls_shadercache_finish(slsShaderCache* self,
+                                               slsShaderCacheBuild* pending)
+{
+  slsProgramStatus status = pending->build.status;
+  if (status == SLS_PROGRAM_PENDING || !pending->missed) {
+    return status;
+  }
+
+  if (status == SLS_PROGRAM_READY && self->enabled) {
+    char path[4096];
+    sls_shadercache_path(self, pending->key, path, sizeof(path));
+    sls_shadercache_store(self, path, pending->key, pending->build.program);
+  }
+
+  pending->missed = false;
+  self->stats.misses++;
+  self->stats.miss_seconds += sls_shadercache_now() - pending->start;
+
+  return status;
+}
+
+slsProgramStatus sls_shadercache_poll(slsShaderCache* self,
+                                      slsShaderCacheBuild* pending)
+{
+  sls_program_build_poll(&pending->build);
+  return sls_shadercache_finish(self, pending);
+}
+
+slsProgramStatus sls_shadercache_wait(slsShaderCache* self,
+                                      slsShaderCacheBuild* pending)
+{
+  sls_program_build_wait(&pending->build);
+  return sls_shadercache_finish(self, pending);
+}
+
+GLuint sls_shadercache_program(slsShaderCache* self,
+                               char const* vs_source,
+                               char const* fs_source,
+                               char const* uniforms)
+{
+  slsShaderCacheBuild pending;
+  sls_shadercache_submit(self, &pending, vs_source, fs_source, uniforms);
+  sls_shadercache_wait(self, &pending);
+
+  // a failed build already deleted its program
+  return pending.build.program;
+}
+
+void sls_shadercache_log_stats(slsShaderCache const* self)
+{
+  slsShaderCacheStats const* s = &self->stats;
+  double warm_ms = s->hits ? 1000.0 * s->hit_seconds / s->hits : 0.0;
+  double cold_ms = s->misses ? 1000.0 * s->miss_seconds / s->misses : 0.0;
+
+  sls_log_info("shader cache: %lu hits (warm, %.2f ms avg), %lu misses "
+               "(cold, %.2f ms avg), %lu rejected",
+               s->hits,
+               warm_ms,
+               s->misses,
+               cold_ms,
+               s->rejected);
+}
@@ -0,0 +1,125 @@
+/**
+ * @file slsshadercache.h
+ * @brief on-disk cache of linked program binaries
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#ifndef DANGERENGINE_SLSSHADERCACHE_H
+#define DANGERENGINE_SLSSHADERCACHE_H
+
+#include "../sls-gl.h"
+#include "slsprogrambuild.h"
+#include <slsmacros.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+SLS_BEGIN_CDECLS
+
+typedef struct slsShaderCacheStats {
+  /** @brief programs loaded from a cached binary */
+  size_t hits;
+  /** @brief programs compiled from source */
+  size_t misses;
+  /** @brief cached binaries rejected by the driver, eg after an update */
+  size_t rejected;
+
+  /** @brief seconds spent producing programs on hits and misses */
+  double hit_seconds;
+  double miss_seconds;
+} slsShaderCacheStats;
+
+typedef struct slsShaderCache {
+  /** @brief directory holding the binaries, with a trailing separator */
+  char* directory;
+  /** @brief GL vendor, renderer and version, mixed into every key */
+  char* device;
+  /** @brief false if the driver supports no binary formats */
+  bool enabled;
+
+  slsShaderCacheStats stats;
+} slsShaderCache;
+
+/**
+ * @brief a program requested from the cache: either loaded from a binary
+ * and ready at once, or compiled asynchronously and stored once it links
+ */
+typedef struct slsShaderCacheBuild {
+  slsProgramBuild build;
+  uint64_t key;
+  /** @brief compiled from source, not yet stored or counted as a miss */
+  bool missed;
+  double start;
+} slsShaderCacheBuild;
+
+/**
+ * @brief creates a cache for the current GL context.
+ * @param directory_opt where to store binaries. If NULL, a `shadercache`
+ * directory in SDL's per-user preference path is used.
+ */
+slsShaderCache* sls_shadercache_init(slsShaderCache* self,
+                                     char const* directory_opt)
+  SLS_NONNULL(1);
+
+slsShaderCache* sls_shadercache_dtor(slsShaderCache* self) SLS_NONNULL(1);
+
+/**
+ * @brief key identifying a program built from the given sources on this
+ * device
+ */
+uint64_t sls_shadercache_key(slsShaderCache const* self,
+                             char const* vs_source,
+                             char const* fs_source,
+                             char const* uniforms) SLS_NONNULL(1, 2, 3, 4);
+
+/**
+ * @brief loads the program from its cached binary if one matches, otherwise
+ * submits it with sls_program_build_submit without waiting on the driver.
+ * @detail Poll or wait on the result with sls_shadercache_poll/wait rather
+ * than on `pending->build` directly, so misses get stored. The program is
+ * owned by `pending->build`.
+ */
+slsShaderCacheBuild* sls_shadercache_submit(slsShaderCache* self,
+                                            slsShaderCacheBuild* pending,
+                                            char const* vs_source,
+                                            char const* fs_source,
+                                            char const* uniforms)
+  SLS_NONNULL(1, 2, 3, 4, 5);
+
+/**
+ * @brief checks whether a submitted program finished, storing its binary
+ * the first time a miss is found ready
+ */
+slsProgramStatus sls_shadercache_poll(slsShaderCache* self,
+                                      slsShaderCacheBuild* pending)
+  SLS_NONNULL(1, 2);
+
+/**
+ * @brief blocks until a submitted program finishes, then stores it like
+ * sls_shadercache_poll
+ */
+slsProgramStatus sls_shadercache_wait(slsShaderCache* self,
+                                      slsShaderCacheBuild* pending)
+  SLS_NONNULL(1, 2);
+
+/**
+ * @brief drop-in replacement for sls_create_program: submits the program
+ * and waits on it.
+ * @return the linked program, or 0 if compilation failed
+ */
+GLuint sls_shadercache_program(slsShaderCache* self,
+                               char const* vs_source,
+                               char const* fs_source,
+                               char const* uniforms) SLS_NONNULL(1, 2, 3, 4);
+
+/**
+ * @brief logs hit/miss counts with warm (cached) and cold (compiled)
+ * timings
+ */
+void sls_shadercache_log_stats(slsShaderCache const* self) SLS_NONNULL(1);
+
+SLS_END_CDECLS
+
+#endif // DANGERENGINE_SLSSHADERCACHE_H
@@ -0,0 +1,393 @@
+/**
+ * @file slsshaderlib.c
+ * @brief
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#include "slsshaderlib.h"
+#include "shaderutils.h"
+#include "slsshader.h"
+#include <ctype.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <slsutils.h>
+#include <string.h>
+
+static const slsCallbackTable sls_shaderlib_string_keys = {
+  .copy_fn = sls_copy_string, .free_fn = free, .cmp_fn = sls_cmp_string
+};
+
+/*================================
+ * growable text buffer
+ *================================*/
+
+typedef struct slsTextBuffer {
+  char* data;
+  size_t length;
+  size_t capacity;
+} slsTextBuffer;
+
+static bool sls_textbuffer_append(slsTextBuffer* self,
+                                  char const* text,
+                                  size_t length)
+{
+  if (self->length + length + 1 > self->capacity) {
+    size_t capacity = self->capacity ? self->capacity : 256;
+    while (self->length + length + 1 > capacity) {
+      capacity *= 2;
+    }
+    char* data = realloc(self->data, capacity);
+    if (!data) {
+      return false;
+    }
+    self->data = data;
+    self->capacity = capacity;
+  }
+
+  memcpy(self->data + self->length, text, length);
+  self->length += length;
+  self->data[self->length] = '\0';
+  return true;
+}
+
+static bool sls_textbuffer_appendf(slsTextBuffer* self, char const* fmt, ...)
+{
+  char line[256];
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(line, sizeof(line), fmt, args);
+  va_end(args);
+
+  return n >= 0 && (size_t)n < sizeof(line) &&
+         sls_textbuffer_append(self, line, (size_t)n);
+}
+
+/*================================
+ * library
+ *================================*/
+
+slsShaderLibrary* sls_shaderlib_init(slsShaderLibrary* self,
+                                     char const* include_dir_opt,
+                                     slsShaderCache* cache_opt)
+{
+  *self = (slsShaderLibrary){.cache = cache_opt };
+
+  slsCallbackTable owned_text = {.copy_fn = sls_copy_string,
+                                 .free_fn = free,
+                                 .cmp_fn = sls_cmp_string };
+
+  sls_checkmem(sls_hashtable_init(&self->includes,
+                                  16,
+                                  sls_hash_fn_default,
+                                  &sls_shaderlib_string_keys,
+                                  &owned_text));
+  sls_checkmem(sls_hashtable_init(&self->permutations,
+                                  32,
+                                  sls_hash_fn_default,
+                                  &sls_shaderlib_string_keys,
+                                  NULL));
+  sls_checkmem(sls_hashtable_init(&self->programs,
+                                  32,
+                                  sls_hash_fn_default,
+                                  &sls_shaderlib_string_keys,
+                                  NULL));
+
+  if (include_dir_opt) {
+    self->include_dir = sls_copy_string(include_dir_opt);
+    sls_checkmem(self->include_dir);
+  }
+
+  return self;
+error:
+  return sls_shaderlib_dtor(self);
+}
+
+slsShaderLibrary* sls_shaderlib_dtor(slsShaderLibrary* self)
+{
+  if (self->programs.keys) {
+    slsHashItor itor;
+    for (slsHashItor* i = sls_hashitor_first(&self->programs, &itor); i;
+         i = sls_hashitor_next(i)) {
+      glDeleteProgram((GLuint)(uintptr_t)*i->val);
+    }
+  }
+
+  if (self->includes.keys) {
+    sls_hashtable_dtor(&self->includes);
+  }
+  if (self->permutations.keys) {
+    sls_hashtable_dtor(&self->permutations);
+  }
+  if (self->programs.keys) {
+    sls_hashtable_dtor(&self->programs);
+  }
+  free(self->include_dir);
+
+  *self = (slsShaderLibrary){};
+  return self;
+}
+
+void sls_shaderlib_add_include(slsShaderLibrary* self,
+                               char const* name,
+                               char const* source)
+{
+  sls_hashtable_insert(&self->includes, name, SLS_STRING_LENGTH, source);
+}
+
+/**
+ * @brief if `line` is an include directive, copies the included name to
+ * `name_out`
+ */
+static bool sls_shaderlib_parse_include(char const* line,
+                                        size_t length,
+                                        char* name_out,
+                                        size_t name_size)
+{
+  char const* end = line + length;
+  char const* p = line;
+
+  while (p < end && isspace((unsigned char)*p)) {
+    ++p;
+  }
+  if (p == end || *p++ != '#') {
+    return false;
+  }
+  while (p < end && isspace((unsigned char)*p)) {
+    ++p;
+  }
+
+  static const char directive[] = "include";
+  const size_t directive_len = sizeof(directive) - 1;
+  if ((size_t)(end - p) < directive_len ||
+      strncmp(p, directive, directive_len) != 0) {
+    return false;
+  }
+  p += directive_len;
+  while (p < end && isspace((unsigned char)*p)) {
+    ++p;
+  }
+
+  if (p == end || (*p != '"' && *p != '<')) {
+    return false;
+  }
+  char close = *p == '"' ? '"' : '>';
+  char const* name = ++p;
+  while (p < end && *p != close) {
+    ++p;
+  }
+  size_t name_len = (size_t)(p - name);
+  if (p == end || name_len == 0 || name_len >= name_size) {
+    return false;
+  }
+
+  memcpy(name_out, name, name_len);
+  name_out[name_len] = '\0';
+  return true;
+}
+
+/**
+ * @brief looks an include up in the registry, then the include directory
+ * @return heap-allocated source, or NULL
+ */
+static char* sls_shaderlib_load_include(slsShaderLibrary* self,
+                                        char const* name)
+{
+  char const* registered =
+    sls_hashtable_find(&self->includes, name, SLS_STRING_LENGTH);
+  if (registered) {
+    return sls_copy_string(registered);
+  }
+
+  if (!self->include_dir) {
+    return NULL;
+  }
+
+  size_t path_size = strlen(self->include_dir) + strlen(name) + 2;
+  char* path = malloc(path_size);
+  if (!path) {
+    return NULL;
+  }
+  snprintf(path, path_size, "%s/%s", self->include_dir, name);
+  char* source = sls_file_read(path);
+  free(path);
+
+  return source;
+}
+
+static bool sls_shaderlib_resolve(slsShaderLibrary* self,
+                                  slsTextBuffer* out,
+                                  char const* source,
+                                  size_t depth)
+{
+  sls_check(depth < SLS_SHADER_MAX_INCLUDE_DEPTH,
+            "shader includes nested deeper than %d levels, recursive include?",
+            SLS_SHADER_MAX_INCLUDE_DEPTH);
+
+  size_t line_number = 1;
+  char const* line = source;
+
+  while (*line) {
+    char const* eol = strchr(line, '\n');
+    size_t length = eol ? (size_t)(eol - line) : strlen(line);
+    char name[256];
+
+    if (sls_shaderlib_parse_include(line, length, name, sizeof(name))) {
+      char* included = sls_shaderlib_load_include(self, name);
+      sls_check(included, "shader include \"%s\" not found", name);
+
+      bool ok = sls_textbuffer_append(out, "#line 1\n", 8) &&
+                sls_shaderlib_resolve(self, out, included, depth + 1);
+      free(included);
+      sls_check(ok, "failed resolving shader include \"%s\"", name);
+
+      // restore line numbering of the including file
+      sls_check(sls_textbuffer_appendf(out, "#line %lu\n", line_number + 1),
+                "memory error");
+    } else {
+      sls_check(sls_textbuffer_append(out, line, length) &&
+                  sls_textbuffer_append(out, "\n", 1),
+                "memory error");
+    }
+
+    if (!eol) {
+      break;
+    }
+    line = eol + 1;
+    ++line_number;
+  }
+
+  return true;
+error:
+  return false;
+}
+
+/**
+ * @return true if `name` appears in `text` as a whole identifier
+ */
+static bool sls_shaderlib_mentions(char const* text, char const* name)
+{
+  size_t length = strlen(name);
+  for (char const* p = strstr(text, name); p; p = strstr(p + 1, name)) {
+    bool starts = p == text || !(isalnum((unsigned char)p[-1]) || p[-1] == '_');
+    bool ends = !(isalnum((unsigned char)p[length]) || p[length] == '_');
+    if (starts && ends) {
+      return true;
+    }
+  }
+  return false;
+}
+
+char* sls_shaderlib_preprocess(slsShaderLibrary* self,
+                               char const* source,
+                               char const* const* features,
+                               size_t n_features,
+                               uint32_t mask,
+                               uint64_t* hash_out_opt)
+{
+  slsTextBuffer body = {};
+  slsTextBuffer out = {};
+  // the text minus the defines it never mentions, which cannot change
+  // what it compiles to
+  slsTextBuffer hashed = {};
+
+  sls_check(sls_textbuffer_append(&body, "#line 1\n", 8), "memory error");
+  sls_check(sls_shaderlib_resolve(self, &body, source, 0),
+            "could not preprocess shader");
+
+  for (size_t i = 0; i < n_features && i < SLS_SHADER_MAX_FEATURES; ++i) {
+    if (!(mask & (UINT32_C(1) << i))) {
+      continue;
+    }
+    sls_check(sls_textbuffer_appendf(&out, "#define %s 1\n", features[i]),
+              "could not emit define for %s",
+              features[i]);
+    if (hash_out_opt && sls_shaderlib_mentions(body.data, features[i])) {
+      sls_check(sls_textbuffer_appendf(&hashed, "#define %s 1\n", features[i]),
+                "memory error");
+    }
+  }
+  sls_check(sls_textbuffer_append(&out, body.data, body.length),
+            "memory error");
+
+  if (hash_out_opt) {
+    sls_check(sls_textbuffer_append(&hashed, body.data, body.length),
+              "memory error");
+    *hash_out_opt = sls_hash_sizeddata(hashed.data, hashed.length);
+  }
+
+  free(body.data);
+  free(hashed.data);
+  return out.data;
+error:
+  free(body.data);
+  free(hashed.data);
+  free(out.data);
+  return NULL;
+}
+
+GLuint sls_shaderlib_program(slsShaderLibrary* self,
+                             slsShaderDesc const* desc,
+                             uint32_t mask)
+{
+  GLuint program = 0;
+  char* vs = NULL;
+  char* fs = NULL;
+  char key[320];
+
+  size_t n_features = desc->n_features < SLS_SHADER_MAX_FEATURES
+                        ? desc->n_features
+                        : SLS_SHADER_MAX_FEATURES;
+  if (n_features < SLS_SHADER_MAX_FEATURES) {
+    mask &= (UINT32_C(1) << n_features) - 1;
+  }
+
+  snprintf(key, sizeof(key), "%s#%08" PRIx32, desc->name, mask);
+  void* found = sls_hashtable_find(&self->permutations, key, SLS_STRING_LENGTH);
+  if (found) {
+    return (GLuint)(uintptr_t)found;
+  }
+
+  char const* uniforms = desc->uniforms ? desc->uniforms : SLS_DEFAULT_UNIFORMS;
+  uint64_t vs_hash = 0, fs_hash = 0;
+  vs = sls_shaderlib_preprocess(
+    self, desc->vs_source, desc->features, n_features, mask, &vs_hash);
+  fs = sls_shaderlib_preprocess(
+    self, desc->fs_source, desc->features, n_features, mask, &fs_hash);
+  sls_check(vs && fs, "could not preprocess %s", key);
+
+  // permutations differing only in features the sources never mention
+  // share a program
+  char text_key[64];
+  snprintf(text_key,
+           sizeof(text_key),
+           "%016" PRIx64 "%016" PRIx64 "%016" PRIx64,
+           vs_hash,
+           fs_hash,
+           sls_hash_cstr(uniforms));
+  found = sls_hashtable_find(&self->programs, text_key, SLS_STRING_LENGTH);
+
+  if (found) {
+    program = (GLuint)(uintptr_t)found;
+    self->n_deduplicated++;
+  } else {
+    program = self->cache
+                ? sls_shadercache_program(self->cache, vs, fs, uniforms)
+                : sls_create_program(vs, fs, uniforms);
+    sls_check(program, "could not compile %s", key);
+    self->n_compiled++;
+    sls_hashtable_insert(&self->programs,
+                         text_key,
+                         SLS_STRING_LENGTH,
+                         (void*)(uintptr_t)program);
+  }
+
+  sls_hashtable_insert(
+    &self->permutations, key, SLS_STRING_LENGTH, (void*)(uintptr_t)program);
+
+error:
+  free(vs);
+  free(fs);
+  return program;
+}
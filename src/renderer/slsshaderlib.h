@@ -0,0 +1,114 @@
+/**
+ * @file slsshaderlib.h
+ * @brief shader source preprocessing and a cache of compiled permutations
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#ifndef DANGERENGINE_SLSSHADERLIB_H
+#define DANGERENGINE_SLSSHADERLIB_H
+
+#include "../data-types/hashtable.h"
+#include "../sls-gl.h"
+#include "slsshadercache.h"
+#include <slsmacros.h>
+#include <stdint.h>
+
+SLS_BEGIN_CDECLS
+
+/**
+ * @brief maximum number of feature flags a shader can declare
+ */
+#define SLS_SHADER_MAX_FEATURES 32
+
+/**
+ * @brief maximum `#include` nesting depth
+ */
+#define SLS_SHADER_MAX_INCLUDE_DEPTH 16
+
+/**
+ * @brief a vertex/fragment program with optional features. Feature i is
+ * enabled by bit i of a variant mask, which emits `#define <feature> 1`
+ * ahead of both sources.
+ */
+typedef struct slsShaderDesc {
+  /** @brief unique name, part of the permutation key */
+  char const* name;
+  char const* vs_source;
+  char const* fs_source;
+  /** @brief uniform definitions, SLS_DEFAULT_UNIFORMS if NULL */
+  char const* uniforms;
+
+  char const* const* features;
+  size_t n_features;
+} slsShaderDesc;
+
+typedef struct slsShaderLibrary {
+  /** @brief include name -> source text registered in memory */
+  slsHashTable includes;
+  /** @brief directory searched for includes not registered, or NULL */
+  char* include_dir;
+
+  /** @brief (name, mask) -> program */
+  slsHashTable permutations;
+  /** @brief hash of resolved source text -> program */
+  slsHashTable programs;
+
+  /** @brief optional binary cache used when compiling */
+  slsShaderCache* cache;
+
+  size_t n_compiled;
+  size_t n_deduplicated;
+} slsShaderLibrary;
+
+/**
+ * @param include_dir_opt directory for `#include` lookups on disk
+ * @param cache_opt if given, programs are built through the binary cache
+ */
+slsShaderLibrary* sls_shaderlib_init(slsShaderLibrary* self,
+                                     char const* include_dir_opt,
+                                     slsShaderCache* cache_opt)
+  SLS_NONNULL(1);
+
+/**
+ * @brief deletes every program the library compiled
+ */
+slsShaderLibrary* sls_shaderlib_dtor(slsShaderLibrary* self) SLS_NONNULL(1);
+
+/**
+ * @brief registers source text for `#include "name"`, taking precedence
+ * over files in the include directory
+ */
+void sls_shaderlib_add_include(slsShaderLibrary* self,
+                               char const* name,
+                               char const* source) SLS_NONNULL(1, 2, 3);
+
+/**
+ * @brief resolves `#include "name"` lines recursively and prefixes the
+ * defines selected by `mask`.
+ * @param hash_out_opt receives a hash of the resolved text, leaving out
+ * the defines of features it never mentions, as they cannot change it
+ * @return heap-allocated text, or NULL if an include could not be resolved
+ */
+char* sls_shaderlib_preprocess(slsShaderLibrary* self,
+                               char const* source,
+                               char const* const* features,
+                               size_t n_features,
+                               uint32_t mask,
+                               uint64_t* hash_out_opt) SLS_NONNULL(1, 2);
+
+/**
+ * @brief the program for one permutation of `desc`, compiling it on first
+ * use. Permutations whose resolved sources are identical, apart from
+ * defines of features neither source mentions, share a program.
+ * Mask bits past desc->n_features are ignored.
+ * @return the program, or 0 on failure. Owned by the library.
+ */
+GLuint sls_shaderlib_program(slsShaderLibrary* self,
+                             slsShaderDesc const* desc,
+                             uint32_t mask) SLS_NONNULL(1, 2);
+
+SLS_END_CDECLS
+
+#endif // DANGERENGINE_SLSSHADERLIB_H
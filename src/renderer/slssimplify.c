@@ -0,0 +1,620 @@
+/**
+ * @file slssimplify.c
+ * @brief
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#include "slssimplify.h"
+#include "slsmeshopt.h"
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief squared cosine of the largest turn a collapse may give a face
+ */
+#define SLS_SIMPLIFY_MIN_COS2 0.25f
+
+/**
+ * @brief symmetric 4x4 quadric, sum of squared distances to planes, and
+ * the total weight of the planes
+ */
+typedef struct slsQuadric {
+  double a00, a01, a02, a11, a12, a22;
+  double b0, b1, b2;
+  double c;
+  double weight;
+} slsQuadric;
+
+static void sls_quadric_add(slsQuadric* q, slsQuadric const* other)
+{
+  double* dst = &q->a00;
+  double const* src = &other->a00;
+  for (size_t k = 0; k < sizeof(slsQuadric) / sizeof(double); ++k) {
+    dst[k] += src[k];
+  }
+}
+
+static double sls_quadric_error(slsQuadric const* q, float const* p)
+{
+  double x = p[0], y = p[1], z = p[2];
+  double e = q->a00 * x * x + q->a11 * y * y + q->a22 * z * z +
+             2.0 * (q->a01 * x * y + q->a02 * x * z + q->a12 * y * z) +
+             2.0 * (q->b0 * x + q->b1 * y + q->b2 * z) + q->c;
+  return e > 0.0 ? e : 0.0;
+}
+
+static kmVec3 sls_simplify_normal(float const* p0,
+                                  float const* p1,
+                                  float const* p2)
+{
+  kmVec3 u = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+  kmVec3 v = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+  return (kmVec3){ u.y * v.z - u.z * v.y,
+                   u.z * v.x - u.x * v.z,
+                   u.x * v.y - u.y * v.x };
+}
+
+/**
+ * @brief the plane of a triangle, weighted by its area
+ */
+static slsQuadric sls_quadric_triangle(float const* p0,
+                                       float const* p1,
+                                       float const* p2)
+{
+  kmVec3 n = sls_simplify_normal(p0, p1, p2);
+  double len = sqrt((double)n.x * n.x + (double)n.y * n.y + (double)n.z * n.z);
+  if (len <= 0.0) {
+    return (slsQuadric){};
+  }
+  double nx = n.x / len, ny = n.y / len, nz = n.z / len;
+  double d = -(nx * p0[0] + ny * p0[1] + nz * p0[2]);
+  double w = 0.5 * len;
+  return (slsQuadric){ w * nx * nx, w * nx * ny, w * nx * nz, w * ny * ny,
+                       w * ny * nz, w * nz * nz, w * nx * d,  w * ny * d,
+                       w * nz * d,  w * d * d,   w };
+}
+
+/*----------------------------------------*
+ * vertex classification
+ *----------------------------------------*/
+
+typedef struct slsPositionKey {
+  float p[3];
+  uint32_t index;
+} slsPositionKey;
+
+static int sls_position_cmp(void const* lhs, void const* rhs)
+{
+  slsPositionKey const* a = lhs;
+  slsPositionKey const* b = rhs;
+  for (int k = 0; k < 3; ++k) {
+    if (a->p[k] != b->p[k]) {
+      return a->p[k] < b->p[k] ? -1 : 1;
+    }
+  }
+  return a->index < b->index ? -1 : a->index > b->index;
+}
+
+static int sls_edge_cmp(void const* lhs, void const* rhs)
+{
+  uint64_t a = *(uint64_t const*)lhs, b = *(uint64_t const*)rhs;
+  return a < b ? -1 : a > b;
+}
+
+/**
+ * @return whether two vertices at one position differ in anything drawn
+ */
+static bool sls_simplify_split(slsVertex const* a, slsVertex const* b)
+{
+  return memcmp(a->normal, b->normal, sizeof(a->normal)) != 0 ||
+         memcmp(a->uv, b->uv, sizeof(a->uv)) != 0 ||
+         memcmp(a->color, b->color, sizeof(a->color)) != 0;
+}
+
+/**
+ * @brief flags the vertices that must not move: copies of a position that
+ * differ in normal, uv or color, and vertices on an edge used by one
+ * triangle. Copies that are identical are welded instead, `weld` mapping
+ * each onto one of them, so they move together.
+ */
+static bool sls_simplify_lock(bool* locked,
+                              uint32_t* weld,
+                              uint32_t const* indices,
+                              size_t n_indices,
+                              slsVertex const* vertices,
+                              size_t n_vertices)
+{
+  slsPositionKey* keys = malloc((n_vertices + 1) * sizeof(*keys));
+  uint32_t* canonical = malloc((n_vertices + 1) * sizeof(uint32_t));
+  uint64_t* edges = malloc((n_indices + 1) * sizeof(uint64_t));
+  bool ok = keys && canonical && edges;
+  if (!ok) {
+    goto done;
+  }
+
+  for (size_t i = 0; i < n_vertices; ++i) {
+    keys[i] = (slsPositionKey){.index = (uint32_t)i };
+    memcpy(keys[i].p, vertices[i].position, sizeof(keys[i].p));
+  }
+  qsort(keys, n_vertices, sizeof(*keys), sls_position_cmp);
+  for (size_t group = 0, end; group < n_vertices; group = end) {
+    uint32_t first = keys[group].index;
+    bool seam = false;
+    end = group + 1;
+    while (end < n_vertices &&
+           memcmp(keys[end].p, keys[group].p, sizeof(keys[end].p)) == 0) {
+      seam |= sls_simplify_split(vertices + first, vertices + keys[end].index);
+      end++;
+    }
+    for (size_t i = group; i < end; ++i) {
+      uint32_t v = keys[i].index;
+      canonical[v] = first;
+      weld[v] = seam ? v : first;
+      locked[v] = seam;
+    }
+  }
+
+  // edges between positions, so seams are not mistaken for borders
+  for (size_t t = 0; t < n_indices; t += 3) {
+    for (int k = 0; k < 3; ++k) {
+      uint64_t a = canonical[indices[t + k]];
+      uint64_t b = canonical[indices[t + (k + 1) % 3]];
+      edges[t + k] = a << 32 | b;
+    }
+  }
+  qsort(edges, n_indices, sizeof(uint64_t), sls_edge_cmp);
+  for (size_t e = 0; e < n_indices; ++e) {
+    uint64_t opposite = edges[e] << 32 | edges[e] >> 32;
+    if (!bsearch(&opposite, edges, n_indices, sizeof(uint64_t), sls_edge_cmp)) {
+      locked[edges[e] >> 32] = true;
+      locked[edges[e] & UINT32_MAX] = true;
+    }
+  }
+
+done:
+  free(keys);
+  free(canonical);
+  free(edges);
+  return ok;
+}
+
+/*----------------------------------------*
+ * simplification
+ *----------------------------------------*/
+
+typedef struct slsCollapse {
+  float cost;
+  uint32_t from;
+  uint32_t to;
+} slsCollapse;
+
+static int sls_collapse_cmp(void const* lhs, void const* rhs)
+{
+  slsCollapse const* a = lhs;
+  slsCollapse const* b = rhs;
+  if (a->cost != b->cost) {
+    return a->cost < b->cost ? -1 : 1;
+  }
+  // ties in a fixed order, so results do not depend on qsort
+  if (a->from != b->from) {
+    return a->from < b->from ? -1 : 1;
+  }
+  return a->to < b->to ? -1 : a->to > b->to;
+}
+
+static void sls_simplify_bounds(uint32_t const* indices,
+                                size_t n_indices,
+                                slsVertex const* vertices,
+                                kmVec3* center,
+                                float* radius)
+{
+  float lo[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+  float hi[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+  for (size_t i = 0; i < n_indices; ++i) {
+    float const* p = vertices[indices[i]].position;
+    for (int k = 0; k < 3; ++k) {
+      lo[k] = p[k] < lo[k] ? p[k] : lo[k];
+      hi[k] = p[k] > hi[k] ? p[k] : hi[k];
+    }
+  }
+  *center = n_indices ? (kmVec3){ 0.5f * (lo[0] + hi[0]),
+                                  0.5f * (lo[1] + hi[1]),
+                                  0.5f * (lo[2] + hi[2]) }
+                      : (kmVec3){ 0.f, 0.f, 0.f };
+  float r2 = 0.f;
+  for (size_t i = 0; i < n_indices; ++i) {
+    float const* p = vertices[indices[i]].position;
+    float dx = p[0] - center->x, dy = p[1] - center->y, dz = p[2] - center->z;
+    float d2 = dx * dx + dy * dy + dz * dz;
+    r2 = d2 > r2 ? d2 : r2;
+  }
+  *radius = sqrtf(r2);
+}
+
+/**
+ * @brief state of one simplification, rebuilt adjacency included
+ */
+typedef struct slsSimplifier {
+  slsVertex const* vertices;
+  size_t n_vertices;
+  uint32_t* indices;
+  size_t n_indices;
+
+  bool* locked;
+  slsQuadric* quadrics;
+  /** @brief triangles around each vertex, as offsets into `triangles` */
+  uint32_t* first_triangle;
+  uint32_t* triangles;
+  uint32_t* collapse_to;
+  bool* touched;
+  slsCollapse* candidates;
+} slsSimplifier;
+
+static void sls_simplifier_adjacency(slsSimplifier* s)
+{
+  size_t n_triangles = s->n_indices / 3;
+  memset(s->first_triangle, 0, (s->n_vertices + 1) * sizeof(uint32_t));
+  for (size_t i = 0; i < s->n_indices; ++i) {
+    s->first_triangle[s->indices[i] + 1]++;
+  }
+  for (size_t v = 0; v < s->n_vertices; ++v) {
+    s->first_triangle[v + 1] += s->first_triangle[v];
+  }
+  // filling from the back walks each list's end down to its start, which
+  // belongs one slot lower
+  for (size_t t = n_triangles; t-- > 0;) {
+    for (int k = 2; k >= 0; --k) {
+      uint32_t v = s->indices[3 * t + (size_t)k];
+      s->triangles[--s->first_triangle[v + 1]] = (uint32_t)t;
+    }
+  }
+  memmove(s->first_triangle,
+          s->first_triangle + 1,
+          s->n_vertices * sizeof(uint32_t));
+  s->first_triangle[s->n_vertices] = (uint32_t)s->n_indices;
+}
+
+/**
+ * @return the cost of moving `from` onto `to`: the mean squared distance
+ * of `to` from both vertices' planes
+ */
+static float sls_simplifier_cost(slsSimplifier const* s,
+                                 uint32_t from,
+                                 uint32_t to)
+{
+  slsQuadric q = s->quadrics[from];
+  sls_quadric_add(&q, s->quadrics + to);
+  if (q.weight <= 0.0) {
+    return 0.f;
+  }
+  return (float)(sls_quadric_error(&q, s->vertices[to].position) / q.weight);
+}
+
+/**
+ * @brief checks no triangle around `from` would flip when it moves to
+ * `to`
+ * @return the number of triangles the collapse removes, or -1 if one flips
+ */
+static int sls_simplifier_check(slsSimplifier const* s,
+                                uint32_t from,
+                                uint32_t to)
+{
+  int n_removed = 0;
+  for (uint32_t k = s->first_triangle[from]; k < s->first_triangle[from + 1];
+       ++k) {
+    uint32_t const* tri = s->indices + 3 * (size_t)s->triangles[k];
+    if (tri[0] == to || tri[1] == to || tri[2] == to) {
+      n_removed++;
+      continue;
+    }
+    float const* before[3];
+    float const* after[3];
+    for (int c = 0; c < 3; ++c) {
+      before[c] = s->vertices[tri[c]].position;
+      after[c] = s->vertices[tri[c] == from ? to : tri[c]].position;
+    }
+    kmVec3 n0 = sls_simplify_normal(before[0], before[1], before[2]);
+    kmVec3 n1 = sls_simplify_normal(after[0], after[1], after[2]);
+    // turning a face far from where it was folds it over its neighbours
+    float dot = n0.x * n1.x + n0.y * n1.y + n0.z * n1.z;
+    float len2 = (n0.x * n0.x + n0.y * n0.y + n0.z * n0.z) *
+                 (n1.x * n1.x + n1.y * n1.y + n1.z * n1.z);
+    if (dot <= 0.f || dot * dot < SLS_SIMPLIFY_MIN_COS2 * len2) {
+      return -1;
+    }
+  }
+  return n_removed;
+}
+
+/**
+ * @brief marks the vertices of every triangle around `v`
+ */
+static void sls_simplifier_touch(slsSimplifier* s, uint32_t v)
+{
+  for (uint32_t k = s->first_triangle[v]; k < s->first_triangle[v + 1]; ++k) {
+    uint32_t const* tri = s->indices + 3 * (size_t)s->triangles[k];
+    s->touched[tri[0]] = s->touched[tri[1]] = s->touched[tri[2]] = true;
+  }
+}
+
+/**
+ * @brief makes the cheapest independent collapses, until `needed`
+ * triangles would be removed
+ * @return the number of collapses, 0 when none is possible
+ */
+static size_t sls_simplifier_pass(slsSimplifier* s,
+                                  size_t needed,
+                                  float limit,
+                                  float* max_cost)
+{
+  sls_simplifier_adjacency(s);
+
+  size_t n_candidates = 0;
+  for (size_t i = 0; i < s->n_indices; ++i) {
+    uint32_t a = s->indices[i];
+    uint32_t b = s->indices[i - i % 3 + (i + 1) % 3];
+    uint32_t ends[2][2] = { { a, b }, { b, a } };
+    for (int k = 0; k < 2; ++k) {
+      if (s->locked[ends[k][0]]) {
+        continue;
+      }
+      float cost = sls_simplifier_cost(s, ends[k][0], ends[k][1]);
+      if (cost <= limit) {
+        s->candidates[n_candidates++] =
+          (slsCollapse){ cost, ends[k][0], ends[k][1] };
+      }
+    }
+  }
+  qsort(s->candidates, n_candidates, sizeof(slsCollapse), sls_collapse_cmp);
+
+  memset(s->touched, 0, s->n_vertices * sizeof(bool));
+  size_t n_collapses = 0, n_removed = 0;
+  for (size_t c = 0; c < n_candidates && n_removed < needed; ++c) {
+    slsCollapse const* collapse = s->candidates + c;
+    if (s->touched[collapse->from] || s->touched[collapse->to]) {
+      continue;
+    }
+    int removed = sls_simplifier_check(s, collapse->from, collapse->to);
+    if (removed < 0) {
+      continue;
+    }
+    sls_simplifier_touch(s, collapse->from);
+    s->collapse_to[collapse->from] = collapse->to;
+    sls_quadric_add(s->quadrics + collapse->to,
+                    s->quadrics + collapse->from);
+    *max_cost = collapse->cost > *max_cost ? collapse->cost : *max_cost;
+    n_removed += (size_t)removed;
+    n_collapses++;
+  }
+  if (n_collapses == 0) {
+    return 0;
+  }
+
+  // move the collapsed vertices and drop the triangles that vanish
+  size_t n_kept = 0;
+  for (size_t t = 0; t < s->n_indices; t += 3) {
+    uint32_t tri[3];
+    for (int k = 0; k < 3; ++k) {
+      tri[k] = s->collapse_to[s->indices[t + (size_t)k]];
+    }
+    if (tri[0] == tri[1] || tri[1] == tri[2] || tri[2] == tri[0]) {
+      continue;
+    }
+    memcpy(s->indices + n_kept, tri, sizeof(tri));
+    n_kept += 3;
+  }
+  s->n_indices = n_kept;
+  return n_collapses;
+}
+
+size_t sls_simplify(uint32_t* dst,
+                    uint32_t const* indices,
+                    size_t n_indices,
+                    slsVertex const* vertices,
+                    size_t n_vertices,
+                    size_t target_indices,
+                    float max_error,
+                    float* error_out)
+{
+  n_indices -= n_indices % 3;
+  slsSimplifier s = {.vertices = vertices,
+                     .n_vertices = n_vertices,
+                     .n_indices = n_indices };
+  float max_cost = 0.f;
+  size_t result = 0;
+
+  s.indices = malloc((n_indices + 1) * sizeof(uint32_t));
+  s.locked = calloc(n_vertices + 1, sizeof(bool));
+  s.quadrics = calloc(n_vertices + 1, sizeof(slsQuadric));
+  s.first_triangle = malloc((n_vertices + 1) * sizeof(uint32_t));
+  s.triangles = malloc((n_indices + 1) * sizeof(uint32_t));
+  s.collapse_to = malloc((n_vertices + 1) * sizeof(uint32_t));
+  s.touched = malloc(n_vertices + 1);
+  s.candidates = malloc((2 * n_indices + 1) * sizeof(slsCollapse));
+  sls_checkmem(s.indices && s.locked && s.quadrics && s.first_triangle &&
+               s.triangles && s.collapse_to && s.touched && s.candidates);
+  // collapse_to holds the welds until the collapses start
+  sls_checkmem(sls_simplify_lock(
+    s.locked, s.collapse_to, indices, n_indices, vertices, n_vertices));
+  for (size_t i = 0; i < n_indices; ++i) {
+    s.indices[i] = s.collapse_to[indices[i]];
+  }
+
+  for (size_t t = 0; t < n_indices; t += 3) {
+    uint32_t const* tri = s.indices + t;
+    slsQuadric q = sls_quadric_triangle(vertices[tri[0]].position,
+                                        vertices[tri[1]].position,
+                                        vertices[tri[2]].position);
+    for (int k = 0; k < 3; ++k) {
+      sls_quadric_add(s.quadrics + tri[k], &q);
+    }
+  }
+  for (size_t v = 0; v < n_vertices; ++v) {
+    s.collapse_to[v] = (uint32_t)v;
+  }
+
+  kmVec3 center;
+  float radius;
+  sls_simplify_bounds(indices, n_indices, vertices, &center, &radius);
+  float limit = max_error * radius;
+  limit *= limit;
+
+  while (s.n_indices > target_indices) {
+    size_t needed = (s.n_indices - target_indices + 2) / 3;
+    if (sls_simplifier_pass(&s, needed, limit, &max_cost) == 0) {
+      break;
+    }
+  }
+
+  memcpy(dst, s.indices, s.n_indices * sizeof(uint32_t));
+  result = s.n_indices;
+  if (error_out) {
+    *error_out = radius > 0.f ? sqrtf(max_cost) / radius : 0.f;
+  }
+
+error:
+  free(s.indices);
+  free(s.locked);
+  free(s.quadrics);
+  free(s.first_triangle);
+  free(s.triangles);
+  free(s.collapse_to);
+  free(s.touched);
+  free(s.candidates);
+  return result;
+}
+
+/*----------------------------------------*
+ * levels of detail
+ *----------------------------------------*/
+
+bool sls_lodchain_build(slsLodChain* self,
+                        slsMesh* mesh,
+                        float const* ratios,
+                        int n_ratios,
+                        float max_error)
+{
+  *self = (slsLodChain){};
+  uint32_t* level = NULL;
+  size_t n_full = mesh->indices.length;
+  sls_check(mesh->has_shadow && !mesh->uploaded &&
+              mesh->gl_draw_mode == GL_TRIANGLES,
+            "levels of detail need a triangle mesh's CPU copy, before upload");
+
+  sls_simplify_bounds(mesh->indices.data,
+                      n_full,
+                      mesh->vertices.data,
+                      &self->center,
+                      &self->radius);
+  self->lods[0] = (slsMeshLod){.first_index = 0, .n_indices = n_full };
+  self->n_lods = 1;
+
+  for (int r = 0; r < n_ratios && self->n_lods < SLS_LOD_MAX; ++r) {
+    slsMeshLod const* prev = self->lods + self->n_lods - 1;
+    size_t target = (size_t)(ratios[r] * (float)(n_full / 3)) * 3;
+    if (target >= prev->n_indices) {
+      continue;
+    }
+
+    // each level simplifies the last, which is smaller than the full mesh
+    level = malloc((prev->n_indices + 1) * sizeof(uint32_t));
+    sls_checkmem(level);
+    float error = 0.f;
+    size_t n_indices = sls_simplify(level,
+                                    mesh->indices.data + prev->first_index,
+                                    prev->n_indices,
+                                    mesh->vertices.data,
+                                    mesh->vertices.length,
+                                    target,
+                                    max_error - prev->error,
+                                    &error);
+    sls_check(n_indices > 0, "could not simplify mesh");
+    // stop once the locked vertices or the error bound prevent progress
+    if (n_indices * 20 > prev->n_indices * 19) {
+      break;
+    }
+    sls_optimize_vertex_cache(
+      level, n_indices, mesh->vertices.length, SLS_VERTEX_CACHE_SIZE);
+
+    size_t first = mesh->indices.length;
+    uint32_t* all =
+      realloc(mesh->indices.data, (first + n_indices + 1) * sizeof(uint32_t));
+    sls_checkmem(all);
+    memcpy(all + first, level, n_indices * sizeof(uint32_t));
+    mesh->indices.data = all;
+    mesh->indices.length = first + n_indices;
+    free(level);
+    level = NULL;
+
+    self->lods[self->n_lods] = (slsMeshLod){.first_index = first,
+                                            .n_indices = n_indices,
+                                            .error = prev->error + error };
+    self->n_lods++;
+  }
+
+  free(level);
+  return true;
+error:
+  // drop the levels already appended, leaving the mesh as it was
+  mesh->indices.length = n_full;
+  *self = (slsLodChain){};
+  free(level);
+  return false;
+}
+
+float sls_lodchain_screen_radius(slsLodChain const* self,
+                                 kmMat4 const* modelview,
+                                 kmMat4 const* projection,
+                                 float viewport_height)
+{
+  float const* m = modelview->mat;
+  kmVec3 c = self->center;
+  float depth = -(m[2] * c.x + m[6] * c.y + m[10] * c.z + m[14]);
+
+  // the largest scale of the model's axes
+  float scale2 = 0.f;
+  for (int col = 0; col < 3; ++col) {
+    float const* axis = m + 4 * col;
+    float len2 = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+    scale2 = len2 > scale2 ? len2 : scale2;
+  }
+  float radius = self->radius * sqrtf(scale2);
+  if (depth <= radius) {
+    return FLT_MAX;
+  }
+  return radius * projection->mat[5] * 0.5f * viewport_height / depth;
+}
+
+int sls_lodchain_select(slsLodChain const* self,
+                        float screen_radius,
+                        float max_pixel_error)
+{
+  for (int lod = self->n_lods - 1; lod > 0; --lod) {
+    if (self->lods[lod].error * screen_radius <= max_pixel_error) {
+      return lod;
+    }
+  }
+  return 0;
+}
+
+void sls_lodchain_draw(slsLodChain const* self,
+                       slsMesh* mesh,
+                       int lod,
+                       slsStreamBuffer* stream_opt)
+{
+  lod = lod < 0 ? 0 : lod >= self->n_lods ? self->n_lods - 1 : lod;
+  slsMeshLod const* level = self->lods + lod;
+  sls_mesh_flush_updates(mesh, stream_opt);
+
+  glBindVertexArray(mesh->vao);
+  glDrawElements(
+    mesh->gl_draw_mode,
+    (GLsizei)level->n_indices,
+    mesh->index_type,
+    (void*)(uintptr_t)(level->first_index * sls_mesh_index_size(mesh)));
+  glBindVertexArray(0);
+}
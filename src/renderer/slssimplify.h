@@ -0,0 +1,113 @@
+/**
+ * @file slssimplify.h
+ * @brief quadric error mesh simplification, and chains of levels of detail
+ * chosen by projected size
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#ifndef DANGERENGINE_SLSSIMPLIFY_H
+#define DANGERENGINE_SLSSIMPLIFY_H
+
+#include "../sls-gl.h"
+#include "slsmesh.h"
+#include <kazmath/kazmath.h>
+#include <slsmacros.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+SLS_BEGIN_CDECLS
+
+#define SLS_LOD_MAX 8
+
+/**
+ * @brief simplifies a triangle list by collapsing edges, cheapest first by
+ * the quadric error metric (Garland & Heckbert, 1997).
+ * @detail Each collapse moves a vertex onto a neighbour, so the result
+ * indexes the same vertices. Copies of a position that differ in normal,
+ * uv or color, as at UV seams and color boundaries, and vertices on open
+ * borders never move, so seams and outlines are kept exactly. Identical
+ * copies are merged, and the result indexes one of them.
+ * @param dst room for n_indices indices; may alias `indices`
+ * @param target_indices stop once at most this many indices remain
+ * @param max_error stop before a collapse would move the surface further
+ * than this, relative to the mesh's bounding radius
+ * @param error_out optional, the largest error of a collapse made,
+ * relative to the bounding radius
+ * @return the number of indices written, or 0 when out of memory
+ */
+size_t sls_simplify(uint32_t* dst,
+                    uint32_t const* indices,
+                    size_t n_indices,
+                    slsVertex const* vertices,
+                    size_t n_vertices,
+                    size_t target_indices,
+                    float max_error,
+                    float* error_out) SLS_NONNULL(1, 2, 4);
+
+typedef struct slsMeshLod {
+  size_t first_index;
+  size_t n_indices;
+  /** @brief largest deviation from the full mesh, relative to radius */
+  float error;
+} slsMeshLod;
+
+/**
+ * @brief Levels of detail of a mesh, sharing its vertices.
+ * @detail Each level's indices follow the previous ones in the mesh's
+ * index array, so one index buffer holds the whole chain. Draw a level
+ * with sls_lodchain_draw: sls_mesh_draw would draw all of them.
+ */
+typedef struct slsLodChain {
+  slsMeshLod lods[SLS_LOD_MAX];
+  int n_lods;
+  /** @brief bounding sphere of the mesh, in model space */
+  kmVec3 center;
+  float radius;
+} slsLodChain;
+
+/**
+ * @brief simplifies a mesh to each of `ratios` of its triangles, appending
+ * the levels to its indices. Level 0 is the mesh as it was. The chain ends
+ * early when a level cannot be reduced further within max_error.
+ * @param mesh a triangle mesh with its CPU copy, not yet uploaded
+ * @param ratios decreasing fractions of the full triangle count
+ * @return false if the mesh cannot be simplified or memory ran out, with
+ * its indices as they were
+ */
+bool sls_lodchain_build(slsLodChain* self,
+                        slsMesh* mesh,
+                        float const* ratios,
+                        int n_ratios,
+                        float max_error) SLS_NONNULL(1, 2, 3);
+
+/**
+ * @brief radius of the mesh's bounding sphere on screen, in pixels, or
+ * FLT_MAX when the camera is inside it
+ */
+float sls_lodchain_screen_radius(slsLodChain const* self,
+                                 kmMat4 const* modelview,
+                                 kmMat4 const* projection,
+                                 float viewport_height) SLS_NONNULL(1, 2, 3);
+
+/**
+ * @brief the coarsest level whose error stays within `max_pixel_error` at
+ * the given screen radius
+ */
+int sls_lodchain_select(slsLodChain const* self,
+                        float screen_radius,
+                        float max_pixel_error) SLS_NONNULL(1);
+
+/**
+ * @brief flushes the mesh's pending updates and draws one level
+ */
+void sls_lodchain_draw(slsLodChain const* self,
+                       slsMesh* mesh,
+                       int lod,
+                       slsStreamBuffer* stream_opt) SLS_NONNULL(1, 2);
+
+SLS_END_CDECLS
+
+#endif // DANGERENGINE_SLSSIMPLIFY_H
@@ -64,8 +64,27 @@ slsSprite *sls_sprite_dtor(slsSprite *self)
 
 void sls_sprite_draw(slsSprite *self, slsRendererGL *renderer)
 {
+  if (self->texture) {
+    sls_texture_bind(self->texture, 0);
+  }
   glBindVertexArray(self->vao);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, self->vbo);
   glDrawElements(GL_POINTS, 6, GL_UNSIGNED_INT, 0);
   glBindVertexArray(0);
 }
+
+void sls_sprite_set_region(slsSprite *self, slsAtlasRegion const *region)
+{
+  kmVec2 lo = region->uv_min, hi = region->uv_max;
+  slsVertex2D verts[] = {
+      {.position={-0.5f, -0.5f, 0.0f}, .uv={lo.x, lo.y}},
+      {.position={0.5f, -0.5f, 0.0f}, .uv={hi.x, lo.y}},
+      {.position={0.5f, 0.5f, 0.0f}, .uv={hi.x, hi.y}},
+      {.position={-0.5f, 0.5f, 0.0f}, .uv={lo.x, hi.y}}
+  };
+
+  self->texture = region->texture;
+  glBindBuffer(GL_ARRAY_BUFFER, self->vbo);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(verts), verts);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -8,6 +8,8 @@
 
 #include "../sls-commonlibs.h"
 #include "slsrender.h"
+#include "slsatlas.h"
+#include "slstexture.h"
 
 typedef struct slsSprite slsSprite;
 typedef struct slsTransform2D slsTransform2D;
@@ -28,7 +30,8 @@ struct slsSprite {
   GLuint vbo;
   GLuint vao;
 
-  void *texture;
+  /** @brief optional, owned by a slsTextureLoader */
+  slsTexture *texture;
   slsTransform2D transform;
 };
 
@@ -37,4 +40,9 @@ slsSprite *sls_sprite_dtor(slsSprite *self);
 
 void sls_sprite_draw(slsSprite *self, slsRendererGL *renderer);
 
+/**
+ * @brief textures the sprite with an atlas region, rewriting its UVs
+ */
+void sls_sprite_set_region(slsSprite *self, slsAtlasRegion const *region);
+
 #endif // SLS_SPRITE_H
\ No newline at end of file
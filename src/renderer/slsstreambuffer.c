@@ -0,0 +1,168 @@
+/**
+ * @file slsstreambuffer.c
+ * @brief
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#include "slsstreambuffer.h"
+#include <slsutils.h>
+#include <string.h>
+
+static const GLuint64 sls_streambuffer_timeout = 1000000000; // 1 second
+
+/**
+ * @brief map/unmap through the copy-write binding, so streaming never
+ * disturbs the element buffer binding of the current VAO
+ */
+static const GLenum sls_streambuffer_map_target = GL_COPY_WRITE_BUFFER;
+
+slsStreamBuffer* sls_streambuffer_init(slsStreamBuffer* self,
+                                       size_t region_size)
+{
+  *self = (slsStreamBuffer){.region_size = (GLsizeiptr)region_size };
+  GLsizeiptr total = self->region_size * SLS_STREAM_BUFFER_REGIONS;
+  GLenum target = sls_streambuffer_map_target;
+
+  glGenBuffers(1, &self->buffer);
+  glBindBuffer(target, self->buffer);
+
+#ifndef __EMSCRIPTEN__
+  if (GLAD_GL_ARB_buffer_storage) {
+    GLbitfield flags =
+      GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(target, total, NULL, flags);
+    self->mapping = glMapBufferRange(target, 0, total, flags);
+    self->persistent = self->mapping != NULL;
+  }
+#endif
+
+  if (!self->persistent) {
+    glBufferData(target, total, NULL, GL_STREAM_DRAW);
+  }
+
+  glBindBuffer(target, 0);
+  sls_check(glIsBuffer(self->buffer), "could not create stream buffer");
+
+  return self;
+error:
+  return sls_streambuffer_dtor(self);
+}
+
+slsStreamBuffer* sls_streambuffer_dtor(slsStreamBuffer* self)
+{
+  for (size_t i = 0; i < SLS_STREAM_BUFFER_REGIONS; ++i) {
+    if (self->fences[i]) {
+      glDeleteSync(self->fences[i]);
+      self->fences[i] = NULL;
+    }
+  }
+
+  if (self->buffer) {
+    if (self->mapping) {
+      glBindBuffer(sls_streambuffer_map_target, self->buffer);
+      glUnmapBuffer(sls_streambuffer_map_target);
+      glBindBuffer(sls_streambuffer_map_target, 0);
+      self->mapping = NULL;
+    }
+    glDeleteBuffers(1, &self->buffer);
+    self->buffer = 0;
+  }
+
+  return self;
+}
+
+void sls_streambuffer_begin_frame(slsStreamBuffer* self)
+{
+  self->region = (self->region + 1) % SLS_STREAM_BUFFER_REGIONS;
+  self->cursor = 0;
+
+  GLsync fence = self->fences[self->region];
+  if (fence) {
+    GLenum res = glClientWaitSync(
+      fence, GL_SYNC_FLUSH_COMMANDS_BIT, sls_streambuffer_timeout);
+    if (res == GL_TIMEOUT_EXPIRED || res == GL_WAIT_FAILED) {
+      sls_log_warn("stream buffer: timed out waiting on region %lu",
+                   self->region);
+    }
+    glDeleteSync(fence);
+    self->fences[self->region] = NULL;
+  }
+}
+
+void sls_streambuffer_end_frame(slsStreamBuffer* self)
+{
+  if (self->fences[self->region]) {
+    glDeleteSync(self->fences[self->region]);
+  }
+  self->fences[self->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void* sls_streambuffer_alloc(slsStreamBuffer* self,
+                             size_t size,
+                             size_t alignment,
+                             GLintptr* offset_out)
+{
+  assert(!self->mapped && "sls_streambuffer_commit was not called");
+
+  const GLintptr region_start = (GLintptr)self->region * self->region_size;
+  const GLintptr a = alignment > 0 ? (GLintptr)alignment : 1;
+
+  // align the absolute offset: non power-of-two strides are allowed
+  GLintptr offset = (region_start + self->cursor + a - 1) / a * a;
+  if (offset + (GLintptr)size > region_start + self->region_size) {
+    sls_log_warn("stream buffer: region of %li bytes exhausted",
+                 (long)self->region_size);
+    return NULL;
+  }
+
+  self->cursor = offset + (GLintptr)size - region_start;
+  *offset_out = offset;
+
+  if (self->persistent) {
+    return self->mapping + offset;
+  }
+
+  GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+                      GL_MAP_UNSYNCHRONIZED_BIT;
+  glBindBuffer(sls_streambuffer_map_target, self->buffer);
+  void* ptr = glMapBufferRange(
+    sls_streambuffer_map_target, offset, (GLsizeiptr)size, access);
+  self->mapped = ptr != NULL;
+  if (!ptr) {
+    glBindBuffer(sls_streambuffer_map_target, 0);
+  }
+
+  return ptr;
+}
+
+void sls_streambuffer_commit(slsStreamBuffer* self)
+{
+  // persistent mappings are coherent: nothing to flush
+  if (!self->mapped) {
+    return;
+  }
+
+  glBindBuffer(sls_streambuffer_map_target, self->buffer);
+  glUnmapBuffer(sls_streambuffer_map_target);
+  glBindBuffer(sls_streambuffer_map_target, 0);
+  self->mapped = false;
+}
+
+GLintptr sls_streambuffer_write(slsStreamBuffer* self,
+                                void const* data,
+                                size_t size,
+                                size_t alignment)
+{
+  GLintptr offset = -1;
+  void* dst = sls_streambuffer_alloc(self, size, alignment, &offset);
+  if (!dst) {
+    return -1;
+  }
+
+  memcpy(dst, data, size);
+  sls_streambuffer_commit(self);
+
+  return offset;
+}
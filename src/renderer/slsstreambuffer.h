@@ -0,0 +1,104 @@
+/**
+ * @file slsstreambuffer.h
+ * @brief ring buffer for streaming per-frame dynamic data to the GPU
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#ifndef DANGERENGINE_SLSSTREAMBUFFER_H
+#define DANGERENGINE_SLSSTREAMBUFFER_H
+
+#include "../sls-gl.h"
+#include <slsmacros.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+SLS_BEGIN_CDECLS
+
+/**
+ * @brief number of frame regions in a stream buffer (triple buffering)
+ */
+#define SLS_STREAM_BUFFER_REGIONS 3
+
+typedef struct slsStreamBuffer slsStreamBuffer;
+
+/**
+ * @brief A buffer object divided into SLS_STREAM_BUFFER_REGIONS regions,
+ * one per frame in flight.
+ * @detail When ARB_buffer_storage is available the whole buffer is mapped
+ * once with GL_MAP_PERSISTENT_BIT and written directly. Otherwise each
+ * allocation maps its own range with unsynchronized/invalidate flags.
+ * Either way a fence per region keeps the CPU from overwriting data the GPU
+ * has not yet read.
+ */
+struct slsStreamBuffer {
+  GLuint buffer;
+  GLsizeiptr region_size;
+
+  bool persistent;
+  char* mapping;
+
+  size_t region;
+  GLintptr cursor;
+
+  /**
+   * @brief range mapped by the fallback path, waiting for commit
+   */
+  bool mapped;
+
+  GLsync fences[SLS_STREAM_BUFFER_REGIONS];
+};
+
+/**
+ * @brief creates the buffer and, if supported, its persistent mapping
+ * @param region_size bytes available to each frame
+ */
+slsStreamBuffer* sls_streambuffer_init(slsStreamBuffer* self,
+                                       size_t region_size) SLS_NONNULL(1);
+
+slsStreamBuffer* sls_streambuffer_dtor(slsStreamBuffer* self) SLS_NONNULL(1);
+
+/**
+ * @brief moves to the next region, waiting on its fence if needed
+ */
+void sls_streambuffer_begin_frame(slsStreamBuffer* self) SLS_NONNULL(1);
+
+/**
+ * @brief fences the current region. Call once the frame's draws that read
+ * from the buffer have been submitted.
+ */
+void sls_streambuffer_end_frame(slsStreamBuffer* self) SLS_NONNULL(1);
+
+/**
+ * @brief reserves `size` bytes in the current region.
+ * @param alignment required alignment of the returned offset, e.g. the
+ * vertex stride. Need not be a power of two.
+ * @param offset_out buffer offset of the allocation, for use in
+ * glVertexAttribPointer/glDrawElementsBaseVertex etc.
+ * @return pointer to write the data to, or NULL if the region is full.
+ * Every non-NULL result must be followed by sls_streambuffer_commit before
+ * drawing from it.
+ */
+void* sls_streambuffer_alloc(slsStreamBuffer* self,
+                             size_t size,
+                             size_t alignment,
+                             GLintptr* offset_out) SLS_NONNULL(1, 4);
+
+/**
+ * @brief finishes the write started by sls_streambuffer_alloc
+ */
+void sls_streambuffer_commit(slsStreamBuffer* self) SLS_NONNULL(1);
+
+/**
+ * @brief convenience wrapper copying `data` with alloc + commit
+ * @return buffer offset, or -1 if the region is full
+ */
+GLintptr sls_streambuffer_write(slsStreamBuffer* self,
+                                void const* data,
+                                size_t size,
+                                size_t alignment) SLS_NONNULL(1, 2);
+
+SLS_END_CDECLS
+
+#endif // DANGERENGINE_SLSSTREAMBUFFER_H
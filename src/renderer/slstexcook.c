@@ -0,0 +1,312 @@
+/**
+ * @file slstexcook.c
+ * @brief
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#include "slstexcook.h"
+#include <slsutils.h>
+#include <string.h>
+
+void sls_texcook_premultiply(unsigned char* rgba, size_t n_pixels)
+{
+  for (size_t i = 0; i < n_pixels; ++i) {
+    unsigned char* p = rgba + i * 4;
+    unsigned a = p[3];
+    for (size_t c = 0; c < 3; ++c) {
+      p[c] = (unsigned char)((p[c] * a + 127) / 255);
+    }
+  }
+}
+
+unsigned char* sls_texcook_downsample(unsigned char const* rgba,
+                                      uint32_t width,
+                                      uint32_t height)
+{
+  uint32_t w = width > 1 ? width / 2 : 1;
+  uint32_t h = height > 1 ? height / 2 : 1;
+  unsigned char* out = malloc((size_t)w * h * 4);
+  if (!out) {
+    return NULL;
+  }
+
+  for (uint32_t y = 0; y < h; ++y) {
+    uint32_t y0 = y * 2, y1 = y * 2 + 1 < height ? y * 2 + 1 : height - 1;
+    for (uint32_t x = 0; x < w; ++x) {
+      uint32_t x0 = x * 2, x1 = x * 2 + 1 < width ? x * 2 + 1 : width - 1;
+      unsigned char const* a = rgba + ((size_t)y0 * width + x0) * 4;
+      unsigned char const* b = rgba + ((size_t)y0 * width + x1) * 4;
+      unsigned char const* c = rgba + ((size_t)y1 * width + x0) * 4;
+      unsigned char const* d = rgba + ((size_t)y1 * width + x1) * 4;
+      unsigned char* dst = out + ((size_t)y * w + x) * 4;
+      for (size_t i = 0; i < 4; ++i) {
+        dst[i] = (unsigned char)((a[i] + b[i] + c[i] + d[i] + 2) / 4);
+      }
+    }
+  }
+
+  return out;
+}
+
+/*================================
+ * block compression
+ *================================*/
+
+static uint16_t sls_pack_565(int const* c)
+{
+  return (uint16_t)(((c[0] >> 3) << 11) | ((c[1] >> 2) << 5) | (c[2] >> 3));
+}
+
+static void sls_unpack_565(uint16_t v, int* c)
+{
+  int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+  c[0] = (r << 3) | (r >> 2);
+  c[1] = (g << 2) | (g >> 4);
+  c[2] = (b << 3) | (b >> 2);
+}
+
+static void sls_write_le16(unsigned char* out, uint16_t v)
+{
+  out[0] = (unsigned char)(v & 0xff);
+  out[1] = (unsigned char)(v >> 8);
+}
+
+/**
+ * @brief encodes the color half of a block from the bounding box of its
+ * texels.
+ * @param punch_through BC1 only: texels with alpha < 128 become
+ * transparent black, using the 3-color palette
+ */
+static void sls_encode_color_block(unsigned char const block[16][4],
+                                   bool punch_through,
+                                   unsigned char* out)
+{
+  int lo[3] = { 255, 255, 255 }, hi[3] = { 0, 0, 0 };
+  bool any_transparent = false, any_opaque = false;
+
+  for (size_t i = 0; i < 16; ++i) {
+    if (punch_through && block[i][3] < 128) {
+      any_transparent = true;
+      continue;
+    }
+    any_opaque = true;
+    for (size_t c = 0; c < 3; ++c) {
+      lo[c] = block[i][c] < lo[c] ? block[i][c] : lo[c];
+      hi[c] = block[i][c] > hi[c] ? block[i][c] : hi[c];
+    }
+  }
+
+  if (!any_opaque) {
+    // c0 <= c1 selects the 3-color palette, where index 3 is transparent
+    memset(out, 0, 4);
+    memset(out + 4, 0xff, 4);
+    return;
+  }
+
+  uint16_t c0 = sls_pack_565(hi), c1 = sls_pack_565(lo);
+  bool three_color = punch_through && any_transparent;
+  if (three_color ? c0 > c1 : c0 < c1) {
+    uint16_t tmp = c0;
+    c0 = c1;
+    c1 = tmp;
+  }
+
+  int palette[4][3];
+  sls_unpack_565(c0, palette[0]);
+  sls_unpack_565(c1, palette[1]);
+  for (size_t c = 0; c < 3; ++c) {
+    if (three_color) {
+      palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+      palette[3][c] = 0;
+    } else {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+  }
+
+  uint32_t indices = 0;
+  if (c0 != c1 || three_color) {
+    size_t n_colors = three_color ? 3 : 4;
+    for (size_t i = 0; i < 16; ++i) {
+      uint32_t best = 3;
+      if (!three_color || block[i][3] >= 128) {
+        int best_dist = INT32_MAX;
+        for (size_t k = 0; k < n_colors; ++k) {
+          int dist = 0;
+          for (size_t c = 0; c < 3; ++c) {
+            int d = block[i][c] - palette[k][c];
+            dist += d * d;
+          }
+          if (dist < best_dist) {
+            best_dist = dist;
+            best = (uint32_t)k;
+          }
+        }
+      }
+      indices |= best << (i * 2);
+    }
+  }
+
+  sls_write_le16(out, c0);
+  sls_write_le16(out + 2, c1);
+  sls_write_le16(out + 4, (uint16_t)(indices & 0xffff));
+  sls_write_le16(out + 6, (uint16_t)(indices >> 16));
+}
+
+/**
+ * @brief BC3 alpha half: two endpoints and 3-bit indices into the 8-value
+ * ramp between them
+ */
+static void sls_encode_alpha_block(unsigned char const block[16][4],
+                                   unsigned char* out)
+{
+  int a0 = 0, a1 = 255;
+  for (size_t i = 0; i < 16; ++i) {
+    a0 = block[i][3] > a0 ? block[i][3] : a0;
+    a1 = block[i][3] < a1 ? block[i][3] : a1;
+  }
+
+  out[0] = (unsigned char)a0;
+  out[1] = (unsigned char)a1;
+  memset(out + 2, 0, 6);
+  if (a0 == a1) {
+    return;
+  }
+
+  int ramp[8] = { a0, a1 };
+  for (int k = 2; k < 8; ++k) {
+    ramp[k] = ((8 - k) * a0 + (k - 1) * a1) / 7;
+  }
+
+  uint64_t bits = 0;
+  for (size_t i = 0; i < 16; ++i) {
+    uint64_t best = 0;
+    int best_dist = INT32_MAX;
+    for (size_t k = 0; k < 8; ++k) {
+      int d = block[i][3] - ramp[k];
+      d = d < 0 ? -d : d;
+      if (d < best_dist) {
+        best_dist = d;
+        best = k;
+      }
+    }
+    bits |= best << (i * 3);
+  }
+
+  for (size_t i = 0; i < 6; ++i) {
+    out[2 + i] = (unsigned char)(bits >> (i * 8));
+  }
+}
+
+void sls_texcook_encode(slsTexFormat format,
+                        unsigned char const* rgba,
+                        uint32_t width,
+                        uint32_t height,
+                        unsigned char* out)
+{
+  if (format == SLS_TEXFORMAT_RGBA8) {
+    memcpy(out, rgba, (size_t)width * height * 4);
+    return;
+  }
+
+  size_t block_size = format == SLS_TEXFORMAT_BC1 ? 8 : 16;
+  uint32_t blocks_x = (width + 3) / 4, blocks_y = (height + 3) / 4;
+
+  for (uint32_t by = 0; by < blocks_y; ++by) {
+    for (uint32_t bx = 0; bx < blocks_x; ++bx) {
+      // texels past the edge repeat the last row and column
+      unsigned char block[16][4];
+      for (uint32_t y = 0; y < 4; ++y) {
+        uint32_t sy = by * 4 + y < height ? by * 4 + y : height - 1;
+        for (uint32_t x = 0; x < 4; ++x) {
+          uint32_t sx = bx * 4 + x < width ? bx * 4 + x : width - 1;
+          memcpy(block[y * 4 + x], rgba + ((size_t)sy * width + sx) * 4, 4);
+        }
+      }
+
+      unsigned char* dst = out + ((size_t)by * blocks_x + bx) * block_size;
+      if (format == SLS_TEXFORMAT_BC1) {
+        sls_encode_color_block(block, true, dst);
+      } else {
+        sls_encode_alpha_block(block, dst);
+        sls_encode_color_block(block, false, dst + 8);
+      }
+    }
+  }
+}
+
+/*================================
+ * container
+ *================================*/
+
+void* sls_texcook_build(unsigned char* rgba,
+                        uint32_t width,
+                        uint32_t height,
+                        slsTexCookOptions const* options,
+                        size_t* size_out)
+{
+  unsigned char* file = NULL;
+  unsigned char* level_pixels = NULL;
+  slsTexFileHeader header = {.magic = SLS_TEXFILE_MAGIC,
+                             .version = SLS_TEXFILE_VERSION,
+                             .format = options->format,
+                             .width = width,
+                             .height = height };
+
+  sls_check(width > 0 && height > 0, "empty image");
+  if (options->premultiply) {
+    sls_texcook_premultiply(rgba, (size_t)width * height);
+    header.flags |= SLS_TEXFILE_PREMULTIPLIED;
+  }
+
+  // lay out the mip chain
+  size_t offset = sizeof(slsTexFileHeader);
+  uint32_t w = width, h = height;
+  for (;;) {
+    offset = (offset + SLS_TEXFILE_ALIGN - 1) & ~(size_t)(SLS_TEXFILE_ALIGN - 1);
+    size_t size = sls_texfile_level_size(options->format, w, h);
+    header.levels[header.n_levels++] = (slsTexFileLevel){
+      .offset = (uint32_t)offset, .size = (uint32_t)size, .width = w, .height = h
+    };
+    offset += size;
+
+    if (options->no_mips || (w == 1 && h == 1) ||
+        header.n_levels == SLS_TEXFILE_MAX_LEVELS) {
+      break;
+    }
+    w = w > 1 ? w / 2 : 1;
+    h = h > 1 ? h / 2 : 1;
+  }
+
+  file = calloc(1, offset);
+  sls_checkmem(file);
+  memcpy(file, &header, sizeof(header));
+
+  unsigned char const* src = rgba;
+  for (uint32_t i = 0; i < header.n_levels; ++i) {
+    slsTexFileLevel const* level = header.levels + i;
+    if (i > 0) {
+      unsigned char* next = sls_texcook_downsample(
+        src, header.levels[i - 1].width, header.levels[i - 1].height);
+      sls_checkmem(next);
+      free(level_pixels);
+      level_pixels = next;
+      src = next;
+    }
+    sls_texcook_encode(options->format,
+                       src,
+                       level->width,
+                       level->height,
+                       file + level->offset);
+  }
+
+  free(level_pixels);
+  *size_out = offset;
+  return file;
+error:
+  free(level_pixels);
+  free(file);
+  return NULL;
+}
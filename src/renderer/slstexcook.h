@@ -0,0 +1,62 @@
+/**
+ * @file slstexcook.h
+ * @brief offline conversion of RGBA8 images to cooked texture containers
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#ifndef DANGERENGINE_SLSTEXCOOK_H
+#define DANGERENGINE_SLSTEXCOOK_H
+
+#include "slstexfile.h"
+#include <slsmacros.h>
+
+SLS_BEGIN_CDECLS
+
+typedef struct slsTexCookOptions {
+  slsTexFormat format;
+  /** @brief multiply color by alpha before building mips */
+  bool premultiply;
+  /** @brief store only level 0 */
+  bool no_mips;
+} slsTexCookOptions;
+
+/**
+ * @brief multiplies each pixel's color channels by its alpha, in place
+ */
+void sls_texcook_premultiply(unsigned char* rgba, size_t n_pixels)
+  SLS_NONNULL(1);
+
+/**
+ * @brief halves an image with a 2x2 box filter. Odd edges are clamped.
+ * @return heap-allocated image of max(1, w/2) x max(1, h/2)
+ */
+unsigned char* sls_texcook_downsample(unsigned char const* rgba,
+                                      uint32_t width,
+                                      uint32_t height) SLS_NONNULL(1);
+
+/**
+ * @brief block-compresses an image. `out` must hold
+ * sls_texfile_level_size(format, width, height) bytes.
+ */
+void sls_texcook_encode(slsTexFormat format,
+                        unsigned char const* rgba,
+                        uint32_t width,
+                        uint32_t height,
+                        unsigned char* out) SLS_NONNULL(2, 5);
+
+/**
+ * @brief builds a complete container in memory. `rgba` rows are bottom
+ * first, and are modified when premultiplying.
+ * @return heap-allocated file contents, or NULL on failure
+ */
+void* sls_texcook_build(unsigned char* rgba,
+                        uint32_t width,
+                        uint32_t height,
+                        slsTexCookOptions const* options,
+                        size_t* size_out) SLS_NONNULL(1, 4, 5);
+
+SLS_END_CDECLS
+
+#endif // DANGERENGINE_SLSTEXCOOK_H
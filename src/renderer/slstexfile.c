@@ -0,0 +1,250 @@
+/**
+ * @file slstexfile.c
+ * @brief
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#include "slstexfile.h"
+#include <slsutils.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+size_t sls_texfile_level_size(slsTexFormat format,
+                              uint32_t width,
+                              uint32_t height)
+{
+  size_t blocks_x = (width + 3) / 4, blocks_y = (height + 3) / 4;
+  switch (format) {
+    case SLS_TEXFORMAT_RGBA8:
+      return (size_t)width * height * 4;
+    case SLS_TEXFORMAT_BC1:
+      return blocks_x * blocks_y * 8;
+    case SLS_TEXFORMAT_BC3:
+      return blocks_x * blocks_y * 16;
+  }
+  return 0;
+}
+
+slsTexFileHeader const* sls_texfile_parse(void const* data, size_t size)
+{
+  slsTexFileHeader const* header = data;
+
+  sls_check(size >= sizeof(slsTexFileHeader), "texture file truncated");
+  sls_check(header->magic != SLS_TEXFILE_MAGIC_SWAPPED,
+            "texture was cooked for the other byte order, cook it again");
+  sls_check(header->magic == SLS_TEXFILE_MAGIC, "not a cooked texture");
+  sls_check(header->version == SLS_TEXFILE_VERSION,
+            "texture file version %u, expected %u",
+            header->version,
+            SLS_TEXFILE_VERSION);
+  sls_check(header->format <= SLS_TEXFORMAT_BC3,
+            "unknown texture format %u",
+            header->format);
+  sls_check(header->n_levels > 0 && header->n_levels <= SLS_TEXFILE_MAX_LEVELS,
+            "bad mip level count %u",
+            header->n_levels);
+
+  uint32_t width = header->width, height = header->height;
+  for (uint32_t i = 0; i < header->n_levels; ++i) {
+    slsTexFileLevel const* level = header->levels + i;
+    sls_check(level->width == width && level->height == height,
+              "mip level %u has size %ux%u, expected %ux%u",
+              i,
+              level->width,
+              level->height,
+              width,
+              height);
+    sls_check(level->size ==
+                sls_texfile_level_size(header->format, width, height),
+              "mip level %u has the wrong byte size",
+              i);
+    sls_check(level->offset % SLS_TEXFILE_ALIGN == 0 &&
+                (size_t)level->offset + level->size <= size,
+              "mip level %u lies outside the file",
+              i);
+
+    width = width > 1 ? width / 2 : 1;
+    height = height > 1 ? height / 2 : 1;
+  }
+
+  return header;
+error:
+  return NULL;
+}
+
+/**
+ * @brief reads the whole file into heap memory, for platforms without mmap
+ */
+static void* sls_texfile_read(char const* path, size_t* size_out)
+{
+  void* data = NULL;
+  FILE* fp = fopen(path, "rb");
+  sls_check(fp, "could not open %s", path);
+
+  fseek(fp, 0, SEEK_END);
+  long size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  sls_check(size > 0, "could not size %s", path);
+
+  data = malloc((size_t)size);
+  sls_checkmem(data);
+  sls_check(fread(data, 1, (size_t)size, fp) == (size_t)size,
+            "could not read %s",
+            path);
+
+  fclose(fp);
+  *size_out = (size_t)size;
+  return data;
+error:
+  if (fp) {
+    fclose(fp);
+  }
+  free(data);
+  return NULL;
+}
+
+slsTexFile* sls_texfile_open(slsTexFile* self, char const* path)
+{
+  *self = (slsTexFile){};
+
+#ifndef _WIN32
+  int fd = open(path, O_RDONLY);
+  if (fd >= 0) {
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+      void* data =
+        mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data != MAP_FAILED) {
+        self->data = data;
+        self->size = (size_t)st.st_size;
+        self->mapped = true;
+      }
+    }
+    // the mapping keeps the file alive
+    close(fd);
+  }
+#endif
+
+  if (!self->data) {
+    self->data = sls_texfile_read(path, &self->size);
+    sls_check(self->data, "could not load %s", path);
+  }
+
+  self->header = sls_texfile_parse(self->data, self->size);
+  sls_check(self->header, "%s is not a valid cooked texture", path);
+
+  return self;
+error:
+  return sls_texfile_close(self);
+}
+
+slsTexFile* sls_texfile_close(slsTexFile* self)
+{
+  if (self->data) {
+#ifndef _WIN32
+    if (self->mapped) {
+      munmap((void*)self->data, self->size);
+    } else
+#endif
+    {
+      free((void*)self->data);
+    }
+  }
+
+  *self = (slsTexFile){};
+  return self;
+}
+
+bool sls_texfile_upload(slsTexFile const* self, GLuint texture)
+{
+  slsTexFileHeader const* header = self->header;
+  GLenum compressed_format = 0;
+
+  switch ((slsTexFormat)header->format) {
+    case SLS_TEXFORMAT_RGBA8:
+      break;
+    case SLS_TEXFORMAT_BC1:
+      compressed_format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+      break;
+    case SLS_TEXFORMAT_BC3:
+      compressed_format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+      break;
+  }
+
+  if (compressed_format && !GLAD_GL_EXT_texture_compression_s3tc) {
+    sls_log_err("driver lacks EXT_texture_compression_s3tc");
+    return false;
+  }
+
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+  char const* base = self->data;
+  for (uint32_t i = 0; i < header->n_levels; ++i) {
+    slsTexFileLevel const* level = header->levels + i;
+    void const* pixels = base + level->offset;
+    if (compressed_format) {
+      glCompressedTexImage2D(GL_TEXTURE_2D,
+                             (GLint)i,
+                             compressed_format,
+                             (GLsizei)level->width,
+                             (GLsizei)level->height,
+                             0,
+                             (GLsizei)level->size,
+                             pixels);
+    } else {
+      glTexImage2D(GL_TEXTURE_2D,
+                   (GLint)i,
+                   GL_RGBA8,
+                   (GLsizei)level->width,
+                   (GLsizei)level->height,
+                   0,
+                   GL_RGBA,
+                   GL_UNSIGNED_BYTE,
+                   pixels);
+    }
+  }
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+  glTexParameteri(
+    GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)header->n_levels - 1);
+  glTexParameteri(GL_TEXTURE_2D,
+                  GL_TEXTURE_MIN_FILTER,
+                  header->n_levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  return true;
+}
+
+bool sls_texture_load_cooked(slsTexture* tex, char const* path)
+{
+  slsTexFile file;
+  if (!sls_texfile_open(&file, path)->header) {
+    tex->state = SLS_TEXTURE_FAILED;
+    return false;
+  }
+
+  if (!tex->id) {
+    glGenTextures(1, &tex->id);
+  }
+  bool res = sls_texfile_upload(&file, tex->id);
+  if (res) {
+    tex->width = (int)file.header->width;
+    tex->height = (int)file.header->height;
+  }
+  tex->state = res ? SLS_TEXTURE_READY : SLS_TEXTURE_FAILED;
+
+  sls_texfile_close(&file);
+  return res;
+}
@@ -0,0 +1,121 @@
+/**
+ * @file slstexfile.h
+ * @brief cooked texture container, uploaded straight from a file mapping
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#ifndef DANGERENGINE_SLSTEXFILE_H
+#define DANGERENGINE_SLSTEXFILE_H
+
+#include "../sls-gl.h"
+#include "slstexture.h"
+#include <slsmacros.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+SLS_BEGIN_CDECLS
+
+/** @brief "SLST" when stored little-endian */
+#define SLS_TEXFILE_MAGIC 0x54534c53u
+/** @brief the magic as read on a host of the other byte order */
+#define SLS_TEXFILE_MAGIC_SWAPPED 0x534c5354u
+#define SLS_TEXFILE_VERSION 1
+#define SLS_TEXFILE_MAX_LEVELS 16
+/** @brief alignment of each level's data within the file */
+#define SLS_TEXFILE_ALIGN 16
+#define SLS_TEXFILE_EXTENSION ".slstex"
+
+typedef enum slsTexFormat {
+  SLS_TEXFORMAT_RGBA8 = 0,
+  /** @brief DXT1: 8 bytes per 4x4 block, 1-bit alpha */
+  SLS_TEXFORMAT_BC1 = 1,
+  /** @brief DXT5: 16 bytes per 4x4 block, interpolated alpha */
+  SLS_TEXFORMAT_BC3 = 2,
+} slsTexFormat;
+
+typedef enum slsTexFileFlags {
+  /** @brief color channels are multiplied by alpha */
+  SLS_TEXFILE_PREMULTIPLIED = 1 << 0,
+} slsTexFileFlags;
+
+typedef struct slsTexFileLevel {
+  /** @brief byte offset from the start of the file */
+  uint32_t offset;
+  uint32_t size;
+  uint32_t width;
+  uint32_t height;
+} slsTexFileLevel;
+
+/**
+ * @brief fixed-size header at the start of a cooked texture, used in
+ * place from the mapping. All fields are in the byte order of the host
+ * that cooked it; files cooked on a host of the other order are rejected,
+ * not swapped. Level 0 is the full-size image, rows bottom first.
+ */
+typedef struct slsTexFileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t format;
+  uint32_t flags;
+  uint32_t width;
+  uint32_t height;
+  uint32_t n_levels;
+  uint32_t reserved;
+  slsTexFileLevel levels[SLS_TEXFILE_MAX_LEVELS];
+} slsTexFileHeader;
+
+/**
+ * @brief an open cooked texture
+ */
+typedef struct slsTexFile {
+  void const* data;
+  size_t size;
+  slsTexFileHeader const* header;
+
+  /** @brief true if `data` is a file mapping, false if heap memory */
+  bool mapped;
+} slsTexFile;
+
+/**
+ * @brief validates a container held in memory
+ * @return the header, or NULL if the data is not a well-formed container
+ */
+slsTexFileHeader const* sls_texfile_parse(void const* data, size_t size)
+  SLS_NONNULL(1);
+
+/**
+ * @brief maps the file at `path` into memory and validates it
+ */
+slsTexFile* sls_texfile_open(slsTexFile* self, char const* path)
+  SLS_NONNULL(1, 2);
+
+slsTexFile* sls_texfile_close(slsTexFile* self) SLS_NONNULL(1);
+
+/**
+ * @brief bytes occupied by one level of the given format and size
+ */
+size_t sls_texfile_level_size(slsTexFormat format,
+                              uint32_t width,
+                              uint32_t height);
+
+/**
+ * @brief uploads every level to `texture` directly from the container
+ * @return false if the format is not supported by the driver
+ */
+bool sls_texfile_upload(slsTexFile const* self, GLuint texture)
+  SLS_NONNULL(1);
+
+/**
+ * @brief opens, uploads and closes a cooked texture. No decoding happens,
+ * so this is cheap enough to run on the GL thread.
+ * @param tex receives the texture id, size and state. Other fields are
+ * left alone, so the texture may belong to a loader.
+ */
+bool sls_texture_load_cooked(slsTexture* tex, char const* path)
+  SLS_NONNULL(1, 2);
+
+SLS_END_CDECLS
+
+#endif // DANGERENGINE_SLSTEXFILE_H
@@ -0,0 +1,257 @@
+/**
+ * @file slstexture.c
+ * @brief
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#include "slstexture.h"
+#include "../sls-imagelib.h"
+#include "slstexfile.h"
+#include <slsutils.h>
+#include <string.h>
+
+static const slsCallbackTable sls_texture_path_keys = {
+  .copy_fn = sls_copy_string, .free_fn = free, .cmp_fn = sls_cmp_string
+};
+
+static slsTexture* sls_texture_free(slsTexture* self)
+{
+  if (self->id) {
+    glDeleteTextures(1, &self->id);
+  }
+  if (self->pixels) {
+    stbi_image_free(self->pixels);
+  }
+  free(self->path);
+  free(self);
+  return NULL;
+}
+
+slsTextureLoader* sls_textureloader_init(slsTextureLoader* self,
+                                         slsJobQueue* jobs)
+{
+  *self = (slsTextureLoader){.jobs = jobs };
+
+  sls_checkmem(sls_hashtable_init(&self->textures,
+                                  32,
+                                  sls_hash_fn_default,
+                                  &sls_texture_path_keys,
+                                  NULL));
+  pthread_mutex_init(&self->lock, NULL);
+  glGenBuffers(1, &self->pbo);
+
+  // images are stored top row first, GL expects the bottom row first.
+  // Set once here: the flag is global to stb_image, and workers only read it
+  stbi_set_flip_vertically_on_load(true);
+
+  return self;
+error:
+  return sls_textureloader_dtor(self);
+}
+
+slsTextureLoader* sls_textureloader_dtor(slsTextureLoader* self)
+{
+  if (!self->textures.keys) {
+    return self;
+  }
+
+  // workers hold pointers to our textures until they finish
+  sls_jobqueue_wait(self->jobs);
+
+  slsHashItor itor;
+  for (slsHashItor* i = sls_hashitor_first(&self->textures, &itor); i;
+       i = sls_hashitor_next(i)) {
+    sls_texture_free(*i->val);
+  }
+  sls_hashtable_dtor(&self->textures);
+
+  if (self->pbo) {
+    glDeleteBuffers(1, &self->pbo);
+  }
+  pthread_mutex_destroy(&self->lock);
+
+  *self = (slsTextureLoader){};
+  return self;
+}
+
+/**
+ * @brief worker job: decodes the image and queues it for upload
+ */
+static void sls_texture_decode(void* data)
+{
+  slsTexture* self = data;
+  slsTextureLoader* loader = self->loader;
+
+  int width = 0, height = 0, channels = 0;
+  unsigned char* pixels =
+    stbi_load(self->path, &width, &height, &channels, STBI_rgb_alpha);
+  if (!pixels) {
+    sls_log_err(
+      "could not decode texture %s: %s", self->path, stbi_failure_reason());
+  }
+
+  pthread_mutex_lock(&loader->lock);
+  self->pixels = pixels;
+  self->width = width;
+  self->height = height;
+  self->state = pixels ? SLS_TEXTURE_DECODED : SLS_TEXTURE_FAILED;
+  if (pixels) {
+    self->next_decoded = loader->decoded;
+    loader->decoded = self;
+  }
+  pthread_mutex_unlock(&loader->lock);
+}
+
+slsTexture* sls_textureloader_load(slsTextureLoader* self, char const* path)
+{
+  slsTexture* tex = sls_hashtable_find(&self->textures, path, SLS_STRING_LENGTH);
+  if (tex) {
+    return tex;
+  }
+
+  tex = calloc(1, sizeof(slsTexture));
+  sls_checkmem(tex);
+  tex->loader = self;
+  tex->state = SLS_TEXTURE_LOADING;
+  tex->width = 1;
+  tex->height = 1;
+  tex->path = sls_copy_string(path);
+  sls_checkmem(tex->path);
+
+  static const unsigned char white[] = { 0xff, 0xff, 0xff, 0xff };
+  glGenTextures(1, &tex->id);
+  glBindTexture(GL_TEXTURE_2D, tex->id);
+  glTexImage2D(
+    GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  sls_hashtable_insert(&self->textures, path, SLS_STRING_LENGTH, tex);
+
+  // cooked textures need no decoding, upload them right away
+  size_t path_len = strlen(path), ext_len = strlen(SLS_TEXFILE_EXTENSION);
+  if (path_len > ext_len &&
+      strcmp(path + path_len - ext_len, SLS_TEXFILE_EXTENSION) == 0) {
+    sls_texture_load_cooked(tex, path);
+  } else if (!sls_jobqueue_submit(self->jobs, sls_texture_decode, tex)) {
+    tex->state = SLS_TEXTURE_FAILED;
+  }
+
+  return tex;
+error:
+  if (tex) {
+    sls_texture_free(tex);
+  }
+  return NULL;
+}
+
+/**
+ * @brief streams decoded pixels through the unpack buffer into the texture
+ */
+static void sls_texture_upload(slsTextureLoader* self, slsTexture* tex)
+{
+  GLsizeiptr size = (GLsizeiptr)tex->width * tex->height * 4;
+
+  // orphan the previous upload's storage so the driver need not wait for
+  // the copy out of it to finish
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, self->pbo);
+  glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+  void* dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER,
+                               0,
+                               size,
+                               GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+
+  glBindTexture(GL_TEXTURE_2D, tex->id);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+  if (dst) {
+    memcpy(dst, tex->pixels, (size_t)size);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    glTexImage2D(GL_TEXTURE_2D,
+                 0,
+                 GL_RGBA8,
+                 tex->width,
+                 tex->height,
+                 0,
+                 GL_RGBA,
+                 GL_UNSIGNED_BYTE,
+                 (void*)0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  } else {
+    sls_log_warn("could not map unpack buffer, uploading %s directly",
+                 tex->path);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glTexImage2D(GL_TEXTURE_2D,
+                 0,
+                 GL_RGBA8,
+                 tex->width,
+                 tex->height,
+                 0,
+                 GL_RGBA,
+                 GL_UNSIGNED_BYTE,
+                 tex->pixels);
+  }
+
+  glGenerateMipmap(GL_TEXTURE_2D);
+  glTexParameteri(
+    GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  stbi_image_free(tex->pixels);
+  tex->pixels = NULL;
+}
+
+size_t sls_textureloader_pump(slsTextureLoader* self, size_t max_uploads)
+{
+  size_t n_uploaded = 0;
+
+  while (max_uploads == 0 || n_uploaded < max_uploads) {
+    pthread_mutex_lock(&self->lock);
+    slsTexture* tex = self->decoded;
+    if (tex) {
+      self->decoded = tex->next_decoded;
+      tex->next_decoded = NULL;
+    }
+    pthread_mutex_unlock(&self->lock);
+
+    if (!tex) {
+      break;
+    }
+
+    sls_texture_upload(self, tex);
+
+    pthread_mutex_lock(&self->lock);
+    tex->state = SLS_TEXTURE_READY;
+    pthread_mutex_unlock(&self->lock);
+    ++n_uploaded;
+  }
+
+  return n_uploaded;
+}
+
+void sls_textureloader_finish(slsTextureLoader* self)
+{
+  sls_jobqueue_wait(self->jobs);
+  sls_textureloader_pump(self, 0);
+}
+
+slsTextureState sls_texture_state(slsTexture* self)
+{
+  // textures created outside a loader, e.g. atlas pages, are never shared
+  if (!self->loader) {
+    return self->state;
+  }
+  pthread_mutex_lock(&self->loader->lock);
+  slsTextureState state = self->state;
+  pthread_mutex_unlock(&self->loader->lock);
+  return state;
+}
+
+void sls_texture_bind(slsTexture const* self, GLuint unit)
+{
+  glActiveTexture(GL_TEXTURE0 + unit);
+  glBindTexture(GL_TEXTURE_2D, self->id);
+}
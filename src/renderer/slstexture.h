@@ -0,0 +1,108 @@
+/**
+ * @file slstexture.h
+ * @brief 2D textures decoded on worker threads and uploaded on the GL thread
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#ifndef DANGERENGINE_SLSTEXTURE_H
+#define DANGERENGINE_SLSTEXTURE_H
+
+#include "../data-types/hashtable.h"
+#include "../sls-gl.h"
+#include "../slsjobs.h"
+#include <slsmacros.h>
+
+SLS_BEGIN_CDECLS
+
+typedef enum slsTextureState {
+  /** @brief queued or being decoded. The texture holds a placeholder */
+  SLS_TEXTURE_LOADING,
+  /** @brief decoded, waiting for sls_textureloader_pump to upload it */
+  SLS_TEXTURE_DECODED,
+  SLS_TEXTURE_READY,
+  /** @brief decoding failed. The placeholder stays bound */
+  SLS_TEXTURE_FAILED
+} slsTextureState;
+
+typedef struct slsTextureLoader slsTextureLoader;
+typedef struct slsTexture slsTexture;
+
+struct slsTexture {
+  /** @brief valid from the moment the texture is requested */
+  GLuint id;
+  int width;
+  int height;
+
+  char* path;
+
+  /** @brief guarded by the loader's lock until the texture is READY */
+  slsTextureState state;
+  unsigned char* pixels;
+
+  slsTextureLoader* loader;
+  /** @brief link in the loader's list of decoded textures */
+  slsTexture* next_decoded;
+};
+
+struct slsTextureLoader {
+  slsJobQueue* jobs;
+
+  pthread_mutex_t lock;
+  /** @brief textures decoded by workers but not yet uploaded */
+  slsTexture* decoded;
+
+  /** @brief pixel unpack buffer staging uploads */
+  GLuint pbo;
+
+  /** @brief path -> slsTexture, owning every texture */
+  slsHashTable textures;
+};
+
+/**
+ * @param jobs worker pool decoding images. Not owned by the loader.
+ */
+slsTextureLoader* sls_textureloader_init(slsTextureLoader* self,
+                                         slsJobQueue* jobs) SLS_NONNULL(1, 2);
+
+/**
+ * @brief waits for outstanding decodes, then deletes every texture
+ */
+slsTextureLoader* sls_textureloader_dtor(slsTextureLoader* self)
+  SLS_NONNULL(1);
+
+/**
+ * @brief requests the texture at `path`. Must be called on the GL thread.
+ * @detail The result is usable immediately: until decoding finishes it is
+ * a 1x1 white placeholder. Repeated requests for a path share a texture.
+ * Cooked (.slstex) files skip decoding and are READY on return.
+ * @return the texture, owned by the loader, or NULL on failure
+ */
+slsTexture* sls_textureloader_load(slsTextureLoader* self, char const* path)
+  SLS_NONNULL(1, 2);
+
+/**
+ * @brief uploads textures that finished decoding. Call once per frame on
+ * the GL thread.
+ * @param max_uploads upload budget for this call, 0 for no limit
+ * @return the number of textures uploaded
+ */
+size_t sls_textureloader_pump(slsTextureLoader* self, size_t max_uploads)
+  SLS_NONNULL(1);
+
+/**
+ * @brief blocks until every requested texture is READY or FAILED
+ */
+void sls_textureloader_finish(slsTextureLoader* self) SLS_NONNULL(1);
+
+slsTextureState sls_texture_state(slsTexture* self) SLS_NONNULL(1);
+
+/**
+ * @brief binds the texture to GL_TEXTURE0 + unit
+ */
+void sls_texture_bind(slsTexture const* self, GLuint unit) SLS_NONNULL(1);
+
+SLS_END_CDECLS
+
+#endif // DANGERENGINE_SLSTEXTURE_H
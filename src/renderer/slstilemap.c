@@ -0,0 +1,334 @@
+/**
+ * @file slstilemap.c
+ * @brief
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#include "slstilemap.h"
+#include "slsshader.h"
+#include <math.h>
+#include <slsutils.h>
+#include <stdlib.h>
+#include <string.h>
+
+static inline size_t sls_tilemap_chunk_of(slsTileMap const* self,
+                                          size_t x,
+                                          size_t y)
+{
+  return (y / SLS_TILEMAP_CHUNK_SIZE) * self->chunks_x +
+         x / SLS_TILEMAP_CHUNK_SIZE;
+}
+
+static void sls_tilemap_mark_dirty(slsTileMap* self, size_t chunk)
+{
+  if (!self->chunks[chunk].dirty) {
+    self->chunks[chunk].dirty = true;
+    self->dirty[self->n_dirty++] = chunk;
+  }
+}
+
+slsTileMap* sls_tilemap_init(slsTileMap* self,
+                             size_t width,
+                             size_t height,
+                             float tile_size,
+                             slsAtlasRegion const* regions,
+                             size_t n_regions)
+{
+  *self = (slsTileMap){.width = width,
+                       .height = height,
+                       .tile_size = tile_size };
+
+  sls_check(width > 0 && height > 0, "empty tile map");
+  sls_check(regions && n_regions > 0 && n_regions < SLS_TILE_EMPTY,
+            "tile maps need between 1 and %d tile regions",
+            SLS_TILE_EMPTY - 1);
+  for (size_t i = 1; i < n_regions; ++i) {
+    sls_check(regions[i].texture == regions[0].texture,
+              "tile regions must share one atlas page");
+  }
+
+  self->regions = malloc(n_regions * sizeof(*self->regions));
+  sls_checkmem(self->regions);
+  memcpy(self->regions, regions, n_regions * sizeof(*self->regions));
+  self->n_regions = n_regions;
+  self->texture = regions[0].texture;
+
+  self->tiles = malloc(width * height * sizeof(*self->tiles));
+  sls_checkmem(self->tiles);
+  for (size_t i = 0; i < width * height; ++i) {
+    self->tiles[i] = SLS_TILE_EMPTY;
+  }
+
+  self->chunks_x = (width + SLS_TILEMAP_CHUNK_SIZE - 1) / SLS_TILEMAP_CHUNK_SIZE;
+  self->chunks_y =
+    (height + SLS_TILEMAP_CHUNK_SIZE - 1) / SLS_TILEMAP_CHUNK_SIZE;
+  size_t n_chunks = self->chunks_x * self->chunks_y;
+  self->chunks = calloc(n_chunks, sizeof(*self->chunks));
+  self->dirty = calloc(n_chunks, sizeof(*self->dirty));
+  sls_checkmem(self->chunks && self->dirty);
+
+  return self;
+error:
+  sls_tilemap_dtor(self);
+  return NULL;
+}
+
+slsTileMap* sls_tilemap_dtor(slsTileMap* self)
+{
+  if (self->chunks) {
+    for (size_t i = 0; i < self->chunks_x * self->chunks_y; ++i) {
+      slsTileChunk* chunk = self->chunks + i;
+      if (chunk->vao) {
+        glDeleteVertexArrays(1, &chunk->vao);
+        glDeleteBuffers(1, &chunk->vbo);
+      }
+    }
+  }
+  if (self->ibo) {
+    glDeleteBuffers(1, &self->ibo);
+  }
+
+  free(self->tiles);
+  free(self->regions);
+  free(self->chunks);
+  free(self->dirty);
+  free(self->scratch);
+  *self = (slsTileMap){};
+  return self;
+}
+
+slsTileId sls_tilemap_get(slsTileMap const* self, size_t x, size_t y)
+{
+  if (x >= self->width || y >= self->height) {
+    return SLS_TILE_EMPTY;
+  }
+  return self->tiles[y * self->width + x];
+}
+
+void sls_tilemap_set(slsTileMap* self, size_t x, size_t y, slsTileId tile)
+{
+  if (x >= self->width || y >= self->height ||
+      (tile != SLS_TILE_EMPTY && tile >= self->n_regions)) {
+    return;
+  }
+
+  slsTileId* cell = self->tiles + y * self->width + x;
+  if (*cell != tile) {
+    *cell = tile;
+    sls_tilemap_mark_dirty(self, sls_tilemap_chunk_of(self, x, y));
+  }
+}
+
+void sls_tilemap_fill(slsTileMap* self,
+                      size_t x,
+                      size_t y,
+                      size_t width,
+                      size_t height,
+                      slsTileId tile)
+{
+  size_t x1 = x + width < self->width ? x + width : self->width;
+  size_t y1 = y + height < self->height ? y + height : self->height;
+  for (size_t j = y; j < y1; ++j) {
+    for (size_t i = x; i < x1; ++i) {
+      sls_tilemap_set(self, i, j, tile);
+    }
+  }
+}
+
+/**
+ * @return the chunk column or row containing world coordinate `v`,
+ * clamped to [0, n]
+ */
+static size_t sls_tilemap_chunk_coord(slsTileMap const* self,
+                                      float v,
+                                      size_t n)
+{
+  float chunk = floorf(v / (self->tile_size * SLS_TILEMAP_CHUNK_SIZE));
+  if (chunk < 0.f) {
+    return 0;
+  }
+  return chunk >= (float)n ? n : (size_t)chunk;
+}
+
+slsTileChunkRange sls_tilemap_cull(slsTileMap const* self,
+                                   kmVec2 view_min,
+                                   kmVec2 view_max)
+{
+  slsTileChunkRange range = {};
+  if (view_max.x < 0.f || view_max.y < 0.f || view_min.x > view_max.x ||
+      view_min.y > view_max.y) {
+    return range;
+  }
+
+  range.x0 = sls_tilemap_chunk_coord(self, view_min.x, self->chunks_x);
+  range.y0 = sls_tilemap_chunk_coord(self, view_min.y, self->chunks_y);
+  range.x1 = sls_tilemap_chunk_coord(self, view_max.x, self->chunks_x - 1) + 1;
+  range.y1 = sls_tilemap_chunk_coord(self, view_max.y, self->chunks_y - 1) + 1;
+  if (range.x0 >= range.x1 || range.y0 >= range.y1) {
+    return (slsTileChunkRange){};
+  }
+  return range;
+}
+
+/**
+ * @brief creates the shared index buffer and scratch vertices
+ */
+static bool sls_tilemap_setup_buffers(slsTileMap* self)
+{
+  self->scratch =
+    malloc(SLS_TILEMAP_CHUNK_TILES * 4 * sizeof(*self->scratch));
+  uint16_t* indices = malloc(SLS_TILEMAP_CHUNK_TILES * 6 * sizeof(*indices));
+  sls_checkmem(self->scratch && indices);
+
+  for (uint16_t q = 0; q < SLS_TILEMAP_CHUNK_TILES; ++q) {
+    uint16_t v = (uint16_t)(q * 4);
+    uint16_t quad[6] = { v, v + 1, v + 2, v + 2, v + 3, v };
+    memcpy(indices + q * 6, quad, sizeof(quad));
+  }
+
+  glGenBuffers(1, &self->ibo);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, self->ibo);
+  glBufferData(GL_COPY_WRITE_BUFFER,
+               SLS_TILEMAP_CHUNK_TILES * 6 * sizeof(*indices),
+               indices,
+               GL_STATIC_DRAW);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  free(indices);
+  return true;
+error:
+  free(indices);
+  return false;
+}
+
+static inline uint16_t sls_tilemap_unorm16(float v)
+{
+  v = v < 0.f ? 0.f : (v > 1.f ? 1.f : v);
+  return (uint16_t)(v * UINT16_MAX + 0.5f);
+}
+
+static void sls_tilemap_rebuild_chunk(slsTileMap* self, size_t index)
+{
+  slsTileChunk* chunk = self->chunks + index;
+  size_t cx = index % self->chunks_x, cy = index / self->chunks_x;
+  size_t x0 = cx * SLS_TILEMAP_CHUNK_SIZE, y0 = cy * SLS_TILEMAP_CHUNK_SIZE;
+  size_t x1 = x0 + SLS_TILEMAP_CHUNK_SIZE < self->width
+                ? x0 + SLS_TILEMAP_CHUNK_SIZE
+                : self->width;
+  size_t y1 = y0 + SLS_TILEMAP_CHUNK_SIZE < self->height
+                ? y0 + SLS_TILEMAP_CHUNK_SIZE
+                : self->height;
+
+  float ts = self->tile_size;
+  slsTileVertex* v = self->scratch;
+  uint32_t n_quads = 0;
+  for (size_t y = y0; y < y1; ++y) {
+    for (size_t x = x0; x < x1; ++x) {
+      slsTileId tile = self->tiles[y * self->width + x];
+      if (tile == SLS_TILE_EMPTY) {
+        continue;
+      }
+
+      slsAtlasRegion const* r = self->regions + tile;
+      uint16_t u0 = sls_tilemap_unorm16(r->uv_min.x);
+      uint16_t v0 = sls_tilemap_unorm16(r->uv_min.y);
+      uint16_t u1 = sls_tilemap_unorm16(r->uv_max.x);
+      uint16_t v1 = sls_tilemap_unorm16(r->uv_max.y);
+      float px0 = x * ts, py0 = y * ts, px1 = px0 + ts, py1 = py0 + ts;
+
+      *v++ = (slsTileVertex){ { px0, py0 }, { u0, v0 } };
+      *v++ = (slsTileVertex){ { px1, py0 }, { u1, v0 } };
+      *v++ = (slsTileVertex){ { px1, py1 }, { u1, v1 } };
+      *v++ = (slsTileVertex){ { px0, py1 }, { u0, v1 } };
+      n_quads++;
+    }
+  }
+
+  chunk->n_quads = n_quads;
+  chunk->dirty = false;
+  if (n_quads == 0 && !chunk->vao) {
+    return;
+  }
+
+  if (!chunk->vao) {
+    glGenVertexArrays(1, &chunk->vao);
+    glGenBuffers(1, &chunk->vbo);
+
+    glBindVertexArray(chunk->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, chunk->vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, self->ibo);
+    glVertexAttribPointer(SLS_ATTRIB_POSITION,
+                          2,
+                          GL_FLOAT,
+                          GL_FALSE,
+                          sizeof(slsTileVertex),
+                          (void*)offsetof(slsTileVertex, position));
+    glVertexAttribPointer(SLS_ATTRIB_UV,
+                          2,
+                          GL_UNSIGNED_SHORT,
+                          GL_TRUE,
+                          sizeof(slsTileVertex),
+                          (void*)offsetof(slsTileVertex, uv));
+    glEnableVertexAttribArray(SLS_ATTRIB_POSITION);
+    glEnableVertexAttribArray(SLS_ATTRIB_UV);
+    glBindVertexArray(0);
+  } else {
+    glBindBuffer(GL_ARRAY_BUFFER, chunk->vbo);
+  }
+
+  // respecifying the store lets the driver orphan the old one
+  glBufferData(GL_ARRAY_BUFFER,
+               (GLsizeiptr)(n_quads * 4 * sizeof(slsTileVertex)),
+               self->scratch,
+               GL_STATIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+size_t sls_tilemap_update(slsTileMap* self)
+{
+  if (self->n_dirty == 0) {
+    return 0;
+  }
+  if (!self->ibo && !sls_tilemap_setup_buffers(self)) {
+    return 0;
+  }
+
+  for (size_t i = 0; i < self->n_dirty; ++i) {
+    sls_tilemap_rebuild_chunk(self, self->dirty[i]);
+  }
+
+  size_t n_rebuilt = self->n_dirty;
+  self->n_dirty = 0;
+  return n_rebuilt;
+}
+
+size_t sls_tilemap_draw(slsTileMap* self, kmVec2 view_min, kmVec2 view_max)
+{
+  sls_tilemap_update(self);
+
+  slsTileChunkRange range = sls_tilemap_cull(self, view_min, view_max);
+  if (range.x0 == range.x1) {
+    return 0;
+  }
+
+  sls_texture_bind(self->texture, 0);
+  glVertexAttrib4f(SLS_ATTRIB_COLOR, 1.f, 1.f, 1.f, 1.f);
+
+  size_t n_draws = 0;
+  for (size_t cy = range.y0; cy < range.y1; ++cy) {
+    for (size_t cx = range.x0; cx < range.x1; ++cx) {
+      slsTileChunk const* chunk = self->chunks + cy * self->chunks_x + cx;
+      if (chunk->n_quads == 0) {
+        continue;
+      }
+      glBindVertexArray(chunk->vao);
+      glDrawElements(
+        GL_TRIANGLES, (GLsizei)(chunk->n_quads * 6), GL_UNSIGNED_SHORT, NULL);
+      n_draws++;
+    }
+  }
+  glBindVertexArray(0);
+
+  return n_draws;
+}
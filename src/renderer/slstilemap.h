@@ -0,0 +1,148 @@
+/**
+ * @file slstilemap.h
+ * @brief large 2D tile grids, drawn as static per-chunk vertex buffers
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#ifndef DANGERENGINE_SLSTILEMAP_H
+#define DANGERENGINE_SLSTILEMAP_H
+
+#include "../sls-gl.h"
+#include "slsatlas.h"
+#include <kazmath/kazmath.h>
+#include <slsmacros.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+SLS_BEGIN_CDECLS
+
+/**
+ * @brief tiles along each side of a chunk. A chunk's quads then fit 16 bit
+ * indices, and a 1000x1000 map is 32x32 chunks.
+ */
+#define SLS_TILEMAP_CHUNK_SIZE 32
+#define SLS_TILEMAP_CHUNK_TILES (SLS_TILEMAP_CHUNK_SIZE * SLS_TILEMAP_CHUNK_SIZE)
+
+/** @brief tile id of cells that draw nothing */
+#define SLS_TILE_EMPTY UINT16_MAX
+
+/** @brief index into the map's tile regions */
+typedef uint16_t slsTileId;
+
+/**
+ * @brief 12 byte vertex. The color attribute is left disabled and reads
+ * as opaque white.
+ */
+typedef struct slsTileVertex {
+  float position[2];
+  /** @brief unorm16 texture coordinates */
+  uint16_t uv[2];
+} slsTileVertex;
+
+typedef struct slsTileChunk {
+  GLuint vao;
+  GLuint vbo;
+  /** @brief non-empty tiles, which are packed at the start of the vbo */
+  uint32_t n_quads;
+  bool dirty;
+} slsTileChunk;
+
+/**
+ * @brief half-open range of chunks, [x0, x1) x [y0, y1)
+ */
+typedef struct slsTileChunkRange {
+  size_t x0, y0;
+  size_t x1, y1;
+} slsTileChunkRange;
+
+/**
+ * @brief Tile map.
+ * @detail Tile (x, y) covers [x, x + 1] x [y, y + 1] * tile_size in world
+ * space. All tile regions must share an atlas page, so a chunk is a single
+ * draw with one texture bound, and every chunk shares one index buffer.
+ * GL objects are created on the first update, so maps can be built and
+ * edited without a context.
+ */
+typedef struct slsTileMap {
+  size_t width;
+  size_t height;
+  float tile_size;
+  slsTileId* tiles;
+
+  slsAtlasRegion* regions;
+  size_t n_regions;
+  slsTexture* texture;
+
+  size_t chunks_x;
+  size_t chunks_y;
+  slsTileChunk* chunks;
+  /** @brief chunks awaiting a rebuild, each listed once */
+  size_t* dirty;
+  size_t n_dirty;
+
+  /** @brief quad indices for a full chunk */
+  GLuint ibo;
+  slsTileVertex* scratch;
+} slsTileMap;
+
+/**
+ * @brief creates a map of empty tiles
+ * @param regions tile images, copied. Tile id i draws regions[i].
+ * @return NULL if the regions span several textures
+ */
+slsTileMap* sls_tilemap_init(slsTileMap* self,
+                             size_t width,
+                             size_t height,
+                             float tile_size,
+                             slsAtlasRegion const* regions,
+                             size_t n_regions) SLS_NONNULL(1);
+
+slsTileMap* sls_tilemap_dtor(slsTileMap* self) SLS_NONNULL(1);
+
+slsTileId sls_tilemap_get(slsTileMap const* self, size_t x, size_t y)
+  SLS_NONNULL(1);
+
+/**
+ * @brief changes one tile, flagging its chunk for a rebuild. Out of range
+ * coordinates and unknown ids are ignored.
+ */
+void sls_tilemap_set(slsTileMap* self, size_t x, size_t y, slsTileId tile)
+  SLS_NONNULL(1);
+
+/**
+ * @brief sets every tile of a rectangle, clipped to the map
+ */
+void sls_tilemap_fill(slsTileMap* self,
+                      size_t x,
+                      size_t y,
+                      size_t width,
+                      size_t height,
+                      slsTileId tile) SLS_NONNULL(1);
+
+/**
+ * @return the chunks overlapping the world-space rectangle
+ * [view_min, view_max], empty if the view misses the map
+ */
+slsTileChunkRange sls_tilemap_cull(slsTileMap const* self,
+                                   kmVec2 view_min,
+                                   kmVec2 view_max) SLS_NONNULL(1);
+
+/**
+ * @brief rebuilds the vertex buffers of dirty chunks
+ * @return chunks rebuilt
+ */
+size_t sls_tilemap_update(slsTileMap* self) SLS_NONNULL(1);
+
+/**
+ * @brief updates dirty chunks and draws the non-empty chunks overlapping
+ * the view. Expects the tile shader to be bound.
+ * @return draw calls made
+ */
+size_t sls_tilemap_draw(slsTileMap* self, kmVec2 view_min, kmVec2 view_max)
+  SLS_NONNULL(1);
+
+SLS_END_CDECLS
+
+#endif // DANGERENGINE_SLSTILEMAP_H
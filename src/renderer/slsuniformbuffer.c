@@ -0,0 +1,136 @@
+/**
+ * @file slsuniformbuffer.c
+ * @brief
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#include "slsuniformbuffer.h"
+#include <slsutils.h>
+#include <string.h>
+
+static inline GLintptr sls_align_offset(GLintptr offset, GLint alignment)
+{
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
+slsMaterialBlock sls_material_block_make(kmVec3 specular,
+                                         kmVec3 diffuse,
+                                         kmVec3 ambient,
+                                         float shininess)
+{
+  slsMaterialBlock block = {
+    .specular_color = { specular.x, specular.y, specular.z, 0.f },
+    .diffuse_color = { diffuse.x, diffuse.y, diffuse.z, 0.f },
+    .ambient_color = { ambient.x, ambient.y, ambient.z },
+    .shininess = shininess
+  };
+  return block;
+}
+
+void sls_lights_block_set(slsLightsBlock* self,
+                          size_t i,
+                          kmVec3 ambient,
+                          kmVec3 diffuse,
+                          kmVec3 specular,
+                          kmVec4 position,
+                          kmMat4 const* modelview)
+{
+  if (i >= SLS_N_LIGHTS) {
+    sls_log_warn("light index %lu exceeds SLS_N_LIGHTS", i);
+    return;
+  }
+
+  memcpy(self->ambient_products[i], &ambient, sizeof(float[3]));
+  memcpy(self->diffuse_products[i], &diffuse, sizeof(float[3]));
+  memcpy(self->specular_products[i], &specular, sizeof(float[3]));
+  memcpy(self->light_positions[i], &position, sizeof(float[4]));
+  memcpy(self->light_modelview[i], modelview->mat, sizeof(float[16]));
+
+  if ((size_t)self->n_lights <= i) {
+    self->n_lights = (int32_t)i + 1;
+  }
+}
+
+slsUniformRing* sls_uniform_ring_init(slsUniformRing* self, size_t frame_size)
+{
+  *self = (slsUniformRing){};
+
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &self->alignment);
+  if (self->alignment <= 0) {
+    self->alignment = 256;
+  }
+
+  GLintptr region_size =
+    sls_align_offset((GLintptr)frame_size, self->alignment);
+  sls_streambuffer_init(&self->stream, (size_t)region_size);
+  sls_check(self->stream.buffer, "could not create uniform ring buffer");
+
+  return self;
+error:
+  return sls_uniform_ring_dtor(self);
+}
+
+slsUniformRing* sls_uniform_ring_dtor(slsUniformRing* self)
+{
+  sls_streambuffer_dtor(&self->stream);
+  return self;
+}
+
+void sls_uniform_ring_begin_frame(slsUniformRing* self)
+{
+  sls_streambuffer_begin_frame(&self->stream);
+}
+
+void sls_uniform_ring_end_frame(slsUniformRing* self)
+{
+  sls_streambuffer_end_frame(&self->stream);
+}
+
+GLintptr sls_uniform_ring_upload(slsUniformRing* self,
+                                 void const* data,
+                                 size_t size)
+{
+  return sls_streambuffer_write(
+    &self->stream, data, size, (size_t)self->alignment);
+}
+
+bool sls_uniform_ring_push_draw(slsUniformRing* self,
+                                slsMaterialBlock const* material,
+                                slsLightsBlock const* lights_opt)
+{
+  const size_t material_size = sizeof(slsMaterialBlock);
+  const size_t lights_offset =
+    (size_t)sls_align_offset((GLintptr)material_size, self->alignment);
+  const size_t total =
+    lights_opt ? lights_offset + sizeof(slsLightsBlock) : material_size;
+
+  GLintptr offset = -1;
+  char* dst = sls_streambuffer_alloc(
+    &self->stream, total, (size_t)self->alignment, &offset);
+  if (!dst) {
+    return false;
+  }
+
+  memcpy(dst, material, material_size);
+  if (lights_opt) {
+    memcpy(dst + lights_offset, lights_opt, sizeof(slsLightsBlock));
+  }
+  sls_streambuffer_commit(&self->stream);
+
+  glBindBufferRange(GL_UNIFORM_BUFFER,
+                    SLS_UBO_BINDING_MATERIAL,
+                    self->stream.buffer,
+                    offset,
+                    (GLsizeiptr)material_size);
+  if (lights_opt) {
+    glBindBufferRange(GL_UNIFORM_BUFFER,
+                      SLS_UBO_BINDING_LIGHTS,
+                      self->stream.buffer,
+                      offset + (GLintptr)lights_offset,
+                      (GLsizeiptr)sizeof(slsLightsBlock));
+  }
+
+  return true;
+}
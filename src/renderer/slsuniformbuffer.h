@@ -0,0 +1,148 @@
+/**
+ * @file slsuniformbuffer.h
+ * @brief std140 mirrors of the uniform blocks in uniforms.glsl, and a
+ * per-frame uniform buffer ring for uploading them
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#ifndef DANGERENGINE_SLSUNIFORMBUFFER_H
+#define DANGERENGINE_SLSUNIFORMBUFFER_H
+
+#include "../sls-gl.h"
+#include "slsshader.h"
+#include "slsstreambuffer.h"
+#include <kazmath/kazmath.h>
+#include <slsmacros.h>
+#include <stddef.h>
+#include <stdint.h>
+
+SLS_BEGIN_CDECLS
+
+/**
+ * @brief must match SLS_N_LIGHTS in resources/shaders/uniforms.glsl
+ */
+#define SLS_N_LIGHTS 8
+
+typedef struct slsMaterialBlock slsMaterialBlock;
+typedef struct slsLightsBlock slsLightsBlock;
+typedef struct slsUniformRing slsUniformRing;
+
+/**
+ * @brief std140 layout of the `Material` uniform block
+ * @detail vec3 members are 16-byte aligned; `shininess` packs into the
+ * tail of `ambient_color`
+ */
+struct slsMaterialBlock {
+  float specular_color[4];
+  float diffuse_color[4];
+  float ambient_color[3];
+  float shininess;
+};
+
+/**
+ * @brief std140 layout of the `Lights` uniform block
+ * @detail arrays of vec3 have a 16 byte stride under std140, so each
+ * element carries one float of padding
+ */
+struct slsLightsBlock {
+  int32_t n_lights;
+  int32_t pad_[3];
+  float ambient_products[SLS_N_LIGHTS][4];
+  float diffuse_products[SLS_N_LIGHTS][4];
+  float specular_products[SLS_N_LIGHTS][4];
+  float light_positions[SLS_N_LIGHTS][4];
+  float light_modelview[SLS_N_LIGHTS][16];
+};
+
+SLS_STATIC_ASSERT(offsetof(slsMaterialBlock, diffuse_color) == 16,
+                  "slsMaterialBlock must match std140 Material block");
+SLS_STATIC_ASSERT(offsetof(slsMaterialBlock, ambient_color) == 32,
+                  "slsMaterialBlock must match std140 Material block");
+SLS_STATIC_ASSERT(offsetof(slsMaterialBlock, shininess) == 44,
+                  "slsMaterialBlock must match std140 Material block");
+SLS_STATIC_ASSERT(sizeof(slsMaterialBlock) == 48,
+                  "slsMaterialBlock must match std140 Material block");
+SLS_STATIC_ASSERT(offsetof(slsLightsBlock, ambient_products) == 16,
+                  "slsLightsBlock must match std140 Lights block");
+SLS_STATIC_ASSERT(offsetof(slsLightsBlock, diffuse_products) == 144,
+                  "slsLightsBlock must match std140 Lights block");
+SLS_STATIC_ASSERT(offsetof(slsLightsBlock, specular_products) == 272,
+                  "slsLightsBlock must match std140 Lights block");
+SLS_STATIC_ASSERT(offsetof(slsLightsBlock, light_positions) == 400,
+                  "slsLightsBlock must match std140 Lights block");
+SLS_STATIC_ASSERT(offsetof(slsLightsBlock, light_modelview) == 528,
+                  "slsLightsBlock must match std140 Lights block");
+SLS_STATIC_ASSERT(sizeof(slsLightsBlock) == 1040,
+                  "slsLightsBlock must match std140 Lights block");
+
+/**
+ * @brief Uniform block uploads streamed through a slsStreamBuffer.
+ * @detail Each frame sub-allocates from its own region of the stream, at
+ * the driver's uniform buffer offset alignment, so uploads never touch
+ * memory the GPU may still be reading. The stream's per-region fences
+ * guard wrap-around.
+ */
+struct slsUniformRing {
+  slsStreamBuffer stream;
+  GLint alignment;
+};
+
+slsMaterialBlock sls_material_block_make(kmVec3 specular,
+                                         kmVec3 diffuse,
+                                         kmVec3 ambient,
+                                         float shininess);
+
+/**
+ * @brief writes light `i` into the block, growing `n_lights` if necessary
+ */
+void sls_lights_block_set(slsLightsBlock* self,
+                          size_t i,
+                          kmVec3 ambient,
+                          kmVec3 diffuse,
+                          kmVec3 specular,
+                          kmVec4 position,
+                          kmMat4 const* modelview) SLS_NONNULL(1, 7);
+
+/**
+ * @brief creates the ring's buffer object
+ * @param frame_size number of bytes available to each frame
+ */
+slsUniformRing* sls_uniform_ring_init(slsUniformRing* self, size_t frame_size)
+  SLS_NONNULL(1);
+
+slsUniformRing* sls_uniform_ring_dtor(slsUniformRing* self) SLS_NONNULL(1);
+
+/**
+ * @brief advances to the next frame region, waiting on its fence if the GPU
+ * has not yet consumed it
+ */
+void sls_uniform_ring_begin_frame(slsUniformRing* self) SLS_NONNULL(1);
+
+/**
+ * @brief fences the current frame region
+ */
+void sls_uniform_ring_end_frame(slsUniformRing* self) SLS_NONNULL(1);
+
+/**
+ * @brief copies `size` bytes into the current frame region
+ * @return buffer offset of the upload, or -1 if the region is full
+ */
+GLintptr sls_uniform_ring_upload(slsUniformRing* self,
+                                 void const* data,
+                                 size_t size) SLS_NONNULL(1, 2);
+
+/**
+ * @brief uploads a material and (optionally) light block for one draw in a
+ * single mapped write, then binds both ranges to their block bindings
+ * @return false if the frame region is full
+ */
+bool sls_uniform_ring_push_draw(slsUniformRing* self,
+                                slsMaterialBlock const* material,
+                                slsLightsBlock const* lights_opt)
+  SLS_NONNULL(1, 2);
+
+SLS_END_CDECLS
+
+#endif // DANGERENGINE_SLSUNIFORMBUFFER_H
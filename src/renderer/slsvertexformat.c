@@ -0,0 +1,286 @@
+/**
+ * @file slsvertexformat.c
+ * @brief
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#include "slsvertexformat.h"
+#include "slsmesh.h"
+#include <float.h>
+#include <math/slsMathUtils.h>
+#include <string.h>
+
+const slsVertexLayout SLS_VERTEX_LAYOUT_FLOAT = {.position = SLS_POSITION_FLOAT3,
+                                                 .normal = SLS_NORMAL_FLOAT3,
+                                                 .uv = SLS_UV_FLOAT2,
+                                                 .color = SLS_COLOR_FLOAT4 };
+
+const slsVertexLayout SLS_VERTEX_LAYOUT_PACKED = {
+  .position = SLS_POSITION_FLOAT3,
+  .normal = SLS_NORMAL_INT_2_10_10_10,
+  .uv = SLS_UV_HALF2,
+  .color = SLS_COLOR_UNORM8
+};
+
+const slsVertexLayout SLS_VERTEX_LAYOUT_COMPACT = {
+  .position = SLS_POSITION_UNORM16_AABB,
+  .normal = SLS_NORMAL_INT_2_10_10_10,
+  .uv = SLS_UV_UNORM16,
+  .color = SLS_COLOR_UNORM8
+};
+
+/*================================
+ * scalar packing
+ *================================*/
+
+static inline float sls_clampf(float x, float lo, float hi)
+{
+  return x < lo ? lo : (x > hi ? hi : x);
+}
+
+static inline uint16_t sls_pack_unorm16(float x)
+{
+  return (uint16_t)lrintf(sls_clampf(x, 0.f, 1.f) * 65535.f);
+}
+
+static inline uint8_t sls_pack_unorm8(float x)
+{
+  return (uint8_t)lrintf(sls_clampf(x, 0.f, 1.f) * 255.f);
+}
+
+static inline uint32_t sls_pack_snorm10(float x)
+{
+  return (uint32_t)lrintf(sls_clampf(x, -1.f, 1.f) * 511.f) & 0x3ff;
+}
+
+/**
+ * @brief packs xyz into GL_INT_2_10_10_10_REV, with w = 0
+ */
+static inline uint32_t sls_pack_snorm_2_10_10_10(float const* v)
+{
+  return sls_pack_snorm10(v[0]) | (sls_pack_snorm10(v[1]) << 10) |
+         (sls_pack_snorm10(v[2]) << 20);
+}
+
+/*================================
+ * format description
+ *================================*/
+
+static void sls_vertex_format_push(slsVertexFormat* self,
+                                   GLuint location,
+                                   GLint components,
+                                   GLenum type,
+                                   GLboolean normalized,
+                                   size_t size)
+{
+  self->attribs[self->n_attribs++] =
+    (slsVertexAttrib){.location = location,
+                      .components = components,
+                      .type = type,
+                      .normalized = normalized,
+                      .offset = self->stride };
+  self->stride += size;
+}
+
+slsVertexFormat* sls_vertex_format_init(slsVertexFormat* self,
+                                        slsVertexLayout layout)
+{
+  *self = (slsVertexFormat){.layout = layout,
+                            .position_scale = { 1.f, 1.f, 1.f } };
+
+  switch (layout.position) {
+    case SLS_POSITION_HALF3:
+      sls_vertex_format_push(
+        self, SLS_ATTRIB_POSITION, 3, GL_HALF_FLOAT, GL_FALSE, 8);
+      break;
+    case SLS_POSITION_UNORM16_AABB:
+      sls_vertex_format_push(
+        self, SLS_ATTRIB_POSITION, 3, GL_UNSIGNED_SHORT, GL_TRUE, 8);
+      break;
+    default:
+      sls_vertex_format_push(
+        self, SLS_ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, sizeof(float[3]));
+  }
+
+  switch (layout.normal) {
+    case SLS_NORMAL_INT_2_10_10_10:
+      sls_vertex_format_push(
+        self, SLS_ATTRIB_NORMAL, 4, GL_INT_2_10_10_10_REV, GL_TRUE, 4);
+      break;
+    default:
+      sls_vertex_format_push(
+        self, SLS_ATTRIB_NORMAL, 3, GL_FLOAT, GL_FALSE, sizeof(float[3]));
+  }
+
+  switch (layout.uv) {
+    case SLS_UV_HALF2:
+      sls_vertex_format_push(self, SLS_ATTRIB_UV, 2, GL_HALF_FLOAT, GL_FALSE, 4);
+      break;
+    case SLS_UV_UNORM16:
+      sls_vertex_format_push(
+        self, SLS_ATTRIB_UV, 2, GL_UNSIGNED_SHORT, GL_TRUE, 4);
+      break;
+    default:
+      sls_vertex_format_push(
+        self, SLS_ATTRIB_UV, 2, GL_FLOAT, GL_FALSE, sizeof(float[2]));
+  }
+
+  switch (layout.color) {
+    case SLS_COLOR_UNORM8:
+      sls_vertex_format_push(
+        self, SLS_ATTRIB_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, 4);
+      break;
+    default:
+      sls_vertex_format_push(
+        self, SLS_ATTRIB_COLOR, 4, GL_FLOAT, GL_FALSE, sizeof(float[4]));
+  }
+
+  return self;
+}
+
+bool sls_vertex_format_is_native(slsVertexFormat const* self)
+{
+  return memcmp(&self->layout,
+                &SLS_VERTEX_LAYOUT_FLOAT,
+                sizeof(slsVertexLayout)) == 0;
+}
+
+void sls_vertex_format_fit_bounds(slsVertexFormat* self,
+                                  slsVertex const* vertices,
+                                  size_t count)
+{
+  float lo[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+  float hi[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+  for (size_t i = 0; i < count; ++i) {
+    for (int c = 0; c < 3; ++c) {
+      float p = vertices[i].position[c];
+      lo[c] = p < lo[c] ? p : lo[c];
+      hi[c] = p > hi[c] ? p : hi[c];
+    }
+  }
+
+  for (int c = 0; c < 3; ++c) {
+    if (count == 0) {
+      lo[c] = hi[c] = 0.f;
+    }
+    float extent = hi[c] - lo[c];
+    self->position_bias[c] = lo[c];
+    // flat axes still need a non-zero scale to stay invertible
+    self->position_scale[c] = extent > 0.f ? extent : 1.f;
+  }
+}
+
+void sls_vertex_format_pack(slsVertexFormat const* self,
+                            slsVertex const* src,
+                            size_t count,
+                            void* dst)
+{
+  if (sls_vertex_format_is_native(self)) {
+    memcpy(dst, src, count * sizeof(slsVertex));
+    return;
+  }
+
+  slsVertexLayout const* l = &self->layout;
+  char* out = dst;
+
+  for (size_t i = 0; i < count; ++i, out += self->stride) {
+    slsVertex const* v = src + i;
+    char* p = out;
+
+    switch (l->position) {
+      case SLS_POSITION_HALF3: {
+        uint16_t h[4] = { sls_float_to_half(v->position[0]),
+                          sls_float_to_half(v->position[1]),
+                          sls_float_to_half(v->position[2]),
+                          0 };
+        memcpy(p, h, sizeof(h));
+        p += sizeof(h);
+      } break;
+      case SLS_POSITION_UNORM16_AABB: {
+        uint16_t q[4] = { 0 };
+        for (int c = 0; c < 3; ++c) {
+          q[c] = sls_pack_unorm16((v->position[c] - self->position_bias[c]) /
+                                  self->position_scale[c]);
+        }
+        memcpy(p, q, sizeof(q));
+        p += sizeof(q);
+      } break;
+      default:
+        memcpy(p, v->position, sizeof(float[3]));
+        p += sizeof(float[3]);
+    }
+
+    if (l->normal == SLS_NORMAL_INT_2_10_10_10) {
+      uint32_t n = sls_pack_snorm_2_10_10_10(v->normal);
+      memcpy(p, &n, sizeof(n));
+      p += sizeof(n);
+    } else {
+      memcpy(p, v->normal, sizeof(float[3]));
+      p += sizeof(float[3]);
+    }
+
+    switch (l->uv) {
+      case SLS_UV_HALF2: {
+        uint16_t h[2] = { sls_float_to_half(v->uv[0]),
+                          sls_float_to_half(v->uv[1]) };
+        memcpy(p, h, sizeof(h));
+        p += sizeof(h);
+      } break;
+      case SLS_UV_UNORM16: {
+        uint16_t q[2] = { sls_pack_unorm16(v->uv[0]),
+                          sls_pack_unorm16(v->uv[1]) };
+        memcpy(p, q, sizeof(q));
+        p += sizeof(q);
+      } break;
+      default:
+        memcpy(p, v->uv, sizeof(float[2]));
+        p += sizeof(float[2]);
+    }
+
+    if (l->color == SLS_COLOR_UNORM8) {
+      uint8_t c[4] = { sls_pack_unorm8(v->color[0]),
+                       sls_pack_unorm8(v->color[1]),
+                       sls_pack_unorm8(v->color[2]),
+                       sls_pack_unorm8(v->color[3]) };
+      memcpy(p, c, sizeof(c));
+    } else {
+      memcpy(p, v->color, sizeof(float[4]));
+    }
+  }
+}
+
+void sls_vertex_format_apply(slsVertexFormat const* self, GLintptr base_offset)
+{
+  for (size_t i = 0; i < self->n_attribs; ++i) {
+    slsVertexAttrib const* a = self->attribs + i;
+    glVertexAttribPointer(a->location,
+                          a->components,
+                          a->type,
+                          a->normalized,
+                          (GLsizei)self->stride,
+                          (GLvoid*)(base_offset + a->offset));
+    glEnableVertexAttribArray(a->location);
+  }
+}
+
+kmMat4* sls_vertex_format_dequant_matrix(slsVertexFormat const* self,
+                                         kmMat4* out)
+{
+  kmMat4Identity(out);
+  if (self->layout.position != SLS_POSITION_UNORM16_AABB) {
+    return out;
+  }
+
+  // column-major: scale on the diagonal, bias in the last column
+  out->mat[0] = self->position_scale[0];
+  out->mat[5] = self->position_scale[1];
+  out->mat[10] = self->position_scale[2];
+  out->mat[12] = self->position_bias[0];
+  out->mat[13] = self->position_bias[1];
+  out->mat[14] = self->position_bias[2];
+
+  return out;
+}
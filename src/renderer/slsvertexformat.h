@@ -0,0 +1,148 @@
+/**
+ * @file slsvertexformat.h
+ * @brief packed vertex layouts and the descriptors that drive their
+ * attribute setup
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#ifndef DANGERENGINE_SLSVERTEXFORMAT_H
+#define DANGERENGINE_SLSVERTEXFORMAT_H
+
+#include "../sls-gl.h"
+#include "slsshader.h"
+#include <kazmath/kazmath.h>
+#include <slsmacros.h>
+#include <stddef.h>
+
+SLS_BEGIN_CDECLS
+
+typedef struct slsVertex slsVertex;
+
+typedef enum slsPositionEncoding {
+  /** 3 x float32, 12 bytes */
+  SLS_POSITION_FLOAT3,
+  /** 3 x float16 + padding, 8 bytes */
+  SLS_POSITION_HALF3,
+  /**
+   * 3 x unorm16 + padding, 8 bytes. Quantised relative to the mesh bounds,
+   * see sls_vertex_format_dequant_matrix
+   */
+  SLS_POSITION_UNORM16_AABB
+} slsPositionEncoding;
+
+typedef enum slsNormalEncoding {
+  /** 3 x float32, 12 bytes */
+  SLS_NORMAL_FLOAT3,
+  /** GL_INT_2_10_10_10_REV snorm, 4 bytes */
+  SLS_NORMAL_INT_2_10_10_10
+} slsNormalEncoding;
+
+typedef enum slsUVEncoding {
+  /** 2 x float32, 8 bytes */
+  SLS_UV_FLOAT2,
+  /** 2 x float16, 4 bytes. Allows repeating coordinates */
+  SLS_UV_HALF2,
+  /** 2 x unorm16, 4 bytes. Coordinates are clamped to [0, 1] */
+  SLS_UV_UNORM16
+} slsUVEncoding;
+
+typedef enum slsColorEncoding {
+  /** 4 x float32, 16 bytes */
+  SLS_COLOR_FLOAT4,
+  /** 4 x unorm8, 4 bytes */
+  SLS_COLOR_UNORM8
+} slsColorEncoding;
+
+typedef struct slsVertexLayout {
+  slsPositionEncoding position;
+  slsNormalEncoding normal;
+  slsUVEncoding uv;
+  slsColorEncoding color;
+} slsVertexLayout;
+
+/**
+ * @brief matches slsVertex exactly (48 bytes)
+ */
+extern const slsVertexLayout SLS_VERTEX_LAYOUT_FLOAT;
+
+/**
+ * @brief full precision positions, packed attributes (24 bytes)
+ */
+extern const slsVertexLayout SLS_VERTEX_LAYOUT_PACKED;
+
+/**
+ * @brief bounds-quantised positions, packed attributes (20 bytes)
+ */
+extern const slsVertexLayout SLS_VERTEX_LAYOUT_COMPACT;
+
+typedef struct slsVertexAttrib {
+  GLuint location;
+  GLint components;
+  GLenum type;
+  GLboolean normalized;
+  size_t offset;
+} slsVertexAttrib;
+
+/**
+ * @brief describes how a slsVertexLayout is laid out in memory, and how to
+ * reconstruct quantised positions
+ */
+typedef struct slsVertexFormat {
+  slsVertexLayout layout;
+
+  slsVertexAttrib attribs[SLS_ATTRIB_LOCATIONS_LAST];
+  size_t n_attribs;
+  size_t stride;
+
+  /**
+   * @brief for SLS_POSITION_UNORM16_AABB, position = bias + q * scale
+   */
+  float position_bias[3];
+  float position_scale[3];
+} slsVertexFormat;
+
+slsVertexFormat* sls_vertex_format_init(slsVertexFormat* self,
+                                        slsVertexLayout layout)
+  SLS_NONNULL(1);
+
+/**
+ * @brief true if the format is byte-for-byte identical to slsVertex
+ */
+bool sls_vertex_format_is_native(slsVertexFormat const* self) SLS_NONNULL(1);
+
+/**
+ * @brief sets the quantisation bounds to the AABB of `vertices`
+ */
+void sls_vertex_format_fit_bounds(slsVertexFormat* self,
+                                  slsVertex const* vertices,
+                                  size_t count) SLS_NONNULL(1, 2);
+
+/**
+ * @brief converts `count` vertices from slsVertex to this format
+ * @param dst must hold count * stride bytes
+ */
+void sls_vertex_format_pack(slsVertexFormat const* self,
+                            slsVertex const* src,
+                            size_t count,
+                            void* dst) SLS_NONNULL(1, 2, 4);
+
+/**
+ * @brief calls glVertexAttribPointer for each attribute, reading from the
+ * currently bound GL_ARRAY_BUFFER starting at `base_offset`
+ */
+void sls_vertex_format_apply(slsVertexFormat const* self, GLintptr base_offset)
+  SLS_NONNULL(1);
+
+/**
+ * @brief matrix mapping quantised positions back to model space.
+ * Premultiply it into the model matrix of meshes using
+ * SLS_POSITION_UNORM16_AABB; it is the identity for other encodings.
+ */
+kmMat4* sls_vertex_format_dequant_matrix(slsVertexFormat const* self,
+                                         kmMat4* out) SLS_NONNULL(1, 2);
+
+SLS_END_CDECLS
+
+#endif // DANGERENGINE_SLSVERTEXFORMAT_H
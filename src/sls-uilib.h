@@ -0,0 +1,31 @@
+/**
+ * @file sls-uilib.h
+ * @brief nuklear immediate-mode UI with its SDL/GL3 backend. Every
+ * translation unit must see the same configuration, so include nuklear
+ * through this header only.
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#ifndef DANGERENGINE_SLS_UILIB_H
+#define DANGERENGINE_SLS_UILIB_H
+
+#include "sls-gl.h"
+
+#define NK_INCLUDE_FIXED_TYPES
+#define NK_INCLUDE_STANDARD_IO
+#define NK_INCLUDE_STANDARD_VARARGS
+#define NK_INCLUDE_DEFAULT_ALLOCATOR
+#define NK_INCLUDE_VERTEX_BUFFER_OUTPUT
+#define NK_INCLUDE_FONT_BAKING
+#define NK_INCLUDE_DEFAULT_FONT
+
+#include <nuklear.h>
+#include <nuklear_sdl_gl3.h>
+
+/** @brief vertex and element buffer sizes handed to nk_sdl_render */
+#define SLS_UI_MAX_VERTEX_BUFFER (512 * 1024)
+#define SLS_UI_MAX_ELEMENT_BUFFER (128 * 1024)
+
+#endif // DANGERENGINE_SLS_UILIB_H
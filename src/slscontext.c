@@ -7,10 +7,26 @@
 #include "contexthandlers.h"
 #include "renderer/slsrender.h"
 #include "math/math-types.h"
+#include "renderer/slsglnull.h"
+#include "renderer/slsglrecord.h"
 #include "renderer/slssprite.h"
+#include "renderer/slsshadercache.h"
+#include "renderer/slsprofiler.h"
+#include "renderer/slsrenderscale.h"
+#include "renderer/slstexture.h"
+#include "sls-uilib.h"
+#include "slsheadless.h"
+#include "slsjobs.h"
 
 
 #define SLS_TICKS_PER_SEC 1000
+
+/** @brief textures uploaded per frame, bounding the time spent in pump */
+#define SLS_TEXTURE_UPLOADS_PER_FRAME 2
+
+/** @brief timestep of headless runs, which ignore wall-clock time */
+#define SLS_HEADLESS_DT (1.0 / 60.0)
+
 #ifdef GLAD_DEBUG
 
 
@@ -19,6 +35,23 @@ struct slsContext_p {
   uint64_t ticks_since_draw;
   slsIPoint last_size;
   slsRendererGL renderer;
+  slsShaderCache shader_cache;
+  slsJobQueue jobs;
+  slsTextureLoader textures;
+
+  slsProfiler profiler;
+  /** @brief nuklear context, drawing the profiler overlay */
+  struct nk_context *nk;
+  bool show_profiler;
+
+  /** @brief GPU budget of the scene in ms, 0 renders at native size */
+  double render_budget_ms;
+  bool render_scale_enabled;
+  slsRenderScale render_scale;
+
+  slsHeadlessGL headless;
+  /** @brief duration of each headless frame, in milliseconds */
+  double *frame_ms;
   // demo resources
 
   slsShader shader;
@@ -28,6 +61,12 @@ struct slsContext_p {
 
 static void pre_gl_call(char const *name, void *glfunc, int len_args, ...)
 {
+  if (sls_glrecord_active()) {
+    va_list args;
+    va_start(args, len_args);
+    sls_glrecord_call(name, len_args, args);
+    va_end(args);
+  }
 }
 
 
@@ -89,6 +128,30 @@ static void debug_message_cb(GLenum source,
 
 #endif
 
+/**
+ * @brief installs the GL debug callbacks, and starts recording GL calls if
+ * the SLS_GL_CAPTURE environment variable names a log file
+ */
+static void sls_context_setup_gl_hooks(void)
+{
+  char const *capture = getenv("SLS_GL_CAPTURE");
+#ifdef GLAD_DEBUG
+  if (GLAD_GL_ARB_debug_output) {
+    glDebugMessageCallback(debug_message_cb, NULL);
+  }
+  glad_set_pre_callback(pre_gl_call);
+  glad_set_post_callback(post_gl_call);
+
+  if (capture && *capture) {
+    sls_glrecord_start(capture);
+  }
+#else
+  if (capture && *capture) {
+    sls_log_warn("GL capture needs a debug glad loader");
+  }
+#endif
+}
+
 
 /*----------------------------------------*
  * slsContext static prototype
@@ -203,12 +266,8 @@ slsContext *sls_context_init(slsContext *self,
   int major, minor;
   SDL_GL_GetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, &major);
   SDL_GL_GetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, &minor);
-  if (GLAD_GL_ARB_debug_output) {
-    glDebugMessageCallback(debug_message_cb, NULL);
-  }
-  glad_set_pre_callback(pre_gl_call);
-  glad_set_post_callback(post_gl_call);
 #endif
+  sls_context_setup_gl_hooks();
 
   // allocate and initialize private members
 
@@ -223,6 +282,125 @@ error:
   return sls_context_dtor(self);
 }
 
+slsContext *sls_context_new_headless(size_t width,
+                                     size_t height,
+                                     long n_frames)
+{
+  slsContext *self = malloc(sizeof(slsContext));
+  sls_checkmem(self);
+
+  if (!sls_context_init_headless(self, width, height, n_frames)) {
+    free(self);
+    return NULL;
+  }
+  return self;
+error:
+  sls_log_err("fatal: memory error for slsContext");
+  exit(EXIT_FAILURE);
+}
+
+slsContext *sls_context_init_headless(slsContext *self,
+                                      size_t width,
+                                      size_t height,
+                                      long n_frames)
+{
+  *self = *sls_context_prototype();
+  self->headless = true;
+  self->max_frames = n_frames;
+  self->interval = 0;
+
+  if (!sls_is_active()) {
+    sls_check(sls_init_headless(), "initialization failed!");
+  }
+
+  self->priv = calloc(1, sizeof(slsContext_p));
+  sls_checkmem(self->priv);
+
+  if (sls_glnull_requested()) {
+    sls_check(sls_glnull_load(), "could not load the null GL backend");
+    self->priv->headless.width = (int) width;
+    self->priv->headless.height = (int) height;
+  } else {
+    sls_check(
+        sls_headless_init(&self->priv->headless, (int) width, (int) height),
+        "could not create a headless GL context");
+  }
+  sls_context_setup_gl_hooks();
+  self->priv->frame_ms = calloc(n_frames > 0 ? (size_t) n_frames : 1,
+                                sizeof(double));
+  sls_checkmem(self->priv->frame_ms);
+
+  sls_renderer_init(&self->priv->renderer, (int) width, (int) height);
+
+  return self;
+error:
+  sls_context_dtor(self);
+  return NULL;
+}
+
+static int sls_cmp_frame_ms(void const *a, void const *b)
+{
+  double x = *(double const *) a, y = *(double const *) b;
+  return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+/**
+ * @brief logs statistics of the frame times recorded by a headless run
+ */
+static void sls_context_report_frames(slsContext *self, long n_frames)
+{
+  if (n_frames <= 0) {
+    return;
+  }
+
+  double *sorted = self->priv->frame_ms;
+  double total = 0.0;
+  for (long i = 0; i < n_frames; ++i) {
+    total += sorted[i];
+  }
+  qsort(sorted, (size_t) n_frames, sizeof(double), sls_cmp_frame_ms);
+
+  size_t n = (size_t) n_frames;
+  sls_log_info("%ld frames in %.1f ms (%.1f fps): min %.3f, median %.3f, "
+               "avg %.3f, p99 %.3f, max %.3f ms",
+               n_frames,
+               total,
+               1000.0 * n_frames / total,
+               sorted[0],
+               sorted[n / 2],
+               total / n_frames,
+               sorted[(size_t) ceil(0.99 * n) - 1],
+               sorted[n - 1]);
+}
+
+/**
+ * @brief renders max_frames frames back to back, timing each
+ */
+static void sls_context_run_headless(slsContext *self)
+{
+  slsContext_p *priv = self->priv;
+  double tick_ms = 1000.0 / (double) SDL_GetPerformanceFrequency();
+
+  sls_context_setup(self);
+  sls_context_resize(self, priv->headless.width, priv->headless.height);
+
+  self->frame_n = 0;
+  while (self->is_running && self->frame_n < self->max_frames) {
+    uint64_t start = SDL_GetPerformanceCounter();
+
+    sls_context_update(self, SLS_HEADLESS_DT);
+    sls_context_display(self, SLS_HEADLESS_DT);
+    sls_context_pollevents(self);
+
+    priv->frame_ms[self->frame_n] =
+        (double) (SDL_GetPerformanceCounter() - start) * tick_ms;
+    self->frame_n++;
+  }
+
+  sls_context_report_frames(self, self->frame_n);
+  sls_context_teardown(self);
+}
+
 void sls_context_run(slsContext *self)
 {
   if (!self->priv) {
@@ -233,16 +411,19 @@ void sls_context_run(slsContext *self)
 
   self->is_running = true;
 
+  if (self->headless) {
+    sls_context_run_headless(self);
+    return;
+  }
+
   sls_context_setup(self);
 
   self->frame_n = 0;
 
   // setup render size
-  int x, y, w, h;
-
-  SDL_GetWindowSize(self->window, &w, &h);
-
-  sls_context_resize(self, w * 2, h * 2);
+  int w, h;
+  sls_context_drawable_size(self, &w, &h);
+  sls_context_resize(self, w, h);
 
   while (self->is_running) {
     sls_context_iter(self);
@@ -259,7 +440,14 @@ slsContext *sls_context_dtor(slsContext *self)
   // free private members
   if (self->priv) {
     sls_renderer_dtor(&self->priv->renderer);
+    sls_shadercache_dtor(&self->priv->shader_cache);
+    sls_textureloader_dtor(&self->priv->textures);
+    sls_jobqueue_dtor(&self->priv->jobs);
+    sls_headless_dtor(&self->priv->headless);
+    sls_glrecord_stop();
+    free(self->priv->frame_ms);
     free(self->priv);
+    self->priv = NULL;
   }
   return self;
 }
@@ -303,12 +491,78 @@ void sls_context_iter(slsContext *self)
   }
 }
 
+void sls_context_drawable_size(slsContext *self, int *width, int *height)
+{
+  if (self->headless) {
+    *width = self->priv->headless.width;
+    *height = self->priv->headless.height;
+  } else {
+    // differs from the window size on HiDPI displays
+    SDL_GL_GetDrawableSize(self->window, width, height);
+  }
+}
+
 void sls_context_resize(slsContext *self, int x, int y)
 {
   glViewport(0, 0, (int) x, (int) y);
 
   if (self->priv) {
+    self->priv->last_size = (slsIPoint) {x, y};
     sls_renderer_resize(&self->priv->renderer, x, y);
+    if (self->priv->render_scale_enabled) {
+      sls_renderscale_resize(&self->priv->render_scale, x, y);
+    }
+  }
+}
+
+void sls_context_set_render_budget(slsContext *self, double gpu_ms)
+{
+  if (self->priv) {
+    self->priv->render_budget_ms = gpu_ms > 0.0 ? gpu_ms : 0.0;
+  }
+}
+
+/**
+ * @brief starts dynamic resolution if a budget is set. Needs GPU timings
+ * from the profiler.
+ */
+static void sls_context_setup_render_scale(slsContext *self)
+{
+  slsContext_p *priv = self->priv;
+  char const *budget = getenv("SLS_RENDER_BUDGET_MS");
+  if (budget) {
+    priv->render_budget_ms = atof(budget);
+  }
+  if (priv->render_budget_ms <= 0.0) {
+    return;
+  }
+  if (!priv->profiler.gpu_enabled) {
+    sls_log_warn("dynamic resolution needs GPU timer queries, "
+                 "rendering at native size");
+    return;
+  }
+
+  slsRenderScaleParams params = SLS_RENDERSCALE_DEFAULT_PARAMS;
+  params.target_ms = priv->render_budget_ms;
+  sls_renderscale_init(&priv->render_scale, &params);
+  priv->render_scale_enabled = true;
+  if (priv->last_size.x > 0 && priv->last_size.y > 0) {
+    sls_renderscale_resize(&priv->render_scale,
+                           priv->last_size.x,
+                           priv->last_size.y);
+  }
+  sls_log_info("dynamic resolution: %.1f ms GPU budget", params.target_ms);
+}
+
+/**
+ * @brief feeds the scene's latest GPU time to the render scale
+ */
+static void sls_context_update_render_scale(slsContext *self)
+{
+  slsContext_p *priv = self->priv;
+  if (sls_renderscale_feed_profiler(
+        &priv->render_scale, &priv->profiler, "scene")) {
+    sls_log_info("render scale %.0f%%", priv->render_scale.scale * 100.f);
   }
 }
 
@@ -318,6 +572,9 @@ void sls_context_update(slsContext *self, double dt)
 
 void sls_context_display(slsContext *self, double dt)
 {
+  slsProfiler *prof = &self->priv->profiler;
+  sls_profiler_begin_frame(prof);
+
   slsShader *s = &self->priv->shader;
   kmMat4 mvp;
   kmMat4OrthographicProjection(&mvp, -1.f, 1.f, -1.f, 1.f, -1.f, 1000.f);
@@ -326,11 +583,54 @@ void sls_context_display(slsContext *self, double dt)
 
   glClearColor(0.0, 1.0, 0.0, 1.0);
   slsRendererGL *r = &self->priv->renderer;
+  sls_profiler_begin(prof, "texture uploads");
+  sls_textureloader_pump(&self->priv->textures,
+                         SLS_TEXTURE_UPLOADS_PER_FRAME);
+  sls_profiler_end(prof);
+
+  // the window, or the headless context's framebuffer
+  GLuint output_fbo = self->headless ? self->priv->headless.fbo : 0;
+  bool scaled = self->priv->render_scale_enabled;
+
+  sls_profiler_begin(prof, "scene");
+  if (scaled) {
+    sls_renderscale_begin(&self->priv->render_scale);
+  }
   glUseProgram(self->priv->shader.program);
+  sls_renderer_begin_frame(r);
   sls_renderer_clear(r);
   sls_sprite_draw(&self->priv->sprite, r);
+  sls_renderer_end_frame(r);
+  sls_profiler_end(prof);
 
-  sls_renderer_swap(r, self);
+  if (scaled) {
+    sls_profiler_begin(prof, "upscale");
+    sls_renderscale_end(&self->priv->render_scale, output_fbo);
+    sls_profiler_end(prof);
+  }
+
+  if (self->priv->show_profiler && self->priv->nk) {
+    sls_profiler_begin(prof, "overlay");
+    sls_profiler_draw_overlay(prof, self->priv->nk);
+    nk_sdl_render(NK_ANTI_ALIASING_ON,
+                  SLS_UI_MAX_VERTEX_BUFFER,
+                  SLS_UI_MAX_ELEMENT_BUFFER);
+    sls_profiler_end(prof);
+  }
+
+  sls_profiler_begin(prof, "swap");
+  if (self->headless) {
+    sls_headless_present(&self->priv->headless);
+  } else {
+    sls_renderer_swap(r, self);
+  }
+  sls_profiler_end(prof);
+  sls_glrecord_frame();
+
+  sls_profiler_end_frame(prof);
+  if (scaled) {
+    sls_context_update_render_scale(self);
+  }
 
 
 }
@@ -348,18 +648,36 @@ void sls_context_setup(slsContext *self)
   sls_log_info("openGL version %s", glGetString(GL_VERSION));
 
 
-  int x, y;
-  SDL_GetWindowSize(self->window, &x, &y);
+  if (!self->headless) {
+    int x, y;
+    sls_context_drawable_size(self, &x, &y);
+    sls_context_resize(self, x, y);
+  }
+
+  sls_checkmem(sls_shadercache_init(&priv->shader_cache, NULL));
+  GLuint program = sls_shadercache_program(&priv->shader_cache,
+                                           SLS_DEFAULT_VS, SLS_DEFAULT_FS,
+                                           SLS_DEFAULT_UNIFORMS);
+  sls_checkmem(sls_shader_init(&priv->shader, program));
+  sls_shadercache_log_stats(&priv->shader_cache);
 
-  sls_context_resize(self, x * 2, y * 2);
+  sls_profiler_init(&priv->profiler, true);
+  sls_context_setup_render_scale(self);
+  if (self->window) {
+    priv->nk = nk_sdl_init(self->window);
+    struct nk_font_atlas *atlas;
+    nk_sdl_font_stash_begin(&atlas);
+    nk_sdl_font_stash_end();
+  }
 
-  sls_checkmem(
-      sls_shader_from_sources(&self->priv->shader,
-                              SLS_DEFAULT_VS, SLS_DEFAULT_FS,
-                              SLS_DEFAULT_UNIFORMS));
+  sls_checkmem(sls_jobqueue_init(&priv->jobs, 0));
+  sls_checkmem(sls_textureloader_init(&priv->textures, &priv->jobs));
+  priv->renderer.jobs = &priv->jobs;
 
   // setup sprite
   sls_checkmem(sls_sprite_init(&self->priv->sprite, SLS_DEFAULT_TRANSFORM));
+  priv->sprite.texture =
+    sls_textureloader_load(&priv->textures, "resources/sheet_tanks.png");
 
   return;
 error:
@@ -375,14 +693,24 @@ void sls_context_pollevents(slsContext *self)
 
   SDL_Event e;
 
-  if (!self->window) {
+  if (!self->window && !self->headless) {
     abort();
   }
 
   if (self->is_running) {
+    struct nk_context *nk = self->priv ? self->priv->nk : NULL;
+    if (nk) {
+      nk_input_begin(nk);
+    }
     while (SDL_PollEvent(&e)) {
+      if (nk && self->priv->show_profiler) {
+        nk_sdl_handle_event(&e);
+      }
       sls_context_handle_event(self, &e);
     }
+    if (nk) {
+      nk_input_end(nk);
+    }
   }
 }
 
@@ -391,7 +719,8 @@ static inline void _sls_context_windowevent(slsContext *self,
 {
   switch (we->event) {
     case SDL_WINDOWEVENT_RESIZED: {
-      int w = we->data1 * 2, h = we->data2 * 2;
+      int w, h;
+      sls_context_drawable_size(self, &w, &h);
       sls_context_resize(self, w, h);
     }
       break;
@@ -409,6 +738,17 @@ void sls_context_handle_event(slsContext *self, SDL_Event const *e)
     case SDL_WINDOWEVENT:
       _sls_context_windowevent(self, &e->window);
       break;
+    case SDL_KEYDOWN:
+      if (!self->priv) {
+        break;
+      }
+      // F3 toggles the profiler overlay, F4 saves the profile
+      if (e->key.keysym.sym == SDLK_F3) {
+        self->priv->show_profiler = !self->priv->show_profiler;
+      } else if (e->key.keysym.sym == SDLK_F4) {
+        sls_profiler_save_json(&self->priv->profiler, "profile.json");
+      }
+      break;
     default:
       break;
   }
@@ -417,6 +757,20 @@ void sls_context_handle_event(slsContext *self, SDL_Event const *e)
 
 void sls_context_teardown(slsContext *self)
 {
+  char const *profile_path = getenv("SLS_PROFILE_JSON");
+  if (profile_path) {
+    sls_profiler_save_json(&self->priv->profiler, profile_path);
+  }
+  if (self->priv->nk) {
+    nk_sdl_shutdown();
+    self->priv->nk = NULL;
+  }
+  sls_profiler_dtor(&self->priv->profiler);
+  if (self->priv->render_scale_enabled) {
+    sls_renderscale_dtor(&self->priv->render_scale);
+    self->priv->render_scale_enabled = false;
+  }
+
   sls_sprite_dtor(&self->priv->sprite);
   sls_shader_dtor(&self->priv->shader);
 }
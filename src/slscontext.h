@@ -24,6 +24,12 @@ struct slsContext {
 
 
   long frame_n;
+  /**
+   * @brief headless contexts have no window, render offscreen, and stop
+   * after max_frames frames
+   */
+  bool headless;
+  long max_frames;
 
   bool is_running;
   uint64_t interval;
@@ -38,6 +44,15 @@ sls_context_prototype();
 slsContext*
 sls_context_new(char const* caption, size_t width, size_t height);
 
+/**
+ * @brief creates a context without a window, through EGL.
+ * @detail sls_context_run then renders `n_frames` frames as fast as
+ * possible with a fixed timestep, and logs frame time statistics.
+ * @return NULL if the build or the machine cannot create one
+ */
+slsContext*
+sls_context_new_headless(size_t width, size_t height, long n_frames);
+
 slsContext*
 sls_context_dtor(slsContext* self);
 
@@ -68,6 +83,24 @@ sls_context_iter(slsContext* self) SLS_NONNULL(1);
 void
 sls_context_resize(slsContext* self, int x, int y) SLS_NONNULL(1);
 
+/**
+ * @brief size of the window's framebuffer in pixels, which is larger than
+ * the window size on HiDPI displays
+ */
+void
+sls_context_drawable_size(slsContext* self, int* width, int* height)
+  SLS_NONNULL(1, 2, 3);
+
+/**
+ * @brief enables dynamic resolution: the scene renders offscreen at a
+ * scale that keeps its GPU time under `gpu_ms`, and is upscaled to the
+ * window. 0 renders at native size. Call before sls_context_run; the
+ * SLS_RENDER_BUDGET_MS environment variable overrides it.
+ */
+void
+sls_context_set_render_budget(slsContext* self, double gpu_ms)
+  SLS_NONNULL(1);
+
 void
 sls_context_update(slsContext* self, double dt) SLS_NONNULL(1);
 
@@ -80,6 +113,12 @@ sls_context_init(slsContext* self,
                  size_t width,
                  size_t height) SLS_NONNULL(1);
 
+slsContext*
+sls_context_init_headless(slsContext* self,
+                          size_t width,
+                          size_t height,
+                          long n_frames) SLS_NONNULL(1);
+
 void
 sls_context_setup(slsContext* self) SLS_NONNULL(1);
 
@@ -0,0 +1,215 @@
+/**
+ * @file slsheadless.c
+ * @brief
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#include "slsheadless.h"
+#include "slsutils.h"
+#include <config.h>
+#include <string.h>
+
+#ifdef SLS_HAVE_EGL
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+bool sls_headless_available(void)
+{
+  return true;
+}
+
+static EGLDisplay sls_headless_display()
+{
+  char const* client_exts = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+
+  if (client_exts && strstr(client_exts, "EGL_MESA_platform_surfaceless")) {
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+      (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress(
+        "eglGetPlatformDisplayEXT");
+    if (get_platform_display) {
+      EGLDisplay display = get_platform_display(
+        EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+      if (display != EGL_NO_DISPLAY) {
+        return display;
+      }
+    }
+  }
+
+  return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+slsHeadlessGL* sls_headless_init(slsHeadlessGL* self, int width, int height)
+{
+  *self = (slsHeadlessGL){};
+
+  EGLDisplay display = sls_headless_display();
+  sls_check(display != EGL_NO_DISPLAY, "no EGL display");
+  self->display = display;
+
+  EGLint major = 0, minor = 0;
+  sls_check(eglInitialize(display, &major, &minor),
+            "eglInitialize failed: 0x%x",
+            eglGetError());
+  sls_log_info(
+    "EGL %d.%d, %s", major, minor, eglQueryString(display, EGL_VENDOR));
+
+  EGLint const config_attribs[] = { EGL_SURFACE_TYPE,
+                                    EGL_PBUFFER_BIT,
+                                    EGL_RENDERABLE_TYPE,
+                                    EGL_OPENGL_BIT,
+                                    EGL_RED_SIZE,
+                                    8,
+                                    EGL_GREEN_SIZE,
+                                    8,
+                                    EGL_BLUE_SIZE,
+                                    8,
+                                    EGL_NONE };
+  EGLConfig config;
+  EGLint n_configs = 0;
+  sls_check(
+    eglChooseConfig(display, config_attribs, &config, 1, &n_configs) &&
+      n_configs > 0,
+    "no suitable EGL config");
+  sls_check(eglBindAPI(EGL_OPENGL_API), "EGL cannot bind desktop GL");
+
+  // same version ladder as windowed contexts
+  static const EGLint versions[][2] = { { 4, 5 }, { 4, 1 }, { 3, 3 } };
+  for (size_t i = 0; !self->context && i < SLS_ARRAY_COUNT(versions); ++i) {
+    EGLint const context_attribs[] = { EGL_CONTEXT_MAJOR_VERSION,
+                                       versions[i][0],
+                                       EGL_CONTEXT_MINOR_VERSION,
+                                       versions[i][1],
+                                       EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                                       EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                       EGL_NONE };
+    EGLContext context =
+      eglCreateContext(display, config, EGL_NO_CONTEXT, context_attribs);
+    if (context != EGL_NO_CONTEXT) {
+      self->context = context;
+    }
+  }
+  sls_check(self->context, "could not create a core profile EGL context");
+
+  // rendering goes to the FBO, so a surface is only needed when the
+  // context cannot be made current without one
+  char const* exts = eglQueryString(display, EGL_EXTENSIONS);
+  EGLSurface surface = EGL_NO_SURFACE;
+  if (!exts || !strstr(exts, "EGL_KHR_surfaceless_context")) {
+    EGLint const pbuffer_attribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+    surface = eglCreatePbufferSurface(display, config, pbuffer_attribs);
+    sls_check(surface != EGL_NO_SURFACE, "could not create a pbuffer");
+    self->surface = surface;
+  }
+
+  sls_check(eglMakeCurrent(display, surface, surface, self->context),
+            "eglMakeCurrent failed: 0x%x",
+            eglGetError());
+  sls_check(gladLoadGLLoader((GLADloadproc)eglGetProcAddress),
+            "failed to load GL functions through EGL");
+  sls_log_info("headless renderer: %s", glGetString(GL_RENDERER));
+
+  glGenFramebuffers(1, &self->fbo);
+  glGenRenderbuffers(1, &self->color);
+  glGenRenderbuffers(1, &self->depth);
+  sls_headless_resize(self, width, height);
+
+  GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  sls_check(status == GL_FRAMEBUFFER_COMPLETE,
+            "headless framebuffer incomplete: 0x%x",
+            status);
+
+  return self;
+error:
+  sls_headless_dtor(self);
+  return NULL;
+}
+
+slsHeadlessGL* sls_headless_dtor(slsHeadlessGL* self)
+{
+  if (self->context) {
+    glDeleteFramebuffers(1, &self->fbo);
+    glDeleteRenderbuffers(1, &self->color);
+    glDeleteRenderbuffers(1, &self->depth);
+    eglMakeCurrent(
+      self->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(self->display, self->context);
+  }
+  if (self->surface) {
+    eglDestroySurface(self->display, self->surface);
+  }
+  if (self->display) {
+    eglTerminate(self->display);
+  }
+
+  *self = (slsHeadlessGL){};
+  return self;
+}
+
+void sls_headless_resize(slsHeadlessGL* self, int width, int height)
+{
+  self->width = width > 0 ? width : 1;
+  self->height = height > 0 ? height : 1;
+
+  glBindRenderbuffer(GL_RENDERBUFFER, self->color);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, self->width, self->height);
+  glBindRenderbuffer(GL_RENDERBUFFER, self->depth);
+  glRenderbufferStorage(
+    GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, self->width, self->height);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, self->fbo);
+  glFramebufferRenderbuffer(
+    GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, self->color);
+  glFramebufferRenderbuffer(
+    GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, self->depth);
+}
+
+void sls_headless_present(slsHeadlessGL* self)
+{
+  glFinish();
+}
+
+void sls_headless_read_pixels(slsHeadlessGL* self, void* rgba)
+{
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, self->fbo);
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  glReadPixels(
+    0, 0, self->width, self->height, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+}
+
+#else // !SLS_HAVE_EGL
+
+bool sls_headless_available(void)
+{
+  return false;
+}
+
+slsHeadlessGL* sls_headless_init(slsHeadlessGL* self, int width, int height)
+{
+  *self = (slsHeadlessGL){};
+  sls_log_err("headless contexts need EGL, which this build lacks");
+  return NULL;
+}
+
+slsHeadlessGL* sls_headless_dtor(slsHeadlessGL* self)
+{
+  *self = (slsHeadlessGL){};
+  return self;
+}
+
+void sls_headless_resize(slsHeadlessGL* self, int width, int height)
+{
+}
+
+void sls_headless_present(slsHeadlessGL* self)
+{
+}
+
+void sls_headless_read_pixels(slsHeadlessGL* self, void* rgba)
+{
+}
+
+#endif // SLS_HAVE_EGL
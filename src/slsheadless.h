@@ -0,0 +1,73 @@
+/**
+ * @file slsheadless.h
+ * @brief windowless GL context through EGL, rendering into a framebuffer
+ * object
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#ifndef DANGERENGINE_SLSHEADLESS_H
+#define DANGERENGINE_SLSHEADLESS_H
+
+#include "sls-gl.h"
+#include "slsmacros.h"
+#include <stdbool.h>
+
+SLS_BEGIN_CDECLS
+
+/**
+ * @brief A GL context with no window.
+ * @detail Prefers Mesa's surfaceless platform, which needs neither a
+ * display server nor a GPU (llvmpipe works), and falls back to the default
+ * display with a pbuffer. Rendering goes to an offscreen framebuffer,
+ * which stays bound as the default draw target.
+ */
+typedef struct slsHeadlessGL {
+  /** @brief EGLDisplay, EGLContext and EGLSurface, kept opaque */
+  void* display;
+  void* context;
+  void* surface;
+
+  GLuint fbo;
+  GLuint color;
+  GLuint depth;
+  int width;
+  int height;
+} slsHeadlessGL;
+
+/**
+ * @return true if this build can create headless contexts
+ */
+bool sls_headless_available(void);
+
+/**
+ * @brief creates the context, makes it current and loads GL functions
+ * @return NULL on failure
+ */
+slsHeadlessGL* sls_headless_init(slsHeadlessGL* self, int width, int height)
+  SLS_NONNULL(1);
+
+slsHeadlessGL* sls_headless_dtor(slsHeadlessGL* self) SLS_NONNULL(1);
+
+/**
+ * @brief reallocates the framebuffer's attachments
+ */
+void sls_headless_resize(slsHeadlessGL* self, int width, int height)
+  SLS_NONNULL(1);
+
+/**
+ * @brief ends a frame. Waits for rendering to finish, so measured frame
+ * times include the work and queued frames cannot pile up.
+ */
+void sls_headless_present(slsHeadlessGL* self) SLS_NONNULL(1);
+
+/**
+ * @brief copies the framebuffer into `rgba`, width * height * 4 bytes
+ */
+void sls_headless_read_pixels(slsHeadlessGL* self, void* rgba)
+  SLS_NONNULL(1, 2);
+
+SLS_END_CDECLS
+
+#endif // DANGERENGINE_SLSHEADLESS_H
@@ -0,0 +1,292 @@
+/**
+ * @file slsjobs.c
+ * @brief
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#include "slsjobs.h"
+#include "sls-gl.h"
+#include "slsutils.h"
+#include <string.h>
+
+static void* sls_jobqueue_worker(void* arg)
+{
+  slsJobQueue* self = arg;
+
+  pthread_mutex_lock(&self->lock);
+  for (;;) {
+    while (self->n_jobs == 0 && !self->stopping) {
+      pthread_cond_wait(&self->has_work, &self->lock);
+    }
+    if (self->n_jobs == 0 && self->stopping) {
+      break;
+    }
+
+    slsJob job = self->jobs[self->head];
+    self->head = (self->head + 1) % self->capacity;
+    self->n_jobs--;
+    self->n_running++;
+
+    pthread_mutex_unlock(&self->lock);
+    job.fn(job.data);
+    pthread_mutex_lock(&self->lock);
+
+    self->n_running--;
+    if (self->n_jobs == 0 && self->n_running == 0) {
+      pthread_cond_broadcast(&self->idle);
+    }
+  }
+  pthread_mutex_unlock(&self->lock);
+
+  return NULL;
+}
+
+slsJobQueue* sls_jobqueue_init(slsJobQueue* self, size_t n_threads)
+{
+  *self = (slsJobQueue){};
+
+  if (n_threads == 0) {
+    int cpus = SDL_GetCPUCount();
+    n_threads = cpus > 1 ? (size_t)cpus - 1 : 1;
+  }
+  if (n_threads > SLS_JOBS_MAX_THREADS) {
+    n_threads = SLS_JOBS_MAX_THREADS;
+  }
+
+  self->capacity = 64;
+  self->jobs = calloc(self->capacity, sizeof(slsJob));
+  sls_checkmem(self->jobs);
+
+  pthread_mutex_init(&self->lock, NULL);
+  pthread_cond_init(&self->has_work, NULL);
+  pthread_cond_init(&self->idle, NULL);
+
+  for (size_t i = 0; i < n_threads; ++i) {
+    int res =
+      pthread_create(self->threads + i, NULL, sls_jobqueue_worker, self);
+    if (res != 0) {
+      sls_log_warn("job queue: could only start %lu of %lu workers",
+                   i,
+                   n_threads);
+      break;
+    }
+    self->n_threads++;
+  }
+  sls_check(self->n_threads > 0, "job queue: no worker threads");
+
+  return self;
+error:
+  return sls_jobqueue_dtor(self);
+}
+
+slsJobQueue* sls_jobqueue_dtor(slsJobQueue* self)
+{
+  if (!self->jobs) {
+    return self;
+  }
+
+  pthread_mutex_lock(&self->lock);
+  self->stopping = true;
+  pthread_cond_broadcast(&self->has_work);
+  pthread_mutex_unlock(&self->lock);
+
+  for (size_t i = 0; i < self->n_threads; ++i) {
+    pthread_join(self->threads[i], NULL);
+  }
+
+  pthread_cond_destroy(&self->idle);
+  pthread_cond_destroy(&self->has_work);
+  pthread_mutex_destroy(&self->lock);
+
+  free(self->jobs);
+  self->jobs = NULL;
+  self->n_threads = 0;
+
+  return self;
+}
+
+/**
+ * @brief doubles the ring buffer, unwrapping it. Called with the lock held
+ */
+static bool sls_jobqueue_grow(slsJobQueue* self)
+{
+  size_t capacity = self->capacity * 2;
+  slsJob* jobs = calloc(capacity, sizeof(slsJob));
+  if (!jobs) {
+    return false;
+  }
+
+  for (size_t i = 0; i < self->n_jobs; ++i) {
+    jobs[i] = self->jobs[(self->head + i) % self->capacity];
+  }
+  free(self->jobs);
+
+  self->jobs = jobs;
+  self->head = 0;
+  self->capacity = capacity;
+  return true;
+}
+
+bool sls_jobqueue_submit(slsJobQueue* self, slsJobFn fn, void* data)
+{
+  pthread_mutex_lock(&self->lock);
+
+  if (self->n_jobs == self->capacity && !sls_jobqueue_grow(self)) {
+    pthread_mutex_unlock(&self->lock);
+    sls_log_err("job queue: out of memory");
+    return false;
+  }
+
+  size_t tail = (self->head + self->n_jobs) % self->capacity;
+  self->jobs[tail] = (slsJob){.fn = fn, .data = data };
+  self->n_jobs++;
+
+  pthread_cond_signal(&self->has_work);
+  pthread_mutex_unlock(&self->lock);
+
+  return true;
+}
+
+void sls_jobqueue_wait(slsJobQueue* self)
+{
+  pthread_mutex_lock(&self->lock);
+  while (self->n_jobs > 0 || self->n_running > 0) {
+    pthread_cond_wait(&self->idle, &self->lock);
+  }
+  pthread_mutex_unlock(&self->lock);
+}
+
+/**
+ * @brief state shared by a parallel_for's helpers. Reference counted,
+ * since helpers may start after the caller has returned.
+ */
+typedef struct slsParallelFor {
+  pthread_mutex_t lock;
+  pthread_cond_t done;
+
+  slsRangeFn fn;
+  void* data;
+  size_t count;
+  size_t grain;
+
+  size_t next;
+  size_t n_chunks;
+  size_t n_finished;
+  size_t refs;
+} slsParallelFor;
+
+static void sls_parallel_for_release(slsParallelFor* batch)
+{
+  pthread_mutex_lock(&batch->lock);
+  bool last = --batch->refs == 0;
+  pthread_mutex_unlock(&batch->lock);
+
+  if (last) {
+    pthread_cond_destroy(&batch->done);
+    pthread_mutex_destroy(&batch->lock);
+    free(batch);
+  }
+}
+
+/**
+ * @brief claims and runs chunks until none are left
+ */
+static void sls_parallel_for_run(slsParallelFor* batch)
+{
+  pthread_mutex_lock(&batch->lock);
+  while (batch->next < batch->n_chunks) {
+    size_t chunk = batch->next++;
+    pthread_mutex_unlock(&batch->lock);
+
+    size_t begin = chunk * batch->grain;
+    size_t end = begin + batch->grain < batch->count ? begin + batch->grain
+                                                     : batch->count;
+    batch->fn(batch->data, begin, end);
+
+    pthread_mutex_lock(&batch->lock);
+    if (++batch->n_finished == batch->n_chunks) {
+      pthread_cond_broadcast(&batch->done);
+    }
+  }
+  pthread_mutex_unlock(&batch->lock);
+}
+
+static void sls_parallel_for_helper(void* data)
+{
+  slsParallelFor* batch = data;
+  sls_parallel_for_run(batch);
+  sls_parallel_for_release(batch);
+}
+
+/**
+ * @brief runs every chunk on the calling thread, keeping the chunk
+ * boundaries callers may rely on
+ */
+static void sls_parallel_for_serial(size_t count,
+                                    size_t grain,
+                                    slsRangeFn fn,
+                                    void* data)
+{
+  for (size_t begin = 0; begin < count; begin += grain) {
+    fn(data, begin, count - begin > grain ? begin + grain : count);
+  }
+}
+
+bool sls_jobqueue_parallel_for(slsJobQueue* self,
+                               size_t count,
+                               size_t grain,
+                               slsRangeFn fn,
+                               void* data)
+{
+  if (grain == 0) {
+    grain = 1;
+  }
+  size_t n_chunks = (count + grain - 1) / grain;
+  if (n_chunks <= 1 || self->n_threads == 0) {
+    sls_parallel_for_serial(count, grain, fn, data);
+    return true;
+  }
+
+  slsParallelFor* batch = calloc(1, sizeof(*batch));
+  if (!batch) {
+    sls_parallel_for_serial(count, grain, fn, data);
+    return false;
+  }
+  *batch = (slsParallelFor){.fn = fn,
+                            .data = data,
+                            .count = count,
+                            .grain = grain,
+                            .n_chunks = n_chunks,
+                            .refs = 1 };
+  pthread_mutex_init(&batch->lock, NULL);
+  pthread_cond_init(&batch->done, NULL);
+
+  // the calling thread takes a share, so one helper fewer is needed
+  size_t n_helpers =
+    n_chunks - 1 < self->n_threads ? n_chunks - 1 : self->n_threads;
+  size_t n_queued = 0;
+  for (size_t i = 0; i < n_helpers; ++i) {
+    pthread_mutex_lock(&batch->lock);
+    batch->refs++;
+    pthread_mutex_unlock(&batch->lock);
+
+    if (!sls_jobqueue_submit(self, sls_parallel_for_helper, batch)) {
+      sls_parallel_for_release(batch);
+      break;
+    }
+    n_queued++;
+  }
+
+  sls_parallel_for_run(batch);
+
+  pthread_mutex_lock(&batch->lock);
+  while (batch->n_finished < batch->n_chunks) {
+    pthread_cond_wait(&batch->done, &batch->lock);
+  }
+  pthread_mutex_unlock(&batch->lock);
+  sls_parallel_for_release(batch);
+
+  return n_queued > 0;
+}
@@ -0,0 +1,101 @@
+/**
+ * @file slsjobs.h
+ * @brief fixed pool of worker threads consuming a FIFO of jobs
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#ifndef DANGERENGINE_SLSJOBS_H
+#define DANGERENGINE_SLSJOBS_H
+
+#include "slsmacros.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+SLS_BEGIN_CDECLS
+
+/**
+ * @brief upper bound on worker threads in a slsJobQueue
+ */
+#define SLS_JOBS_MAX_THREADS 16
+
+typedef void (*slsJobFn)(void* data);
+
+/**
+ * @brief processes items [begin, end) of a sls_jobqueue_parallel_for
+ */
+typedef void (*slsRangeFn)(void* data, size_t begin, size_t end);
+
+typedef struct slsJob {
+  slsJobFn fn;
+  void* data;
+} slsJob;
+
+/**
+ * @brief Thread pool.
+ * @detail Jobs run on worker threads in submission order, but may finish
+ * in any order. They must not make GL calls: hand results back to the GL
+ * thread instead.
+ */
+typedef struct slsJobQueue {
+  pthread_t threads[SLS_JOBS_MAX_THREADS];
+  size_t n_threads;
+
+  pthread_mutex_t lock;
+  pthread_cond_t has_work;
+  pthread_cond_t idle;
+
+  /** @brief ring buffer of pending jobs */
+  slsJob* jobs;
+  size_t head;
+  size_t n_jobs;
+  size_t capacity;
+
+  /** @brief jobs currently executing */
+  size_t n_running;
+  bool stopping;
+} slsJobQueue;
+
+/**
+ * @param n_threads worker count. 0 uses one less than the CPU count, so
+ * the GL thread keeps a core.
+ */
+slsJobQueue* sls_jobqueue_init(slsJobQueue* self, size_t n_threads)
+  SLS_NONNULL(1);
+
+/**
+ * @brief finishes every pending job, then joins the workers
+ */
+slsJobQueue* sls_jobqueue_dtor(slsJobQueue* self) SLS_NONNULL(1);
+
+/**
+ * @return false if the job could not be queued
+ */
+bool sls_jobqueue_submit(slsJobQueue* self, slsJobFn fn, void* data)
+  SLS_NONNULL(1, 2);
+
+/**
+ * @brief blocks until no job is queued or running
+ */
+void sls_jobqueue_wait(slsJobQueue* self) SLS_NONNULL(1);
+
+/**
+ * @brief calls `fn` over [0, count) in chunks of `grain` items, on the
+ * workers and the calling thread, and returns once every chunk is done.
+ * @detail Unlike sls_jobqueue_wait, it does not wait on unrelated jobs:
+ * helpers still queued behind them when the work runs out find nothing
+ * left to do.
+ * @return false if no helper could be queued, in which case the calling
+ * thread did all the work
+ */
+bool sls_jobqueue_parallel_for(slsJobQueue* self,
+                               size_t count,
+                               size_t grain,
+                               slsRangeFn fn,
+                               void* data) SLS_NONNULL(1, 4);
+
+SLS_END_CDECLS
+
+#endif // DANGERENGINE_SLSJOBS_H
@@ -123,6 +123,71 @@ static void test_array_foreach()
 
 }
 
+static void test_rangeset_coalesce()
+{
+  slsRangeSet set = {};
+
+  sls_rangeset_add(&set, 10, 20);
+  sls_rangeset_add(&set, 30, 40);
+  sls_rangeset_add(&set, 20, 25); // adjacent to the first range
+  TEST_ASSERT_EQUAL(2, set.n_ranges);
+  TEST_ASSERT_EQUAL(25, set.ranges[0].end);
+
+  sls_rangeset_add(&set, 5, 35); // spans both
+  TEST_ASSERT_EQUAL(1, set.n_ranges);
+  TEST_ASSERT_EQUAL(5, set.ranges[0].begin);
+  TEST_ASSERT_EQUAL(40, set.ranges[0].end);
+}
+
+static void test_rangeset_overflow()
+{
+  slsRangeSet set = {};
+  const size_t n = SLS_RANGESET_MAX * 2;
+
+  for (size_t i = 0; i < n; ++i) {
+    sls_rangeset_add(&set, i * 10, i * 10 + 1);
+  }
+  TEST_ASSERT_EQUAL(SLS_RANGESET_MAX, set.n_ranges);
+
+  // every added range must still be covered
+  for (size_t i = 0; i < n; ++i) {
+    bool covered = false;
+    for (size_t j = 0; j < set.n_ranges; ++j) {
+      covered = covered || (set.ranges[j].begin <= i * 10 &&
+                            set.ranges[j].end >= i * 10 + 1);
+    }
+    TEST_ASSERT_TRUE(covered);
+  }
+}
+
+static void test_hashtable_grow()
+{
+  slsCallbackTable keys = {.copy_fn = sls_copy_string,
+                           .free_fn = free,
+                           .cmp_fn = sls_cmp_string };
+  slsHashTable table;
+  sls_hashtable_init(&table, 4, sls_hash_fn_default, &keys, NULL);
+
+  static int vals[64];
+  char key[16];
+  for (int i = 0; i < 64; ++i) {
+    snprintf(key, sizeof(key), "key-%d", i);
+    sls_hashtable_insert(&table, key, SLS_STRING_LENGTH, vals + i);
+  }
+  // replacing a key must not add an entry
+  sls_hashtable_insert(&table, "key-3", SLS_STRING_LENGTH, vals + 3);
+
+  TEST_ASSERT_EQUAL(64, table.n_entries);
+  TEST_ASSERT_TRUE(table.array_size > 64);
+  for (int i = 0; i < 64; ++i) {
+    snprintf(key, sizeof(key), "key-%d", i);
+    TEST_ASSERT_EQUAL_PTR(vals + i,
+                          sls_hashtable_find(&table, key, SLS_STRING_LENGTH));
+  }
+  TEST_ASSERT_NULL(sls_hashtable_find(&table, "missing", SLS_STRING_LENGTH));
+
+  sls_hashtable_dtor(&table);
+}
 
 int data_tests_main()
 {
@@ -132,6 +197,9 @@ int data_tests_main()
   RUN_TEST(test_array_insert_many);
   RUN_TEST(test_array_remove);
   RUN_TEST(test_array_foreach);
+  RUN_TEST(test_rangeset_coalesce);
+  RUN_TEST(test_rangeset_overflow);
+  RUN_TEST(test_hashtable_grow);
 
   return UNITY_END();
 
@@ -12,8 +12,10 @@ int main(int argc, char **argv)
   if (TEST_PROTECT()) {
     extern int data_tests_main(void);
     extern int math_tests_main(void);
+    extern int renderer_tests_main(void);
     res = data_tests_main();
     res = math_tests_main() && res;
+    res = renderer_tests_main() && res;
   }
   return res;
 }
@@ -21,10 +21,66 @@ static void test_v2_add()
   TEST_ASSERT_EQUAL_FLOAT(6.4, res.y);
 }
 
+static void test_half_round_trip()
+{
+  // exactly representable values survive both ways
+  float exact[] = { 0.f, 1.f, -2.f, 0.5f, 65504.f, 6.103515625e-05f };
+  uint16_t bits[] = { 0x0000, 0x3c00, 0xc000, 0x3800, 0x7bff, 0x0400 };
+  for (size_t i = 0; i < SLS_ARRAY_COUNT(exact); ++i) {
+    TEST_ASSERT_EQUAL(bits[i], sls_float_to_half(exact[i]));
+    TEST_ASSERT_EQUAL_FLOAT(exact[i], sls_half_to_float(bits[i]));
+  }
+  TEST_ASSERT_EQUAL(0x8000, sls_float_to_half(-0.f));
+
+  // round to nearest, ties to even
+  const float ulp = 1.f / 1024.f;
+  TEST_ASSERT_EQUAL(0x3c00, sls_float_to_half(1.f + ulp * 0.25f));
+  TEST_ASSERT_EQUAL(0x3c01, sls_float_to_half(1.f + ulp * 0.75f));
+  TEST_ASSERT_EQUAL(0x3c00, sls_float_to_half(1.f + ulp * 0.5f));
+  TEST_ASSERT_EQUAL(0x3c02, sls_float_to_half(1.f + ulp * 1.5f));
+  // a carry out of the mantissa bumps the exponent
+  TEST_ASSERT_EQUAL(0x4000, sls_float_to_half(2.f - ulp * 0.25f));
+
+  // denormals, including rounding up into the smallest normal
+  const float tiny = 5.9604644775390625e-08f; // 2^-24
+  TEST_ASSERT_EQUAL(0x0001, sls_float_to_half(tiny));
+  TEST_ASSERT_EQUAL_FLOAT(tiny, sls_half_to_float(0x0001));
+  TEST_ASSERT_EQUAL(0x03ff, sls_float_to_half(tiny * 1023.f));
+  TEST_ASSERT_EQUAL_FLOAT(tiny * 1023.f, sls_half_to_float(0x03ff));
+  TEST_ASSERT_EQUAL(0x0002, sls_float_to_half(tiny * 2.5f));
+  TEST_ASSERT_EQUAL(0x0004, sls_float_to_half(tiny * 3.5f));
+  TEST_ASSERT_EQUAL(0x0400, sls_float_to_half(tiny * 1023.75f));
+  TEST_ASSERT_EQUAL(0x0000, sls_float_to_half(tiny * 0.5f));
+  TEST_ASSERT_EQUAL(0x0001, sls_float_to_half(tiny * 0.75f));
+  TEST_ASSERT_EQUAL(0x8000, sls_float_to_half(-1e-10f));
+
+  // overflow goes to infinity, NaN stays NaN
+  TEST_ASSERT_EQUAL(0x7bff, sls_float_to_half(65519.f));
+  TEST_ASSERT_EQUAL(0x7c00, sls_float_to_half(65520.f));
+  TEST_ASSERT_EQUAL(0x7c00, sls_float_to_half(1e10f));
+  TEST_ASSERT_EQUAL(0xfc00, sls_float_to_half(-1e10f));
+  TEST_ASSERT_EQUAL(0x7c00, sls_float_to_half(INFINITY));
+  TEST_ASSERT_EQUAL(0xfc00, sls_float_to_half(-INFINITY));
+  TEST_ASSERT_TRUE(isinf(sls_half_to_float(0x7c00)));
+  TEST_ASSERT_TRUE(sls_half_to_float(0xfc00) < 0.f);
+  uint16_t nan = sls_float_to_half(NAN);
+  TEST_ASSERT_EQUAL(0x7c00, nan & 0x7c00);
+  TEST_ASSERT_TRUE((nan & 0x3ff) != 0);
+  TEST_ASSERT_TRUE(isnan(sls_half_to_float(nan)));
+
+  // every finite half converts back to itself
+  for (uint32_t h = 0; h < 0x10000; ++h) {
+    if ((h & 0x7c00) != 0x7c00) {
+      TEST_ASSERT_EQUAL(h, sls_float_to_half(sls_half_to_float((uint16_t)h)));
+    }
+  }
+}
+
 int math_tests_main()
 {
   UNITY_BEGIN();
 
   RUN_TEST(test_v2_add);
+  RUN_TEST(test_half_round_trip);
   return UNITY_END();
 }
\ No newline at end of file
@@ -0,0 +1,1975 @@
+//
+// Created by steve on 10/19/26.
+//
+
+#include <config.h>
+#include <dangerengine.h>
+#include <renderer/slsatlas.h>
+#include <renderer/slscull.h>
+#include <renderer/slsgeompool.h>
+#include <renderer/slsglnull.h>
+#include <renderer/slsglrecord.h>
+#include <renderer/slsgpuheap.h>
+#include <renderer/slslightgrid.h>
+#include <renderer/slsmeshopt.h>
+#include <renderer/slsparticles.h>
+#include <renderer/slspostfx.h>
+#include <renderer/slsprimitives.h>
+#include <renderer/slsprofiler.h>
+#include <renderer/slsrendergraph.h>
+#include <renderer/slsrenderscale.h>
+#include <renderer/slsshadercache.h>
+#include <renderer/slsshaderlib.h>
+#include <renderer/slssimplify.h>
+#include <renderer/slsstreambuffer.h>
+#include <renderer/slstexcook.h>
+#include <renderer/slstexture.h>
+#include <renderer/slstilemap.h>
+#include <renderer/slsuniformbuffer.h>
+#include <unity.h>
+
+#define GRID_N 24
+#define GRID_VERTS ((GRID_N + 1) * (GRID_N + 1))
+#define GRID_INDICES (GRID_N * GRID_N * 6)
+
+/**
+ * @brief regular grid whose triangles are emitted in a scrambled order, as
+ * an unoptimised exporter might
+ */
+static void make_scrambled_grid(uint32_t* indices)
+{
+  size_t n_quads = GRID_N * GRID_N;
+  for (size_t q = 0; q < n_quads; ++q) {
+    // 169 is coprime with GRID_N^2, so this visits every quad once
+    size_t s = (q * 169) % n_quads;
+    uint32_t x = (uint32_t)(s % GRID_N), y = (uint32_t)(s / GRID_N);
+    uint32_t a = y * (GRID_N + 1) + x, b = a + 1;
+    uint32_t c = a + GRID_N + 1, d = c + 1;
+    uint32_t quad[6] = { a, b, d, a, d, c };
+    memcpy(indices + q * 6, quad, sizeof(quad));
+  }
+}
+
+static int compare_u64(void const* a, void const* b)
+{
+  uint64_t x = *(uint64_t const*)a, y = *(uint64_t const*)b;
+  return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+/**
+ * @brief triangle keys independent of winding rotation, sorted
+ */
+static void triangle_keys(uint32_t const* indices, uint64_t* keys)
+{
+  for (size_t t = 0; t < GRID_INDICES / 3; ++t) {
+    uint32_t const* tri = indices + t * 3;
+    size_t r = tri[0] < tri[1] ? (tri[0] < tri[2] ? 0 : 2)
+                               : (tri[1] < tri[2] ? 1 : 2);
+    keys[t] = (uint64_t)tri[r] << 42 | (uint64_t)tri[(r + 1) % 3] << 21 |
+              tri[(r + 2) % 3];
+  }
+  qsort(keys, GRID_INDICES / 3, sizeof(uint64_t), compare_u64);
+}
+
+static void test_vertex_cache_optimize()
+{
+  static uint32_t indices[GRID_INDICES];
+  static uint64_t keys_before[GRID_INDICES / 3], keys_after[GRID_INDICES / 3];
+  make_scrambled_grid(indices);
+  triangle_keys(indices, keys_before);
+
+  slsVertexCacheStats before = sls_analyze_vertex_cache(
+    indices, GRID_INDICES, GRID_VERTS, SLS_VERTEX_CACHE_SIZE);
+  TEST_ASSERT_TRUE(sls_optimize_vertex_cache(
+    indices, GRID_INDICES, GRID_VERTS, SLS_VERTEX_CACHE_SIZE));
+  slsVertexCacheStats after = sls_analyze_vertex_cache(
+    indices, GRID_INDICES, GRID_VERTS, SLS_VERTEX_CACHE_SIZE);
+
+  TEST_ASSERT_TRUE(after.acmr < before.acmr);
+  TEST_ASSERT_TRUE(after.acmr < 1.f);
+  TEST_ASSERT_TRUE(after.atvr >= 1.f);
+
+  // same triangles, same winding
+  triangle_keys(indices, keys_after);
+  TEST_ASSERT_EQUAL_MEMORY(keys_before, keys_after, sizeof(keys_before));
+}
+
+static void test_vertex_fetch_optimize()
+{
+  static uint32_t indices[GRID_INDICES];
+  static slsVertex verts[GRID_VERTS + 1];
+  make_scrambled_grid(indices);
+  for (size_t i = 0; i < GRID_VERTS + 1; ++i) {
+    verts[i].position[0] = (float)i;
+  }
+
+  uint32_t first = indices[0];
+  TEST_ASSERT_TRUE(
+    sls_optimize_vertex_fetch(verts, GRID_VERTS + 1, indices, GRID_INDICES));
+
+  // vertices are numbered in order of first use
+  uint32_t next = 0;
+  for (size_t i = 0; i < GRID_INDICES; ++i) {
+    TEST_ASSERT_TRUE(indices[i] <= next);
+    next = indices[i] == next ? next + 1 : next;
+  }
+  TEST_ASSERT_EQUAL(GRID_VERTS, next);
+  TEST_ASSERT_EQUAL_FLOAT((float)first, verts[0].position[0]);
+  // the unreferenced vertex ends up last
+  TEST_ASSERT_EQUAL_FLOAT((float)GRID_VERTS, verts[GRID_VERTS].position[0]);
+}
+
+static void test_vertex_format_pack()
+{
+  slsVertex vertices[2] = {
+    {.position = { -1.f, 2.f, 0.5f },
+     .normal = { 0.f, 1.f, 0.f },
+     .uv = { 0.25f, 1.5f },
+     .color = { 1.f, 0.5f, 0.f, 1.f } },
+    {.position = { 3.f, 2.f, -1.5f },
+     .normal = { -1.f, 0.f, 0.f },
+     .uv = { 1.f, -0.5f },
+     .color = { 0.f, 0.f, 0.f, 0.f } },
+  };
+  char out[2 * sizeof(slsVertex)];
+  kmMat4 dequant;
+
+  // PACKED keeps float positions, halves allow repeating uvs
+  slsVertexFormat packed;
+  sls_vertex_format_init(&packed, SLS_VERTEX_LAYOUT_PACKED);
+  TEST_ASSERT_FALSE(sls_vertex_format_is_native(&packed));
+  TEST_ASSERT_EQUAL(24, packed.stride);
+  TEST_ASSERT_EQUAL(4, packed.n_attribs);
+  sls_vertex_format_pack(&packed, vertices, 2, out);
+
+  float position[3];
+  uint32_t normals[2];
+  uint16_t uvs[2][2];
+  uint8_t colors[2][4];
+  for (size_t i = 0; i < 2; ++i) {
+    char const* v = out + i * packed.stride;
+    memcpy(normals + i, v + packed.attribs[1].offset, sizeof(uint32_t));
+    memcpy(uvs[i], v + packed.attribs[2].offset, sizeof(uvs[i]));
+    memcpy(colors[i], v + packed.attribs[3].offset, sizeof(colors[i]));
+  }
+  memcpy(position, out + packed.stride, sizeof(position));
+  TEST_ASSERT_EQUAL_FLOAT(-1.5f, position[2]);
+  TEST_ASSERT_EQUAL(511, (normals[0] >> 10) & 0x3ff);
+  TEST_ASSERT_EQUAL(0x201, normals[1] & 0x3ff); // -511
+  TEST_ASSERT_EQUAL(0, normals[1] >> 10);
+  TEST_ASSERT_EQUAL(0x3400, uvs[0][0]);
+  TEST_ASSERT_EQUAL(0x3e00, uvs[0][1]);
+  TEST_ASSERT_EQUAL(0xb800, uvs[1][1]);
+  uint8_t color[4] = { 255, 128, 0, 255 };
+  TEST_ASSERT_EQUAL_MEMORY(color, colors[0], sizeof(color));
+  kmMat4 identity;
+  kmMat4Identity(&identity);
+  sls_vertex_format_dequant_matrix(&packed, &dequant);
+  TEST_ASSERT_EQUAL_MEMORY(identity.mat, dequant.mat, sizeof(identity.mat));
+
+  // COMPACT positions come back through the dequantisation matrix
+  slsVertexFormat compact;
+  sls_vertex_format_init(&compact, SLS_VERTEX_LAYOUT_COMPACT);
+  TEST_ASSERT_EQUAL(20, compact.stride);
+  sls_vertex_format_fit_bounds(&compact, vertices, 2);
+  sls_vertex_format_pack(&compact, vertices, 2, out);
+  sls_vertex_format_dequant_matrix(&compact, &dequant);
+
+  for (size_t i = 0; i < 2; ++i) {
+    char const* v = out + i * compact.stride;
+    uint16_t q[4];
+    memcpy(q, v, sizeof(q));
+    TEST_ASSERT_EQUAL(0, q[3]);
+    float const* m = dequant.mat;
+    for (int c = 0; c < 3; ++c) {
+      float p = m[c] * q[0] / 65535.f + m[4 + c] * q[1] / 65535.f +
+                m[8 + c] * q[2] / 65535.f + m[12 + c];
+      TEST_ASSERT_FLOAT_WITHIN(1e-4f, vertices[i].position[c], p);
+    }
+
+    // unorm uvs clamp instead of repeating
+    uint16_t uv[2];
+    memcpy(uv, v + compact.attribs[2].offset, sizeof(uv));
+    TEST_ASSERT_EQUAL(i == 0 ? 16384 : 65535, uv[0]);
+    TEST_ASSERT_EQUAL(i == 0 ? 65535 : 0, uv[1]);
+  }
+}
+
+/**
+ * @brief points GL at the null backend, for tests of code that calls GL
+ */
+static void use_glnull()
+{
+  static bool loaded = false;
+  if (!loaded) {
+    TEST_ASSERT_TRUE(sls_glnull_load());
+    loaded = true;
+  }
+}
+
+static void test_shader_preprocess()
+{
+  slsShaderLibrary lib;
+  sls_shaderlib_init(&lib, NULL, NULL);
+  sls_shaderlib_add_include(&lib, "inner.glsl", "float inner;\n");
+  sls_shaderlib_add_include(
+    &lib, "common.glsl", "#include \"inner.glsl\"\nfloat common;\n");
+
+  char const* features[] = { "USE_FOG", "USE_SKINNING" };
+  char const* source = "#include \"common.glsl\"\nvoid main() {}\n";
+
+  uint64_t hash_a = 0, hash_b = 0, hash_c = 0;
+  char* text = sls_shaderlib_preprocess(&lib, source, features, 2, 2, &hash_a);
+  TEST_ASSERT_NOT_NULL(text);
+  TEST_ASSERT_EQUAL_STRING("#define USE_SKINNING 1\n"
+                           "#line 1\n"
+                           "#line 1\n"
+                           "#line 1\n"
+                           "float inner;\n"
+                           "#line 2\n"
+                           "float common;\n"
+                           "#line 2\n"
+                           "void main() {}\n",
+                           text);
+  free(text);
+
+  free(sls_shaderlib_preprocess(&lib, source, features, 2, 2, &hash_b));
+  free(sls_shaderlib_preprocess(&lib, source, features, 2, 1, &hash_c));
+  TEST_ASSERT_TRUE(hash_a == hash_b);
+  // neither feature is mentioned, so neither can change the program
+  TEST_ASSERT_TRUE(hash_a == hash_c);
+
+  // only the defines the text tests tell permutations apart
+  char const* fog = "#ifdef USE_FOG\nfloat fog;\n#endif\nvoid main() {}\n";
+  uint64_t hash_none = 0, hash_fog = 0, hash_skinning = 0;
+  free(sls_shaderlib_preprocess(&lib, fog, features, 2, 0, &hash_none));
+  free(sls_shaderlib_preprocess(&lib, fog, features, 2, 1, &hash_fog));
+  free(sls_shaderlib_preprocess(&lib, fog, features, 2, 2, &hash_skinning));
+  TEST_ASSERT_TRUE(hash_none != hash_fog);
+  TEST_ASSERT_TRUE(hash_none == hash_skinning);
+  // a longer identifier containing the name is not a mention
+  char const* fogged = "float USE_FOG_AMOUNT;\n";
+  free(sls_shaderlib_preprocess(&lib, fogged, features, 2, 0, &hash_none));
+  free(sls_shaderlib_preprocess(&lib, fogged, features, 2, 1, &hash_fog));
+  TEST_ASSERT_TRUE(hash_none == hash_fog);
+
+  // permutations that hash alike share one program
+  use_glnull();
+  slsShaderDesc desc = {.name = "fog",
+                        .vs_source = fog,
+                        .fs_source = "void main() {}\n",
+                        .uniforms = "",
+                        .features = features,
+                        .n_features = 2 };
+  GLuint plain = sls_shaderlib_program(&lib, &desc, 0);
+  TEST_ASSERT_TRUE(plain != 0);
+  TEST_ASSERT_EQUAL(plain, sls_shaderlib_program(&lib, &desc, 2));
+  TEST_ASSERT_TRUE(plain != sls_shaderlib_program(&lib, &desc, 3));
+  TEST_ASSERT_EQUAL(2, lib.n_compiled);
+  TEST_ASSERT_EQUAL(1, lib.n_deduplicated);
+
+  // missing and recursive includes fail
+  TEST_ASSERT_NULL(sls_shaderlib_preprocess(
+    &lib, "#include \"missing.glsl\"\n", NULL, 0, 0, NULL));
+  sls_shaderlib_add_include(&lib, "loop.glsl", "#include \"loop.glsl\"\n");
+  TEST_ASSERT_NULL(sls_shaderlib_preprocess(
+    &lib, "#include <loop.glsl>\n", NULL, 0, 0, NULL));
+
+  sls_shaderlib_dtor(&lib);
+}
+
+static void test_shadercache_binaries()
+{
+  use_glnull();
+  slsShaderCache cache;
+  TEST_ASSERT_NOT_NULL(sls_shadercache_init(&cache, "test-shadercache"));
+  TEST_ASSERT_TRUE(cache.enabled);
+  TEST_ASSERT_EQUAL_STRING("dangerengine\nnull\n" SLS_GLNULL_VERSION,
+                           cache.device);
+
+  // keys cover every source and each part of the device string
+  char const* vs = "void main() {}\n";
+  char const* fs = "out vec4 color;\nvoid main() {}\n";
+  uint64_t key = sls_shadercache_key(&cache, vs, fs, "");
+  TEST_ASSERT_TRUE(key == sls_shadercache_key(&cache, vs, fs, ""));
+  TEST_ASSERT_TRUE(key != sls_shadercache_key(&cache, fs, vs, ""));
+  TEST_ASSERT_TRUE(key != sls_shadercache_key(&cache, vs, fs, "float t;"));
+  TEST_ASSERT_TRUE(sls_shadercache_key(&cache, "ab", "c", "") !=
+                   sls_shadercache_key(&cache, "a", "bc", ""));
+  char* device = cache.device;
+  char* devices[] = { "other\nnull\n" SLS_GLNULL_VERSION,
+                      "dangerengine\nother\n" SLS_GLNULL_VERSION,
+                      "dangerengine\nnull\n4.6 dangerengine null" };
+  for (size_t i = 0; i < SLS_ARRAY_COUNT(devices); ++i) {
+    cache.device = devices[i];
+    TEST_ASSERT_TRUE(key != sls_shadercache_key(&cache, vs, fs, ""));
+  }
+  cache.device = device;
+
+  // a miss stores the binary for the next build to load
+  TEST_ASSERT_TRUE(sls_shadercache_program(&cache, vs, fs, "") != 0);
+  TEST_ASSERT_EQUAL(1, cache.stats.misses);
+  TEST_ASSERT_TRUE(sls_shadercache_program(&cache, vs, fs, "") != 0);
+  TEST_ASSERT_EQUAL(1, cache.stats.hits);
+
+  char path[64];
+  snprintf(path,
+           sizeof(path),
+           "test-shadercache/%016llx.bin",
+           (unsigned long long)key);
+
+  // binaries the driver rejects are recompiled and overwritten
+  FILE* file = fopen(path, "r+b");
+  TEST_ASSERT_NOT_NULL(file);
+  fseek(file, -1, SEEK_END);
+  fputc('x', file);
+  fclose(file);
+  TEST_ASSERT_TRUE(sls_shadercache_program(&cache, vs, fs, "") != 0);
+  TEST_ASSERT_EQUAL(1, cache.stats.rejected);
+  TEST_ASSERT_EQUAL(2, cache.stats.misses);
+  TEST_ASSERT_TRUE(sls_shadercache_program(&cache, vs, fs, "") != 0);
+  TEST_ASSERT_EQUAL(2, cache.stats.hits);
+
+  // so are truncated entries
+  file = fopen(path, "wb");
+  TEST_ASSERT_NOT_NULL(file);
+  fputs("junk", file);
+  fclose(file);
+  TEST_ASSERT_TRUE(sls_shadercache_program(&cache, vs, fs, "") != 0);
+  TEST_ASSERT_EQUAL(3, cache.stats.misses);
+  TEST_ASSERT_TRUE(sls_shadercache_program(&cache, vs, fs, "") != 0);
+  TEST_ASSERT_EQUAL(3, cache.stats.hits);
+
+  sls_shadercache_dtor(&cache);
+  remove(path);
+  remove("test-shadercache");
+}
+
+static void test_shadercache_async()
+{
+  use_glnull();
+  slsShaderCache cache;
+  TEST_ASSERT_NOT_NULL(sls_shadercache_init(&cache, "test-shadercache"));
+
+  char const* vs = "void main() { gl_Position = vec4(0.0); }\n";
+  char const* fs = "void main() {}\n";
+  char path[64];
+  snprintf(path,
+           sizeof(path),
+           "test-shadercache/%016llx.bin",
+           (unsigned long long)sls_shadercache_key(&cache, vs, fs, ""));
+
+  // a miss is only submitted: nothing is stored or counted yet
+  slsShaderCacheBuild pending;
+  sls_shadercache_submit(&cache, &pending, vs, fs, "");
+  TEST_ASSERT_EQUAL(SLS_PROGRAM_PENDING, pending.build.status);
+  TEST_ASSERT_TRUE(pending.missed);
+  TEST_ASSERT_EQUAL(0, cache.stats.misses);
+  FILE* file = fopen(path, "rb");
+  TEST_ASSERT_NULL(file);
+
+  // the first poll to find it ready stores the binary, once
+  TEST_ASSERT_EQUAL(SLS_PROGRAM_READY, sls_shadercache_poll(&cache, &pending));
+  TEST_ASSERT_TRUE(pending.build.program != 0);
+  TEST_ASSERT_FALSE(pending.missed);
+  TEST_ASSERT_EQUAL(1, cache.stats.misses);
+  file = fopen(path, "rb");
+  TEST_ASSERT_NOT_NULL(file);
+  fclose(file);
+  TEST_ASSERT_EQUAL(SLS_PROGRAM_READY, sls_shadercache_poll(&cache, &pending));
+  TEST_ASSERT_EQUAL(SLS_PROGRAM_READY, sls_shadercache_wait(&cache, &pending));
+  TEST_ASSERT_EQUAL(1, cache.stats.misses);
+  sls_program_build_dtor(&pending.build);
+
+  // hits are ready as soon as they are submitted
+  sls_shadercache_submit(&cache, &pending, vs, fs, "");
+  TEST_ASSERT_EQUAL(SLS_PROGRAM_READY, pending.build.status);
+  TEST_ASSERT_FALSE(pending.missed);
+  TEST_ASSERT_TRUE(pending.build.program != 0);
+  TEST_ASSERT_EQUAL(1, cache.stats.hits);
+  TEST_ASSERT_EQUAL(pending.build.program,
+                    sls_program_build_select(&pending.build, 0));
+  TEST_ASSERT_EQUAL(SLS_PROGRAM_READY, sls_shadercache_wait(&cache, &pending));
+  TEST_ASSERT_EQUAL(1, cache.stats.misses);
+  sls_program_build_dtor(&pending.build);
+
+  sls_shadercache_dtor(&cache);
+  remove(path);
+  remove("test-shadercache");
+}
+
+static void test_skyline_pack()
+{
+  enum { N_RECTS = 600, SIZE = 256 };
+  slsSkyline sky;
+  TEST_ASSERT_NOT_NULL(sls_skyline_init(&sky, SIZE, SIZE)->nodes);
+
+  int xs[N_RECTS], ys[N_RECTS], ws[N_RECTS], hs[N_RECTS];
+  size_t n = 0;
+  uint32_t seed = 12345;
+  for (size_t i = 0; i < N_RECTS; ++i) {
+    seed = seed * 1664525u + 1013904223u;
+    ws[n] = 4 + (int)((seed >> 8) % 20);
+    hs[n] = 4 + (int)((seed >> 16) % 20);
+    if (sls_skyline_insert(&sky, ws[n], hs[n], xs + n, ys + n)) {
+      ++n;
+    }
+  }
+  TEST_ASSERT_TRUE(n > 0);
+
+  for (size_t i = 0; i < n; ++i) {
+    TEST_ASSERT_TRUE(xs[i] >= 0 && xs[i] + ws[i] <= SIZE);
+    TEST_ASSERT_TRUE(ys[i] >= 0 && ys[i] + hs[i] <= SIZE);
+    for (size_t j = i + 1; j < n; ++j) {
+      bool disjoint = xs[i] + ws[i] <= xs[j] || xs[j] + ws[j] <= xs[i] ||
+                      ys[i] + hs[i] <= ys[j] || ys[j] + hs[j] <= ys[i];
+      TEST_ASSERT_TRUE(disjoint);
+    }
+  }
+
+  // the stream overflows the page, which should end up mostly covered
+  TEST_ASSERT_TRUE(sls_skyline_occupancy(&sky) > 0.8f);
+
+  int x, y;
+  TEST_ASSERT_FALSE(sls_skyline_insert(&sky, SIZE + 1, 1, &x, &y));
+  sls_skyline_dtor(&sky);
+}
+
+static void test_texcook_container()
+{
+  enum { W = 8, H = 6 };
+  unsigned char image[W * H * 4];
+  for (size_t i = 0; i < W * H; ++i) {
+    unsigned char px[4] = { 200, 0, 0, (unsigned char)(i % 2 ? 255 : 0) };
+    memcpy(image + i * 4, px, 4);
+  }
+
+  slsTexCookOptions options = {.format = SLS_TEXFORMAT_RGBA8,
+                               .premultiply = true };
+  size_t size = 0;
+  unsigned char* file = sls_texcook_build(image, W, H, &options, &size);
+  TEST_ASSERT_NOT_NULL(file);
+
+  slsTexFileHeader const* header = sls_texfile_parse(file, size);
+  TEST_ASSERT_NOT_NULL(header);
+  TEST_ASSERT_TRUE(header->flags & SLS_TEXFILE_PREMULTIPLIED);
+  // 8x6, 4x3, 2x1, 1x1
+  TEST_ASSERT_EQUAL(4, header->n_levels);
+  TEST_ASSERT_EQUAL(2, header->levels[2].width);
+  TEST_ASSERT_EQUAL(1, header->levels[2].height);
+
+  // premultiplied before filtering: half the texels are transparent black
+  unsigned char const* mip1 = file + header->levels[1].offset;
+  TEST_ASSERT_EQUAL(100, mip1[0]);
+  TEST_ASSERT_EQUAL(128, mip1[3]);
+
+  TEST_ASSERT_NULL(sls_texfile_parse(file, header->levels[3].offset));
+  // cooked on a host of the other byte order
+  uint32_t swapped = SLS_TEXFILE_MAGIC_SWAPPED;
+  memcpy(file, &swapped, sizeof(swapped));
+  TEST_ASSERT_NULL(sls_texfile_parse(file, size));
+  free(file);
+
+  // a solid block compresses exactly
+  unsigned char solid[4 * 4 * 4];
+  for (size_t i = 0; i < 16; ++i) {
+    unsigned char px[4] = { 255, 0, 0, 255 };
+    memcpy(solid + i * 4, px, 4);
+  }
+  unsigned char block[16];
+  sls_texcook_encode(SLS_TEXFORMAT_BC1, solid, 4, 4, block);
+  TEST_ASSERT_EQUAL_HEX8(0x00, block[0]);
+  TEST_ASSERT_EQUAL_HEX8(0xf8, block[1]);
+  sls_texcook_encode(SLS_TEXFORMAT_BC3, solid, 4, 4, block);
+  TEST_ASSERT_EQUAL(255, block[0]);
+  TEST_ASSERT_EQUAL(255, block[1]);
+}
+
+/**
+ * @brief feeds a call through the recorder the way glad's callback does
+ */
+static void record_call(char const* name, int len_args, ...)
+{
+  va_list args;
+  va_start(args, len_args);
+  sls_glrecord_call(name, len_args, args);
+  va_end(args);
+}
+
+static void test_gllog_analyze()
+{
+  char const* path = "test-glrecord" SLS_GLLOG_EXTENSION;
+  static char const pixels[16];
+  TEST_ASSERT_TRUE(sls_glrecord_start(path));
+
+  record_call("glUseProgram", 1, 3u);
+  record_call("glBindBuffer", 2, GL_ARRAY_BUFFER, 1u);
+  record_call("glBufferData",
+              4,
+              GL_ARRAY_BUFFER,
+              (GLsizeiptr)64,
+              (void const*)pixels,
+              GL_STATIC_DRAW);
+  // orphaning uploads nothing
+  record_call("glBufferData",
+              4,
+              GL_ARRAY_BUFFER,
+              (GLsizeiptr)64,
+              (void const*)NULL,
+              GL_STREAM_DRAW);
+  record_call("glDrawArrays", 3, GL_TRIANGLES, 0, 3);
+  sls_glrecord_frame();
+
+  record_call("glUseProgram", 1, 3u);
+  record_call("glBindBuffer", 2, GL_ARRAY_BUFFER, 1u);
+  record_call("glBindBuffer", 2, GL_ARRAY_BUFFER, 2u);
+  record_call("glEnable", 1, GL_BLEND);
+  record_call("glEnable", 1, GL_BLEND);
+  record_call("glDisable", 1, GL_BLEND);
+  record_call("glTexSubImage2D",
+              9,
+              GL_TEXTURE_2D,
+              0,
+              0,
+              0,
+              2,
+              2,
+              GL_RGBA,
+              GL_UNSIGNED_BYTE,
+              (void const*)pixels);
+  record_call("glClear", 1, GL_COLOR_BUFFER_BIT);
+  sls_glrecord_frame();
+  sls_glrecord_stop();
+
+  slsGLLogStats stats;
+  TEST_ASSERT_NOT_NULL(sls_gllog_analyze_file(&stats, path));
+  remove(path);
+
+  TEST_ASSERT_EQUAL(2, stats.n_frames);
+  TEST_ASSERT_EQUAL(5, stats.frames[0].calls);
+  TEST_ASSERT_EQUAL(1, stats.frames[0].draws);
+  TEST_ASSERT_EQUAL(64, stats.frames[0].buffer_bytes);
+  TEST_ASSERT_EQUAL(0, stats.frames[0].redundant);
+
+  TEST_ASSERT_EQUAL(8, stats.frames[1].calls);
+  // the program, the first buffer and the second glEnable
+  TEST_ASSERT_EQUAL(3, stats.frames[1].redundant);
+  TEST_ASSERT_EQUAL(3, stats.frames[1].state_changes);
+  TEST_ASSERT_EQUAL(16, stats.frames[1].texture_bytes);
+  TEST_ASSERT_EQUAL(13, stats.total.calls);
+
+  sls_gllog_stats_dtor(&stats);
+}
+
+static void test_glnull_buffers()
+{
+  use_glnull();
+  GLuint buffers[2];
+  glGenBuffers(2, buffers);
+  glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+  glBufferData(GL_ARRAY_BUFFER, 64, NULL, GL_STREAM_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, buffers[1]);
+  glBufferData(GL_UNIFORM_BUFFER, 4096, NULL, GL_STREAM_DRAW);
+
+  // two live mappings, the second larger, never alias or move the first
+  char* small = glMapBufferRange(GL_ARRAY_BUFFER, 0, 64, GL_MAP_WRITE_BIT);
+  TEST_ASSERT_NOT_NULL(small);
+  memset(small, 0xab, 64);
+  char* large =
+    glMapBufferRange(GL_UNIFORM_BUFFER, 256, 3840, GL_MAP_WRITE_BIT);
+  TEST_ASSERT_NOT_NULL(large);
+  memset(large, 0xcd, 3840);
+  TEST_ASSERT_TRUE(large + 3840 <= small || small + 64 <= large);
+  for (int i = 0; i < 64; ++i) {
+    TEST_ASSERT_EQUAL(0xab, (unsigned char)small[i]);
+  }
+  char* again = glMapBufferRange(GL_ARRAY_BUFFER, 16, 16, GL_MAP_WRITE_BIT);
+  TEST_ASSERT_TRUE(again == small + 16);
+
+  // sub data lands in the buffer's storage, ranges outside it fail
+  char bytes[4] = { 1, 2, 3, 4 };
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, 4, bytes);
+  TEST_ASSERT_EQUAL(0, memcmp(large - 256, bytes, 4));
+  TEST_ASSERT_NULL(glMapBufferRange(GL_UNIFORM_BUFFER, 4000, 200, 0));
+
+  glUnmapBuffer(GL_ARRAY_BUFFER);
+  glUnmapBuffer(GL_UNIFORM_BUFFER);
+  glDeleteBuffers(2, buffers);
+  TEST_ASSERT_NULL(glMapBufferRange(GL_ARRAY_BUFFER, 0, 64, 0));
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+static void test_streambuffer_alloc()
+{
+  use_glnull();
+  slsStreamBuffer stream;
+  TEST_ASSERT_NOT_NULL(sls_streambuffer_init(&stream, 1000));
+  TEST_ASSERT_NOT_EQUAL(0, stream.buffer);
+  // the null backend has no ARB_buffer_storage: ranges are mapped per alloc
+  TEST_ASSERT_FALSE(stream.persistent);
+
+  sls_streambuffer_begin_frame(&stream);
+  GLintptr offset = -1;
+  char* dst = sls_streambuffer_alloc(&stream, 10, 0, &offset);
+  TEST_ASSERT_NOT_NULL(dst);
+  TEST_ASSERT_EQUAL(1000, offset);
+  memset(dst, 0x11, 10);
+  sls_streambuffer_commit(&stream);
+
+  // non power-of-two strides align the absolute offset
+  char bytes[12] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12 };
+  TEST_ASSERT_EQUAL(1020, sls_streambuffer_write(&stream, bytes, 12, 12));
+  TEST_ASSERT_EQUAL(1032, sls_streambuffer_write(&stream, bytes, 12, 4));
+
+  // an allocation past the region fails without moving the cursor
+  TEST_ASSERT_NULL(sls_streambuffer_alloc(&stream, 1000, 4, &offset));
+  TEST_ASSERT_FALSE(stream.mapped);
+  TEST_ASSERT_EQUAL(1044, sls_streambuffer_write(&stream, bytes, 4, 4));
+  TEST_ASSERT_EQUAL(1996, sls_streambuffer_write(&stream, bytes, 4, 998));
+  TEST_ASSERT_EQUAL(-1, sls_streambuffer_write(&stream, bytes, 1, 1));
+
+  glBindBuffer(GL_COPY_READ_BUFFER, stream.buffer);
+  char* mapped = glMapBufferRange(GL_COPY_READ_BUFFER, 1000, 36, 0);
+  TEST_ASSERT_NOT_NULL(mapped);
+  TEST_ASSERT_EQUAL(0x11, mapped[9]);
+  TEST_ASSERT_EQUAL(0, memcmp(mapped + 20, bytes, 12));
+  TEST_ASSERT_EQUAL(0, memcmp(mapped + 32, bytes, 4));
+  glUnmapBuffer(GL_COPY_READ_BUFFER);
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  sls_streambuffer_end_frame(&stream);
+  TEST_ASSERT_NOT_NULL(stream.fences[1]);
+
+  // every frame starts at its own region, wrapping after the last
+  sls_streambuffer_begin_frame(&stream);
+  TEST_ASSERT_EQUAL(2000, sls_streambuffer_write(&stream, bytes, 4, 4));
+  sls_streambuffer_end_frame(&stream);
+  sls_streambuffer_begin_frame(&stream);
+  TEST_ASSERT_EQUAL(0, sls_streambuffer_write(&stream, bytes, 4, 4));
+  sls_streambuffer_end_frame(&stream);
+  sls_streambuffer_begin_frame(&stream);
+  TEST_ASSERT_NULL(stream.fences[1]);
+  TEST_ASSERT_EQUAL(1000, sls_streambuffer_write(&stream, bytes, 4, 4));
+  sls_streambuffer_end_frame(&stream);
+
+  sls_streambuffer_dtor(&stream);
+  TEST_ASSERT_EQUAL(0, stream.buffer);
+}
+
+static void test_uniform_ring()
+{
+  TEST_ASSERT_EQUAL(44, offsetof(slsMaterialBlock, shininess));
+  TEST_ASSERT_EQUAL(48, sizeof(slsMaterialBlock));
+  TEST_ASSERT_EQUAL(400, offsetof(slsLightsBlock, light_positions));
+  TEST_ASSERT_EQUAL(528, offsetof(slsLightsBlock, light_modelview));
+  TEST_ASSERT_EQUAL(1040, sizeof(slsLightsBlock));
+
+  use_glnull();
+  slsUniformRing ring;
+  TEST_ASSERT_NOT_NULL(sls_uniform_ring_init(&ring, 2000));
+  TEST_ASSERT_NOT_EQUAL(0, ring.stream.buffer);
+  TEST_ASSERT_EQUAL(256, ring.alignment);
+  TEST_ASSERT_EQUAL(2048, ring.stream.region_size);
+
+  slsMaterialBlock material = sls_material_block_make(
+    (kmVec3){ 1.f, 2.f, 3.f }, (kmVec3){ 4.f, 5.f, 6.f },
+    (kmVec3){ 7.f, 8.f, 9.f }, 10.f);
+  TEST_ASSERT_EQUAL_FLOAT(9.f, material.ambient_color[2]);
+  TEST_ASSERT_EQUAL_FLOAT(10.f, material.shininess);
+
+  slsLightsBlock lights = {};
+  kmMat4 modelview;
+  kmMat4Identity(&modelview);
+  sls_lights_block_set(&lights, 2, (kmVec3){ 1.f, 1.f, 1.f },
+                       (kmVec3){}, (kmVec3){}, (kmVec4){ 0.f, 1.f, 0.f, 1.f },
+                       &modelview);
+  TEST_ASSERT_EQUAL(3, lights.n_lights);
+  sls_lights_block_set(&lights, SLS_N_LIGHTS, (kmVec3){}, (kmVec3){},
+                       (kmVec3){}, (kmVec4){}, &modelview);
+  TEST_ASSERT_EQUAL(3, lights.n_lights);
+
+  // both blocks go to the start of the frame's region, lights aligned
+  sls_uniform_ring_begin_frame(&ring);
+  TEST_ASSERT_TRUE(sls_uniform_ring_push_draw(&ring, &material, &lights));
+  glBindBuffer(GL_UNIFORM_BUFFER, ring.stream.buffer);
+  char* mapped = glMapBufferRange(GL_UNIFORM_BUFFER, 2048, 2048, 0);
+  TEST_ASSERT_NOT_NULL(mapped);
+  TEST_ASSERT_EQUAL(0, memcmp(mapped, &material, sizeof(material)));
+  TEST_ASSERT_EQUAL(0, memcmp(mapped + 256, &lights, sizeof(lights)));
+  glUnmapBuffer(GL_UNIFORM_BUFFER);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+  // later uploads keep the offset alignment until the region is full
+  const size_t size = sizeof(material);
+  TEST_ASSERT_EQUAL(3584, sls_uniform_ring_upload(&ring, &material, size));
+  TEST_ASSERT_FALSE(sls_uniform_ring_push_draw(&ring, &material, &lights));
+  TEST_ASSERT_TRUE(sls_uniform_ring_push_draw(&ring, &material, NULL));
+  TEST_ASSERT_EQUAL(-1, sls_uniform_ring_upload(&ring, &material, size));
+  sls_uniform_ring_end_frame(&ring);
+
+  sls_uniform_ring_begin_frame(&ring);
+  TEST_ASSERT_EQUAL(4096, sls_uniform_ring_upload(&ring, &material, size));
+  sls_uniform_ring_end_frame(&ring);
+
+  sls_uniform_ring_dtor(&ring);
+  TEST_ASSERT_EQUAL(0, ring.stream.buffer);
+}
+
+static void test_tilemap_chunks()
+{
+  slsTexture page = {};
+  slsAtlasRegion regions[2] = {
+    {.texture = &page, .uv_min = { 0.f, 0.f }, .uv_max = { .5f, 1.f } },
+    {.texture = &page, .uv_min = { .5f, 0.f }, .uv_max = { 1.f, 1.f } },
+  };
+
+  slsTileMap map;
+  TEST_ASSERT_NOT_NULL(sls_tilemap_init(&map, 1000, 1000, 1.f, regions, 2));
+  TEST_ASSERT_EQUAL(32, map.chunks_x);
+  TEST_ASSERT_EQUAL(32, map.chunks_y);
+  TEST_ASSERT_EQUAL(0, map.n_dirty);
+
+  sls_tilemap_fill(&map, 0, 0, 1000, 1000, 0);
+  TEST_ASSERT_EQUAL(32 * 32, map.n_dirty);
+  TEST_ASSERT_EQUAL(0, sls_tilemap_get(&map, 999, 999));
+  TEST_ASSERT_EQUAL(SLS_TILE_EMPTY, sls_tilemap_get(&map, 1000, 0));
+
+  // edits only flag their own chunk, once
+  for (size_t i = 0; i < 32 * 32; ++i) {
+    map.chunks[i].dirty = false;
+  }
+  map.n_dirty = 0;
+  sls_tilemap_set(&map, 40, 70, 1);
+  sls_tilemap_set(&map, 41, 71, 1);
+  sls_tilemap_set(&map, 42, 72, 0);
+  TEST_ASSERT_EQUAL(1, map.n_dirty);
+  TEST_ASSERT_EQUAL(2 * 32 + 1, map.dirty[0]);
+
+  // a 100x60 view touches at most 5x3 chunks
+  slsTileChunkRange r = sls_tilemap_cull(
+    &map, (kmVec2){ 10.f, 10.f }, (kmVec2){ 110.f, 70.f });
+  TEST_ASSERT_EQUAL(0, r.x0);
+  TEST_ASSERT_EQUAL(4, r.x1);
+  TEST_ASSERT_EQUAL(0, r.y0);
+  TEST_ASSERT_EQUAL(3, r.y1);
+
+  r = sls_tilemap_cull(
+    &map, (kmVec2){ -50.f, 990.f }, (kmVec2){ 5000.f, 5000.f });
+  TEST_ASSERT_EQUAL(0, r.x0);
+  TEST_ASSERT_EQUAL(32, r.x1);
+  TEST_ASSERT_EQUAL(30, r.y0);
+  TEST_ASSERT_EQUAL(32, r.y1);
+
+  r = sls_tilemap_cull(
+    &map, (kmVec2){ 1200.f, 0.f }, (kmVec2){ 1300.f, 10.f });
+  TEST_ASSERT_EQUAL(r.x0, r.x1);
+
+  sls_tilemap_dtor(&map);
+
+  // one draw per chunk needs one texture
+  slsTexture other = {};
+  regions[1].texture = &other;
+  TEST_ASSERT_NULL(sls_tilemap_init(&map, 10, 10, 1.f, regions, 2));
+}
+
+static void test_geom_freelist()
+{
+  slsGeomFreeList list;
+  TEST_ASSERT_NOT_NULL(sls_geom_freelist_init(&list, 100));
+
+  uint32_t a = sls_geom_freelist_alloc(&list, 30);
+  uint32_t b = sls_geom_freelist_alloc(&list, 30);
+  uint32_t c = sls_geom_freelist_alloc(&list, 30);
+  TEST_ASSERT_EQUAL(0, a);
+  TEST_ASSERT_EQUAL(30, b);
+  TEST_ASSERT_EQUAL(60, c);
+  TEST_ASSERT_EQUAL(UINT32_MAX, sls_geom_freelist_alloc(&list, 20));
+
+  // the hole left by b is reused first
+  sls_geom_freelist_free(&list, b, 30);
+  TEST_ASSERT_EQUAL(2, list.n_ranges);
+  TEST_ASSERT_EQUAL(30, sls_geom_freelist_alloc(&list, 20));
+  TEST_ASSERT_EQUAL(50, sls_geom_freelist_alloc(&list, 10));
+  TEST_ASSERT_EQUAL(1, list.n_ranges);
+
+  // freeing everything coalesces back into one range
+  sls_geom_freelist_free(&list, 30, 20);
+  sls_geom_freelist_free(&list, a, 30);
+  sls_geom_freelist_free(&list, c, 30);
+  sls_geom_freelist_free(&list, 50, 10);
+  TEST_ASSERT_EQUAL(1, list.n_ranges);
+  TEST_ASSERT_EQUAL(0, list.ranges[0].first);
+  TEST_ASSERT_EQUAL(100, list.ranges[0].count);
+
+  sls_geom_freelist_dtor(&list);
+}
+
+static void test_geompool_commands()
+{
+  use_glnull();
+  slsGeomPool pool;
+  TEST_ASSERT_NOT_NULL(
+    sls_geompool_init(&pool, SLS_VERTEX_LAYOUT_FLOAT, 8, 8));
+  // the null backend is plain GL 4.1, without ARB_base_instance
+  TEST_ASSERT_FALSE(pool.base_instance);
+
+  slsVertex vertices[6] = {};
+  uint32_t triangle[] = { 0, 1, 2 };
+  slsGeomMesh a, b;
+  TEST_ASSERT_TRUE(sls_geompool_add(&pool, vertices, 6, triangle, 3, &a));
+  TEST_ASSERT_TRUE(sls_geompool_add(&pool, vertices, 6, triangle, 3, &b));
+  TEST_ASSERT_EQUAL(16, pool.vertex_capacity);
+  TEST_ASSERT_EQUAL(6, b.base_vertex);
+  TEST_ASSERT_EQUAL(3, b.first_index);
+
+  sls_geompool_push(&pool, &a, 0);
+  sls_geompool_push(&pool, &b, 0);
+  TEST_ASSERT_EQUAL(2, pool.n_commands);
+  slsDrawElementsIndirectCommand const* cmd = pool.commands + 1;
+  TEST_ASSERT_EQUAL(3, cmd->count);
+  TEST_ASSERT_EQUAL(1, cmd->instance_count);
+  TEST_ASSERT_EQUAL(3, cmd->first_index);
+  TEST_ASSERT_EQUAL(6, cmd->base_vertex);
+  TEST_ASSERT_EQUAL(0, cmd->base_instance);
+  TEST_ASSERT_EQUAL(1, sls_geompool_submit(&pool, NULL));
+  TEST_ASSERT_EQUAL(0, pool.n_commands);
+
+  // base instances the driver cannot apply split the batch
+  sls_geompool_push(&pool, &a, 0);
+  sls_geompool_push(&pool, &b, 7);
+  TEST_ASSERT_EQUAL(7, pool.commands[1].base_instance);
+  TEST_ASSERT_EQUAL(2, sls_geompool_submit(&pool, NULL));
+
+  sls_geompool_dtor(&pool);
+}
+
+static void test_tlsf_defrag()
+{
+  slsTlsf tlsf;
+  TEST_ASSERT_NOT_NULL(sls_tlsf_init(&tlsf, 16));
+  TEST_ASSERT_EQUAL(0, sls_tlsf_add_pool(&tlsf, 4096));
+
+  uint32_t handles[12];
+  for (size_t i = 0; i < SLS_ARRAY_COUNT(handles); ++i) {
+    handles[i] = sls_tlsf_alloc(&tlsf, 200, i % 2 ? 256 : 16);
+    TEST_ASSERT_NOT_EQUAL(SLS_TLSF_NULL, handles[i]);
+    slsTlsfBlock const* block = sls_tlsf_block(&tlsf, handles[i]);
+    TEST_ASSERT_EQUAL(0, block->offset % (i % 2 ? 256 : 16));
+    TEST_ASSERT_EQUAL(208, block->size);
+  }
+  TEST_ASSERT_EQUAL(SLS_TLSF_NULL, sls_tlsf_alloc(&tlsf, 2048, 16));
+
+  // punch holes, then spill into a second pool
+  for (size_t i = 0; i < SLS_ARRAY_COUNT(handles); i += 2) {
+    sls_tlsf_free(&tlsf, handles[i]);
+    handles[i] = SLS_TLSF_NULL;
+  }
+  TEST_ASSERT_NULL(sls_tlsf_block(&tlsf, handles[0]));
+  TEST_ASSERT_EQUAL(SLS_TLSF_NULL, sls_tlsf_alloc(&tlsf, 2048, 16));
+  TEST_ASSERT_EQUAL(1, sls_tlsf_add_pool(&tlsf, 4096));
+  uint32_t spilled = sls_tlsf_alloc(&tlsf, 2048, 16);
+  TEST_ASSERT_EQUAL(1, sls_tlsf_block(&tlsf, spilled)->pool);
+  size_t used = tlsf.used;
+
+  slsTlsfMove move;
+  size_t n_moves = 0;
+  while (sls_tlsf_next_move(&tlsf, 4096, &move)) {
+    TEST_ASSERT_TRUE(move.dst_pool < move.src_pool ||
+                     move.dst_offset < move.src_offset);
+    n_moves++;
+  }
+  TEST_ASSERT_TRUE(n_moves > 0);
+  TEST_ASSERT_EQUAL(used, tlsf.used);
+
+  // survivors are packed at the start of the first pool, leaving the
+  // second one empty and all free space in one block
+  TEST_ASSERT_EQUAL(0, sls_tlsf_block(&tlsf, spilled)->pool);
+  TEST_ASSERT_EQUAL(0, tlsf.pools[1].n_allocs);
+  TEST_ASSERT_TRUE(sls_tlsf_remove_pool(&tlsf, 1));
+  TEST_ASSERT_FALSE(sls_tlsf_remove_pool(&tlsf, 0));
+  size_t end = 0;
+  for (size_t i = 1; i < SLS_ARRAY_COUNT(handles); i += 2) {
+    slsTlsfBlock const* block = sls_tlsf_block(&tlsf, handles[i]);
+    TEST_ASSERT_EQUAL(0, block->offset % 256);
+    end = block->offset + block->size > end ? block->offset + block->size
+                                              : end;
+  }
+  TEST_ASSERT_TRUE(end <= 4096 - sls_tlsf_largest_free(&tlsf));
+  TEST_ASSERT_EQUAL(SLS_TLSF_NULL, sls_tlsf_alloc(&tlsf, 4096, 16));
+
+  for (size_t i = 1; i < SLS_ARRAY_COUNT(handles); i += 2) {
+    sls_tlsf_free(&tlsf, handles[i]);
+  }
+  sls_tlsf_free(&tlsf, spilled);
+  TEST_ASSERT_EQUAL(0, tlsf.n_allocs);
+  TEST_ASSERT_EQUAL(4096, sls_tlsf_largest_free(&tlsf));
+
+  sls_tlsf_dtor(&tlsf);
+}
+
+static void test_count_job(void* data)
+{
+  __atomic_add_fetch((int*)data, 1, __ATOMIC_RELAXED);
+}
+
+static void test_jobqueue_submit()
+{
+  slsJobQueue jobs;
+  TEST_ASSERT_NOT_NULL(sls_jobqueue_init(&jobs, 3));
+  TEST_ASSERT_EQUAL(3, jobs.n_threads);
+
+  // more jobs than the ring starts with, so it may grow while running
+  int count = 0;
+  for (int i = 0; i < 1000; ++i) {
+    TEST_ASSERT_TRUE(sls_jobqueue_submit(&jobs, test_count_job, &count));
+  }
+  sls_jobqueue_wait(&jobs);
+  TEST_ASSERT_EQUAL(1000, __atomic_load_n(&count, __ATOMIC_RELAXED));
+  TEST_ASSERT_EQUAL(0, jobs.n_jobs);
+  TEST_ASSERT_EQUAL(0, jobs.n_running);
+
+  // the destructor finishes what is still queued
+  for (int i = 0; i < 100; ++i) {
+    sls_jobqueue_submit(&jobs, test_count_job, &count);
+  }
+  sls_jobqueue_dtor(&jobs);
+  TEST_ASSERT_EQUAL(1100, count);
+}
+
+static void test_textureloader_decode()
+{
+  use_glnull();
+  char const* path = "test-loader.ppm";
+  FILE* file = fopen(path, "wb");
+  TEST_ASSERT_NOT_NULL(file);
+  static const unsigned char ppm[] = "P6\n3 2\n255\n"
+                                     "\xff\x00\x00\x00\xff\x00\x00\x00\xff"
+                                     "\xff\xff\xff\x00\x00\x00\x80\x80\x80";
+  fwrite(ppm, 1, sizeof(ppm) - 1, file);
+  fclose(file);
+
+  slsJobQueue jobs;
+  TEST_ASSERT_NOT_NULL(sls_jobqueue_init(&jobs, 2));
+  slsTextureLoader loader;
+  TEST_ASSERT_NOT_NULL(sls_textureloader_init(&loader, &jobs));
+
+  // usable at once as a placeholder, and shared between requests
+  slsTexture* tex = sls_textureloader_load(&loader, path);
+  TEST_ASSERT_NOT_NULL(tex);
+  TEST_ASSERT_TRUE(tex->id != 0);
+  TEST_ASSERT_TRUE(tex == sls_textureloader_load(&loader, path));
+  slsTexture* missing = sls_textureloader_load(&loader, "test-missing.png");
+  TEST_ASSERT_NOT_NULL(missing);
+
+  sls_textureloader_finish(&loader);
+  TEST_ASSERT_EQUAL(SLS_TEXTURE_READY, sls_texture_state(tex));
+  TEST_ASSERT_EQUAL(3, tex->width);
+  TEST_ASSERT_EQUAL(2, tex->height);
+  TEST_ASSERT_NULL(tex->pixels);
+  TEST_ASSERT_EQUAL(SLS_TEXTURE_FAILED, sls_texture_state(missing));
+  TEST_ASSERT_EQUAL(0, sls_textureloader_pump(&loader, 0));
+
+  // uploads respect the per-call budget
+  char const* copies[] = { "test-loader-a.ppm", "test-loader-b.ppm" };
+  for (size_t i = 0; i < SLS_ARRAY_COUNT(copies); ++i) {
+    file = fopen(copies[i], "wb");
+    fwrite(ppm, 1, sizeof(ppm) - 1, file);
+    fclose(file);
+    sls_textureloader_load(&loader, copies[i]);
+  }
+  sls_jobqueue_wait(&jobs);
+  TEST_ASSERT_EQUAL(1, sls_textureloader_pump(&loader, 1));
+  TEST_ASSERT_EQUAL(1, sls_textureloader_pump(&loader, 1));
+  TEST_ASSERT_EQUAL(0, sls_textureloader_pump(&loader, 1));
+
+  sls_textureloader_dtor(&loader);
+  sls_jobqueue_dtor(&jobs);
+  remove(path);
+  for (size_t i = 0; i < SLS_ARRAY_COUNT(copies); ++i) {
+    remove(copies[i]);
+  }
+}
+
+typedef struct testChunks {
+  size_t grain;
+  size_t count;
+  /** @brief times each item was visited */
+  int* visits;
+  /** @brief ranges that do not start and end on grain boundaries */
+  int n_misaligned;
+  pthread_mutex_t lock;
+} testChunks;
+
+static void test_chunks_fn(void* data, size_t begin, size_t end)
+{
+  testChunks* chunks = data;
+  bool aligned = begin % chunks->grain == 0 &&
+                 (end == begin + chunks->grain ||
+                  (end == chunks->count && end - begin < chunks->grain));
+  pthread_mutex_lock(&chunks->lock);
+  chunks->n_misaligned += !aligned;
+  pthread_mutex_unlock(&chunks->lock);
+  for (size_t i = begin; i < end; ++i) {
+    __atomic_add_fetch(chunks->visits + i, 1, __ATOMIC_RELAXED);
+  }
+}
+
+/**
+ * @brief checks every item is visited once, in grain-sized chunks
+ */
+static void check_parallel_for(slsJobQueue* jobs, size_t count, size_t grain)
+{
+  testChunks chunks = {.grain = grain,
+                       .count = count,
+                       .visits = calloc(count + 1, sizeof(int)) };
+  pthread_mutex_init(&chunks.lock, NULL);
+  sls_jobqueue_parallel_for(jobs, count, grain, test_chunks_fn, &chunks);
+  TEST_ASSERT_EQUAL(0, chunks.n_misaligned);
+  for (size_t i = 0; i < count; ++i) {
+    TEST_ASSERT_EQUAL(1, chunks.visits[i]);
+  }
+  pthread_mutex_destroy(&chunks.lock);
+  free(chunks.visits);
+}
+
+static void test_parallel_for_chunks()
+{
+  slsJobQueue jobs;
+  TEST_ASSERT_NOT_NULL(sls_jobqueue_init(&jobs, 3));
+  check_parallel_for(&jobs, 1000, 64);
+  check_parallel_for(&jobs, 64, 64);
+  check_parallel_for(&jobs, 0, 64);
+  sls_jobqueue_dtor(&jobs);
+
+  // without workers the calling thread still goes chunk by chunk
+  slsJobQueue none = {};
+  check_parallel_for(&none, 1000, 64);
+  check_parallel_for(&none, 5, 2);
+}
+
+static void test_cull()
+{
+  // a 20x10 orthographic view centred on (100, 0)
+  kmMat4 modelview, projection;
+  kmMat4Translation(&modelview, -100.f, 0.f, 0.f);
+  kmMat4OrthographicProjection(&projection, -10.f, 10.f, -5.f, 5.f, -1.f, 1.f);
+  slsCullCamera camera;
+  sls_cull_camera_init(&camera, &modelview, &projection);
+  TEST_ASSERT_FLOAT_WITHIN(1e-3f, 90.f, camera.rect_min.x);
+  TEST_ASSERT_FLOAT_WITHIN(1e-3f, 110.f, camera.rect_max.x);
+  TEST_ASSERT_FLOAT_WITHIN(1e-3f, -5.f, camera.rect_min.y);
+
+  slsCullSet rects;
+  TEST_ASSERT_NOT_NULL(sls_cullset_init(&rects, SLS_CULL_RECT, 0));
+  // a row of half-unit tiles, inset from the integers from x = 0 to 300
+  for (size_t i = 0; i < 300; ++i) {
+    float tile[] = { (float)i + 0.25f, 0.f, (float)i + 0.75f, 1.f };
+    TEST_ASSERT_EQUAL(i, sls_cullset_push(&rects, tile));
+  }
+  uint32_t visible[300];
+  TEST_ASSERT_EQUAL(20, sls_cull(&camera, &rects, visible, NULL));
+  TEST_ASSERT_EQUAL(90, visible[0]);
+  TEST_ASSERT_EQUAL(109, visible[19]);
+
+  // spheres and boxes against a perspective frustum looking down -z
+  kmMat4Identity(&modelview);
+  kmMat4PerspectiveProjection(&projection, 90.f, 1.f, 0.1f, 100.f);
+  sls_cull_camera_init(&camera, &modelview, &projection);
+
+  slsCullSet spheres, boxes;
+  TEST_ASSERT_NOT_NULL(sls_cullset_init(&spheres, SLS_CULL_SPHERE, 4));
+  TEST_ASSERT_NOT_NULL(sls_cullset_init(&boxes, SLS_CULL_AABB, 4));
+  float volumes[][6] = {
+    { 0.f, 0.f, -10.f, 1.f, 1.f, 1.f },   // ahead
+    { 0.f, 0.f, 10.f, 1.f, 1.f, 1.f },    // behind
+    { 30.f, 0.f, -10.f, 1.f, 1.f, 1.f },  // off to the side
+    { 11.5f, 0.f, -10.f, 2.f, 2.f, 2.f }, // straddling the right plane
+    { 0.f, 0.f, -150.f, 1.f, 1.f, 1.f },  // past the far plane
+  };
+  for (size_t i = 0; i < SLS_ARRAY_COUNT(volumes); ++i) {
+    sls_cullset_push(&spheres, volumes[i]);
+    sls_cullset_push(&boxes, volumes[i]);
+  }
+  TEST_ASSERT_EQUAL(2, sls_cull(&camera, &spheres, visible, NULL));
+  TEST_ASSERT_EQUAL(0, visible[0]);
+  TEST_ASSERT_EQUAL(3, visible[1]);
+  TEST_ASSERT_EQUAL(2, sls_cull(&camera, &boxes, visible, NULL));
+  TEST_ASSERT_EQUAL(3, visible[1]);
+
+  // a large set split across workers matches the serial result
+  slsJobQueue jobs;
+  TEST_ASSERT_NOT_NULL(sls_jobqueue_init(&jobs, 3));
+  sls_cullset_clear(&rects);
+  for (size_t i = 0; i < 5 * SLS_CULL_GRAIN + 7; ++i) {
+    float x = (float)((i * 37) % 1000);
+    float tile[] = { x, 0.f, x + 1.f, 1.f };
+    sls_cullset_push(&rects, tile);
+  }
+  kmMat4Translation(&modelview, -100.f, 0.f, 0.f);
+  kmMat4OrthographicProjection(&projection, -10.f, 10.f, -5.f, 5.f, -1.f, 1.f);
+  sls_cull_camera_init(&camera, &modelview, &projection);
+
+  uint32_t* serial = calloc(rects.n, sizeof(uint32_t));
+  uint32_t* parallel = calloc(rects.n, sizeof(uint32_t));
+  size_t n_serial = sls_cull(&camera, &rects, serial, NULL);
+  size_t n_parallel = sls_cull(&camera, &rects, parallel, &jobs);
+  TEST_ASSERT_TRUE(n_serial > 0);
+  TEST_ASSERT_EQUAL(n_serial, n_parallel);
+  for (size_t i = 0; i < n_serial; ++i) {
+    TEST_ASSERT_EQUAL(serial[i], parallel[i]);
+  }
+
+  free(serial);
+  free(parallel);
+  sls_jobqueue_dtor(&jobs);
+  sls_cullset_dtor(&boxes);
+  sls_cullset_dtor(&spheres);
+  sls_cullset_dtor(&rects);
+}
+
+static void test_lightgrid_bin()
+{
+  slsLightGridParams params = {
+    .tiles_x = 8, .tiles_y = 8, .slices = 16, .near = 0.1f, .far = 100.f
+  };
+  slsLightGrid grid;
+  sls_lightgrid_init(&grid, &params);
+  TEST_ASSERT_NOT_NULL(grid.cells);
+  kmMat4 projection, view;
+  kmMat4PerspectiveProjection(&projection, 90.f, 1.f, 0.1f, 100.f);
+  sls_lightgrid_set_projection(&grid, &projection, 800, 800);
+  kmMat4Identity(&view);
+
+  float lights[][4] = {
+    { 0.f, 0.f, -10.f, 1.f },   // ahead, across the middle tiles
+    { 0.f, 0.f, 10.f, 1.f },    // behind
+    { 30.f, 0.f, -10.f, 1.f },  // off to the side
+    { 0.f, 0.f, -150.f, 1.f },  // past far
+    { 3.6f, 0.f, -10.f, 0.3f }, // inside column 5, across rows 3 and 4
+  };
+  kmVec3 white = { 1.f, 1.f, 1.f };
+  for (size_t i = 0; i < SLS_ARRAY_COUNT(lights); ++i) {
+    kmVec3 position = { lights[i][0], lights[i][1], lights[i][2] };
+    TEST_ASSERT_EQUAL(i,
+                      sls_lightgrid_add(&grid, position, lights[i][3], white));
+  }
+  TEST_ASSERT_TRUE(sls_lightgrid_bin(&grid, &view, NULL));
+  TEST_ASSERT_EQUAL(2, grid.stats.n_visible);
+
+  slsLightRange r = grid.ranges[4];
+  TEST_ASSERT_EQUAL(5, r.x0);
+  TEST_ASSERT_EQUAL(5, r.x1);
+  TEST_ASSERT_EQUAL(3, r.y0);
+  TEST_ASSERT_EQUAL(4, r.y1);
+  // log(100) * 16 / log(1000) puts depth 10 in slice 10
+  TEST_ASSERT_EQUAL(10, r.z0);
+  TEST_ASSERT_EQUAL(10, r.z1);
+  r = grid.ranges[0];
+  TEST_ASSERT_TRUE(r.x0 <= 3 && r.x1 >= 4 && r.x1 < 5);
+
+  uint32_t const* cell = grid.cells + 2 * sls_lightgrid_cell(&grid, 5, 4, 10);
+  TEST_ASSERT_EQUAL(1, cell[1]);
+  TEST_ASSERT_EQUAL(4, grid.indices[cell[0]]);
+  cell = grid.cells + 2 * sls_lightgrid_cell(&grid, 3, 3, 10);
+  TEST_ASSERT_EQUAL(1, cell[1]);
+  TEST_ASSERT_EQUAL(0, grid.indices[cell[0]]);
+  cell = grid.cells + 2 * sls_lightgrid_cell(&grid, 0, 0, 0);
+  TEST_ASSERT_EQUAL(0, cell[1]);
+
+  // many lights binned across workers match the serial result
+  sls_lightgrid_clear(&grid);
+  srand(7);
+  for (size_t i = 0; i < 3 * SLS_LIGHTGRID_GRAIN + 5; ++i) {
+    kmVec3 position = { (float)(rand() % 200 - 100),
+                        (float)(rand() % 200 - 100),
+                        -(float)(rand() % 120) };
+    sls_lightgrid_add(&grid, position, (float)(rand() % 8 + 1), white);
+  }
+  TEST_ASSERT_TRUE(sls_lightgrid_bin(&grid, &view, NULL));
+  size_t n_cells = 2 * 8 * 8 * 16;
+  size_t n_indices = grid.stats.n_indices;
+  uint32_t* cells = malloc(n_cells * sizeof(uint32_t));
+  uint32_t* indices = malloc(n_indices * sizeof(uint32_t));
+  memcpy(cells, grid.cells, n_cells * sizeof(uint32_t));
+  memcpy(indices, grid.indices, n_indices * sizeof(uint32_t));
+  TEST_ASSERT_TRUE(n_indices > grid.stats.n_visible);
+
+  slsJobQueue jobs;
+  TEST_ASSERT_NOT_NULL(sls_jobqueue_init(&jobs, 3));
+  TEST_ASSERT_TRUE(sls_lightgrid_bin(&grid, &view, &jobs));
+  TEST_ASSERT_EQUAL(n_indices, grid.stats.n_indices);
+  TEST_ASSERT_EQUAL(0, memcmp(cells, grid.cells, n_cells * sizeof(uint32_t)));
+  TEST_ASSERT_EQUAL(
+    0, memcmp(indices, grid.indices, n_indices * sizeof(uint32_t)));
+
+  free(cells);
+  free(indices);
+  sls_jobqueue_dtor(&jobs);
+  sls_lightgrid_dtor(&grid);
+}
+
+static void test_particles_update()
+{
+  slsParticleEmitter emitter = {
+    .velocity = { 1.f, 0.f, 0.f },
+    .gravity = { 0.f, -10.f, 0.f },
+    .lifetime_min = 1.f,
+    .lifetime_max = 1.f,
+    .size_start = 2.f,
+    .size_end = 4.f,
+    .color_start = 0xff0000ffu,
+    .color_end = 0xff00ff00u,
+  };
+  slsParticleSystem ps;
+  TEST_ASSERT_NOT_NULL(sls_particles_init(&ps, &emitter, 10));
+  TEST_ASSERT_EQUAL(12, ps.capacity);
+  TEST_ASSERT_EQUAL(10, sls_particles_emit(&ps, 10, NULL));
+  TEST_ASSERT_EQUAL(2, sls_particles_emit(&ps, 10, NULL));
+  TEST_ASSERT_EQUAL_FLOAT(1.f, ps.vx[11]);
+  TEST_ASSERT_EQUAL_FLOAT(0.f, ps.px[11]);
+
+  sls_particles_update(&ps, 0.25f, NULL);
+  TEST_ASSERT_EQUAL(12, ps.stats.n_alive);
+  TEST_ASSERT_EQUAL_FLOAT(0.25f, ps.px[0]);
+  TEST_ASSERT_EQUAL_FLOAT(-2.5f, ps.vy[0]);
+  TEST_ASSERT_EQUAL_FLOAT(-0.625f, ps.py[0]);
+  TEST_ASSERT_EQUAL_FLOAT(0.25f, ps.age[0]);
+
+  // vertices interpolate by age: a quarter of the way to the end values
+  slsParticleVertex vertices[12];
+  sls_particles_write_vertices(&ps, vertices, NULL);
+  TEST_ASSERT_EQUAL_FLOAT(0.25f, vertices[11].position[0]);
+  TEST_ASSERT_EQUAL_FLOAT(2.5f, vertices[11].size);
+  TEST_ASSERT_EQUAL(0xff0040bfu, vertices[11].color);
+  // halfway between two values rounds up, with or without SSE
+  ps.emitter.color_start = 0u;
+  ps.emitter.color_end = 0x02060a02u;
+  sls_particles_write_vertices(&ps, vertices, NULL);
+  TEST_ASSERT_EQUAL(0x01020301u, vertices[11].color);
+
+  // the odd particles expire; survivors keep their order
+  for (size_t i = 0; i < ps.n_particles; ++i) {
+    ps.pz[i] = (float)i;
+    ps.lifetime[i] = i % 2 ? 0.4f : 10.f;
+  }
+  sls_particles_update(&ps, 0.25f, NULL);
+  TEST_ASSERT_EQUAL(6, ps.n_particles);
+  TEST_ASSERT_EQUAL(6, ps.stats.n_died);
+  for (size_t i = 0; i < ps.n_particles; ++i) {
+    TEST_ASSERT_EQUAL_FLOAT((float)(2 * i), ps.pz[i]);
+    TEST_ASSERT_EQUAL_FLOAT(0.5f, ps.age[i]);
+  }
+  sls_particles_dtor(&ps);
+
+  // several chunks simulated across workers match the serial result
+  emitter = SLS_PARTICLES_DEFAULT_EMITTER;
+  emitter.extent = (kmVec3){ 1.f, 1.f, 1.f };
+  emitter.lifetime_min = 0.3f;
+  emitter.lifetime_max = 0.9f;
+  emitter.rate = 2.5f * SLS_PARTICLES_GRAIN / 0.2f;
+  slsParticleSystem serial, parallel;
+  size_t capacity = 3 * SLS_PARTICLES_GRAIN + 10;
+  TEST_ASSERT_NOT_NULL(sls_particles_init(&serial, &emitter, capacity));
+  TEST_ASSERT_NOT_NULL(sls_particles_init(&parallel, &emitter, capacity));
+  slsJobQueue jobs;
+  TEST_ASSERT_NOT_NULL(sls_jobqueue_init(&jobs, 3));
+  size_t n_died = 0;
+  for (int frame = 0; frame < 8; ++frame) {
+    sls_particles_update(&serial, 0.2f, NULL);
+    sls_particles_update(&parallel, 0.2f, &jobs);
+    n_died += serial.stats.n_died;
+    TEST_ASSERT_EQUAL(serial.n_particles, parallel.n_particles);
+    size_t size = serial.n_particles * sizeof(float);
+    TEST_ASSERT_EQUAL(0, memcmp(serial.px, parallel.px, size));
+    TEST_ASSERT_EQUAL(0, memcmp(serial.vy, parallel.vy, size));
+    TEST_ASSERT_EQUAL(0, memcmp(serial.age, parallel.age, size));
+    TEST_ASSERT_EQUAL(0, memcmp(serial.lifetime, parallel.lifetime, size));
+  }
+  TEST_ASSERT_TRUE(n_died > 0);
+  TEST_ASSERT_TRUE(serial.n_particles > SLS_PARTICLES_GRAIN);
+  for (size_t i = 0; i < serial.n_particles; ++i) {
+    TEST_ASSERT_TRUE(serial.age[i] < serial.lifetime[i]);
+  }
+
+  sls_jobqueue_dtor(&jobs);
+  sls_particles_dtor(&parallel);
+  sls_particles_dtor(&serial);
+}
+
+/**
+ * @brief checks indices are in range, every vertex is used, and triangles
+ * face away from `center`, or along their vertices' normals if NULL
+ */
+static void check_primitive(slsGeometry const* g, kmVec3 const* center)
+{
+  bool* used = calloc(g->n_vertices, sizeof(bool));
+  for (size_t t = 0; t < g->n_indices; t += 3) {
+    float const* p[3];
+    for (int k = 0; k < 3; ++k) {
+      TEST_ASSERT_TRUE(g->indices[t + k] < g->n_vertices);
+      used[g->indices[t + k]] = true;
+      p[k] = g->vertices[g->indices[t + k]].position;
+    }
+    kmVec3 ab = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+    kmVec3 ac = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+    kmVec3 n;
+    kmVec3Cross(&n, &ab, &ac);
+    kmVec3 out;
+    if (center) {
+      out = (kmVec3){ p[0][0] + p[1][0] + p[2][0] - 3.f * center->x,
+                      p[0][1] + p[1][1] + p[2][1] - 3.f * center->y,
+                      p[0][2] + p[1][2] + p[2][2] - 3.f * center->z };
+    } else {
+      float const* normal = g->vertices[g->indices[t]].normal;
+      out = (kmVec3){ normal[0], normal[1], normal[2] };
+    }
+    TEST_ASSERT_TRUE(n.x * out.x + n.y * out.y + n.z * out.z > 0.f);
+  }
+  for (size_t i = 0; i < g->n_vertices; ++i) {
+    TEST_ASSERT_TRUE(used[i]);
+  }
+  free(used);
+}
+
+static void test_primitives_generate()
+{
+  kmVec3 origin = { 0.f, 0.f, 0.f };
+  slsGeometry g;
+
+  // shared vertices: 12 corners, n - 1 per edge, and each face's inside,
+  // plus copies of those on the u seam
+  slsPrimitiveDesc desc = sls_primitive_icosphere(8);
+  TEST_ASSERT_TRUE(sls_primitive_generate(&g, &desc, NULL));
+  TEST_ASSERT_TRUE(g.n_vertices > 10 * 8 * 8 + 2);
+  TEST_ASSERT_TRUE(g.n_vertices < 10 * 8 * 8 + 2 + 4 * 8);
+  TEST_ASSERT_EQUAL(20 * 8 * 8 * 3, g.n_indices);
+  check_primitive(&g, &origin);
+  // no triangle stretches its texture back across the seam. u is
+  // meaningless at the poles, so their triangles are left out
+  for (size_t t = 0; t < g.n_indices; t += 3) {
+    float lo = 2.f, hi = -1.f;
+    bool pole = false;
+    for (int k = 0; k < 3; ++k) {
+      slsVertex const* v = g.vertices + g.indices[t + k];
+      pole = pole || fabsf(v->position[1]) > 1.f - 1e-6f;
+      lo = fminf(lo, v->uv[0]);
+      hi = fmaxf(hi, v->uv[0]);
+    }
+    TEST_ASSERT_TRUE(pole || hi - lo < 0.25f);
+  }
+  for (size_t i = 0; i < g.n_vertices; ++i) {
+    float const* p = g.vertices[i].position;
+    TEST_ASSERT_FLOAT_WITHIN(
+      1e-5f, 1.f, sqrtf(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]));
+  }
+  slsVertexCacheStats stats = sls_analyze_vertex_cache(
+    g.indices, g.n_indices, g.n_vertices, SLS_VERTEX_CACHE_SIZE);
+  TEST_ASSERT_TRUE(stats.acmr < 0.8f);
+
+  // generated across workers, the result is the same
+  slsJobQueue jobs;
+  TEST_ASSERT_NOT_NULL(sls_jobqueue_init(&jobs, 3));
+  slsGeometry parallel;
+  TEST_ASSERT_TRUE(sls_primitive_generate(&parallel, &desc, &jobs));
+  TEST_ASSERT_EQUAL(g.n_vertices, parallel.n_vertices);
+  TEST_ASSERT_EQUAL(0,
+                    memcmp(g.vertices,
+                           parallel.vertices,
+                           g.n_vertices * sizeof(slsVertex)));
+  TEST_ASSERT_EQUAL(
+    0, memcmp(g.indices, parallel.indices, g.n_indices * sizeof(uint32_t)));
+  sls_geometry_dtor(&parallel);
+  sls_geometry_dtor(&g);
+
+  desc = sls_primitive_uv_sphere(16, 8);
+  TEST_ASSERT_TRUE(sls_primitive_generate(&g, &desc, NULL));
+  TEST_ASSERT_EQUAL(2 + 7 * 17, g.n_vertices);
+  TEST_ASSERT_EQUAL(2 * 16 * 7 * 3, g.n_indices);
+  check_primitive(&g, &origin);
+  sls_geometry_dtor(&g);
+
+  desc = sls_primitive_capsule(12, 6, 2.f);
+  TEST_ASSERT_TRUE(sls_primitive_generate(&g, &desc, NULL));
+  TEST_ASSERT_EQUAL(2 + 6 * 13, g.n_vertices);
+  check_primitive(&g, NULL);
+  float top = 0.f;
+  for (size_t i = 0; i < g.n_vertices; ++i) {
+    top = fmaxf(top, g.vertices[i].position[1]);
+  }
+  TEST_ASSERT_EQUAL_FLOAT(2.f, top);
+  sls_geometry_dtor(&g);
+
+  desc = sls_primitive_box(3);
+  TEST_ASSERT_TRUE(sls_primitive_generate(&g, &desc, &jobs));
+  TEST_ASSERT_EQUAL(6 * 4 * 4, g.n_vertices);
+  TEST_ASSERT_EQUAL(6 * 9 * 6, g.n_indices);
+  check_primitive(&g, &origin);
+  sls_geometry_dtor(&g);
+
+  desc = sls_primitive_plane(200, 100);
+  TEST_ASSERT_TRUE(sls_primitive_generate(&g, &desc, &jobs));
+  TEST_ASSERT_EQUAL(201 * 101, g.n_vertices);
+  check_primitive(&g, NULL);
+  sls_geometry_dtor(&g);
+
+  desc = sls_primitive_capsule(12, 5, 1.f);
+  TEST_ASSERT_FALSE(sls_primitive_generate(&g, &desc, NULL));
+  TEST_ASSERT_NULL(g.vertices);
+
+  // cache keys ignore the parameters a kind does not use
+  char a[96], b[96];
+  slsPrimitiveDesc box = sls_primitive_box(4);
+  sls_primitive_key(&box, a, sizeof(a));
+  box.rings = 9;
+  box.length = 3.f;
+  sls_primitive_key(&box, b, sizeof(b));
+  TEST_ASSERT_EQUAL_STRING(a, b);
+  slsPrimitiveDesc capsule = sls_primitive_capsule(8, 4, 1.f);
+  sls_primitive_key(&capsule, a, sizeof(a));
+  capsule.length = 1.5f;
+  sls_primitive_key(&capsule, b, sizeof(b));
+  TEST_ASSERT_TRUE(strcmp(a, b) != 0);
+
+  // the cache shares one mesh between equal descriptors
+  use_glnull();
+  slsPrimitiveCache cache;
+  TEST_ASSERT_NOT_NULL(sls_primitive_cache_init(&cache, NULL, &jobs));
+  desc = sls_primitive_icosphere(4);
+  slsMesh* mesh = sls_primitive_cache_get(&cache, &desc);
+  TEST_ASSERT_NOT_NULL(mesh);
+  TEST_ASSERT_TRUE(mesh->vbo != 0);
+  TEST_ASSERT_EQUAL(20 * 4 * 4 * 3, mesh->indices.length);
+  TEST_ASSERT_EQUAL_PTR(mesh, sls_primitive_cache_get(&cache, &desc));
+  TEST_ASSERT_EQUAL(1, cache.n_generated);
+  TEST_ASSERT_EQUAL(1, cache.n_hits);
+  desc = sls_primitive_icosphere(5);
+  TEST_ASSERT_TRUE(mesh != sls_primitive_cache_get(&cache, &desc));
+  TEST_ASSERT_EQUAL(2, cache.n_generated);
+  desc = sls_primitive_capsule(12, 5, 1.f);
+  TEST_ASSERT_NULL(sls_primitive_cache_get(&cache, &desc));
+  TEST_ASSERT_EQUAL(2, cache.n_generated);
+  sls_primitive_cache_dtor(&cache);
+  TEST_ASSERT_EQUAL(0, cache.n_generated);
+
+  // the legacy disc writes its vertices
+  kmVec4 red = { 1.f, 0.f, 0.f, 1.f };
+  slsVertex* disc = sls_sphere_vertices(4, &red);
+  TEST_ASSERT_EQUAL_FLOAT(1.f, disc[1].position[1]);
+  TEST_ASSERT_EQUAL_FLOAT(1.f, disc[3].color[0]);
+  free(disc);
+
+  sls_jobqueue_dtor(&jobs);
+}
+
+/**
+ * @brief checks a simplified index list is valid and has no degenerate
+ * triangles
+ */
+static void check_simplified(uint32_t const* indices,
+                             size_t n_indices,
+                             slsGeometry const* g)
+{
+  TEST_ASSERT_EQUAL(0, n_indices % 3);
+  for (size_t t = 0; t < n_indices; t += 3) {
+    uint32_t const* tri = indices + t;
+    TEST_ASSERT_TRUE(tri[0] < g->n_vertices && tri[1] < g->n_vertices &&
+                     tri[2] < g->n_vertices);
+    TEST_ASSERT_TRUE(tri[0] != tri[1] && tri[1] != tri[2] &&
+                     tri[2] != tri[0]);
+  }
+}
+
+static void test_simplify_lod()
+{
+  slsGeometry g;
+  slsPrimitiveDesc desc = sls_primitive_icosphere(16);
+  TEST_ASSERT_TRUE(sls_primitive_generate(&g, &desc, NULL));
+
+  // a quarter of the triangles of a closed sphere, still facing outward
+  float error = -1.f;
+  size_t target = g.n_indices / 4;
+  uint32_t* dst = malloc(g.n_indices * sizeof(uint32_t));
+  size_t n = sls_simplify(
+    dst, g.indices, g.n_indices, g.vertices, g.n_vertices, target, 1.f, &error);
+  TEST_ASSERT_TRUE(n > 0 && n <= target);
+  check_simplified(dst, n, &g);
+  for (size_t t = 0; t < n; t += 3) {
+    float const* p[3];
+    for (int k = 0; k < 3; ++k) {
+      p[k] = g.vertices[dst[t + k]].position;
+    }
+    kmVec3 ab = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+    kmVec3 ac = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+    kmVec3 normal;
+    kmVec3Cross(&normal, &ab, &ac);
+    TEST_ASSERT_TRUE(normal.x * p[0][0] + normal.y * p[0][1] +
+                       normal.z * p[0][2] >
+                     0.f);
+  }
+  TEST_ASSERT_TRUE(error > 0.f && error < 0.05f);
+
+  // no error allowed on a curved surface, nothing collapses
+  n = sls_simplify(
+    dst, g.indices, g.n_indices, g.vertices, g.n_vertices, target, 0.f, NULL);
+  TEST_ASSERT_EQUAL(g.n_indices, n);
+  free(dst);
+
+  // a level of detail chain appended to the mesh's own indices
+  slsMesh mesh = {.vertices = { g.vertices, g.n_vertices },
+                  .indices = { g.indices, g.n_indices },
+                  .gl_draw_mode = GL_TRIANGLES,
+                  .has_shadow = true };
+  float ratios[] = { 0.5f, 0.25f, 0.1f, 0.02f };
+  slsLodChain chain;
+  TEST_ASSERT_TRUE(sls_lodchain_build(
+    &chain, &mesh, ratios, (int)SLS_ARRAY_COUNT(ratios), 0.2f));
+  TEST_ASSERT_TRUE(chain.n_lods > 2);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 1.f, chain.radius);
+  size_t expected_first = 0;
+  for (int lod = 0; lod < chain.n_lods; ++lod) {
+    slsMeshLod const* level = chain.lods + lod;
+    TEST_ASSERT_EQUAL(expected_first, level->first_index);
+    check_simplified(mesh.indices.data + level->first_index,
+                     level->n_indices,
+                     &g);
+    if (lod > 0) {
+      TEST_ASSERT_TRUE(level->n_indices < level[-1].n_indices);
+      TEST_ASSERT_TRUE(level->error >= level[-1].error);
+    }
+    expected_first += level->n_indices;
+  }
+  TEST_ASSERT_EQUAL(expected_first, mesh.indices.length);
+  g.indices = mesh.indices.data;
+  sls_geometry_dtor(&g);
+
+  // coarser levels as the mesh shrinks on screen
+  chain = (slsLodChain){.n_lods = 3, .radius = 1.f };
+  chain.lods[1].error = 0.01f;
+  chain.lods[2].error = 0.05f;
+  TEST_ASSERT_EQUAL(0, sls_lodchain_select(&chain, 1000.f, 1.f));
+  TEST_ASSERT_EQUAL(1, sls_lodchain_select(&chain, 50.f, 1.f));
+  TEST_ASSERT_EQUAL(2, sls_lodchain_select(&chain, 10.f, 1.f));
+
+  // radius 1 at distance 10 with a 90 degree field of view
+  kmMat4 modelview, projection;
+  kmMat4Translation(&modelview, 0.f, 0.f, -10.f);
+  kmMat4PerspectiveProjection(&projection, 90.f, 1.f, 0.1f, 100.f);
+  TEST_ASSERT_FLOAT_WITHIN(
+    0.01f,
+    50.f,
+    sls_lodchain_screen_radius(&chain, &modelview, &projection, 1000.f));
+  kmMat4Translation(&modelview, 0.f, 0.f, -0.5f);
+  TEST_ASSERT_TRUE(
+    sls_lodchain_screen_radius(&chain, &modelview, &projection, 1000.f) >
+    1e30f);
+
+  // seams and borders stay where they are
+  desc = sls_primitive_plane(16, 16);
+  TEST_ASSERT_TRUE(sls_primitive_generate(&g, &desc, NULL));
+  dst = malloc(g.n_indices * sizeof(uint32_t));
+  n = sls_simplify(
+    dst, g.indices, g.n_indices, g.vertices, g.n_vertices, 6, 0.f, &error);
+  check_simplified(dst, n, &g);
+  TEST_ASSERT_TRUE(n < g.n_indices / 4);
+  TEST_ASSERT_EQUAL_FLOAT(0.f, error);
+  bool* used = calloc(g.n_vertices, sizeof(bool));
+  for (size_t i = 0; i < n; ++i) {
+    used[dst[i]] = true;
+  }
+  for (size_t i = 0; i < g.n_vertices; ++i) {
+    float const* p = g.vertices[i].position;
+    if (fabsf(p[0]) == 1.f || fabsf(p[1]) == 1.f) {
+      TEST_ASSERT_TRUE(used[i]);
+    }
+  }
+  free(used);
+
+  // identical copies of a vertex are not a seam, and move as one
+  slsVertex* doubled = malloc(2 * g.n_vertices * sizeof(slsVertex));
+  memcpy(doubled, g.vertices, g.n_vertices * sizeof(slsVertex));
+  memcpy(doubled + g.n_vertices, g.vertices, g.n_vertices * sizeof(slsVertex));
+  uint32_t* split = malloc(g.n_indices * sizeof(uint32_t));
+  for (size_t i = 0; i < g.n_indices; ++i) {
+    split[i] = g.indices[i] + (i / 3 % 2 ? (uint32_t)g.n_vertices : 0);
+  }
+  n = sls_simplify(
+    dst, split, g.n_indices, doubled, 2 * g.n_vertices, 6, 0.f, NULL);
+  TEST_ASSERT_TRUE(n < g.n_indices / 4);
+  for (size_t i = 0; i < n; ++i) {
+    TEST_ASSERT_TRUE(dst[i] < 2 * g.n_vertices);
+  }
+  free(split);
+  free(doubled);
+  free(dst);
+  sls_geometry_dtor(&g);
+
+  desc = sls_primitive_uv_sphere(16, 8);
+  TEST_ASSERT_TRUE(sls_primitive_generate(&g, &desc, NULL));
+  dst = malloc(g.n_indices * sizeof(uint32_t));
+  n = sls_simplify(
+    dst, g.indices, g.n_indices, g.vertices, g.n_vertices, 0, 1.f, NULL);
+  check_simplified(dst, n, &g);
+  used = calloc(g.n_vertices, sizeof(bool));
+  for (size_t i = 0; i < n; ++i) {
+    used[dst[i]] = true;
+  }
+  for (size_t i = 0; i < g.n_vertices; ++i) {
+    if (g.vertices[i].uv[0] == 0.f || g.vertices[i].uv[0] == 1.f) {
+      TEST_ASSERT_TRUE(used[i]);
+    }
+  }
+  free(used);
+  free(dst);
+  sls_geometry_dtor(&g);
+}
+
+static void test_renderscale_feed()
+{
+  slsRenderScale rs;
+  sls_renderscale_init(&rs, &SLS_RENDERSCALE_DEFAULT_PARAMS);
+  rs.output_width = 1920;
+  rs.output_height = 1080;
+  TEST_ASSERT_EQUAL_FLOAT(1.f, rs.scale);
+
+  // a single spike in steady frames is absorbed
+  for (int i = 0; i < 10; ++i) {
+    TEST_ASSERT_FALSE(sls_renderscale_feed(&rs, 8.0));
+  }
+  TEST_ASSERT_FALSE(sls_renderscale_feed(&rs, 40.0));
+  for (int i = 0; i < 10; ++i) {
+    TEST_ASSERT_FALSE(sls_renderscale_feed(&rs, 8.0));
+  }
+  TEST_ASSERT_EQUAL_FLOAT(1.f, rs.scale);
+
+  // sustained overload drops the scale, one step at a time, to the floor
+  int n_changes = 0;
+  for (int i = 0; i < 200; ++i) {
+    n_changes += sls_renderscale_feed(&rs, 30.0);
+  }
+  TEST_ASSERT_EQUAL(5, n_changes);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.5f, rs.scale);
+  int width, height;
+  sls_renderscale_size(&rs, &width, &height);
+  TEST_ASSERT_EQUAL(960, width);
+  TEST_ASSERT_EQUAL(540, height);
+
+  // just under budget is inside the hysteresis band: no change
+  for (int i = 0; i < 200; ++i) {
+    TEST_ASSERT_FALSE(sls_renderscale_feed(&rs, 13.0));
+  }
+  // comfortably under budget climbs back, slower than it fell
+  int n_samples = 1;
+  while (!sls_renderscale_feed(&rs, 5.0)) {
+    n_samples++;
+  }
+  TEST_ASSERT_TRUE(n_samples >= SLS_RENDERSCALE_DEFAULT_PARAMS.samples_up);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.6f, rs.scale);
+
+  // frames in flight at a change still report the old scale's time, and
+  // must not step the scale down a second time
+  sls_renderscale_init(&rs, &SLS_RENDERSCALE_DEFAULT_PARAMS);
+  n_changes = 0;
+  for (int i = 0; i < SLS_RENDERSCALE_DEFAULT_PARAMS.samples_down; ++i) {
+    n_changes += sls_renderscale_feed(&rs, 20.0);
+  }
+  TEST_ASSERT_EQUAL(1, n_changes);
+  for (int i = 0; i < SLS_PROFILER_LATENCY; ++i) {
+    TEST_ASSERT_FALSE(sls_renderscale_feed(&rs, 20.0));
+  }
+  for (int i = 0; i < 20; ++i) {
+    TEST_ASSERT_FALSE(sls_renderscale_feed(&rs, 13.0));
+  }
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.9f, rs.scale);
+}
+
+static void test_renderscale_profiler()
+{
+  use_glnull();
+  static slsProfiler prof;
+  sls_profiler_init(&prof, true);
+  TEST_ASSERT_TRUE(prof.gpu_enabled);
+
+  slsRenderScaleParams params = SLS_RENDERSCALE_DEFAULT_PARAMS;
+  params.samples_up = 2;
+  slsRenderScale rs;
+  sls_renderscale_init(&rs, &params);
+  rs.scale = 0.5f;
+
+  // frames nest their scopes like sls_context_display. The null backend
+  // times everything at 0 ms, under budget
+  int n_fed = 0;
+  bool changed = false;
+  for (int frame = 0; !changed && frame < 2 * SLS_PROFILER_LATENCY; ++frame) {
+    sls_profiler_begin_frame(&prof);
+    sls_profiler_begin(&prof, "texture uploads");
+    sls_profiler_end(&prof);
+    sls_profiler_begin(&prof, "scene");
+    sls_profiler_end(&prof);
+    sls_profiler_end_frame(&prof);
+
+    int n_under = rs.n_under;
+    changed = sls_renderscale_feed_profiler(&rs, &prof, "scene");
+    n_fed += changed || rs.n_under != n_under;
+    // a sample is only fed once
+    n_under = rs.n_under;
+    TEST_ASSERT_FALSE(sls_renderscale_feed_profiler(&rs, &prof, "scene"));
+    TEST_ASSERT_EQUAL(n_under, rs.n_under);
+  }
+  TEST_ASSERT_TRUE(changed);
+  TEST_ASSERT_EQUAL(2, n_fed);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.6f, rs.scale);
+  TEST_ASSERT_FALSE(sls_renderscale_feed_profiler(&rs, &prof, "missing"));
+
+  sls_profiler_dtor(&prof);
+}
+
+static void test_rendergraph_compile()
+{
+  slsRenderGraph graph;
+  sls_rendergraph_init(&graph);
+
+  for (int frame = 0; frame < 2; ++frame) {
+    sls_rendergraph_begin(&graph, 1280, 720);
+    slsRGResource backbuffer =
+      sls_rendergraph_import_framebuffer(&graph, "backbuffer", 0, 1280, 720);
+    slsRGResource color = sls_rendergraph_create_texture(
+      &graph, "gbuffer_color", (slsRGTextureDesc){.internal_format = GL_RGBA8 });
+    slsRGResource depth = sls_rendergraph_create_texture(
+      &graph,
+      "depth",
+      (slsRGTextureDesc){.internal_format = GL_DEPTH_COMPONENT24 });
+    slsRGResource hdr = sls_rendergraph_create_texture(
+      &graph, "hdr", (slsRGTextureDesc){.internal_format = GL_RGBA16F });
+    slsRGResource bloom = sls_rendergraph_create_texture(
+      &graph,
+      "bloom",
+      (slsRGTextureDesc){.scale = 0.5f, .internal_format = GL_RGBA16F });
+    slsRGResource ldr = sls_rendergraph_create_texture(
+      &graph, "ldr", (slsRGTextureDesc){.internal_format = GL_RGBA8 });
+
+    int gbuffer = sls_rendergraph_add_pass(&graph, "gbuffer", NULL, NULL);
+    sls_rendergraph_write(&graph, gbuffer, color);
+    sls_rendergraph_write_depth(&graph, gbuffer, depth);
+    int lighting = sls_rendergraph_add_pass(&graph, "lighting", NULL, NULL);
+    sls_rendergraph_read(&graph, lighting, color);
+    sls_rendergraph_read(&graph, lighting, depth);
+    sls_rendergraph_write(&graph, lighting, hdr);
+    // nothing reads the bloom, so the pass is culled
+    int blur = sls_rendergraph_add_pass(&graph, "bloom", NULL, NULL);
+    sls_rendergraph_read(&graph, blur, hdr);
+    sls_rendergraph_write(&graph, blur, bloom);
+    int tonemap = sls_rendergraph_add_pass(&graph, "tonemap", NULL, NULL);
+    sls_rendergraph_read(&graph, tonemap, hdr);
+    sls_rendergraph_write(&graph, tonemap, ldr);
+    int fxaa = sls_rendergraph_add_pass(&graph, "fxaa", NULL, NULL);
+    sls_rendergraph_read(&graph, fxaa, ldr);
+    sls_rendergraph_write(&graph, fxaa, backbuffer);
+
+    TEST_ASSERT_TRUE(sls_rendergraph_compile(&graph));
+    TEST_ASSERT_EQUAL(4, graph.n_order);
+    TEST_ASSERT_EQUAL(gbuffer, graph.order[0]);
+    TEST_ASSERT_EQUAL(lighting, graph.order[1]);
+    TEST_ASSERT_EQUAL(tonemap, graph.order[2]);
+    TEST_ASSERT_EQUAL(fxaa, graph.order[3]);
+    TEST_ASSERT_TRUE(graph.culled[blur]);
+    TEST_ASSERT_EQUAL(1, graph.stats.n_culled);
+
+    // the G-buffer color is dead once lit, so the LDR image takes its place
+    TEST_ASSERT_EQUAL(graph.physical_of[color], graph.physical_of[ldr]);
+    TEST_ASSERT_EQUAL(-1, graph.physical_of[bloom]);
+    TEST_ASSERT_EQUAL(4, graph.stats.n_transients);
+    TEST_ASSERT_EQUAL(3, graph.stats.n_physical);
+    TEST_ASSERT_TRUE(graph.stats.aliased_bytes < graph.stats.unaliased_bytes);
+    // the second, identical frame reuses the first one's compilation
+    TEST_ASSERT_EQUAL(frame, graph.stats.n_cached);
+  }
+
+  // a transient read before any pass writes it
+  sls_rendergraph_begin(&graph, 1280, 720);
+  slsRGResource orphan = sls_rendergraph_create_texture(
+    &graph, "orphan", (slsRGTextureDesc){.internal_format = GL_RGBA8 });
+  slsRGResource out = sls_rendergraph_import_framebuffer(
+    &graph, "backbuffer", 0, 1280, 720);
+  int pass = sls_rendergraph_add_pass(&graph, "blit", NULL, NULL);
+  sls_rendergraph_read(&graph, pass, orphan);
+  sls_rendergraph_write(&graph, pass, out);
+  TEST_ASSERT_FALSE(sls_rendergraph_compile(&graph));
+
+  // the graph never executed, so it owns no GL objects
+  TEST_ASSERT_EQUAL(0, graph.n_fbos);
+}
+
+static void test_postfx_fusion()
+{
+  slsShaderLibrary lib;
+  sls_shaderlib_init(&lib, NULL, NULL);
+  slsPostFx fx;
+  sls_postfx_init(&fx, &lib);
+
+  slsPostFxEffect effects[] = {
+    {.name = "glow",
+     .kind = SLS_POSTFX_BLUR,
+     .source = "uniform sampler2D glow_tex;\n"
+               "vec4 glow_prefilter(vec4 c) { return c; }\n"
+               "vec4 glow(vec4 c, vec2 uv) { return c; }\n",
+     .scale = 0.25f,
+     .iterations = 1 },
+    {.name = "expose",
+     .kind = SLS_POSTFX_PIXEL,
+     .source = "vec4 expose(vec4 c, vec2 uv) { return c * 2.0; }\n" },
+    {.name = "tint",
+     .kind = SLS_POSTFX_PIXEL,
+     .source = "vec4 tint(vec4 c, vec2 uv) { return c; }\n" },
+    {.name = "smooth",
+     .kind = SLS_POSTFX_NEIGHBORHOOD,
+     .source = "vec4 smooth(sampler2D s, vec2 uv, vec2 t) "
+               "{ return texture(s, uv); }\n" },
+    {.name = "dither",
+     .kind = SLS_POSTFX_PIXEL,
+     .source = "vec4 dither(vec4 c, vec2 uv) { return c; }\n" },
+  };
+  for (size_t i = 0; i < SLS_ARRAY_COUNT(effects); ++i) {
+    TEST_ASSERT_EQUAL((int)i, sls_postfx_add(&fx, effects + i));
+  }
+  TEST_ASSERT_EQUAL(-1, sls_postfx_add(&fx, effects + 1));
+
+  // the blur composite fuses with the per-pixel effects after it, and the
+  // neighborhood effect needs a texture, so it starts the second pass
+  TEST_ASSERT_EQUAL(2, sls_postfx_plan(&fx));
+  TEST_ASSERT_EQUAL(3, fx.groups[0].n_effects);
+  TEST_ASSERT_EQUAL(2, fx.groups[1].n_effects);
+  TEST_ASSERT_EQUAL_STRING("postfx/glow+expose+tint", fx.groups[0].key);
+  TEST_ASSERT_EQUAL(5, fx.stats.n_unfused);
+  TEST_ASSERT_EQUAL(2, fx.stats.n_fullscreen);
+  // two halvings to a quarter, then one horizontal and vertical pair
+  TEST_ASSERT_EQUAL(4, fx.stats.n_reduced);
+
+  char* source = sls_postfx_group_source(&fx, 1);
+  TEST_ASSERT_NOT_NULL(
+    strstr(source, "vec4 color = smooth(postfx_src, frag_uv, postfx_texel);"));
+  TEST_ASSERT_NOT_NULL(strstr(source, "color = dither(color, frag_uv);"));
+  free(source);
+
+  source = sls_postfx_group_source(&fx, 0);
+  char const* glow = strstr(source, "color = glow(color, frag_uv);");
+  char const* expose = strstr(source, "color = expose(color, frag_uv);");
+  char const* tint = strstr(source, "color = tint(color, frag_uv);");
+  TEST_ASSERT_TRUE(glow && expose && tint && glow < expose && expose < tint);
+  // the effect sources are registered as includes of the library
+  char* resolved = sls_shaderlib_preprocess(&lib, source, NULL, 0, 0, NULL);
+  TEST_ASSERT_NOT_NULL(resolved);
+  TEST_ASSERT_NOT_NULL(strstr(resolved, "return c * 2.0;"));
+  free(resolved);
+  free(source);
+
+  // without the neighborhood effect, everything fuses into one pass
+  sls_postfx_set_enabled(&fx, 3, false);
+  TEST_ASSERT_FALSE(fx.planned);
+  TEST_ASSERT_EQUAL(1, sls_postfx_plan(&fx));
+  TEST_ASSERT_EQUAL(4, fx.groups[0].n_effects);
+
+  // a blur after a per-pixel effect must read its result from a texture
+  sls_postfx_dtor(&fx);
+  sls_postfx_init(&fx, &lib);
+  sls_postfx_add(&fx, effects + 1);
+  sls_postfx_add(&fx, effects + 0);
+  TEST_ASSERT_EQUAL(2, sls_postfx_plan(&fx));
+
+  sls_postfx_dtor(&fx);
+  sls_shaderlib_dtor(&lib);
+}
+
+static void test_profile_stats()
+{
+  slsProfileHistory history = {};
+  // overflow the ring so the oldest samples are discarded
+  for (size_t i = 0; i < SLS_PROFILER_HISTORY + 100; ++i) {
+    history.samples[history.head] = (double)(i % 100);
+    history.head = (history.head + 1) % SLS_PROFILER_HISTORY;
+    history.n_samples = history.n_samples < SLS_PROFILER_HISTORY
+                          ? history.n_samples + 1
+                          : SLS_PROFILER_HISTORY;
+  }
+
+  slsProfileStats stats = sls_profile_history_stats(&history);
+  TEST_ASSERT_EQUAL_FLOAT(0.0, stats.min);
+  // 0..99 twice, then 0..39: the 238th of 240 sorted samples is 98
+  TEST_ASSERT_EQUAL_FLOAT(98.0, stats.p99);
+  TEST_ASSERT_EQUAL_FLOAT(39.0, stats.last);
+  TEST_ASSERT_TRUE(stats.avg > 40.0 && stats.avg < 50.0);
+
+  slsProfileHistory empty = {};
+  stats = sls_profile_history_stats(&empty);
+  TEST_ASSERT_EQUAL_FLOAT(0.0, stats.avg);
+}
+
+#ifdef SLS_HAVE_EGL
+static void test_headless_smoke()
+{
+  // machines without a usable EGL driver skip the test
+  slsHeadlessGL gl;
+  if (!sls_headless_init(&gl, 8, 4)) {
+    TEST_ASSERT_TRUE(sls_glnull_load());
+    TEST_IGNORE_MESSAGE("no usable EGL display");
+  }
+  TEST_ASSERT_TRUE(sls_headless_available());
+  TEST_ASSERT_NOT_NULL(glGetString(GL_VERSION));
+
+  glViewport(0, 0, gl.width, gl.height);
+  glClearColor(1.f, 0.f, 1.f, 1.f);
+  glClear(GL_COLOR_BUFFER_BIT);
+  sls_headless_present(&gl);
+
+  uint8_t pixels[8 * 4 * 4];
+  sls_headless_read_pixels(&gl, pixels);
+  uint8_t magenta[4] = { 255, 0, 255, 255 };
+  TEST_ASSERT_EQUAL_MEMORY(magenta, pixels, sizeof(magenta));
+  TEST_ASSERT_EQUAL_MEMORY(
+    magenta, pixels + sizeof(pixels) - sizeof(magenta), sizeof(magenta));
+  TEST_ASSERT_EQUAL(GL_NO_ERROR, glGetError());
+
+  sls_headless_dtor(&gl);
+  // GL calls in later tests go to the null backend again
+  TEST_ASSERT_TRUE(sls_glnull_load());
+}
+#endif
+
+int renderer_tests_main()
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_vertex_cache_optimize);
+  RUN_TEST(test_vertex_fetch_optimize);
+  RUN_TEST(test_vertex_format_pack);
+  RUN_TEST(test_shader_preprocess);
+  RUN_TEST(test_shadercache_binaries);
+  RUN_TEST(test_shadercache_async);
+  RUN_TEST(test_skyline_pack);
+  RUN_TEST(test_texcook_container);
+  RUN_TEST(test_profile_stats);
+  RUN_TEST(test_gllog_analyze);
+  RUN_TEST(test_glnull_buffers);
+  RUN_TEST(test_streambuffer_alloc);
+  RUN_TEST(test_uniform_ring);
+  RUN_TEST(test_tilemap_chunks);
+  RUN_TEST(test_geom_freelist);
+  RUN_TEST(test_geompool_commands);
+  RUN_TEST(test_tlsf_defrag);
+  RUN_TEST(test_jobqueue_submit);
+  RUN_TEST(test_parallel_for_chunks);
+  RUN_TEST(test_textureloader_decode);
+  RUN_TEST(test_cull);
+  RUN_TEST(test_lightgrid_bin);
+  RUN_TEST(test_renderscale_feed);
+  RUN_TEST(test_renderscale_profiler);
+  RUN_TEST(test_rendergraph_compile);
+  RUN_TEST(test_postfx_fusion);
+  RUN_TEST(test_particles_update);
+  RUN_TEST(test_primitives_generate);
+  RUN_TEST(test_simplify_lod);
+#ifdef SLS_HAVE_EGL
+  RUN_TEST(test_headless_smoke);
+#endif
+
+  return UNITY_END();
+}
@@ -0,0 +1,148 @@
+/**
+ * @file sls-glstat.c
+ * @brief summarises a GL command log recorded with SLS_GL_CAPTURE
+ *
+ * usage: sls-glstat [-f] [-t count] [-c calls] [-r redundant] log.slsgl
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#include <renderer/slsglrecord.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void usage(char const* program)
+{
+  fprintf(stderr,
+          "usage: %s [-f] [-t count] [-c calls] [-r redundant] log%s\n"
+          "  -f  print every frame\n"
+          "  -t  functions listed, by call count, default 15\n"
+          "  -c  fail if a frame makes more GL calls\n"
+          "  -r  fail if a frame makes more redundant state changes\n"
+          "limits skip the first frame, which includes loading\n",
+          program,
+          SLS_GLLOG_EXTENSION);
+}
+
+static int cmp_funcs(void const* a, void const* b)
+{
+  slsGLFuncStats const* x = a;
+  slsGLFuncStats const* y = b;
+  return x->calls < y->calls ? 1 : (x->calls > y->calls ? -1 : 0);
+}
+
+static void print_frame(char const* label, slsGLFrameStats const* f)
+{
+  printf("%-8s %10llu %8llu %10llu %10llu %14llu %14llu\n",
+         label,
+         (unsigned long long)f->calls,
+         (unsigned long long)f->draws,
+         (unsigned long long)f->state_changes,
+         (unsigned long long)f->redundant,
+         (unsigned long long)f->buffer_bytes,
+         (unsigned long long)f->texture_bytes);
+}
+
+int main(int argc, char** argv)
+{
+  char const* path = NULL;
+  bool per_frame = false;
+  long top = 15;
+  long max_calls = -1, max_redundant = -1;
+
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "-f") == 0) {
+      per_frame = true;
+    } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+      top = strtol(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+      max_calls = strtol(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+      max_redundant = strtol(argv[++i], NULL, 10);
+    } else if (!path) {
+      path = argv[i];
+    } else {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (!path) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  slsGLLogStats stats;
+  if (!sls_gllog_analyze_file(&stats, path)) {
+    fprintf(stderr, "could not analyze %s\n", path);
+    return EXIT_FAILURE;
+  }
+
+  printf("%-8s %10s %8s %10s %10s %14s %14s\n",
+         "frame",
+         "calls",
+         "draws",
+         "changes",
+         "redundant",
+         "buffer bytes",
+         "texture bytes");
+  if (per_frame) {
+    for (size_t i = 0; i < stats.n_frames; ++i) {
+      char label[32];
+      snprintf(label, sizeof(label), "%zu", i);
+      print_frame(label, stats.frames + i);
+    }
+  }
+  print_frame("total", &stats.total);
+
+  if (stats.n_frames > 0) {
+    slsGLFrameStats avg = stats.total;
+    uint64_t n = stats.n_frames;
+    avg.calls /= n;
+    avg.draws /= n;
+    avg.state_changes /= n;
+    avg.redundant /= n;
+    avg.buffer_bytes /= n;
+    avg.texture_bytes /= n;
+    print_frame("average", &avg);
+  }
+
+  qsort(stats.funcs, stats.n_funcs, sizeof(*stats.funcs), cmp_funcs);
+  printf("\n%-40s %10s %10s\n", "function", "calls", "redundant");
+  for (size_t i = 0; i < stats.n_funcs && (long)i < top; ++i) {
+    slsGLFuncStats const* func = stats.funcs + i;
+    if (func->calls == 0) {
+      break;
+    }
+    printf("%-40s %10llu %10llu\n",
+           func->name,
+           (unsigned long long)func->calls,
+           (unsigned long long)func->redundant);
+  }
+
+  int res = EXIT_SUCCESS;
+  for (size_t i = 1; i < stats.n_frames; ++i) {
+    slsGLFrameStats const* f = stats.frames + i;
+    if (max_calls >= 0 && f->calls > (uint64_t)max_calls) {
+      fprintf(stderr,
+              "frame %zu makes %llu GL calls, limit %ld\n",
+              i,
+              (unsigned long long)f->calls,
+              max_calls);
+      res = EXIT_FAILURE;
+    }
+    if (max_redundant >= 0 && f->redundant > (uint64_t)max_redundant) {
+      fprintf(stderr,
+              "frame %zu makes %llu redundant state changes, limit %ld\n",
+              i,
+              (unsigned long long)f->redundant,
+              max_redundant);
+      res = EXIT_FAILURE;
+    }
+  }
+
+  sls_gllog_stats_dtor(&stats);
+  return res;
+}
@@ -0,0 +1,99 @@
+/**
+ * @file sls-texcook.c
+ * @brief converts images to cooked .slstex containers
+ *
+ * usage: sls-texcook [-f rgba8|bc1|bc3] [-p] [-n] input output.slstex
+ *
+ * Copyright (c) 2015-present, Steven Shea
+ * All rights reserved.
+ **/
+
+#include <renderer/slstexcook.h>
+#include <sls-imagelib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void usage(char const* program)
+{
+  fprintf(stderr,
+          "usage: %s [-f rgba8|bc1|bc3] [-p] [-n] input output%s\n"
+          "  -f  storage format, default rgba8\n"
+          "  -p  premultiply alpha\n"
+          "  -n  no mip chain\n",
+          program,
+          SLS_TEXFILE_EXTENSION);
+}
+
+int main(int argc, char** argv)
+{
+  slsTexCookOptions options = {.format = SLS_TEXFORMAT_RGBA8 };
+  char const* input = NULL;
+  char const* output = NULL;
+
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+      char const* name = argv[++i];
+      if (strcmp(name, "rgba8") == 0) {
+        options.format = SLS_TEXFORMAT_RGBA8;
+      } else if (strcmp(name, "bc1") == 0) {
+        options.format = SLS_TEXFORMAT_BC1;
+      } else if (strcmp(name, "bc3") == 0) {
+        options.format = SLS_TEXFORMAT_BC3;
+      } else {
+        fprintf(stderr, "unknown format %s\n", name);
+        return EXIT_FAILURE;
+      }
+    } else if (strcmp(argv[i], "-p") == 0) {
+      options.premultiply = true;
+    } else if (strcmp(argv[i], "-n") == 0) {
+      options.no_mips = true;
+    } else if (!input) {
+      input = argv[i];
+    } else if (!output) {
+      output = argv[i];
+    } else {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (!input || !output) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  // GL expects the bottom row first
+  stbi_set_flip_vertically_on_load(true);
+  int width = 0, height = 0, channels = 0;
+  unsigned char* pixels =
+    stbi_load(input, &width, &height, &channels, STBI_rgb_alpha);
+  if (!pixels) {
+    fprintf(stderr, "could not decode %s: %s\n", input, stbi_failure_reason());
+    return EXIT_FAILURE;
+  }
+
+  size_t size = 0;
+  void* file = sls_texcook_build(
+    pixels, (uint32_t)width, (uint32_t)height, &options, &size);
+  stbi_image_free(pixels);
+  if (!file) {
+    fprintf(stderr, "could not cook %s\n", input);
+    return EXIT_FAILURE;
+  }
+
+  FILE* fp = fopen(output, "wb");
+  bool ok = fp && fwrite(file, 1, size, fp) == size;
+  if (fp) {
+    ok = fclose(fp) == 0 && ok;
+  }
+  free(file);
+
+  if (!ok) {
+    fprintf(stderr, "could not write %s\n", output);
+    return EXIT_FAILURE;
+  }
+
+  printf("%s: %dx%d, %lu bytes\n", output, width, height, (unsigned long)size);
+  return EXIT_SUCCESS;
+}